@@ -0,0 +1,99 @@
+//
+// Created by alex on 5/5/25.
+//
+
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Benchmark.h"
+#include "TlsfAllocator.h"
+
+// Range allocator behind the GPU memory blocks and the geometry pool. The stress run checks its invariants and
+// fails the benchmark run if one is broken.
+namespace Bcg {
+    namespace {
+        constexpr uint64_t Capacity = 256ull << 20;
+        constexpr uint32_t Operations = 100000; // Allocations, every one is freed again
+        constexpr uint32_t MaxLive = 8192;
+        constexpr uint64_t MaxSize = 16384;
+        constexpr uint64_t Alignments[] = {1, 4, 16, 256, 4096};
+
+        void check(bool condition, const std::string &message) {
+            if (!condition) throw std::runtime_error("Tlsf/stress: " + message);
+        }
+
+        // Random sizes and alignments, frees in random order, the live set mostly between MaxLive / 2 and MaxLive
+        void tlsfStress(Bench::State &state) {
+            std::mt19937 rng(state.seed());
+            std::uniform_int_distribution<uint64_t> size(1, MaxSize);
+            std::uniform_int_distribution<size_t> alignment(0, std::size(Alignments) - 1);
+            std::uniform_real_distribution<float> chance(0.0f, 1.0f);
+
+            double fragmentationSum = 0.0, fragmentationMax = 0.0, utilizationSum = 0.0;
+            uint32_t samples = 0;
+            state.start();
+            for (uint64_t iteration = 0; iteration < state.iterations(); ++iteration) {
+                TlsfAllocator allocator(Capacity);
+                std::vector<TlsfAllocator::Allocation> live;
+                std::map<uint64_t, uint64_t> ranges; // Offset to end of every live allocation
+                auto release = [&](size_t index) {
+                    ranges.erase(live[index].offset);
+                    allocator.free(live[index]);
+                    live[index] = live.back();
+                    live.pop_back();
+                };
+
+                for (uint32_t i = 0; i < Operations; ++i) {
+                    while (live.size() >= MaxLive || (live.size() > MaxLive / 2 && chance(rng) < 0.5f)) {
+                        release(std::uniform_int_distribution<size_t>(0, live.size() - 1)(rng));
+                    }
+                    const uint64_t bytes = size(rng);
+                    const uint64_t align = Alignments[alignment(rng)];
+                    TlsfAllocator::Allocation allocation = allocator.allocate(bytes, align);
+                    check(allocation.valid(), "allocation of " + std::to_string(bytes) + " bytes failed");
+                    check(allocation.offset % align == 0, "offset not aligned to " + std::to_string(align));
+                    check(allocation.size >= bytes && allocation.offset + allocation.size <= Capacity,
+                          "range outside of the capacity");
+                    // Neither the live range before nor the one after may reach into the new one
+                    auto next = ranges.lower_bound(allocation.offset);
+                    check(next == ranges.end() || next->first >= allocation.offset + allocation.size,
+                          "range overlaps the next allocation");
+                    check(next == ranges.begin() || std::prev(next)->second <= allocation.offset,
+                          "range overlaps the previous allocation");
+                    ranges.emplace(allocation.offset, allocation.offset + allocation.size);
+                    live.push_back(allocation);
+
+                    if (iteration == 0 && i % 1000 == 999) {
+                        // Free space scattered between allocations, used bytes of the spanned range
+                        TlsfAllocator::Stats stats = allocator.getStats();
+                        double fragmentation = stats.fragmentation();
+                        fragmentationSum += fragmentation;
+                        fragmentationMax = std::max(fragmentationMax, fragmentation);
+                        utilizationSum += static_cast<double>(stats.usedBytes) /
+                                          static_cast<double>(ranges.rbegin()->second);
+                        ++samples;
+                    }
+                }
+
+                while (!live.empty()) release(live.size() - 1);
+                TlsfAllocator::Stats stats = allocator.getStats();
+                check(stats.allocationCount == 0 && stats.usedBytes == 0, "allocations left after freeing all");
+                check(stats.freeRangeCount == 1 && stats.largestFreeRange == Capacity,
+                      "free space not merged back into one range (" + std::to_string(stats.freeRangeCount) +
+                      " ranges)");
+            }
+            state.stop();
+            state.counter("operations", Operations);
+            state.counter("fragmentation_mean", fragmentationSum / samples);
+            state.counter("fragmentation_max", fragmentationMax);
+            state.counter("utilization_mean", utilizationSum / samples);
+        }
+    }
+
+    BCG_BENCHMARK_NAMED("Tlsf/stress100k", tlsfStress);
+}
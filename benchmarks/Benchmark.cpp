@@ -0,0 +1,221 @@
+//
+// Created by alex on 5/4/25.
+//
+
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+#include "JsonWriter.h"
+
+namespace Bcg::Bench {
+    namespace {
+        struct Entry {
+            std::string name;
+            Function function;
+        };
+
+        struct Result {
+            std::string name;
+            uint64_t iterations = 0;
+            std::vector<double> nanoseconds; // Per iteration, one per repetition, sorted
+            std::vector<std::pair<std::string, double> > counters;
+        };
+
+        struct Options {
+            std::string filter;
+            std::string jsonPath;
+            double minMilliseconds = 200.0;
+            uint32_t repetitions = 5;
+            uint32_t seed = 42;
+            bool list = false;
+        };
+
+        std::vector<Entry> &registry() {
+            static std::vector<Entry> entries;
+            return entries;
+        }
+
+        double runOnce(const Entry &entry, uint64_t iterations, uint32_t seed,
+                       std::vector<std::pair<std::string, double> > *counters = nullptr) {
+            State state(iterations, seed);
+            auto begin = std::chrono::steady_clock::now();
+            entry.function(state);
+            auto elapsed = state.isTimed() ? state.getElapsed() : std::chrono::steady_clock::now() - begin;
+            if (counters) *counters = state.getCounters();
+            return std::chrono::duration<double, std::nano>(elapsed).count();
+        }
+
+        Result run(const Entry &entry, const Options &options) {
+            // Grow the iteration count until one run takes long enough to be measured reliably
+            const double minNanoseconds = options.minMilliseconds * 1e6;
+            uint64_t iterations = 1;
+            double nanoseconds = runOnce(entry, iterations, options.seed);
+            while (nanoseconds < minNanoseconds && iterations < (1ull << 40)) {
+                double scale = nanoseconds > 0.0 ? 1.4 * minNanoseconds / nanoseconds : 10.0;
+                iterations = std::max(iterations + 1, static_cast<uint64_t>(static_cast<double>(iterations) *
+                                                                            std::min(scale, 10.0)));
+                nanoseconds = runOnce(entry, iterations, options.seed);
+            }
+
+            Result result;
+            result.name = entry.name;
+            result.iterations = iterations;
+            for (uint32_t i = 0; i < options.repetitions; ++i) {
+                double total = runOnce(entry, iterations, options.seed, &result.counters);
+                result.nanoseconds.push_back(total / static_cast<double>(iterations));
+            }
+            std::sort(result.nanoseconds.begin(), result.nanoseconds.end());
+            return result;
+        }
+
+        double median(const std::vector<double> &sorted) {
+            size_t middle = sorted.size() / 2;
+            return sorted.size() % 2 ? sorted[middle] : 0.5 * (sorted[middle - 1] + sorted[middle]);
+        }
+
+        bool writeJson(const std::string &path, const Options &options, const std::vector<Result> &results) {
+            std::ofstream file(path, std::ios::trunc);
+            if (!file.is_open()) return false;
+
+            JsonWriter json(file);
+            json.beginObject();
+            json.key("context").beginObject();
+#if defined(__clang__)
+            json.field("compiler", "clang " __clang_version__);
+#elif defined(__GNUC__)
+            json.field("compiler", "gcc " __VERSION__);
+#elif defined(_MSC_VER)
+            json.field("compiler", "msvc " + std::to_string(_MSC_VER));
+#endif
+#ifdef NDEBUG
+            json.field("build_type", "release");
+#else
+            json.field("build_type", "debug");
+#endif
+            json.field("seed", options.seed);
+            json.field("min_time_ms", options.minMilliseconds);
+            json.field("repetitions", options.repetitions);
+            json.endObject();
+
+            json.key("benchmarks").beginArray();
+            for (const auto &result: results) {
+                double sum = 0.0;
+                for (double value: result.nanoseconds) sum += value;
+                json.beginObject();
+                json.field("name", result.name);
+                json.field("iterations", result.iterations);
+                json.field("min_ns", result.nanoseconds.front());
+                json.field("median_ns", median(result.nanoseconds));
+                json.field("mean_ns", sum / static_cast<double>(result.nanoseconds.size()));
+                json.field("max_ns", result.nanoseconds.back());
+                json.key("counters").beginObject();
+                for (const auto &[name, value]: result.counters) json.field(name, value);
+                json.endObject();
+                json.endObject();
+            }
+            json.endArray();
+            json.endObject();
+            file << '\n';
+            return static_cast<bool>(file);
+        }
+
+        Options parseOptions(int argc, char **argv) {
+            Options options;
+            for (int i = 1; i < argc; ++i) {
+                std::string option = argv[i];
+                auto next = [&]() -> std::string {
+                    if (i + 1 >= argc) throw std::invalid_argument(option + " expects a value");
+                    return argv[++i];
+                };
+                if (option == "--filter") {
+                    options.filter = next();
+                } else if (option == "--json") {
+                    options.jsonPath = next();
+                } else if (option == "--min-time") {
+                    options.minMilliseconds = std::stod(next());
+                } else if (option == "--repetitions") {
+                    options.repetitions = std::max(1, std::stoi(next()));
+                } else if (option == "--seed") {
+                    options.seed = static_cast<uint32_t>(std::stoul(next()));
+                } else if (option == "--list") {
+                    options.list = true;
+                } else {
+                    throw std::invalid_argument("Unknown option '" + option + "'");
+                }
+            }
+            return options;
+        }
+    }
+
+    void State::counter(const std::string &name, double value) {
+        for (auto &entry: m_counters) {
+            if (entry.first == name) {
+                entry.second = value;
+                return;
+            }
+        }
+        m_counters.emplace_back(name, value);
+    }
+
+    Registrar::Registrar(const char *name, Function function) {
+        registry().push_back({name, function});
+    }
+}
+
+int main(int argc, char **argv) {
+    using namespace Bcg::Bench;
+    Options options;
+    try {
+        options = parseOptions(argc, argv);
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << "\n\nUsage: " << argv[0] << " [options]\n"
+                  << "  --filter <text>      Only run benchmarks whose name contains text\n"
+                  << "  --json <path>        Write the results as JSON\n"
+                  << "  --min-time <ms>      Minimum duration of one run (default 200)\n"
+                  << "  --repetitions <n>    Runs per benchmark (default 5)\n"
+                  << "  --seed <n>           Seed of all random input (default 42)\n"
+                  << "  --list               List the benchmarks\n";
+        return EXIT_FAILURE;
+    }
+
+    auto entries = registry();
+    std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) { return a.name < b.name; });
+
+    std::vector<Result> results;
+    bool failed = false;
+    std::printf("%-48s %14s %12s %12s\n", "Benchmark", "Iterations", "Median ns", "Min ns");
+    for (const auto &entry: entries) {
+        if (entry.name.find(options.filter) == std::string::npos) continue;
+        if (options.list) {
+            std::printf("%s\n", entry.name.c_str());
+            continue;
+        }
+        Result result;
+        try {
+            result = run(entry, options);
+        } catch (const std::exception &e) {
+            // A benchmark throws when a result it checks is wrong, the others still run
+            std::printf("%-48s FAILED: %s\n", entry.name.c_str(), e.what());
+            std::fflush(stdout);
+            failed = true;
+            continue;
+        }
+        std::printf("%-48s %14llu %12.2f %12.2f\n", result.name.c_str(),
+                    static_cast<unsigned long long>(result.iterations), median(result.nanoseconds),
+                    result.nanoseconds.front());
+        for (const auto &[name, value]: result.counters) std::printf("    %-44s %14.2f\n", name.c_str(), value);
+        std::fflush(stdout);
+        results.push_back(std::move(result));
+    }
+
+    if (!options.jsonPath.empty() && !writeJson(options.jsonPath, options, results)) {
+        std::cerr << "Cannot write " << options.jsonPath << "\n";
+        return EXIT_FAILURE;
+    }
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,86 @@
+//
+// Created by alex on 5/4/25.
+//
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Minimal micro-benchmark harness. A benchmark runs state.iterations() times, the harness picks the count so that
+// one run takes at least --min-time and reports nanoseconds per iteration over several runs:
+//   static void vectorPushBack(Bench::State &state) {
+//       std::vector<int> values;          // setup, not timed
+//       state.start();
+//       for (uint64_t i = 0; i < state.iterations(); ++i) values.push_back(int(i));
+//       state.stop();
+//   }
+//   BCG_BENCHMARK(vectorPushBack);
+// Without start()/stop() the whole call is timed. A benchmark that checks its results throws on a wrong one, the run
+// then reports it as failed and exits with a failure status.
+#define BCG_BENCHMARK_CONCAT_INNER(a, b) a##b
+#define BCG_BENCHMARK_CONCAT(a, b) BCG_BENCHMARK_CONCAT_INNER(a, b)
+#define BCG_BENCHMARK(function) \
+    static ::Bcg::Bench::Registrar BCG_BENCHMARK_CONCAT(bcgBenchmark, __LINE__)(#function, function)
+#define BCG_BENCHMARK_NAMED(name, function) \
+    static ::Bcg::Bench::Registrar BCG_BENCHMARK_CONCAT(bcgBenchmark, __LINE__)(name, function)
+
+namespace Bcg::Bench {
+    // Keeps the compiler from removing the computation of value
+    template<typename T>
+    inline void doNotOptimize(const T &value) {
+#if defined(__GNUC__) || defined(__clang__)
+        asm volatile("" : : "r,m"(value) : "memory");
+#else
+        static volatile const void *sink;
+        sink = &value;
+#endif
+    }
+
+    class State {
+    public:
+        State(uint64_t iterations, uint32_t seed) : m_iterations(iterations), m_seed(seed) {
+        }
+
+        uint64_t iterations() const { return m_iterations; }
+
+        // Fixed per run (--seed), benchmarks must derive all random input from it
+        uint32_t seed() const { return m_seed; }
+
+        void start() { m_start = std::chrono::steady_clock::now(); }
+
+        void stop() {
+            m_elapsed += std::chrono::steady_clock::now() - m_start;
+            m_timed = true;
+        }
+
+        // Extra result, e.g. a latency percentile measured by the benchmark itself. Reported from the last run.
+        void counter(const std::string &name, double value);
+
+        bool isTimed() const { return m_timed; }
+
+        std::chrono::steady_clock::duration getElapsed() const { return m_elapsed; }
+
+        const std::vector<std::pair<std::string, double> > &getCounters() const { return m_counters; }
+
+    private:
+        uint64_t m_iterations;
+        uint32_t m_seed;
+        std::chrono::steady_clock::time_point m_start;
+        std::chrono::steady_clock::duration m_elapsed{0};
+        bool m_timed = false;
+        std::vector<std::pair<std::string, double> > m_counters;
+    };
+
+    using Function = void (*)(State &);
+
+    struct Registrar {
+        Registrar(const char *name, Function function);
+    };
+}
+
+#endif //BENCHMARK_H
@@ -0,0 +1,88 @@
+//
+// Created by alex on 5/5/25.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+#include "Benchmark.h"
+#include "EventBus.h"
+
+// Frame times under event storms: one iteration is one frame, every StormInterval-th frame publishes StormEvents
+// events whose handler busy-waits HandlerMicroseconds (a small model load). Event/immediate runs the handlers inside
+// publish() like entt::dispatcher::trigger did, Event/deferred/<budget> runs them from update() with that per-frame
+// budget in milliseconds. The total work is the same; the counters show how it is spread over the frames.
+namespace Bcg {
+    namespace {
+        constexpr uint64_t StormInterval = 60;
+        constexpr int StormEvents = 32;
+        constexpr int HandlerMicroseconds = 250;
+        constexpr size_t MaxSamples = 1u << 20;
+
+        struct StormEvent {
+            int index;
+        };
+
+        void busyWait(int microseconds) {
+            auto end = std::chrono::steady_clock::now() + std::chrono::microseconds(microseconds);
+            while (std::chrono::steady_clock::now() < end) {
+            }
+        }
+
+        void frameTimes(Bench::State &state, EventDelivery delivery, double budgetMilliseconds) {
+            EventBus bus;
+            int handled = 0;
+            bus.subscribe<StormEvent>([&handled](const StormEvent &) {
+                busyWait(HandlerMicroseconds);
+                ++handled;
+            }, delivery);
+
+            const uint64_t stride = std::max<uint64_t>(1, state.iterations() / MaxSamples);
+            std::vector<double> samples;
+            samples.reserve(std::min<uint64_t>(state.iterations(), MaxSamples) + 1);
+            double maxMilliseconds = 0.0;
+            state.start();
+            for (uint64_t frame = 0; frame < state.iterations(); ++frame) {
+                auto start = std::chrono::steady_clock::now();
+                if (frame % StormInterval == 0) {
+                    for (int i = 0; i < StormEvents; ++i) bus.publish(StormEvent{i});
+                }
+                bus.update(budgetMilliseconds);
+                double milliseconds = std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - start).count();
+                maxMilliseconds = std::max(maxMilliseconds, milliseconds);
+                if (frame % stride == 0) samples.push_back(milliseconds);
+            }
+            state.stop();
+            Bench::doNotOptimize(handled);
+
+            std::sort(samples.begin(), samples.end());
+            auto percentile = [&samples](double p) {
+                auto rank = static_cast<size_t>(std::ceil(p / 100.0 * static_cast<double>(samples.size())));
+                return samples[std::clamp<size_t>(rank, 1, samples.size()) - 1];
+            };
+            state.counter("p50_frame_ms", percentile(50.0));
+            state.counter("p99_frame_ms", percentile(99.0));
+            state.counter("max_frame_ms", maxMilliseconds);
+            state.counter("pending_at_end", static_cast<double>(bus.getPendingCount()));
+        }
+
+        void eventImmediate(Bench::State &state) {
+            frameTimes(state, EventDelivery::Immediate, 0.0);
+        }
+
+        void eventDeferred1(Bench::State &state) {
+            frameTimes(state, EventDelivery::Deferred, 1.0);
+        }
+
+        void eventDeferred2(Bench::State &state) {
+            frameTimes(state, EventDelivery::Deferred, 2.0);
+        }
+    }
+
+    BCG_BENCHMARK_NAMED("Event/immediate", eventImmediate);
+    BCG_BENCHMARK_NAMED("Event/deferred/1", eventDeferred1);
+    BCG_BENCHMARK_NAMED("Event/deferred/2", eventDeferred2);
+}
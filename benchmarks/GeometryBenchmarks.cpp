@@ -0,0 +1,178 @@
+//
+// Created by alex on 5/5/25.
+//
+
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "Benchmark.h"
+#include "MatVec.h"
+#include "TlsfAllocator.h"
+
+// CPU side of the geometry pool at 10k unique meshes: range allocation, the repacking done by compaction and the
+// indirect commands of the single multi-draw call (GeometryPool, RendererSystem::buildDrawCommands). The device
+// copies and the draw itself need a GPU, run those with --headless --bench-scene 10000 --bench-meshes 10000.
+namespace Bcg {
+    namespace {
+        constexpr uint32_t MeshCount = 10000;
+
+        // Layout of VkDrawIndexedIndirectCommand, the benchmarks build without the Vulkan headers
+        struct DrawCommand {
+            uint32_t indexCount;
+            uint32_t instanceCount;
+            uint32_t firstIndex;
+            int32_t vertexOffset;
+            uint32_t firstInstance;
+        };
+
+        struct MeshSize {
+            uint64_t vertices = 0;
+            uint64_t indices = 0;
+        };
+
+        // Between the generated cube (24 vertices) and the finest generated sphere
+        std::vector<MeshSize> makeMeshSizes(uint32_t seed, uint64_t &vertexTotal, uint64_t &indexTotal) {
+            std::mt19937 rng(seed);
+            std::uniform_int_distribution<uint64_t> vertices(24, 1024);
+            std::vector<MeshSize> sizes(MeshCount);
+            vertexTotal = indexTotal = 0;
+            for (auto &size: sizes) {
+                size.vertices = vertices(rng);
+                size.indices = 6 * size.vertices;
+                vertexTotal += size.vertices;
+                indexTotal += size.indices;
+            }
+            return sizes;
+        }
+
+        // Power of two as the pool reaches by growing
+        uint64_t poolCapacity(uint64_t used) {
+            uint64_t capacity = 1;
+            while (capacity < used) capacity *= 2;
+            return capacity;
+        }
+
+        struct PooledMesh {
+            TlsfAllocator::Allocation vertices;
+            TlsfAllocator::Allocation indices;
+        };
+
+        void allocateAll(const std::vector<MeshSize> &sizes, TlsfAllocator &vertexRanges,
+                         TlsfAllocator &indexRanges, std::vector<PooledMesh> &meshes) {
+            meshes.resize(sizes.size());
+            for (size_t i = 0; i < sizes.size(); ++i) {
+                meshes[i].vertices = vertexRanges.allocate(sizes[i].vertices);
+                meshes[i].indices = indexRanges.allocate(sizes[i].indices);
+                if (!meshes[i].vertices.valid() || !meshes[i].indices.valid()) {
+                    throw std::runtime_error("Geometry: mesh does not fit into the pool");
+                }
+            }
+        }
+
+        void poolAllocate(Bench::State &state) {
+            uint64_t vertexTotal = 0, indexTotal = 0;
+            std::vector<MeshSize> sizes = makeMeshSizes(state.seed(), vertexTotal, indexTotal);
+            std::vector<PooledMesh> meshes;
+            state.start();
+            for (uint64_t i = 0; i < state.iterations(); ++i) {
+                TlsfAllocator vertexRanges(poolCapacity(vertexTotal));
+                TlsfAllocator indexRanges(poolCapacity(indexTotal));
+                allocateAll(sizes, vertexRanges, indexRanges, meshes);
+                Bench::doNotOptimize(meshes.data());
+            }
+            state.stop();
+            state.counter("meshes", MeshCount);
+            state.counter("vertices", static_cast<double>(vertexTotal));
+        }
+
+        // Every other mesh freed, then all live ones repacked in slot order into fresh allocators with their copy
+        // regions, as GeometryPool::rebuild() does
+        void poolCompact(Bench::State &state) {
+            struct Copy {
+                uint64_t source, destination, size;
+            };
+            uint64_t vertexTotal = 0, indexTotal = 0;
+            std::vector<MeshSize> sizes = makeMeshSizes(state.seed(), vertexTotal, indexTotal);
+            const uint64_t vertexCapacity = poolCapacity(vertexTotal);
+            const uint64_t indexCapacity = poolCapacity(indexTotal);
+            std::vector<PooledMesh> meshes;
+            std::vector<Copy> vertexCopies, indexCopies;
+            float fragmentationBefore = 0.0f, fragmentationAfter = 0.0f;
+
+            for (uint64_t i = 0; i < state.iterations(); ++i) {
+                TlsfAllocator vertexRanges(vertexCapacity);
+                TlsfAllocator indexRanges(indexCapacity);
+                allocateAll(sizes, vertexRanges, indexRanges, meshes);
+                for (size_t mesh = 0; mesh < meshes.size(); mesh += 2) {
+                    vertexRanges.free(meshes[mesh].vertices);
+                    indexRanges.free(meshes[mesh].indices);
+                }
+                fragmentationBefore = vertexRanges.getStats().fragmentation();
+
+                state.start();
+                TlsfAllocator packedVertices(vertexCapacity);
+                TlsfAllocator packedIndices(indexCapacity);
+                vertexCopies.clear();
+                indexCopies.clear();
+                for (size_t mesh = 1; mesh < meshes.size(); mesh += 2) {
+                    auto vertices = packedVertices.allocate(meshes[mesh].vertices.size);
+                    auto indices = packedIndices.allocate(meshes[mesh].indices.size);
+                    vertexCopies.push_back({meshes[mesh].vertices.offset, vertices.offset, vertices.size});
+                    indexCopies.push_back({meshes[mesh].indices.offset, indices.offset, indices.size});
+                    meshes[mesh].vertices = vertices;
+                    meshes[mesh].indices = indices;
+                }
+                state.stop();
+                fragmentationAfter = packedVertices.getStats().fragmentation();
+                Bench::doNotOptimize(vertexCopies.data());
+                Bench::doNotOptimize(indexCopies.data());
+            }
+            state.counter("live_meshes", static_cast<double>(MeshCount / 2));
+            state.counter("fragmentation_before", fragmentationBefore);
+            state.counter("fragmentation_after", fragmentationAfter);
+        }
+
+        // One command and one instance matrix per mesh, the whole scene in one vkCmdDrawIndexedIndirect
+        void buildIndirect(Bench::State &state) {
+            uint64_t vertexTotal = 0, indexTotal = 0;
+            std::vector<MeshSize> sizes = makeMeshSizes(state.seed(), vertexTotal, indexTotal);
+            TlsfAllocator vertexRanges(poolCapacity(vertexTotal));
+            TlsfAllocator indexRanges(poolCapacity(indexTotal));
+            std::vector<PooledMesh> meshes;
+            allocateAll(sizes, vertexRanges, indexRanges, meshes);
+
+            std::mt19937 rng(state.seed());
+            std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+            std::vector<Matrix4f> transforms(MeshCount, Matrix4f::Identity());
+            for (auto &transform: transforms) {
+                transform.block<3, 1>(0, 3) = Vector3f(position(rng), position(rng), position(rng));
+            }
+            // Stand-ins for the persistently mapped indirect and instance buffers
+            std::vector<DrawCommand> commands(MeshCount);
+            std::vector<Matrix4f> instances(MeshCount);
+
+            state.start();
+            for (uint64_t i = 0; i < state.iterations(); ++i) {
+                for (uint32_t draw = 0; draw < MeshCount; ++draw) {
+                    instances[draw] = transforms[draw];
+                    DrawCommand &command = commands[draw];
+                    command.indexCount = static_cast<uint32_t>(meshes[draw].indices.size);
+                    command.instanceCount = 1;
+                    command.firstIndex = static_cast<uint32_t>(meshes[draw].indices.offset);
+                    command.vertexOffset = static_cast<int32_t>(meshes[draw].vertices.offset);
+                    command.firstInstance = draw;
+                }
+                Bench::doNotOptimize(commands.data());
+                Bench::doNotOptimize(instances.data());
+            }
+            state.stop();
+            state.counter("draws", MeshCount);
+            state.counter("bytes", static_cast<double>(MeshCount * (sizeof(DrawCommand) + sizeof(Matrix4f))));
+        }
+    }
+
+    BCG_BENCHMARK_NAMED("Geometry/allocate10k", poolAllocate);
+    BCG_BENCHMARK_NAMED("Geometry/compact10k", poolCompact);
+    BCG_BENCHMARK_NAMED("Geometry/buildIndirect10k", buildIndirect);
+}
@@ -0,0 +1,90 @@
+//
+// Created by alex on 5/5/25.
+//
+
+#include <vector>
+
+#include "Benchmark.h"
+#include "CameraComponent.h"
+#include "CameraUtils.h"
+#include "InputQueue.h"
+#include "Mouse.h"
+
+// Per-frame input cost while dragging the arcball camera with a high-rate mouse: one iteration is one frame.
+// Input/perEvent is what the GLFW callbacks did before InputQueue (an arcball update per cursor event),
+// Input/coalesced pushes the same events through the queue and updates the camera once per frame.
+// 16 and 128 events per frame are 1 kHz and 8 kHz mice at 60 Hz; every 8th event is a scroll tick.
+namespace Bcg {
+    namespace {
+        InputEvent syntheticEvent(uint64_t frame, uint32_t i) {
+            InputEvent event;
+            if (i % 8 == 7) {
+                event.type = InputEventType::Scroll;
+                event.values[1] = (frame & 1) ? 1.0 : -1.0; // Keeps the camera distance bounded
+            } else {
+                event.type = InputEventType::CursorPos;
+                event.values[0] = 400.0 + static_cast<double>((frame * 7 + i) % 200);
+                event.values[1] = 300.0 + static_cast<double>((frame * 3 + i) % 100);
+            }
+            return event;
+        }
+
+        void apply(const InputEvent &event, CameraParametersComponent &camera, Mouse &mouse) {
+            if (event.type == InputEventType::CursorPos) {
+                mouse.current.cursor_position = Vector2f(event.values[0], event.values[1]);
+                CameraUtils::arcball(camera, mouse);
+            } else if (event.type == InputEventType::Scroll) {
+                CameraUtils::zoom(camera, static_cast<float>(event.values[1]));
+            }
+        }
+
+        void resetCamera(CameraParametersComponent &camera) {
+            camera = CameraParametersComponent();
+            camera.zoomSensitivity = 1.0f; // Zooming then only moves by the offset
+        }
+
+        template<uint32_t EventsPerFrame>
+        void inputPerEvent(Bench::State &state) {
+            CameraParametersComponent camera;
+            resetCamera(camera);
+            Mouse mouse;
+            mouse.is_dragging = true;
+            state.start();
+            for (uint64_t frame = 0; frame < state.iterations(); ++frame) {
+                for (uint32_t i = 0; i < EventsPerFrame; ++i) apply(syntheticEvent(frame, i), camera, mouse);
+                Bench::doNotOptimize(camera.position);
+            }
+            state.stop();
+            state.counter("events_per_frame", EventsPerFrame);
+            state.counter("camera_updates_per_frame", EventsPerFrame);
+        }
+
+        template<uint32_t EventsPerFrame>
+        void inputCoalesced(Bench::State &state) {
+            CameraParametersComponent camera;
+            resetCamera(camera);
+            Mouse mouse;
+            mouse.is_dragging = true;
+            InputQueue queue;
+            std::vector<InputEvent> events;
+            size_t updates = 0;
+            state.start();
+            for (uint64_t frame = 0; frame < state.iterations(); ++frame) {
+                for (uint32_t i = 0; i < EventsPerFrame; ++i) queue.push(syntheticEvent(frame, i));
+                queue.drain(events);
+                for (const auto &event: events) apply(event, camera, mouse);
+                updates += events.size();
+                Bench::doNotOptimize(camera.position);
+            }
+            state.stop();
+            state.counter("events_per_frame", EventsPerFrame);
+            state.counter("camera_updates_per_frame",
+                          static_cast<double>(updates) / static_cast<double>(state.iterations()));
+        }
+    }
+
+    BCG_BENCHMARK_NAMED("Input/perEvent/16", inputPerEvent<16>);
+    BCG_BENCHMARK_NAMED("Input/perEvent/128", inputPerEvent<128>);
+    BCG_BENCHMARK_NAMED("Input/coalesced/16", inputCoalesced<16>);
+    BCG_BENCHMARK_NAMED("Input/coalesced/128", inputCoalesced<128>);
+}
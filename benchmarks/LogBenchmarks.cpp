@@ -0,0 +1,116 @@
+//
+// Created by alex on 5/5/25.
+//
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "Benchmark.h"
+#include "Logger.h"
+
+// Latency of one Log::Info on the calling thread while ContendingThreads other threads log as fast as they can.
+// All variants write to a log file only (no console); the per-call latencies are reported as counters.
+namespace Bcg {
+    namespace {
+        constexpr int ContendingThreads = 3;
+        constexpr size_t MaxSamples = 1u << 20;
+
+        void logLatency(Bench::State &state, const LogConfig &config) {
+            Log::Init(config);
+
+            std::atomic<bool> stop{false};
+            std::vector<std::thread> workers;
+            for (int i = 0; i < ContendingThreads; ++i) {
+                workers.emplace_back([&stop, i]() {
+                    uint64_t count = 0;
+                    while (!stop.load(std::memory_order_relaxed)) {
+                        Log::Info("[LogBenchmark] Worker {} message {} ({:.3f})", i, count, count * 0.5);
+                        ++count;
+                    }
+                });
+            }
+
+            // Every call is timed, a bounded number of them is kept for the percentiles
+            const uint64_t stride = std::max<uint64_t>(1, state.iterations() / MaxSamples);
+            std::vector<uint64_t> samples;
+            samples.reserve(std::min<uint64_t>(state.iterations(), MaxSamples) + 1);
+            state.start();
+            for (uint64_t i = 0; i < state.iterations(); ++i) {
+                auto begin = std::chrono::steady_clock::now();
+                Log::Info("[LogBenchmark] Main message {} of {} ({:.3f})", i, state.iterations(), i * 0.25);
+                auto end = std::chrono::steady_clock::now();
+                if (i % stride == 0) {
+                    samples.push_back(static_cast<uint64_t>(
+                        std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count()));
+                }
+            }
+            state.stop();
+
+            stop.store(true, std::memory_order_relaxed);
+            for (auto &worker: workers) worker.join();
+            state.counter("dropped", static_cast<double>(Log::getDroppedCount()));
+            Log::Shutdown();
+
+            std::sort(samples.begin(), samples.end());
+            auto percentile = [&samples](double p) {
+                auto index = static_cast<size_t>(p / 100.0 * static_cast<double>(samples.size() - 1));
+                return static_cast<double>(samples[index]);
+            };
+            state.counter("p50_ns", percentile(50.0));
+            state.counter("p99_ns", percentile(99.0));
+            state.counter("p99.9_ns", percentile(99.9));
+            state.counter("max_ns", static_cast<double>(samples.back()));
+        }
+
+        LogConfig benchmarkConfig(bool async, LogOverflowPolicy policy) {
+            LogConfig config;
+            config.async = async;
+            config.overflowPolicy = policy;
+            config.console = false;
+            config.filePath = "logs/LogBenchmark.log";
+            return config;
+        }
+
+        void logSync(Bench::State &state) {
+            logLatency(state, benchmarkConfig(false, LogOverflowPolicy::Block));
+        }
+
+        void logAsyncDrop(Bench::State &state) {
+            logLatency(state, benchmarkConfig(true, LogOverflowPolicy::Drop));
+        }
+
+        void logAsyncBlock(Bench::State &state) {
+            logLatency(state, benchmarkConfig(true, LogOverflowPolicy::Block));
+        }
+
+        // BCG_LOG_TRACE below BCG_LOG_ACTIVE_LEVEL: fails if an argument is evaluated. Where trace is compiled in,
+        // the level is off at runtime and this measures the level check.
+        void traceCompiledOut(Bench::State &state) {
+            Log::Init(benchmarkConfig(false, LogOverflowPolicy::Block));
+            Log::setLevel(spdlog::level::off);
+            uint64_t evaluated = 0;
+            auto expensive = [&evaluated]() { return ++evaluated; };
+            state.start();
+            for (uint64_t i = 0; i < state.iterations(); ++i) {
+                BCG_LOG_TRACE("[LogBenchmark] Trace {}", expensive());
+                Bench::doNotOptimize(i);
+            }
+            state.stop();
+            Log::Shutdown();
+            if (BCG_LOG_ACTIVE_LEVEL > SPDLOG_LEVEL_TRACE && evaluated > 0) {
+                throw std::runtime_error("BCG_LOG_TRACE evaluated its arguments below BCG_LOG_ACTIVE_LEVEL");
+            }
+            state.counter("active_level", BCG_LOG_ACTIVE_LEVEL);
+            state.counter("evaluated", static_cast<double>(evaluated));
+        }
+    }
+
+    BCG_BENCHMARK_NAMED("Log/sync", logSync);
+    BCG_BENCHMARK_NAMED("Log/asyncDrop", logAsyncDrop);
+    BCG_BENCHMARK_NAMED("Log/asyncBlock", logAsyncBlock);
+    BCG_BENCHMARK_NAMED("Log/traceCompiledOut", traceCompiledOut);
+}
@@ -0,0 +1,140 @@
+//
+// Created by alex on 5/5/25.
+//
+
+#include <random>
+#include <vector>
+
+#include "Benchmark.h"
+#include "AABBUtils.h"
+#include "CameraUtils.h"
+#include "TransformUtils.h"
+
+// Transform, bounding box and camera math of the ECS systems. Inputs are random (from --seed) and cycled through,
+// so that results do not depend on one well-conditioned value.
+namespace Bcg {
+    namespace {
+        constexpr size_t InputCount = 1024; // Power of two, fits into the L1 cache as matrices
+
+        Eigen::Affine3f randomAffine(std::mt19937 &rng) {
+            std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+            std::uniform_real_distribution<float> angle(-3.14159f, 3.14159f);
+            std::uniform_real_distribution<float> scale(0.1f, 10.0f);
+            Vector3f axis = Vector3f(position(rng), position(rng), position(rng)).normalized();
+            return Eigen::Translation3f(position(rng), position(rng), position(rng)) *
+                   Eigen::AngleAxisf(angle(rng), axis) * Eigen::Scaling(scale(rng), scale(rng), scale(rng));
+        }
+
+        std::vector<TransformComponent> randomTransforms(std::mt19937 &rng) {
+            std::vector<TransformComponent> transforms(InputCount);
+            for (auto &transform: transforms) TransformUtils::setFromMatrix(transform, randomAffine(rng));
+            return transforms;
+        }
+
+        void transformUpdate(Bench::State &state) {
+            std::mt19937 rng(state.seed());
+            auto transforms = randomTransforms(rng);
+            state.start();
+            for (uint64_t i = 0; i < state.iterations(); ++i) {
+                auto &transform = transforms[i & (InputCount - 1)];
+                transform.dirty = true;
+                TransformUtils::update(transform);
+                Bench::doNotOptimize(transform.cachedModelMatrix);
+            }
+            state.stop();
+        }
+
+        void transformSetFromMatrix(Bench::State &state) {
+            std::mt19937 rng(state.seed());
+            std::vector<Eigen::Affine3f> matrices;
+            for (size_t i = 0; i < InputCount; ++i) matrices.push_back(randomAffine(rng));
+            TransformComponent transform;
+            state.start();
+            for (uint64_t i = 0; i < state.iterations(); ++i) {
+                TransformUtils::setFromMatrix(transform, matrices[i & (InputCount - 1)]);
+                Bench::doNotOptimize(transform);
+            }
+            state.stop();
+        }
+
+        template<size_t PointCount>
+        void aabbBuild(Bench::State &state) {
+            std::mt19937 rng(state.seed());
+            std::uniform_real_distribution<float> coordinate(-1.0f, 1.0f);
+            std::vector<Vector3f> points(PointCount);
+            for (auto &point: points) point = Vector3f(coordinate(rng), coordinate(rng), coordinate(rng));
+            Eigen::Affine3f worldXf = randomAffine(rng);
+            AABBComponent aabb;
+            state.start();
+            for (uint64_t i = 0; i < state.iterations(); ++i) {
+                AABBUtils::build(aabb, points, worldXf);
+                Bench::doNotOptimize(aabb);
+            }
+            state.stop();
+            state.counter("points", static_cast<double>(PointCount));
+        }
+
+        std::vector<CameraParametersComponent> randomCameras(std::mt19937 &rng) {
+            std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+            std::uniform_real_distribution<float> fov(20.0f, 90.0f);
+            std::uniform_real_distribution<float> aspect(0.5f, 2.5f);
+            std::vector<CameraParametersComponent> cameras(InputCount);
+            for (auto &camera: cameras) {
+                camera.position = Vector3f(position(rng), position(rng), position(rng));
+                camera.target = Vector3f(position(rng), position(rng), position(rng));
+                camera.fovYDegrees = fov(rng);
+                camera.aspectRatio = aspect(rng);
+            }
+            return cameras;
+        }
+
+        void cameraUpdate(Bench::State &state) {
+            std::mt19937 rng(state.seed());
+            auto cameras = randomCameras(rng);
+            state.start();
+            for (uint64_t i = 0; i < state.iterations(); ++i) {
+                auto &camera = cameras[i & (InputCount - 1)];
+                camera.dirtyView = true;
+                camera.dirtyProjection = true;
+                CameraUtils::update(camera);
+                Bench::doNotOptimize(camera.viewMatrix);
+                Bench::doNotOptimize(camera.projectionMatrix);
+            }
+            state.stop();
+        }
+
+        void cameraLookAt(Bench::State &state) {
+            std::mt19937 rng(state.seed());
+            auto cameras = randomCameras(rng);
+            Eigen::Affine3f view;
+            state.start();
+            for (uint64_t i = 0; i < state.iterations(); ++i) {
+                const auto &camera = cameras[i & (InputCount - 1)];
+                LookAt(view, camera.position, camera.target, camera.up);
+                Bench::doNotOptimize(view);
+            }
+            state.stop();
+        }
+
+        void cameraPerspective(Bench::State &state) {
+            std::mt19937 rng(state.seed());
+            auto cameras = randomCameras(rng);
+            Matrix4f projection;
+            state.start();
+            for (uint64_t i = 0; i < state.iterations(); ++i) {
+                const auto &camera = cameras[i & (InputCount - 1)];
+                Perspective(projection, camera.fovYDegrees, camera.aspectRatio, camera.nearPlane, camera.farPlane);
+                Bench::doNotOptimize(projection);
+            }
+            state.stop();
+        }
+    }
+
+    BCG_BENCHMARK_NAMED("TransformUtils/update", transformUpdate);
+    BCG_BENCHMARK_NAMED("TransformUtils/setFromMatrix", transformSetFromMatrix);
+    BCG_BENCHMARK_NAMED("AABBUtils/build/64", aabbBuild<64>);
+    BCG_BENCHMARK_NAMED("AABBUtils/build/65536", aabbBuild<65536>);
+    BCG_BENCHMARK_NAMED("CameraUtils/update", cameraUpdate);
+    BCG_BENCHMARK_NAMED("CameraUtils/LookAt", cameraLookAt);
+    BCG_BENCHMARK_NAMED("CameraUtils/Perspective", cameraPerspective);
+}
@@ -0,0 +1,84 @@
+//
+// Created by alex on 5/5/25.
+//
+
+#include <random>
+#include <vector>
+
+#include "Benchmark.h"
+#include "ObjMeshBuilder.h"
+
+// Vertex hashing and the deduplication of OBJ corners when a model is loaded (SceneManager::loadModel).
+namespace Bcg {
+    namespace {
+        constexpr size_t VertexCount = 4096; // Power of two
+
+        void vertexHash(Bench::State &state) {
+            std::mt19937 rng(state.seed());
+            std::uniform_real_distribution<float> value(-1.0f, 1.0f);
+            std::vector<Vertex> vertices(VertexCount);
+            for (auto &vertex: vertices) {
+                vertex.pos = Vector3f(value(rng), value(rng), value(rng));
+                vertex.normal = Vector3f(value(rng), value(rng), value(rng)).normalized();
+                vertex.texCoord = Vector2f(value(rng), value(rng));
+                vertex.color = Vector3f::Ones();
+            }
+            std::hash<Vertex> hash;
+            state.start();
+            for (uint64_t i = 0; i < state.iterations(); ++i) {
+                Bench::doNotOptimize(hash(vertices[i & (VertexCount - 1)]));
+            }
+            state.stop();
+        }
+
+        // What tinyobjloader returns for a size x size grid of quads as two triangles each: every position, normal
+        // and texture coordinate is listed once and referenced by up to six corners.
+        struct ObjGrid {
+            std::vector<float> positions, normals, texCoords, colors;
+            std::vector<int> corners; // Position index, normal and texture coordinate use the same
+        };
+
+        ObjGrid makeGrid(uint32_t size, std::mt19937 &rng) {
+            std::uniform_real_distribution<float> height(-0.1f, 0.1f);
+            ObjGrid grid;
+            for (uint32_t y = 0; y <= size; ++y) {
+                for (uint32_t x = 0; x <= size; ++x) {
+                    float u = static_cast<float>(x) / static_cast<float>(size);
+                    float v = static_cast<float>(y) / static_cast<float>(size);
+                    grid.positions.insert(grid.positions.end(), {u, height(rng), v});
+                    grid.normals.insert(grid.normals.end(), {0.0f, 1.0f, 0.0f});
+                    grid.texCoords.insert(grid.texCoords.end(), {u, v});
+                }
+            }
+            for (uint32_t y = 0; y < size; ++y) {
+                for (uint32_t x = 0; x < size; ++x) {
+                    int corner = static_cast<int>(y * (size + 1) + x);
+                    int below = corner + static_cast<int>(size + 1);
+                    grid.corners.insert(grid.corners.end(), {corner, below, corner + 1, corner + 1, below, below + 1});
+                }
+            }
+            return grid;
+        }
+
+        template<uint32_t Size>
+        void objDeduplicate(Bench::State &state) {
+            std::mt19937 rng(state.seed());
+            ObjGrid grid = makeGrid(Size, rng);
+            size_t vertexCount = 0;
+            state.start();
+            for (uint64_t i = 0; i < state.iterations(); ++i) {
+                ObjMeshBuilder builder(grid.positions, grid.normals, grid.texCoords, grid.colors);
+                for (int corner: grid.corners) builder.addCorner(corner, corner, corner);
+                vertexCount = builder.vertices.size();
+                Bench::doNotOptimize(builder.indices.data());
+            }
+            state.stop();
+            state.counter("corners", static_cast<double>(grid.corners.size()));
+            state.counter("vertices", static_cast<double>(vertexCount));
+        }
+    }
+
+    BCG_BENCHMARK_NAMED("Vertex/hash", vertexHash);
+    BCG_BENCHMARK_NAMED("ObjMeshBuilder/deduplicate/16", objDeduplicate<16>);
+    BCG_BENCHMARK_NAMED("ObjMeshBuilder/deduplicate/256", objDeduplicate<256>);
+}
@@ -0,0 +1,91 @@
+//
+// Created by alex on 5/4/25.
+//
+
+#include "Benchmark.h"
+#include "PerfCounters.h"
+#include "Profiler.h"
+
+// Overhead of the CPU profiler instrumentation. Subtract "emptyLoop" from the scope benchmarks for the cost of one
+// BCG_PROFILE_SCOPE or BCG_COUNT. With BCG_PROFILER=OFF both compile to nothing and all of them match emptyLoop.
+namespace Bcg {
+    namespace {
+        void emptyLoop(Bench::State &state) {
+            state.start();
+            for (uint64_t i = 0; i < state.iterations(); ++i) {
+                Bench::doNotOptimize(i);
+            }
+            state.stop();
+        }
+
+        void profilerNow(Bench::State &state) {
+            state.start();
+            for (uint64_t i = 0; i < state.iterations(); ++i) {
+                Bench::doNotOptimize(Profiler::now());
+            }
+            state.stop();
+        }
+
+        void profileScope(Bench::State &state) {
+            Profiler::setEnabled(true);
+            state.start();
+            for (uint64_t i = 0; i < state.iterations(); ++i) {
+                BCG_PROFILE_SCOPE("profileScope");
+                Bench::doNotOptimize(i);
+            }
+            state.stop();
+        }
+
+        void profileScopeNested(Bench::State &state) {
+            Profiler::setEnabled(true);
+            state.start();
+            for (uint64_t i = 0; i < state.iterations(); ++i) {
+                BCG_PROFILE_SCOPE("outer");
+                {
+                    BCG_PROFILE_SCOPE("inner");
+                    Bench::doNotOptimize(i);
+                }
+            }
+            state.stop();
+        }
+
+        // Compiled in, but switched off at runtime
+        void profileScopeDisabled(Bench::State &state) {
+            Profiler::setEnabled(false);
+            state.start();
+            for (uint64_t i = 0; i < state.iterations(); ++i) {
+                BCG_PROFILE_SCOPE("profileScopeDisabled");
+                Bench::doNotOptimize(i);
+            }
+            state.stop();
+            Profiler::setEnabled(true);
+        }
+
+        void count(Bench::State &state) {
+            state.start();
+            for (uint64_t i = 0; i < state.iterations(); ++i) {
+                BCG_COUNT(DrawCalls, 1);
+                Bench::doNotOptimize(i);
+            }
+            state.stop();
+        }
+
+        // Sum over all threads and history entry, once per frame
+        void countEndFrame(Bench::State &state) {
+            BCG_COUNT(DrawCalls, 1);
+            state.start();
+            for (uint64_t i = 0; i < state.iterations(); ++i) {
+                PerfCounters::endFrame();
+            }
+            state.stop();
+        }
+    }
+
+    BCG_BENCHMARK_NAMED("Profiler/emptyLoop", emptyLoop);
+    BCG_BENCHMARK_NAMED("Profiler/now", profilerNow);
+    BCG_BENCHMARK_NAMED("Profiler/scope", profileScope);
+    BCG_BENCHMARK_NAMED("Profiler/scopeNested", profileScopeNested);
+    BCG_BENCHMARK_NAMED("Profiler/scopeDisabled", profileScopeDisabled);
+    BCG_BENCHMARK_NAMED("Profiler/count", count);
+    BCG_BENCHMARK_NAMED("Profiler/countEndFrame", countEndFrame);
+}
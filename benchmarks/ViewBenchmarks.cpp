@@ -0,0 +1,148 @@
+//
+// Created by alex on 5/5/25.
+//
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "Benchmark.h"
+#include "CameraUtils.h"
+#include "FrustumUtils.h"
+#include "ViewCulling.h"
+#include "WorkerPool.h"
+
+// CPU culling of multi-view frames, one iteration culls the whole scene for every view. View/<n>/independent tests
+// every object against every view on its own (n times the single view cost), View/<n>/shared uses ViewCulling like
+// the renderer: world bounds and the union rejection once, only the plane tests per view. /parallel filters the
+// views on a WorkerPool like the renderer records them; its wall time is reported, the CPU time is that of /shared.
+namespace Bcg {
+    namespace {
+        constexpr size_t ObjectCount = 20000;
+        constexpr float SceneExtent = 150.0f; // Objects are spread over [-extent, extent]^3
+
+        struct Object {
+            Matrix4f model;
+            Vector3f min;
+            Vector3f max;
+        };
+
+        std::vector<Object> randomObjects(uint32_t seed) {
+            std::mt19937 rng(seed);
+            std::uniform_real_distribution<float> position(-SceneExtent, SceneExtent);
+            std::uniform_real_distribution<float> angle(-3.14159f, 3.14159f);
+            std::uniform_real_distribution<float> size(0.2f, 2.0f);
+            std::vector<Object> objects(ObjectCount);
+            for (auto &object: objects) {
+                Vector3f axis = Vector3f(position(rng), position(rng), position(rng)).normalized();
+                Eigen::Affine3f model = Eigen::Translation3f(position(rng), position(rng), position(rng)) *
+                                        Eigen::AngleAxisf(angle(rng), axis);
+                object.model = model.matrix();
+                object.max = Vector3f(size(rng), size(rng), size(rng));
+                object.min = -object.max;
+            }
+            return objects;
+        }
+
+        // Like CameraSystem::getViews: the first camera and the others orbiting its target in 90 degree steps
+        std::vector<Matrix4f> viewProjections(size_t viewCount) {
+            CameraParametersComponent camera;
+            camera.position = Vector3f(0.0f, 20.0f, 60.0f);
+            camera.target = Vector3f::Zero();
+            camera.aspectRatio = 16.0f / 9.0f; // Quad views keep the framebuffer's aspect ratio
+            camera.farPlane = 120.0f;
+            camera.dirtyView = camera.dirtyProjection = true;
+            std::vector<Matrix4f> result;
+            for (size_t view = 0; view < viewCount; ++view) {
+                CameraParametersComponent orbited = camera;
+                CameraUtils::orbit(orbited, 0.5f * 3.14159265f * static_cast<float>(view));
+                CameraUtils::update(orbited);
+                result.push_back(orbited.projectionMatrix * orbited.viewMatrix.matrix());
+            }
+            return result;
+        }
+
+        void independent(Bench::State &state, size_t viewCount) {
+            auto objects = randomObjects(state.seed());
+            std::vector<Frustum> frusta;
+            for (const auto &viewProjection: viewProjections(viewCount)) {
+                frusta.push_back(FrustumUtils::extract(viewProjection));
+            }
+            std::vector<std::vector<uint32_t> > visible(viewCount);
+            state.start();
+            for (uint64_t i = 0; i < state.iterations(); ++i) {
+                for (size_t view = 0; view < viewCount; ++view) {
+                    visible[view].clear();
+                    for (uint32_t index = 0; index < objects.size(); ++index) {
+                        const Object &object = objects[index];
+                        if (FrustumUtils::isVisible(frusta[view], object.model, object.min, object.max)) {
+                            visible[view].push_back(index);
+                        }
+                    }
+                }
+                Bench::doNotOptimize(visible);
+            }
+            state.stop();
+            size_t total = 0;
+            for (const auto &list: visible) total += list.size();
+            state.counter("visible", static_cast<double>(total));
+        }
+
+        void shared(Bench::State &state, size_t viewCount, WorkerPool *pool) {
+            auto objects = randomObjects(state.seed());
+            auto matrices = viewProjections(viewCount);
+            ViewCulling culling;
+            std::vector<std::vector<uint32_t> > visible(viewCount);
+            auto filter = [&](uint32_t view) {
+                visible[view].clear();
+                culling.forEachVisible(view, [&](uint32_t index) { visible[view].push_back(index); });
+            };
+            state.start();
+            for (uint64_t i = 0; i < state.iterations(); ++i) {
+                culling.begin(matrices, objects.size());
+                for (uint32_t index = 0; index < objects.size(); ++index) {
+                    const Object &object = objects[index];
+                    culling.add(index, object.model, object.min, object.max);
+                }
+                if (pool) {
+                    pool->parallelFor(static_cast<uint32_t>(viewCount), filter);
+                } else {
+                    for (uint32_t view = 0; view < viewCount; ++view) filter(view);
+                }
+                Bench::doNotOptimize(visible);
+            }
+            state.stop();
+            size_t total = 0;
+            for (const auto &list: visible) total += list.size();
+            state.counter("visible", static_cast<double>(total));
+            state.counter("candidates", static_cast<double>(culling.getCandidateCount()));
+        }
+
+        void view1Independent(Bench::State &state) {
+            independent(state, 1);
+        }
+
+        void view1Shared(Bench::State &state) {
+            shared(state, 1, nullptr);
+        }
+
+        void view4Independent(Bench::State &state) {
+            independent(state, 4);
+        }
+
+        void view4Shared(Bench::State &state) {
+            shared(state, 4, nullptr);
+        }
+
+        void view4SharedParallel(Bench::State &state) {
+            WorkerPool pool(3, "Benchmark worker");
+            shared(state, 4, &pool);
+        }
+    }
+
+    BCG_BENCHMARK_NAMED("View/1/independent", view1Independent);
+    BCG_BENCHMARK_NAMED("View/1/shared", view1Shared);
+    BCG_BENCHMARK_NAMED("View/4/independent", view4Independent);
+    BCG_BENCHMARK_NAMED("View/4/shared", view4Shared);
+    BCG_BENCHMARK_NAMED("View/4/shared/parallel", view4SharedParallel);
+}
@@ -14,7 +14,25 @@
 #include "CameraSystem.h"
 #include "TransformSystem.h"
 #include "AABBSystem.h"
-
+#include "BenchmarkReport.h"
+#include "PerfCounters.h"
+#include "Profiler.h"
+#include "FrameStats.h"
+#include "CameraPathStats.h"
+#include "CameraPathUtils.h"
+#include "SceneGenerator.h"
+#include "TaskGraph.h"
+#include "TripleBuffer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <exception>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
 #include <iostream> // Needed for Vertex Attribute Descriptions
 
 // Link Slang library
@@ -25,16 +43,67 @@
 
 
 namespace Bcg {
-    Application::Application(int width, int height, const std::string &title) {
+    namespace {
+        // Longest sleep while idle, bounds the latency of changes that arrive without a window event
+        constexpr double IdleWaitSeconds = 0.25;
+        // Rendered after the last change, ImGui needs a few frames to settle hover states and layout
+        constexpr uint32_t RedrawFrames = 3;
+
+        // Sums the CPU profiler scopes of the previous main loop iteration by name
+        void reportCpuStages(BenchmarkReport &report, uint64_t frame, std::vector<ProfileEvent> &events) {
+            uint64_t start = 0, end = 0;
+            Profiler::getLastFrame(events, start, end);
+            for (const auto &event: events) {
+                report.addCpuStageTime(frame, event.name, Profiler::ticksToMilliseconds(event.end - event.start));
+            }
+        }
+
+        // Work counters of the frame PerfCounters::endFrame() just closed
+        void reportCounters(BenchmarkReport &report, uint64_t frame) {
+            for (uint32_t i = 0; i < PerfCounters::CounterCount; ++i) {
+                auto counter = static_cast<PerfCounter>(i);
+                report.setCounter(frame, toString(counter), PerfCounters::getLast(counter));
+            }
+        }
+
+        // One decimal, for report fields
+        std::string formatDecimal(double value) {
+            char buffer[32];
+            std::snprintf(buffer, sizeof(buffer), "%.1f", value);
+            return buffer;
+        }
+
+        // Startup of the process. A cold run starts without shader_cache/ (delete it), the next run is warm.
+        void reportStartup(BenchmarkReport &report, VulkanContext &context, double timeToFirstFrame) {
+            ShaderCacheStats cacheStats = context.shaderCache.getStats();
+            report.setInfo("startup_shader_cache", cacheStats.misses == 0 ? "warm" : "cold");
+            report.setInfo("startup_init_ms", formatDecimal(context.initMilliseconds));
+            report.setInfo("startup_first_frame_ms", formatDecimal(timeToFirstFrame));
+            report.setInfo("startup_shader_hits", std::to_string(cacheStats.hits) + " (" +
+                                                  formatDecimal(cacheStats.hitMilliseconds) + " ms)");
+            report.setInfo("startup_shader_misses", std::to_string(cacheStats.misses) + " (" +
+                                                    formatDecimal(cacheStats.missMilliseconds) + " ms)");
+            // Serial against parallel builds (BCG_SERIAL_PIPELINES), without and with the persisted pipeline cache
+            report.setInfo("startup_pipeline_builds", context.serialPipelineJobs ? "serial" : "parallel");
+            report.setInfo("startup_pipeline_cache_bytes", std::to_string(context.pipelineCacheLoadedBytes));
+            report.setInfo("startup_pipeline_work_ms", formatDecimal(context.pipelineWorkMilliseconds));
+            report.setInfo("startup_pipeline_wait_ms", formatDecimal(context.pipelineWaitMilliseconds));
+        }
+    }
+
+    Application::Application(const ApplicationConfig &config) : m_config(config) {
         Log::Init();
         Log::setLevel(spdlog::level::debug);
 
+        m_startTime = std::chrono::steady_clock::now();
         m_lastFrameTime = std::chrono::high_resolution_clock::now();
 
         auto context = getApplicationContext();
-        context->windowManager = std::make_unique<WindowManager>(width, height, title);
+        // Headless the window manager is never initialized, it only provides the size
+        context->windowManager = std::make_unique<WindowManager>(m_config.width, m_config.height, m_config.title);
         context->registry = &m_registry;
-        context->dispatcher = &m_dispatcher;
+        context->eventBus = &m_eventBus;
+        context->config = &m_config;
         context->sceneManager = std::make_unique<SceneManager>();
         context->cameraSystem = std::make_unique<CameraSystem>();
         context->uiManager = std::make_unique<UIManager>();
@@ -42,6 +111,7 @@ namespace Bcg {
         context->inputManager = std::make_unique<InputManager>();
         context->transformSystem = std::make_unique<TransformSystem>();
         context->aabbSystem = std::make_unique<AABBSystem>();
+        context->frameStats = std::make_unique<FrameStats>();
     }
 
     Application::~Application() {
@@ -50,34 +120,175 @@ namespace Bcg {
 
     void Application::run() {
         auto context = getApplicationContext();
+        BCG_PROFILE_THREAD("Main");
 
-        context->windowManager->initialize(context);
-        context->sceneManager->initialize(context);
-        context->cameraSystem->initialize(context);
-        context->uiManager->initialize(context);
-        context->rendererSystem->initialize(context); // Renderer performs its specific setup
-        context->uiManager->initGLFWBackend(); // Initialize ImGui GLFW backend
-        context->inputManager->initialize(context);
-        context->transformSystem->initialize(context);
-        context->aabbSystem->initialize(context);
+        startup();
 
-        initECS();
+        // Started after the scene is set up, a replay starts from the same camera as its recording
+        if (!m_config.inputReplayPath.empty()) {
+            if (!context->inputManager->startReplay(m_config.inputReplayPath)) {
+                throw std::runtime_error("Cannot replay input from " + m_config.inputReplayPath);
+            }
+        } else if (!m_config.inputRecordPath.empty()) {
+            context->inputManager->startRecording();
+        }
+        if (!m_config.cameraPath.empty()) {
+            CameraPathComponent cameraPath;
+            if (!CameraPathUtils::load(m_config.cameraPath, cameraPath)) {
+                throw std::runtime_error("Cannot load camera path " + m_config.cameraPath);
+            }
+            m_cameraPathStats = std::make_unique<CameraPathStats>(cameraPath);
+            context->cameraSystem->setPath(std::move(cameraPath));
+        }
 
-        loadPlugins(); // Init plugins after core systems are ready
+        if (m_config.headless) {
+            headlessLoop();
+        } else if (m_config.threaded) {
+            threadedLoop();
+        } else {
+            mainLoop();
+        }
 
-        m_dispatcher.trigger<LoadModelEvent>({"models/star.obj"}); // Example load
+        if (!m_config.inputRecordPath.empty()) {
+            context->inputManager->saveRecording(m_config.inputRecordPath);
+        }
 
-        mainLoop();
+        if (!m_config.frameStatsPath.empty()) {
+            const std::vector<std::pair<std::string, std::string> > info = {
+                {"mode", m_config.headless ? "headless" : "windowed"},
+                {"resolution", std::to_string(m_config.width) + "x" + std::to_string(m_config.height)},
+                {"model", m_config.modelPath},
+                {"idle", m_config.idle && !m_config.headless ? "on" : "off"},
+                {"time_to_first_frame_ms", std::to_string(m_timeToFirstFrame)},
+                {"loop", m_config.threaded ? "threaded, " + std::to_string(m_config.simulationHz) + " Hz" : "single"},
+                {"simulation_ticks_per_second", formatDecimal(m_simulationRate)},
+                {"frames_per_second", formatDecimal(m_frameRate)}
+            };
+            if (context->frameStats->writeJson(m_config.frameStatsPath, info)) {
+                Log::Info("[Application::run] Wrote frame statistics to {}", m_config.frameStatsPath);
+            } else {
+                Log::Error("[Application::run] Cannot write frame statistics to {}", m_config.frameStatsPath);
+            }
+        }
+        if (m_cameraPathStats && !m_config.pathStatsPath.empty()) {
+            const std::vector<std::pair<std::string, std::string> > info = {
+                {"camera_path", m_config.cameraPath},
+                {"mode", m_config.headless ? "headless" : "windowed"},
+                {"resolution", std::to_string(m_config.width) + "x" + std::to_string(m_config.height)},
+                {"model", m_config.modelPath},
+                {"views", std::to_string(m_config.views)},
+                {"loop", m_config.threaded ? "threaded, " + std::to_string(m_config.simulationHz) + " Hz" : "single"}
+            };
+            if (m_cameraPathStats->writeJson(m_config.pathStatsPath, info)) {
+                Log::Info("[Application::run] Wrote camera path statistics to {}", m_config.pathStatsPath);
+            } else {
+                Log::Error("[Application::run] Cannot write camera path statistics to {}", m_config.pathStatsPath);
+            }
+        }
+
+        if (!m_config.tracePath.empty()) {
+            if (Profiler::writeChromeTrace(m_config.tracePath)) {
+                Log::Info("[Application::run] Wrote CPU trace to {}", m_config.tracePath);
+            } else {
+                Log::Error("[Application::run] Cannot write CPU trace to {}", m_config.tracePath);
+            }
+        }
 
         cleanup();
+        if (!m_headlessFailure.empty()) throw std::runtime_error(m_headlessFailure);
+    }
+
+    void Application::startup() {
+        auto context = getApplicationContext();
+        // Headless there is no window, no UI and input only from a replay
+        const bool windowed = !m_config.headless;
+        const bool benchScene = m_config.benchSceneEntities > 0;
+        ModelData startupModel;
+
+        // Startup as a dependency graph. The font atlas and the model file are prepared on workers and the pipelines
+        // build on VulkanContext's jobs while this thread creates the window and the Vulkan objects. GLFW, the ImGui
+        // backends and the registry stay on the main thread. CUDA and Slang are initialized on first use.
+        TaskGraph graph;
+        auto window = graph.add("window", [&]() {
+            if (windowed) context->windowManager->initialize(context);
+        }, {}, TaskThread::Main);
+        auto imguiContext = graph.add("imguiContext", [&]() {
+            if (windowed) context->uiManager->initialize(context);
+        }, {}, TaskThread::Main);
+        auto fontAtlas = graph.add("fontAtlas", [&]() {
+            if (windowed) context->uiManager->buildFontAtlas();
+        }, {imguiContext});
+        auto parseModel = graph.add("parseModel", [&]() {
+            if (!benchScene) SceneManager::parseModel(m_config.modelPath, startupModel);
+        });
+        auto systems = graph.add("systems", [&]() {
+            context->sceneManager->initialize(context);
+            context->cameraSystem->initialize(context); // Aspect ratio of the window size
+            context->cameraSystem->setViewLayout(m_config.views == 4   ? ViewLayout::Quad
+                                                 : m_config.views == 2 ? ViewLayout::SideBySide
+                                                                       : ViewLayout::Single);
+            context->inputManager->initialize(context);
+            context->transformSystem->initialize(context);
+            context->aabbSystem->initialize(context);
+            initECS();
+        }, {window}, TaskThread::Main);
+        auto renderer = graph.add("renderer", [&]() {
+            context->rendererSystem->initialize(context); // Renderer performs its specific setup
+        }, {window, systems}, TaskThread::Main);
+        auto uiBackends = graph.add("uiBackends", [&]() {
+            if (!windowed) return;
+            context->rendererSystem->getVulkanContext()->initUi(); // Uploads the atlas built by fontAtlas
+            context->uiManager->initGLFWBackend(); // Initialize ImGui GLFW backend
+        }, {renderer, imguiContext, fontAtlas}, TaskThread::Main);
+        auto plugins = graph.add("plugins", [&]() {
+            loadPlugins(); // Init plugins after core systems are ready
+        }, {systems, renderer, uiBackends}, TaskThread::Main);
+        auto scene = graph.add("scene", [&]() {
+            if (benchScene) {
+                SceneGeneratorConfig sceneConfig;
+                sceneConfig.entityCount = m_config.benchSceneEntities;
+                sceneConfig.meshCount = m_config.benchSceneMeshes;
+                sceneConfig.dirtyFraction = m_config.benchSceneDirtyFraction;
+                sceneConfig.seed = m_config.seed;
+                m_sceneGenerator = std::make_unique<SceneGenerator>();
+                m_sceneGenerator->generate(context, sceneConfig);
+            } else {
+                // Parse errors were logged, an empty model is reported once more as failed load
+                entt::entity entity = context->sceneManager->createModel(startupModel, m_config.modelPath);
+                addLoadedModel(entity, LoadModelEvent{m_config.modelPath});
+            }
+        }, {plugins, parseModel}, TaskThread::Main);
+        graph.add("pipelines", [&]() {
+            // Every pipeline must exist before the first frame
+            context->rendererSystem->getVulkanContext()->finishPipelineJobs();
+        }, {renderer, scene}, TaskThread::Main);
+        graph.run();
+
+        double total = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - m_startTime).count();
+        for (const TaskTiming &timing: graph.getTimings()) {
+            Log::Info("[Application::startup] {:<12} {:7.1f} - {:7.1f} ms ({})", timing.name, timing.start, timing.end,
+                      timing.thread == TaskThread::Main ? "main" : "worker");
+        }
+        Log::Info("[Application::startup] Started in {:.1f} ms, critical path {:.1f} ms.", total,
+                  graph.getCriticalPathMilliseconds());
+    }
+
+    void Application::logTimeToFirstFrame() {
+        if (m_timeToFirstFrame > 0.0) return;
+        m_timeToFirstFrame = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - m_startTime).count();
+        Log::Info("[Application] First frame after {:.1f} ms.", m_timeToFirstFrame);
     }
 
     void Application::initECS() {
         Log::Info("Initializing ECS...");
 
         // Connect event listeners
-        m_dispatcher.sink<WindowResizeEvent>().connect<&Application::onWindowResize>(this);
-        m_dispatcher.sink<LoadModelEvent>().connect<&Application::onLoadModelRequest>(this);
+        m_eventBus.subscribe<WindowResizeEvent>([this](const WindowResizeEvent &event) { onWindowResize(event); });
+        // Loads read files and upload meshes, a burst of them is spread over frames
+        m_eventBus.subscribe<LoadModelEvent>([this](const LoadModelEvent &event) { onLoadModelRequest(event); },
+                                             EventDelivery::Deferred);
     }
 
     void Application::loadPlugins() {
@@ -103,56 +314,558 @@ namespace Bcg {
     }
 
     void Application::mainLoop() {
-        auto vkContext = m_applicationContext.rendererSystem->getVulkanContext();
+        auto *renderer = m_applicationContext.rendererSystem.get();
+        auto vkContext = renderer->getVulkanContext();
+        auto *windowManager = m_applicationContext.windowManager.get();
+        RenderSnapshot snapshot; // Refers to the registry
+        uint64_t simulationTicks = 0, renderedFrames = 0;
+        const auto loopStart = std::chrono::steady_clock::now();
+
+        // Nothing changed in the last iteration: sleep until an event instead of rendering the same image again
+        bool idle = false;
+        m_activityStart = std::chrono::high_resolution_clock::now();
+        m_activityCpuStart = FrameStats::processCpuSeconds();
+
+        const uint64_t frameLimit = m_config.limitFrames ? m_config.frameCount : std::numeric_limits<uint64_t>::max();
+        while (!windowManager->shouldClose() && renderedFrames < frameLimit) {
+            BCG_PROFILE_FRAME();
+            // --- Input ---
+            {
+                BCG_PROFILE_SCOPE("pollEvents");
+                if (idle) {
+                    WindowManager::waitEvents(IdleWaitSeconds);
+                } else {
+                    windowManager->pollEvents(); // Check for window events, input, etc.
+                }
+            }
+            // Nothing is submitted while minimized, restoring resizes the framebuffer which ends the idle state
+            if (windowManager->isMinimized()) {
+                recordActivity(true);
+                idle = true;
+                continue;
+            }
+            if (idle) {
+                // The wait is neither simulated nor part of the frame time
+                recordActivity(true);
+                m_lastFrameTime = std::chrono::high_resolution_clock::now();
+            }
 
-        while (!m_applicationContext.windowManager->shouldClose()) {
             auto currentTime = std::chrono::high_resolution_clock::now();
             float deltaTime = std::chrono::duration<float, std::chrono::seconds::period>(
                     currentTime - m_lastFrameTime).
                     count();
             m_lastFrameTime = currentTime;
 
+            {
+                // Camera and scene work for the events the callbacks queued, coalesced once per frame
+                BCG_PROFILE_SCOPE("dispatchInput");
+                m_applicationContext.inputManager->dispatchEvents();
+            }
+            // Recorded events and time step in place of the GLFW input, which the callbacks ignore while replaying
+            if (m_applicationContext.inputManager->isReplaying()) {
+                BCG_PROFILE_SCOPE("replayInput");
+                if (!m_applicationContext.inputManager->replayFrame(deltaTime)) break;
+            }
+            {
+                BCG_PROFILE_SCOPE("processInput");
+                m_applicationContext.inputManager->processInput(deltaTime); // Continuous input (e.g., key holds)
+            }
+            // The path overrides the camera input, one step of its fixed time step per simulated frame
+            if (m_cameraPathStats && !updateCameraPath()) break;
+            // Deferred handlers (loads) within the budget, the rest in the next frames
+            m_eventBus.update(m_config.eventBudgetMilliseconds);
+
+            // --- Idle ---
+            if (!m_config.idle || needsRedraw()) m_redrawFrames = RedrawFrames;
+            idle = m_redrawFrames == 0;
+            if (idle) {
+                recordActivity(true);
+                continue;
+            }
+            --m_redrawFrames;
+
+            // --- Update ---
+            updateSimulation(deltaTime);
+
+            // --- Render ---
+            // The same split as threaded: the snapshot (camera, UI) ends the simulated part of the frame
+            renderer->captureSnapshot(snapshot, false);
+            double simulationMilliseconds = std::chrono::duration<double, std::milli>(
+                std::chrono::high_resolution_clock::now() - currentTime).count();
+            if (renderer->render(snapshot)) {
+                auto presented = std::chrono::high_resolution_clock::now();
+                FrameTimes times = renderer->getLastFrameTimes();
+                times[static_cast<size_t>(FrameMetric::Cpu)] = std::chrono::duration<double, std::milli>(
+                    presented - currentTime).count();
+                times[static_cast<size_t>(FrameMetric::Simulation)] = simulationMilliseconds;
+                times[static_cast<size_t>(FrameMetric::Latency)] = times[static_cast<size_t>(FrameMetric::Cpu)];
+                m_applicationContext.frameStats->record(times);
+                PerfCounters::endFrame();
+                recordCameraPathFrame(m_cameraPathSegment, times);
+                ++renderedFrames;
+                logTimeToFirstFrame();
+            }
+            ++simulationTicks;
+            recordActivity(false);
+        }
+
+        logThroughput("Application::mainLoop", simulationTicks, renderedFrames, loopStart);
+
+        // Wait for device to finish operations before cleanup
+        VK_CHECK(vkDeviceWaitIdle(vkContext->device));
+    }
+
+    void Application::threadedLoop() {
+        auto *renderer = m_applicationContext.rendererSystem.get();
+        auto vkContext = renderer->getVulkanContext();
+        auto *windowManager = m_applicationContext.windowManager.get();
+        auto *inputManager = m_applicationContext.inputManager.get();
+        auto *frameStats = m_applicationContext.frameStats.get();
+
+        // One frame single-threaded: ImGui's Vulkan backend creates its font texture while recording the first frame
+        updateSimulation(0.0f);
+        renderer->drawFrame();
+        logTimeToFirstFrame();
+        // GLFW only allows the main thread to query the window, the swapchain is recreated here
+        renderer->setDeferSwapChainRecreation(true);
+
+        // The simulation writes the newest frame while the render thread reads the one before, neither waits
+        TripleBuffer<RenderSnapshot> snapshots;
+        std::mutex wakeMutex;
+        std::condition_variable wake;
+        bool stop = false; // Guarded by wakeMutex
+        std::atomic<bool> failed{false};
+        std::exception_ptr renderError;
+        std::atomic<uint64_t> renderedFrames{0};
+
+        std::thread renderThread([&] {
+            BCG_PROFILE_THREAD("Render");
+            try {
+                while (true) {
+                    {
+                        std::unique_lock<std::mutex> lock(wakeMutex);
+                        wake.wait(lock, [&] { return stop || snapshots.hasNew(); });
+                        if (stop) break;
+                    }
+                    snapshots.update();
+                    RenderSnapshot &snapshot = snapshots.front();
+                    auto start = std::chrono::steady_clock::now();
+                    if (!renderer->render(snapshot)) continue;
+                    auto presented = std::chrono::steady_clock::now();
+
+                    FrameTimes times = renderer->getLastFrameTimes();
+                    times[static_cast<size_t>(FrameMetric::Cpu)] = std::chrono::duration<double, std::milli>(
+                        presented - start).count();
+                    times[static_cast<size_t>(FrameMetric::Simulation)] = snapshot.simulationMilliseconds;
+                    times[static_cast<size_t>(FrameMetric::Latency)] = std::chrono::duration<double, std::milli>(
+                        presented - snapshot.inputTime).count();
+                    {
+                        // The UI reads the statistics while it is built
+                        std::lock_guard<std::mutex> lock(renderer->getMutex());
+                        frameStats->record(times);
+                        // Includes the simulation ticks since the previous rendered frame
+                        PerfCounters::endFrame();
+                        recordCameraPathFrame(snapshot.cameraPathSegment, times);
+                    }
+                    renderedFrames.fetch_add(1, std::memory_order_relaxed);
+                }
+            } catch (...) {
+                renderError = std::current_exception();
+                failed.store(true, std::memory_order_release);
+            }
+        });
+
+        const auto tick = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(1.0 / m_config.simulationHz));
+        auto nextTick = std::chrono::steady_clock::now();
+        uint64_t simulationTicks = 0;
+        const auto loopStart = std::chrono::steady_clock::now();
+
+        bool idle = false;
+        m_activityStart = std::chrono::high_resolution_clock::now();
+        m_activityCpuStart = FrameStats::processCpuSeconds();
+
+        // Counts the frames of the render thread only, the first one above is not part of the comparison
+        const uint64_t frameLimit = m_config.limitFrames ? m_config.frameCount : std::numeric_limits<uint64_t>::max();
+        while (!windowManager->shouldClose() && !failed.load(std::memory_order_acquire) &&
+               renderedFrames.load(std::memory_order_relaxed) < frameLimit) {
+            BCG_PROFILE_FRAME();
             // --- Input ---
-            m_applicationContext.windowManager->pollEvents(); // Check for window events, input, etc.
-            m_applicationContext.inputManager->processInput(deltaTime); // Handle continuous input (e.g., key holds)
+            {
+                BCG_PROFILE_SCOPE("pollEvents");
+                if (idle) {
+                    WindowManager::waitEvents(IdleWaitSeconds);
+                } else {
+                    windowManager->pollEvents();
+                }
+            }
+            renderer->recreateSwapChainIfRequested();
+            if (windowManager->isMinimized()) {
+                recordActivity(true);
+                idle = true;
+                continue;
+            }
+            if (idle) {
+                recordActivity(true);
+                m_lastFrameTime = std::chrono::high_resolution_clock::now();
+                nextTick = std::chrono::steady_clock::now();
+            }
+
+            auto inputTime = std::chrono::steady_clock::now();
+            auto currentTime = std::chrono::high_resolution_clock::now();
+            float deltaTime = std::chrono::duration<float, std::chrono::seconds::period>(
+                currentTime - m_lastFrameTime).count();
+            m_lastFrameTime = currentTime;
+
+            bool replayEnded = false, pathEnded = false;
+            {
+                // Loading a model uploads and frees geometry the render thread may be recording
+                std::lock_guard<std::mutex> lock(renderer->getMutex());
+                {
+                    BCG_PROFILE_SCOPE("dispatchInput");
+                    inputManager->dispatchEvents();
+                }
+                if (inputManager->isReplaying()) {
+                    BCG_PROFILE_SCOPE("replayInput");
+                    replayEnded = !inputManager->replayFrame(deltaTime);
+                }
+                if (!replayEnded) {
+                    BCG_PROFILE_SCOPE("processInput");
+                    inputManager->processInput(deltaTime);
+                    m_eventBus.update(m_config.eventBudgetMilliseconds);
+                }
+                if (m_cameraPathStats) pathEnded = !updateCameraPath();
+            }
+            if (replayEnded || pathEnded) break;
+
+            // --- Idle ---
+            if (!m_config.idle || needsRedraw()) m_redrawFrames = RedrawFrames;
+            idle = m_redrawFrames == 0;
+            if (idle) {
+                recordActivity(true);
+                continue;
+            }
+            --m_redrawFrames;
 
             // --- Update ---
-            m_applicationContext.aabbSystem->update();
+            updateSimulation(deltaTime);
+
+            // --- Handoff ---
+            RenderSnapshot &snapshot = snapshots.back();
+            {
+                // Building the UI uses the ImGui context the render thread records from
+                std::lock_guard<std::mutex> lock(renderer->getMutex());
+                renderer->captureSnapshot(snapshot, true);
+            }
+            snapshot.simulationFrame = simulationTicks++;
+            snapshot.cameraPathSegment = m_cameraPathSegment;
+            snapshot.inputTime = inputTime;
+            snapshot.simulationMilliseconds = std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - inputTime).count();
+            snapshots.publish();
+            {
+                // Taken so that the render thread cannot miss the notification between its check and its wait
+                std::lock_guard<std::mutex> lock(wakeMutex);
+            }
+            wake.notify_one();
+            recordActivity(false);
+
+            // --- Pacing ---
+            nextTick += tick;
+            auto now = std::chrono::steady_clock::now();
+            if (nextTick < now) {
+                nextTick = now; // Behind, e.g. after a hitch: continue at the rate instead of catching up
+            } else {
+                BCG_PROFILE_SCOPE("simulationWait");
+                std::this_thread::sleep_until(nextTick);
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex);
+            stop = true;
+        }
+        wake.notify_one();
+        renderThread.join();
+        renderer->setDeferSwapChainRecreation(false);
+
+        logThroughput("Application::threadedLoop", simulationTicks, renderedFrames.load(), loopStart);
+
+        VK_CHECK(vkDeviceWaitIdle(vkContext->device));
+        if (renderError) std::rethrow_exception(renderError);
+    }
+
+    void Application::updateSimulation(float deltaTime) {
+        if (m_sceneGenerator) {
+            BCG_PROFILE_SCOPE("sceneMotion");
+            m_sceneGenerator->update(deltaTime);
+        }
+        // Bounds are built from the model matrices, which must be updated first
+        {
+            BCG_PROFILE_SCOPE("transformSystem");
             m_applicationContext.transformSystem->update();
+        }
+        {
+            BCG_PROFILE_SCOPE("aabbSystem");
+            m_applicationContext.aabbSystem->update();
+        }
 
-            // Update entity transforms (simple example)
-            auto view = m_registry.view<TransformComponent>();
-            for (auto entity: view) {
-                // Example: Simple rotation
-                // if (m_registry.all_of<RotateMe>(entity)) { ... }
-                // view.get<TransformComponent>(entity).updateModelMatrix();
-            }
+        // Update entity transforms (simple example)
+        auto view = m_registry.view<TransformComponent>();
+        for (auto entity: view) {
+            // Example: Simple rotation
+            // if (m_registry.all_of<RotateMe>(entity)) { ... }
+            // view.get<TransformComponent>(entity).updateModelMatrix();
+        }
 
-            // Update Plugins
+        // Update Plugins
+        {
+            BCG_PROFILE_SCOPE("plugins");
             for (auto &plugin: m_plugins) {
                 plugin->update(deltaTime);
             }
+        }
+
+        // TODO: Run other application/ECS systems (Physics, Animation, AI...)
 
-            // TODO: Run other application/ECS systems (Physics, Animation, AI...)
+        // --- Process Dirty Resources ---
+        // Example: If a system marked a mesh as dirty, re-upload it
+        auto dirtyView = m_registry.view<DirtyGPUResource, VulkanMeshComponent /*, OtherDataComponent*/>();
+        for (auto entity: dirtyView) {
+            // Re-fetch data from source components (e.g., CPU-side mesh data)
+            // const auto& cpuMeshData = m_registry.get<CPUMeshData>(entity);
+            // m_renderer->uploadMesh(entity, cpuMeshData.vertices, cpuMeshData.indices);
+            m_registry.remove<DirtyGPUResource>(entity); // Clear flag
+        }
+    }
 
-            // --- Process Dirty Resources ---
-            // Example: If a system marked a mesh as dirty, re-upload it
-            auto dirtyView = m_registry.view<DirtyGPUResource, VulkanMeshComponent /*, OtherDataComponent*/>();
-            for (auto entity: dirtyView) {
-                // Re-fetch data from source components (e.g., CPU-side mesh data)
-                // const auto& cpuMeshData = m_registry.get<CPUMeshData>(entity);
-                // m_renderer->uploadMesh(entity, cpuMeshData.vertices, cpuMeshData.indices);
-                m_registry.remove<DirtyGPUResource>(entity); // Clear flag
+    void Application::headlessLoop() {
+        auto *renderer = m_applicationContext.rendererSystem.get();
+        auto *vkContext = renderer->getVulkanContext();
+
+        BenchmarkReport report;
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(vkContext->physicalDevice, &properties);
+        report.setInfo("device", properties.deviceName);
+        report.setInfo("resolution", std::to_string(m_config.width) + "x" + std::to_string(m_config.height));
+        if (m_sceneGenerator) {
+            report.setInfo("scene", std::to_string(m_config.benchSceneEntities) + " entities, " +
+                                    std::to_string(m_config.benchSceneMeshes) + " meshes, dirty " +
+                                    std::to_string(m_config.benchSceneDirtyFraction) + ", seed " +
+                                    std::to_string(m_config.seed));
+        } else {
+            report.setInfo("model", m_config.modelPath);
+        }
+        // A replay renders its recorded frames, with the recorded time steps instead of the fixed one
+        auto *inputManager = m_applicationContext.inputManager.get();
+        const bool replaying = inputManager->isReplaying();
+        // A camera path renders its frames once, a looping one config.frameCount frames
+        const CameraPathComponent *cameraPath = m_applicationContext.cameraSystem->getPath();
+        auto frameCount = replaying ? static_cast<uint32_t>(inputManager->getReplayFrameCount())
+                                    : m_config.frameCount;
+        if (cameraPath && !cameraPath->loop) frameCount = CameraPathUtils::getFrameCount(*cameraPath);
+        if (replaying) report.setInfo("input", m_config.inputReplayPath);
+        if (cameraPath) report.setInfo("camera_path", m_config.cameraPath);
+        // The first frames include uploads and lazily created buffers
+        report.warmupFrames = std::min<uint32_t>(10, frameCount / 10);
+        auto &culling = renderer->getGpuCulling();
+        if (m_config.validateCulling) {
+            culling.enabled = true;
+            culling.validate = true;
+        }
+        auto &profiler = renderer->getGpuProfiler();
+        profiler.onFrameProfile = [&report](const GpuFrameProfile &profile) {
+            report.setGpuTime(profile.frame, profile.totalMilliseconds);
+            for (const auto &scope: profile.scopes) {
+                report.setGpuScopeTime(profile.frame, scope.name, scope.milliseconds);
+            }
+            if (profile.hasStatistics) {
+                const GpuPipelineStatistics &statistics = profile.statistics;
+                report.setGpuCounter(profile.frame, "input_assembly_vertices", statistics.inputAssemblyVertices);
+                report.setGpuCounter(profile.frame, "input_assembly_primitives", statistics.inputAssemblyPrimitives);
+                report.setGpuCounter(profile.frame, "vertex_shader_invocations", statistics.vertexShaderInvocations);
+                report.setGpuCounter(profile.frame, "clipping_invocations", statistics.clippingInvocations);
+                report.setGpuCounter(profile.frame, "clipping_primitives", statistics.clippingPrimitives);
+                report.setGpuCounter(profile.frame, "fragment_shader_invocations",
+                                     statistics.fragmentShaderInvocations);
+            }
+        };
+
+        Log::Info("[Application::headlessLoop] Rendering {} frames at {}x{} on {}", frameCount,
+                  m_config.width, m_config.height, properties.deviceName);
+        // Fixed time step, runs are reproducible independent of the frame rate. The scene moves at the path's.
+        float deltaTime = cameraPath ? cameraPath->timeStep : 1.0f / 60.0f;
+        // Per-stage CPU times come from the profiler scopes of the previous iteration, read outside the timing
+        std::vector<ProfileEvent> stageEvents;
+        uint64_t previousFrame = 0;
+
+        // Load while rendering: parsed here, the measured frames only create the entity and upload its mesh
+        const bool loading = m_config.loadEveryFrames > 0;
+        ModelData loadModel;
+        if (loading && !SceneManager::parseModel(m_config.modelPath, loadModel)) {
+            throw std::runtime_error("Cannot parse " + m_config.modelPath + " for --load-every");
+        }
+        uint32_t loads = 0;
+        uint64_t loadHitches = 0;
+
+        for (uint32_t i = 0; i < frameCount; ++i) {
+            BCG_PROFILE_FRAME();
+            if (i > 0) reportCpuStages(report, previousFrame, stageEvents);
+            auto frameStart = std::chrono::high_resolution_clock::now();
+
+            const bool loadFrame = loading && i >= report.warmupFrames &&
+                                   (i - report.warmupFrames) % m_config.loadEveryFrames == 0;
+            if (loadFrame) {
+                BCG_PROFILE_SCOPE("loadWhileRendering");
+                LoadModelEvent event{m_config.modelPath};
+                event.initialPosition = Vector3f(2.0f * static_cast<float>(++loads), 0.0f, 0.0f);
+                addLoadedModel(m_applicationContext.sceneManager->createModel(loadModel, m_config.modelPath), event);
             }
+            const uint64_t hitchesBefore = m_applicationContext.frameStats->getHitchCount();
 
-            // --- Render ---
-            if (m_applicationContext.rendererSystem) {
-                m_applicationContext.rendererSystem->drawFrame();
+            if (replaying) {
+                BCG_PROFILE_SCOPE("replayInput");
+                inputManager->replayFrame(deltaTime);
+                inputManager->processInput(deltaTime);
+            }
+            if (cameraPath) updateCameraPath();
+            m_eventBus.update(m_config.eventBudgetMilliseconds);
+
+            if (m_sceneGenerator) {
+                BCG_PROFILE_SCOPE("sceneMotion");
+                m_sceneGenerator->update(deltaTime);
+            }
+            {
+                BCG_PROFILE_SCOPE("transformSystem");
+                m_applicationContext.transformSystem->update();
+            }
+            {
+                BCG_PROFILE_SCOPE("aabbSystem");
+                m_applicationContext.aabbSystem->update();
+            }
+            {
+                BCG_PROFILE_SCOPE("plugins");
+                for (auto &plugin: m_plugins) {
+                    plugin->update(deltaTime);
+                }
+            }
+
+            uint64_t frame = renderer->getFrameNumber();
+            previousFrame = frame;
+            renderer->drawFrame();
+            if (i == 0) logTimeToFirstFrame();
+            FrameTimes times = renderer->getLastFrameTimes();
+            times[static_cast<size_t>(FrameMetric::Cpu)] = std::chrono::duration<double, std::milli>(
+                std::chrono::high_resolution_clock::now() - frameStart).count();
+            m_applicationContext.frameStats->record(times);
+            PerfCounters::endFrame();
+            recordCameraPathFrame(m_cameraPathSegment, times);
+            report.setCpuTime(frame, times[static_cast<size_t>(FrameMetric::Cpu)]);
+            reportCounters(report, frame);
+            if (loadFrame && m_applicationContext.frameStats->getHitchCount() > hitchesBefore) ++loadHitches;
+        }
+        if (loading) {
+            // The frames of a load show their uploaded bytes in the per-frame counters of the report
+            Log::Info("[Application::headlessLoop] {} loads while rendering, {} of their frames were hitches "
+                      "(> {:.1f}x the average)", loads, loadHitches, m_applicationContext.frameStats->hitchFactor);
+            report.setInfo("load_every", std::to_string(m_config.loadEveryFrames));
+            report.setInfo("loads", std::to_string(loads));
+            report.setInfo("load_hitches", std::to_string(loadHitches));
+            if (loadHitches > 0) {
+                failHeadless("Load while rendering: " + std::to_string(loadHitches) + " of " +
+                             std::to_string(loads) + " loads caused a hitch");
             }
         }
 
-        // Wait for device to finish operations before cleanup
+        BCG_PROFILE_FRAME();
+        if (frameCount > 0) reportCpuStages(report, previousFrame, stageEvents);
+
         VK_CHECK(vkDeviceWaitIdle(vkContext->device));
+        renderer->collectGpuFrameTimes();
+        profiler.onFrameProfile = nullptr;
+        reportStartup(report, *vkContext, m_timeToFirstFrame);
+        if (m_config.validateCulling) {
+            const GpuCullingStats &stats = culling.getStats();
+            Log::Info("[Application::headlessLoop] Culling validated in {} frames, {} mismatched",
+                      stats.validatedFrames, stats.mismatchedFrames);
+            report.setInfo("culling_validated_frames", std::to_string(stats.validatedFrames));
+            report.setInfo("culling_mismatched_frames", std::to_string(stats.mismatchedFrames));
+            if (stats.validatedFrames == 0) {
+                failHeadless("GPU culling validation: no frame was validated (empty scene?)");
+            } else if (stats.mismatchedFrames > 0) {
+                failHeadless("GPU culling validation: " + std::to_string(stats.mismatchedFrames) + " of " +
+                             std::to_string(stats.validatedFrames) + " frames differ from the CPU reference");
+            }
+        }
+
+        if (!m_config.screenshotPath.empty()) {
+            renderer->saveLastFrame(m_config.screenshotPath);
+        }
+        if (!m_config.reportPath.empty()) {
+            if (report.write(m_config.reportPath)) {
+                Log::Info("[Application::headlessLoop] Wrote timing report to {}", m_config.reportPath);
+            } else {
+                Log::Error("[Application::headlessLoop] Cannot write timing report to {}", m_config.reportPath);
+            }
+        }
+    }
+
+    bool Application::updateCameraPath() {
+        BCG_PROFILE_SCOPE("cameraPath");
+        auto *cameraSystem = m_applicationContext.cameraSystem.get();
+        if (!cameraSystem->updatePath()) return false;
+        m_cameraPathSegment = static_cast<int32_t>(CameraPathUtils::getSegment(*cameraSystem->getPath(),
+                                                                               cameraSystem->getPath()->time));
+        return true;
+    }
+
+    void Application::recordCameraPathFrame(int32_t segment, const FrameTimes &times) {
+        if (m_cameraPathStats && segment >= 0) m_cameraPathStats->record(static_cast<uint32_t>(segment), times);
+    }
+
+    void Application::failHeadless(const std::string &message) {
+        Log::Error("[Application::headlessLoop] {}", message);
+        m_headlessFailure += (m_headlessFailure.empty() ? "" : "; ") + message;
+    }
+
+    bool Application::needsRedraw() {
+        uint64_t eventCount = m_applicationContext.windowManager->getEventCount();
+        if (eventCount != m_lastEventCount) {
+            m_lastEventCount = eventCount;
+            return true;
+        }
+        const auto &inputManager = *m_applicationContext.inputManager;
+        if (inputManager.isReplaying() || inputManager.hasHeldKeys() || m_eventBus.getPendingCount() > 0) return true;
+        // Plugins only update in rendered frames, none of them animates on its own yet
+        if (m_sceneGenerator && m_config.benchSceneDirtyFraction > 0.0f) return true;
+        if (m_registry.view<TransformNeedsUpdate>().size() > 0 || m_registry.view<NeedsAABBUpdate>().size() > 0 ||
+            m_registry.view<DirtyGPUResource>().size() > 0) {
+            return true;
+        }
+        auto *camera = m_applicationContext.cameraSystem->getCurrentCamera();
+        return camera && (camera->dirtyView || camera->dirtyProjection);
+    }
+
+    void Application::recordActivity(bool idle) {
+        auto now = std::chrono::high_resolution_clock::now();
+        double cpuSeconds = FrameStats::processCpuSeconds();
+        // Threaded the render thread records its frames concurrently
+        std::lock_guard<std::mutex> lock(m_applicationContext.rendererSystem->getMutex());
+        m_applicationContext.frameStats->recordActivity(
+            idle, std::chrono::duration<double>(now - m_activityStart).count(), cpuSeconds - m_activityCpuStart);
+        m_activityStart = now;
+        m_activityCpuStart = cpuSeconds;
+    }
+
+    void Application::logThroughput(const char *loop, uint64_t simulationTicks, uint64_t renderedFrames,
+                                    std::chrono::steady_clock::time_point start) {
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (seconds <= 0.0) return;
+        m_simulationRate = static_cast<double>(simulationTicks) / seconds;
+        m_frameRate = static_cast<double>(renderedFrames) / seconds;
+        Log::Info("[{}] {} simulation ticks ({:.1f}/s), {} frames rendered ({:.1f}/s) in {:.1f} s", loop,
+                  simulationTicks, static_cast<double>(simulationTicks) / seconds, renderedFrames,
+                  static_cast<double>(renderedFrames) / seconds, seconds);
     }
 
     void Application::cleanup() {
@@ -187,9 +900,12 @@ namespace Bcg {
             m_applicationContext.rendererSystem.reset(); // Destroys renderer instance
         }
 
-        m_applicationContext.uiManager->shutdown();
+        if (!m_config.headless) {
+            m_applicationContext.uiManager->shutdown();
+        }
 
         Log::Info("Application cleanup complete.");
+        Log::Shutdown(); // Writes the queued messages, later ones are written synchronously
     }
 
 
@@ -197,7 +913,7 @@ namespace Bcg {
 
     void Application::onWindowResize(const WindowResizeEvent &event) {
         // Set flag for Vulkan context to handle swapchain recreation
-        m_applicationContext.windowManager->m_framebufferResized = true;
+        m_applicationContext.rendererSystem->notifyFramebufferResized();
         // Update window dimensions
         m_applicationContext.windowManager->setWindowSize(event.width, event.height);
 
@@ -206,26 +922,44 @@ namespace Bcg {
             auto camera = m_applicationContext.cameraSystem->getCurrentCamera();
             camera->aspectRatio = (float) event.width / (float) event.height;
             camera->dirtyProjection = true;
-            Log::Trace("Window resized: {}x{}, aspect ratio updated to: {}", event.width, event.height,
-                       camera->aspectRatio);
+            BCG_LOG_TRACE("Window resized: {}x{}, aspect ratio updated to: {}", event.width, event.height,
+                          camera->aspectRatio);
         }
     }
 
     void Application::onLoadModelRequest(const LoadModelEvent &event) {
+        if (event.replaceScene) {
+            Log::Info("[Application::onLoadModelRequest] Waiting for GPU idle before replacing the scene");
+            VK_CHECK(vkDeviceWaitIdle(m_applicationContext.rendererSystem->getVulkanContext()->device));
+            m_applicationContext.sceneManager->clearScene();
+            m_applicationContext.cameraFocusEntity = entt::null;
+        }
+
         // Delegate to the loading function
-        entt::entity loadedEntity = m_applicationContext.sceneManager->loadModel(event.filepath);
+        addLoadedModel(m_applicationContext.sceneManager->loadModel(event.filepath), event);
+    }
+
+    void Application::addLoadedModel(entt::entity loadedEntity, const LoadModelEvent &event) {
+        if (loadedEntity == entt::null) {
+            Log::Error("Model loading failed for '{}', cannot set focus.", event.filepath);
+            return;
+        }
 
         auto &transform = m_registry.emplace<TransformComponent>(loadedEntity);
         transform.position = event.initialPosition;
         transform.rotation = event.initialRot;
         transform.scale = event.initialScale;
         transform.dirty = true;
+        // The scene panels show the new entity without waiting for the refresh of a static UI
+        m_applicationContext.uiManager->invalidate();
 
-
-
-        if (loadedEntity == entt::null) {
-            Log::Error("Model loading failed for '{}', cannot set focus.", event.filepath);
-            return;
+        if (event.replaceScene) {
+            m_applicationContext.cameraFocusEntity = loadedEntity;
+            auto camera = m_applicationContext.cameraSystem->getCurrentCamera();
+            if (camera) {
+                camera->target = transform.position;
+                camera->dirtyView = true;
+            }
         }
     }
 } // namespace Bcg
@@ -9,19 +9,23 @@
 #include <vector>
 #include <chrono>
 #include <memory>
+#include <string>
 
 // --- External Libraries ---
 
 
 
 
-#include <entt/entt.hpp> // EnTT ECS and Dispatcher
+#include <entt/entt.hpp> // EnTT ECS
 
 #include "VulkanContext.h"
 #include "MatVec.h"
 #include "Components.h"
 #include "Events.h"
 #include "ApplicationContext.h"
+#include "ApplicationConfig.h"
+#include "EventBus.h"
+#include "FrameStats.h"
 
 // --- Forward Declarations ---
 namespace Bcg {
@@ -42,12 +46,16 @@ namespace Bcg {
     class CameraSystem;
 
     class SceneManager;
+
+    class SceneGenerator;
+
+    class CameraPathStats;
 } // namespace Bcg
 
 namespace Bcg {
     class Application {
     public:
-        Application(int width = 1280, int height = 720, const std::string &title = "Vulkan EnTT App");
+        explicit Application(const ApplicationConfig &config = {});
 
         ~Application();
 
@@ -58,12 +66,49 @@ namespace Bcg {
             return &m_applicationContext;
         }
 
+        // Initializes the managers and systems and loads the scene, independent steps concurrently
+        void startup();
+
+        // Once, after the first frame was submitted
+        void logTimeToFirstFrame();
+
         void initECS();
 
         void loadPlugins(); // Placeholder
 
         void mainLoop();
 
+        // Windowed with config.threaded: input, systems and UI on this thread at config.simulationHz, the newest
+        // simulated frame is rendered on a render thread
+        void threadedLoop();
+
+        // Systems of one simulated frame, after the input
+        void updateSimulation(float deltaTime);
+
+        // Renders config.frameCount frames offscreen and writes the report and screenshot
+        void headlessLoop();
+
+        // Moves the camera to the next frame of config.cameraPath and remembers its segment, false once it ended
+        bool updateCameraPath();
+
+        // Frame times of a frame rendered in the segment, -1 (no path) is ignored
+        void recordCameraPathFrame(int32_t segment, const FrameTimes &times);
+
+        // Logs a failed headless check, run() throws all of them together once the run is cleaned up
+        void failHeadless(const std::string &message);
+
+        // Anything to show since the last check: window events (input, resize, expose), held keys, animation, a replay
+        // or pending transform, bounds, GPU resource or camera updates
+        bool needsRedraw();
+
+        // Time since the previous call to the frame statistics, as idle or interactive
+        void recordActivity(bool idle);
+
+        // Simulated and rendered frames per second of a windowed loop, logged at its end and kept for the frame
+        // statistics
+        void logThroughput(const char *loop, uint64_t simulationTicks, uint64_t renderedFrames,
+                           std::chrono::steady_clock::time_point start);
+
         void cleanup();
 
         // Event Handlers
@@ -71,16 +116,35 @@ namespace Bcg {
 
         void onLoadModelRequest(const LoadModelEvent &event); // Example event listener
 
+        // Places the entity of a loaded model as the event requests, logs entt::null as a failed load
+        void addLoadedModel(entt::entity loadedEntity, const LoadModelEvent &event);
+
+        ApplicationConfig m_config;
         ApplicationContext m_applicationContext;
 
         entt::registry m_registry;
-        entt::dispatcher m_dispatcher;
+        EventBus m_eventBus;
 
         // Plugins
         std::vector<std::unique_ptr<IPlugin> > m_plugins;
 
+        std::unique_ptr<SceneGenerator> m_sceneGenerator; // Only with config.benchSceneEntities
+        std::unique_ptr<CameraPathStats> m_cameraPathStats; // Only with config.cameraPath
+        int32_t m_cameraPathSegment = -1; // Of the last applied path frame
+        std::string m_headlessFailure; // Failed headless checks, see failHeadless()
+
         // Timing
+        std::chrono::steady_clock::time_point m_startTime; // Construction, the start of time-to-first-frame
+        double m_timeToFirstFrame = 0.0; // Milliseconds, 0 before the first frame
+        double m_simulationRate = 0.0; // Ticks per second of the windowed loop, see logThroughput()
+        double m_frameRate = 0.0; // Rendered frames per second of the windowed loop
         std::chrono::high_resolution_clock::time_point m_lastFrameTime;
+
+        // Idle mode, frames still rendered after the last change and what was already seen
+        uint32_t m_redrawFrames = 0;
+        uint64_t m_lastEventCount = 0;
+        std::chrono::high_resolution_clock::time_point m_activityStart;
+        double m_activityCpuStart = 0.0;
     };
 } // namespace Bcg
 
@@ -0,0 +1,165 @@
+//
+// Created by alex on 5/2/25.
+//
+
+#include "ApplicationConfig.h"
+
+#include <stdexcept>
+
+namespace Bcg {
+    namespace {
+        long parseInteger(const std::string &option, const std::string &text, long min, long max) {
+            size_t end = 0;
+            long result = 0;
+            try {
+                result = std::stol(text, &end);
+            } catch (const std::exception &) {
+                end = 0;
+            }
+            if (end == 0 || end != text.size() || result < min || result > max) {
+                throw std::invalid_argument(option + " expects an integer in [" + std::to_string(min) + ", " +
+                                            std::to_string(max) + "], got '" + text + "'");
+            }
+            return result;
+        }
+
+        float parseFloat(const std::string &option, const std::string &text, float min, float max) {
+            size_t end = 0;
+            float result = 0.0f;
+            try {
+                result = std::stof(text, &end);
+            } catch (const std::exception &) {
+                end = 0;
+            }
+            if (end == 0 || end != text.size() || !(result >= min && result <= max)) {
+                throw std::invalid_argument(option + " expects a number in [" + std::to_string(min) + ", " +
+                                            std::to_string(max) + "], got '" + text + "'");
+            }
+            return result;
+        }
+    }
+
+    ApplicationConfig ApplicationConfig::fromCommandLine(int argc, char **argv) {
+        ApplicationConfig config;
+        for (int i = 1; i < argc; ++i) {
+            std::string option = argv[i];
+            auto next = [&]() -> std::string {
+                if (i + 1 >= argc) throw std::invalid_argument(option + " expects a value");
+                return argv[++i];
+            };
+
+            if (option == "--help" || option == "-h") {
+                config.showHelp = true;
+            } else if (option == "--headless") {
+                config.headless = true;
+            } else if (option == "--no-idle") {
+                config.idle = false;
+            } else if (option == "--no-ui-cache") {
+                config.uiCache = false;
+            } else if (option == "--ui-refresh") {
+                config.uiRefreshMilliseconds = parseFloat(option, next(), 1.0f, 60000.0f);
+            } else if (option == "--event-budget") {
+                config.eventBudgetMilliseconds = parseFloat(option, next(), 0.0f, 1000.0f);
+            } else if (option == "--threaded") {
+                config.threaded = true;
+            } else if (option == "--sim-hz") {
+                config.simulationHz = parseFloat(option, next(), 1.0f, 10000.0f);
+            } else if (option == "--views") {
+                config.views = static_cast<uint32_t>(parseInteger(option, next(), 1, 4));
+                if (config.views == 3) throw std::invalid_argument("--views expects 1, 2 or 4, got '3'");
+            } else if (option == "--frames") {
+                config.frameCount = static_cast<uint32_t>(parseInteger(option, next(), 1, 10000000));
+                config.limitFrames = true;
+            } else if (option == "--validate-culling") {
+                config.validateCulling = true;
+            } else if (option == "--load-every") {
+                config.loadEveryFrames = static_cast<uint32_t>(parseInteger(option, next(), 1, 10000000));
+            } else if (option == "--width") {
+                config.width = static_cast<int>(parseInteger(option, next(), 1, 16384));
+            } else if (option == "--height") {
+                config.height = static_cast<int>(parseInteger(option, next(), 1, 16384));
+            } else if (option == "--model") {
+                config.modelPath = next();
+            } else if (option == "--bench-scene") {
+                config.benchSceneEntities = static_cast<uint32_t>(parseInteger(option, next(), 1, 10000000));
+            } else if (option == "--bench-meshes") {
+                config.benchSceneMeshes = static_cast<uint32_t>(parseInteger(option, next(), 1, 1000000));
+            } else if (option == "--bench-dirty") {
+                config.benchSceneDirtyFraction = parseFloat(option, next(), 0.0f, 1.0f);
+            } else if (option == "--seed") {
+                config.seed = static_cast<uint32_t>(parseInteger(option, next(), 0, 2147483647));
+            } else if (option == "--report") {
+                config.reportPath = next();
+            } else if (option == "--screenshot") {
+                config.screenshotPath = next();
+            } else if (option == "--frame-stats") {
+                config.frameStatsPath = next();
+            } else if (option == "--trace") {
+                config.tracePath = next();
+            } else if (option == "--record-input") {
+                config.inputRecordPath = next();
+            } else if (option == "--replay-input") {
+                config.inputReplayPath = next();
+            } else if (option == "--camera-path") {
+                config.cameraPath = next();
+            } else if (option == "--path-stats") {
+                config.pathStatsPath = next();
+            } else {
+                throw std::invalid_argument("Unknown option '" + option + "'");
+            }
+        }
+        if (!config.inputRecordPath.empty() && !config.inputReplayPath.empty()) {
+            throw std::invalid_argument("--record-input and --replay-input are exclusive");
+        }
+        if (!config.inputRecordPath.empty() && config.headless) {
+            throw std::invalid_argument("--record-input needs a window, there is no input headless");
+        }
+        if (!config.cameraPath.empty() && !config.inputReplayPath.empty()) {
+            throw std::invalid_argument("--camera-path and --replay-input both drive the camera, use one");
+        }
+        if (config.loadEveryFrames > 0 && !config.headless) {
+            throw std::invalid_argument("--load-every is a headless test, use it with --headless");
+        }
+        if (config.validateCulling && (!config.headless || config.views != 1)) {
+            throw std::invalid_argument("--validate-culling checks the GPU culling of one view, use it with "
+                                        "--headless and --views 1");
+        }
+        // A measured windowed run must not wait for events, it would never reach its frame count
+        if (config.limitFrames && !config.headless) config.idle = false;
+        if (config.threaded && config.headless) {
+            throw std::invalid_argument("--threaded needs a window, headless frames are rendered one after another");
+        }
+        return config;
+    }
+
+    std::string ApplicationConfig::usage(const std::string &program) {
+        return "Usage: " + program + " [options]\n"
+               "  --width <n>          Window or offscreen width (default 1280)\n"
+               "  --height <n>         Window or offscreen height (default 720)\n"
+               "  --model <path>       Model loaded at startup (default models/star.obj)\n"
+               "  --bench-scene <n>    Generate n entities sharing procedural meshes instead of the model\n"
+               "  --bench-meshes <n>   Distinct meshes of the generated scene (default 4)\n"
+               "  --bench-dirty <f>    Fraction of the generated entities moved every frame (default 0.1)\n"
+               "  --seed <n>           Seed of the generated scene (default 42)\n"
+               "  --headless           Render offscreen without a window, then exit\n"
+               "  --no-idle            Render every frame in a window, also when nothing changes\n"
+               "  --no-ui-cache        Build and record the UI every frame, also when it is static\n"
+               "  --ui-refresh <ms>    Rebuild interval of a static UI for the values it shows (default 250)\n"
+               "  --event-budget <ms>  Time per frame for deferred events such as model loads (default 2)\n"
+               "  --threaded           Simulate and render on separate threads in a window\n"
+               "  --sim-hz <f>         Simulation rate of --threaded (default 120)\n"
+               "  --views <n>          Views of the scene: 1, 2 side by side or 4 as a quad (default 1)\n"
+               "  --frames <n>         Frames to render headless (default 300), or windowed before exiting\n"
+               "  --load-every <n>     Headless: upload the model again every n frames, fail on a hitch\n"
+               "  --validate-culling   Headless: fail if GPU culling differs from the CPU reference\n"
+               "  --report <path>      Headless timing report as JSON (default benchmark.json, '' to skip)\n"
+               "  --screenshot <path>  Write the final headless frame as PPM\n"
+               "  --frame-stats <path> Frame time percentiles as JSON at exit (default frame_stats.json, '' to skip)\n"
+               "  --trace <path>       Write the CPU profiler scopes as Chrome trace JSON at exit\n"
+               "  --record-input <path> Record camera input and frame time steps, written at exit\n"
+               "  --replay-input <path> Replay recorded input instead of mouse and keyboard, then exit\n"
+               "  --camera-path <path> Fly the camera along a keyframed path, then exit (see CameraPathUtils.h)\n"
+               "  --path-stats <path>  Frame times per camera path segment as JSON (default path_stats.json)\n"
+               "  --help               Show this message\n";
+    }
+}
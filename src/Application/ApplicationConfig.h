@@ -0,0 +1,83 @@
+//
+// Created by alex on 5/2/25.
+//
+
+#ifndef APPLICATIONCONFIG_H
+#define APPLICATIONCONFIG_H
+
+#include <cstdint>
+#include <string>
+
+namespace Bcg {
+    // Startup options, filled from the command line by main.
+    struct ApplicationConfig {
+        int width = 1280;
+        int height = 720;
+        std::string title = "Vulkan EnTT App";
+        std::string modelPath = "models/star.obj"; // Loaded at startup
+
+        // Procedural load test scene (SceneGenerator) instead of the model, entity count or 0 for none
+        uint32_t benchSceneEntities = 0;
+        uint32_t benchSceneMeshes = 4;
+        float benchSceneDirtyFraction = 0.1f; // Of the entities moved every frame
+        uint32_t seed = 42; // Of everything generated, runs with the same seed are identical
+
+        // Headless: no GLFW window, no surface and no UI. Renders frameCount frames into offscreen images, writes
+        // the timing report and exits. Runs without a display (e.g. on lavapipe in CI).
+        bool headless = false;
+        uint32_t frameCount = 300;
+        // Windowed: exit after frameCount rendered frames, set by --frames. Such a run renders every frame (no idle),
+        // e.g. for comparing the latency and frame rate of the single and the threaded loop.
+        bool limitFrames = false;
+        std::string reportPath = "benchmark.json"; // Per-frame CPU/GPU timings, empty to skip
+        std::string screenshotPath; // Final frame as PPM, empty to skip
+        // Headless load-while-rendering test: every loadEveryFrames measured frames the model (parsed once up front)
+        // is created and uploaded again. A frame with a load that FrameStats counts as a hitch fails the run.
+        uint32_t loadEveryFrames = 0;
+        // Headless: compare the GPU culling of every read back frame against the CPU reference, a mismatch (or no
+        // validated frame) makes the run fail
+        bool validateCulling = false;
+
+        std::string frameStatsPath = "frame_stats.json"; // Frame time percentiles written at exit, empty to skip
+        std::string tracePath; // Chrome trace of the CPU profiler scopes written at exit, empty to skip
+
+        // Input of a windowed session saved at exit, replayed instead of GLFW input with the recorded time steps.
+        // A replay ends with the recording; headless it renders the recorded frames and ignores frameCount.
+        std::string inputRecordPath;
+        std::string inputReplayPath;
+
+        // Camera flythrough played with its own fixed time step (see CameraPathUtils::load). The run ends with the
+        // path unless it loops; headless it renders the path's frames and ignores frameCount. Frame times per
+        // path segment are written to pathStatsPath at exit, empty to skip.
+        std::string cameraPath;
+        std::string pathStatsPath = "path_stats.json";
+
+        // Windowed: wait for events instead of rendering while nothing changes, never render while minimized
+        bool idle = true;
+
+        // Windowed: build the UI only after window events (and the frames after them that settle ImGui's state) or
+        // every uiRefreshMilliseconds for the values it shows, otherwise reuse the last draw data and its recording
+        bool uiCache = true;
+        float uiRefreshMilliseconds = 250.0f;
+
+        // Per frame, for deferred event handlers such as model loads; at least one runs per frame
+        float eventBudgetMilliseconds = 2.0f;
+
+        // Windowed: simulate on the main thread at simulationHz and render the newest simulated frame on a render
+        // thread at the display rate, instead of one after the other in a single loop
+        bool threaded = false;
+        float simulationHz = 120.0f;
+
+        // Views of the scene in one frame: 1, 2 (side by side) or 4 (quad), see CameraSystem::getViews
+        uint32_t views = 1;
+
+        bool showHelp = false;
+
+        // Throws std::invalid_argument for unknown options or malformed values
+        static ApplicationConfig fromCommandLine(int argc, char **argv);
+
+        static std::string usage(const std::string &program);
+    };
+}
+
+#endif //APPLICATIONCONFIG_H
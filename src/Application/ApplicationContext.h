@@ -9,6 +9,7 @@
 #include <memory>
 
 namespace Bcg{
+    struct ApplicationConfig;
 
     //Managers
     class WindowManager;
@@ -22,6 +23,11 @@ namespace Bcg{
     class RendererSystem;
     class AABBSystem;
 
+    //Diagnostics
+    class FrameStats;
+
+    class EventBus;
+
     struct ApplicationContext{
         //Managers
         std::unique_ptr<WindowManager> windowManager;
@@ -35,8 +41,12 @@ namespace Bcg{
         std::unique_ptr<TransformSystem> transformSystem;
         std::unique_ptr<AABBSystem> aabbSystem;
 
+        //Diagnostics
+        std::unique_ptr<FrameStats> frameStats; // Recorded by the main loop, shown by the UI
+
         entt::registry* registry;
-        entt::dispatcher* dispatcher;
+        EventBus* eventBus = nullptr;
+        const ApplicationConfig* config = nullptr; // Startup options, owned by Application
 
         entt::entity cameraFocusEntity = entt::null;
     };
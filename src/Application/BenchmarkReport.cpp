@@ -0,0 +1,195 @@
+//
+// Created by alex on 5/2/25.
+//
+
+#include "BenchmarkReport.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+#include "JsonWriter.h"
+
+namespace Bcg {
+    namespace {
+        // Nearest-rank percentile of sorted values
+        double percentile(const std::vector<double> &sorted, double p) {
+            if (sorted.empty()) return 0.0;
+            auto rank = static_cast<size_t>(std::ceil(p / 100.0 * static_cast<double>(sorted.size())));
+            return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+        }
+
+        void writeSummary(JsonWriter &json, std::vector<double> values, const std::string &unit = "_ms") {
+            json.beginObject();
+            json.field("count", static_cast<uint64_t>(values.size()));
+            if (!values.empty()) {
+                std::sort(values.begin(), values.end());
+                double sum = 0.0;
+                for (double value: values) sum += value;
+                json.field("mean" + unit, sum / static_cast<double>(values.size()));
+                json.field("min" + unit, values.front());
+                json.field("p50" + unit, percentile(values, 50.0));
+                json.field("p95" + unit, percentile(values, 95.0));
+                json.field("p99" + unit, percentile(values, 99.0));
+                json.field("max" + unit, values.back());
+            }
+            json.endObject();
+        }
+
+        template<typename T>
+        void setNamed(std::vector<std::pair<std::string, T> > &entries, const std::string &name, T value) {
+            for (auto &entry: entries) {
+                if (entry.first == name) {
+                    entry.second = value;
+                    return;
+                }
+            }
+            entries.emplace_back(name, value);
+        }
+
+        // Values of every name over the measured frames, in order of first appearance
+        template<typename Member>
+        std::vector<std::pair<std::string, std::vector<double> > > collectNamed(
+            const std::vector<FrameTiming> &frames, size_t first, Member member) {
+            std::vector<std::pair<std::string, std::vector<double> > > series;
+            for (size_t i = first; i < frames.size(); ++i) {
+                for (const auto &[name, value]: frames[i].*member) {
+                    auto it = std::find_if(series.begin(), series.end(),
+                                           [&name = name](const auto &entry) { return entry.first == name; });
+                    if (it == series.end()) {
+                        series.emplace_back(name, std::vector<double>());
+                        it = series.end() - 1;
+                    }
+                    it->second.push_back(static_cast<double>(value));
+                }
+            }
+            return series;
+        }
+    }
+
+    void BenchmarkReport::setInfo(const std::string &key, const std::string &value) {
+        setNamed(m_info, key, value);
+    }
+
+    void BenchmarkReport::setCpuTime(uint64_t frame, double milliseconds) {
+        this->frame(frame).cpuMilliseconds = milliseconds;
+    }
+
+    void BenchmarkReport::setGpuTime(uint64_t frame, double milliseconds) {
+        this->frame(frame).gpuMilliseconds = milliseconds;
+    }
+
+    void BenchmarkReport::addCpuStageTime(uint64_t frame, const std::string &stage, double milliseconds) {
+        auto &stages = this->frame(frame).cpuStages;
+        auto it = std::find_if(stages.begin(), stages.end(), [&](const auto &entry) { return entry.first == stage; });
+        if (it == stages.end()) {
+            stages.emplace_back(stage, milliseconds);
+        } else {
+            it->second += milliseconds;
+        }
+    }
+
+    void BenchmarkReport::setGpuScopeTime(uint64_t frame, const std::string &scope, double milliseconds) {
+        setNamed(this->frame(frame).gpuScopes, scope, milliseconds);
+    }
+
+    void BenchmarkReport::setGpuCounter(uint64_t frame, const std::string &counter, uint64_t value) {
+        setNamed(this->frame(frame).gpuCounters, counter, value);
+    }
+
+    void BenchmarkReport::setCounter(uint64_t frame, const std::string &counter, uint64_t value) {
+        setNamed(this->frame(frame).counters, counter, value);
+    }
+
+    FrameTiming &BenchmarkReport::frame(uint64_t frame) {
+        if (frame >= m_frames.size()) m_frames.resize(frame + 1);
+        return m_frames[frame];
+    }
+
+    bool BenchmarkReport::write(const std::string &path) const {
+        std::ofstream file(path, std::ios::trunc);
+        if (!file.is_open()) return false;
+
+        std::vector<double> cpu, gpu;
+        for (size_t i = warmupFrames; i < m_frames.size(); ++i) {
+            cpu.push_back(m_frames[i].cpuMilliseconds);
+            if (m_frames[i].gpuMilliseconds >= 0.0) gpu.push_back(m_frames[i].gpuMilliseconds);
+        }
+
+        JsonWriter json(file);
+        json.beginObject();
+        json.key("info").beginObject();
+        for (const auto &[key, value]: m_info) json.field(key, value);
+        json.endObject();
+
+        json.key("summary").beginObject();
+        json.field("frames", static_cast<uint64_t>(m_frames.size()));
+        json.field("warmup_frames", warmupFrames);
+        json.key("cpu");
+        writeSummary(json, cpu);
+        json.key("gpu");
+        writeSummary(json, gpu);
+        json.key("cpu_stages").beginObject();
+        for (const auto &[name, values]: collectNamed(m_frames, warmupFrames, &FrameTiming::cpuStages)) {
+            json.key(name);
+            writeSummary(json, values);
+        }
+        json.endObject();
+        json.key("gpu_scopes").beginObject();
+        for (const auto &[name, values]: collectNamed(m_frames, warmupFrames, &FrameTiming::gpuScopes)) {
+            json.key(name);
+            writeSummary(json, values);
+        }
+        json.endObject();
+        json.key("gpu_counters").beginObject();
+        for (const auto &[name, values]: collectNamed(m_frames, warmupFrames, &FrameTiming::gpuCounters)) {
+            json.key(name);
+            writeSummary(json, values, "");
+        }
+        json.endObject();
+        json.key("counters").beginObject();
+        for (const auto &[name, values]: collectNamed(m_frames, warmupFrames, &FrameTiming::counters)) {
+            json.key(name);
+            writeSummary(json, values, "");
+        }
+        json.endObject();
+        json.endObject();
+
+        json.key("frames").beginArray();
+        for (size_t i = 0; i < m_frames.size(); ++i) {
+            json.beginObject();
+            json.field("frame", static_cast<uint64_t>(i));
+            json.field("cpu_ms", m_frames[i].cpuMilliseconds);
+            if (m_frames[i].gpuMilliseconds >= 0.0) {
+                json.field("gpu_ms", m_frames[i].gpuMilliseconds);
+            } else {
+                json.key("gpu_ms").null();
+            }
+            if (!m_frames[i].cpuStages.empty()) {
+                json.key("cpu_stages").beginObject();
+                for (const auto &[name, milliseconds]: m_frames[i].cpuStages) json.field(name, milliseconds);
+                json.endObject();
+            }
+            if (!m_frames[i].gpuScopes.empty()) {
+                json.key("gpu_scopes").beginObject();
+                for (const auto &[name, milliseconds]: m_frames[i].gpuScopes) json.field(name, milliseconds);
+                json.endObject();
+            }
+            if (!m_frames[i].gpuCounters.empty()) {
+                json.key("gpu_counters").beginObject();
+                for (const auto &[name, value]: m_frames[i].gpuCounters) json.field(name, value);
+                json.endObject();
+            }
+            if (!m_frames[i].counters.empty()) {
+                json.key("counters").beginObject();
+                for (const auto &[name, value]: m_frames[i].counters) json.field(name, value);
+                json.endObject();
+            }
+            json.endObject();
+        }
+        json.endArray();
+        json.endObject();
+        file << '\n';
+        return static_cast<bool>(file);
+    }
+}
@@ -0,0 +1,60 @@
+//
+// Created by alex on 5/2/25.
+//
+
+#ifndef BENCHMARKREPORT_H
+#define BENCHMARKREPORT_H
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Bcg {
+    struct FrameTiming {
+        double cpuMilliseconds = 0.0; // Whole main loop iteration
+        double gpuMilliseconds = -1.0; // First to last command of the frame, negative if not measured
+        std::vector<std::pair<std::string, double> > cpuStages; // CPU profiler scopes in milliseconds, by name
+        std::vector<std::pair<std::string, double> > gpuScopes; // Named GPU scopes in milliseconds
+        std::vector<std::pair<std::string, uint64_t> > gpuCounters; // Pipeline statistics etc.
+        std::vector<std::pair<std::string, uint64_t> > counters; // CPU side work counters (PerfCounters)
+    };
+
+    // Per-frame timings of a headless run, written as JSON:
+    // { "info": {...}, "summary": { "cpu": {...}, "gpu": {...}, "cpu_stages": {...}, "gpu_scopes": {...},
+    //   "gpu_counters": {...}, "counters": {...} }, "frames": [ { "frame", "cpu_ms", "gpu_ms", "cpu_stages": {...},
+    //   "gpu_scopes": {...}, "gpu_counters": {...}, "counters": {...} } ] }
+    class BenchmarkReport {
+    public:
+        void setInfo(const std::string &key, const std::string &value);
+
+        void setCpuTime(uint64_t frame, double milliseconds);
+
+        // GPU times arrive later than CPU times (after the frame's fence was waited)
+        void setGpuTime(uint64_t frame, double milliseconds);
+
+        // Adds to the time of the stage, scopes that run several times per frame are summed
+        void addCpuStageTime(uint64_t frame, const std::string &stage, double milliseconds);
+
+        void setGpuScopeTime(uint64_t frame, const std::string &scope, double milliseconds);
+
+        void setGpuCounter(uint64_t frame, const std::string &counter, uint64_t value);
+
+        void setCounter(uint64_t frame, const std::string &counter, uint64_t value);
+
+        const std::vector<FrameTiming> &getFrames() const { return m_frames; }
+
+        // Frames to leave out of the summary (shader cache misses, first uploads, ...), all are still listed
+        uint32_t warmupFrames = 0;
+
+        bool write(const std::string &path) const;
+
+    private:
+        FrameTiming &frame(uint64_t frame);
+
+        std::vector<std::pair<std::string, std::string> > m_info;
+        std::vector<FrameTiming> m_frames;
+    };
+}
+
+#endif //BENCHMARKREPORT_H
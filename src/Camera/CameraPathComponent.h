@@ -0,0 +1,37 @@
+//
+// Created by alex on 5/5/25.
+//
+
+#ifndef CAMERAPATHCOMPONENT_H
+#define CAMERAPATHCOMPONENT_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "MatVec.h"
+
+namespace Bcg {
+    struct CameraKeyframe {
+        float time = 0.0f; // Seconds from the start of the path, increasing
+        Vector3f position = Vector3f::Zero();
+        Vector3f target = Vector3f::Zero();
+        Vector3f up = Vector3f(0.0f, 1.0f, 0.0f);
+        std::string label; // Of the segment starting here, e.g. "near", "far" or "occluded"
+    };
+
+    // Scripted camera flythrough, attached to a camera entity. Segment i lies between keyframes i and i + 1. The
+    // pose is interpolated with a Catmull-Rom spline and advanced by timeStep per simulated frame, independent of
+    // the frame rate, so every run sees the same poses in the same frames.
+    struct CameraPathComponent {
+        std::vector<CameraKeyframe> keyframes;
+        float timeStep = 1.0f / 60.0f;
+        bool loop = false;
+
+        uint32_t frame = 0; // Next frame to apply, at time frame * timeStep (not accumulated, no drift)
+        float time = 0.0f; // Of the last applied frame
+        bool finished = false;
+    };
+}
+
+#endif //CAMERAPATHCOMPONENT_H
@@ -0,0 +1,55 @@
+//
+// Created by alex on 5/5/25.
+//
+
+#include "CameraPathStats.h"
+
+#include <fstream>
+
+#include "JsonWriter.h"
+
+namespace Bcg {
+    CameraPathStats::CameraPathStats(const CameraPathComponent &cameraPath) : m_timeStep(cameraPath.timeStep) {
+        const auto &keys = cameraPath.keyframes;
+        for (size_t i = 0; i + 1 < keys.size(); ++i) {
+            Segment &segment = m_segments.emplace_back();
+            segment.label = keys[i].label;
+            segment.start = keys[i].time;
+            segment.end = keys[i + 1].time;
+        }
+    }
+
+    void CameraPathStats::record(uint32_t segment, const FrameTimes &times) {
+        if (segment < m_segments.size()) m_segments[segment].stats.record(times);
+    }
+
+    bool CameraPathStats::writeJson(const std::string &path,
+                                    const std::vector<std::pair<std::string, std::string> > &info) const {
+        std::ofstream file(path, std::ios::trunc);
+        if (!file.is_open()) return false;
+
+        JsonWriter json(file);
+        json.beginObject();
+        json.key("info").beginObject();
+        for (const auto &[key, value]: info) json.field(key, value);
+        json.endObject();
+        json.field("time_step_s", static_cast<double>(m_timeStep));
+        json.key("segments").beginArray();
+        for (const Segment &segment: m_segments) {
+            json.beginObject();
+            json.field("label", segment.label);
+            json.field("start_s", static_cast<double>(segment.start));
+            json.field("end_s", static_cast<double>(segment.end));
+            json.field("frames", segment.stats.getFrameCount());
+            json.field("hitches", segment.stats.getHitchCount());
+            json.field("over_budget", segment.stats.getOverBudgetCount());
+            json.key("metrics");
+            segment.stats.writeMetrics(json);
+            json.endObject();
+        }
+        json.endArray();
+        json.endObject();
+        file << '\n';
+        return static_cast<bool>(file);
+    }
+}
@@ -0,0 +1,47 @@
+//
+// Created by alex on 5/5/25.
+//
+
+#ifndef CAMERAPATHSTATS_H
+#define CAMERAPATHSTATS_H
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "CameraPathComponent.h"
+#include "FrameStats.h"
+
+namespace Bcg {
+    // Frame timings of a camera path flythrough, one FrameStats per segment so that runs can be compared segment
+    // by segment (e.g. the near, far and occluded parts of the path).
+    class CameraPathStats {
+    public:
+        static constexpr size_t FramesPerSegment = 1u << 14; // Newest frames kept for the percentiles
+
+        explicit CameraPathStats(const CameraPathComponent &cameraPath);
+
+        // Times of a frame rendered with the camera in the segment
+        void record(uint32_t segment, const FrameTimes &times);
+
+        const FrameStats &getSegment(uint32_t segment) const { return m_segments[segment].stats; }
+
+        size_t getSegmentCount() const { return m_segments.size(); }
+
+        // Per segment its keyframes and the summary of every metric, false if the file cannot be written
+        bool writeJson(const std::string &path, const std::vector<std::pair<std::string, std::string> > &info) const;
+
+    private:
+        struct Segment {
+            std::string label;
+            float start = 0.0f;
+            float end = 0.0f;
+            FrameStats stats{FramesPerSegment};
+        };
+
+        std::vector<Segment> m_segments;
+        float m_timeStep = 0.0f;
+    };
+}
+
+#endif //CAMERAPATHSTATS_H
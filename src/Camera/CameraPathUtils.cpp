@@ -0,0 +1,152 @@
+//
+// Created by alex on 5/5/25.
+//
+
+#include "CameraPathUtils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+#include "Logger.h"
+
+namespace Bcg::CameraPathUtils {
+    namespace {
+        // Cubic Hermite on [t1, t2] with Catmull-Rom tangents for non-uniform key times, one-sided at the ends
+        Vector3f catmullRom(const CameraPathComponent &cameraPath, size_t segment, float time,
+                            Vector3f CameraKeyframe::*member) {
+            const auto &keys = cameraPath.keyframes;
+            const size_t last = keys.size() - 1;
+            const CameraKeyframe &k1 = keys[segment];
+            const CameraKeyframe &k2 = keys[segment + 1];
+            const CameraKeyframe &k0 = keys[segment == 0 ? 0 : segment - 1];
+            const CameraKeyframe &k3 = keys[std::min(segment + 2, last)];
+
+            const Vector3f m1 = (k2.*member - k0.*member) / (k2.time - k0.time);
+            const Vector3f m2 = (k3.*member - k1.*member) / (k3.time - k1.time);
+            const float length = k2.time - k1.time;
+            const float s = std::clamp((time - k1.time) / length, 0.0f, 1.0f);
+            const float s2 = s * s;
+            const float s3 = s2 * s;
+            return (2.0f * s3 - 3.0f * s2 + 1.0f) * k1.*member + (s3 - 2.0f * s2 + s) * length * m1 +
+                   (-2.0f * s3 + 3.0f * s2) * k2.*member + (s3 - s2) * length * m2;
+        }
+
+        bool readVector(std::istringstream &stream, Vector3f &vector) {
+            return static_cast<bool>(stream >> vector.x() >> vector.y() >> vector.z());
+        }
+    }
+
+    bool load(const std::string &path, CameraPathComponent &cameraPath) {
+        std::ifstream file(path);
+        if (!file.is_open()) {
+            Log::Error("[CameraPathUtils::load] Cannot open {}", path);
+            return false;
+        }
+
+        CameraPathComponent result;
+        std::string line;
+        for (size_t lineNumber = 1; std::getline(file, line); ++lineNumber) {
+            line = line.substr(0, line.find('#'));
+            std::istringstream stream(line);
+            std::string statement;
+            if (!(stream >> statement)) continue;
+
+            bool valid = true;
+            if (statement == "step") {
+                valid = static_cast<bool>(stream >> result.timeStep) && result.timeStep > 0.0f;
+            } else if (statement == "loop") {
+                result.loop = true;
+            } else if (statement == "key") {
+                CameraKeyframe keyframe;
+                valid = static_cast<bool>(stream >> keyframe.time) && readVector(stream, keyframe.position) &&
+                        readVector(stream, keyframe.target) && readVector(stream, keyframe.up) &&
+                        keyframe.up.squaredNorm() > 0.0f;
+                stream >> keyframe.label;
+                if (valid && !result.keyframes.empty() && keyframe.time <= result.keyframes.back().time) {
+                    Log::Error("[CameraPathUtils::load] {}:{}: key times must increase", path, lineNumber);
+                    return false;
+                }
+                result.keyframes.push_back(keyframe);
+            } else {
+                valid = false;
+            }
+            std::string rest;
+            if (!valid || stream >> rest) {
+                Log::Error("[CameraPathUtils::load] {}:{}: cannot parse '{}'", path, lineNumber, line);
+                return false;
+            }
+        }
+        if (result.keyframes.size() < 2) {
+            Log::Error("[CameraPathUtils::load] {} needs at least two keyframes", path);
+            return false;
+        }
+
+        cameraPath = std::move(result);
+        Log::Info("[CameraPathUtils::load] {}: {} keyframes, {:.2f} s, {} frames", path, cameraPath.keyframes.size(),
+                  getDuration(cameraPath), getFrameCount(cameraPath));
+        return true;
+    }
+
+    float getDuration(const CameraPathComponent &cameraPath) {
+        if (cameraPath.keyframes.empty()) return 0.0f;
+        return cameraPath.keyframes.back().time - cameraPath.keyframes.front().time;
+    }
+
+    uint32_t getFrameCount(const CameraPathComponent &cameraPath) {
+        if (cameraPath.keyframes.size() < 2) return 0;
+        return static_cast<uint32_t>(std::ceil(getDuration(cameraPath) / cameraPath.timeStep)) + 1;
+    }
+
+    uint32_t getSegment(const CameraPathComponent &cameraPath, float time) {
+        const auto &keys = cameraPath.keyframes;
+        if (keys.size() < 2) return 0;
+        // First keyframe after the time, the segment starts at the one before
+        auto next = std::upper_bound(keys.begin(), keys.end(), time, [](float value, const CameraKeyframe &key) {
+            return value < key.time;
+        });
+        auto segment = static_cast<size_t>(std::max<std::ptrdiff_t>(next - keys.begin() - 1, 0));
+        return static_cast<uint32_t>(std::min(segment, keys.size() - 2));
+    }
+
+    void evaluate(const CameraPathComponent &cameraPath, float time, Vector3f &position, Vector3f &target,
+                  Vector3f &up) {
+        const auto &keys = cameraPath.keyframes;
+        if (keys.size() < 2) {
+            if (keys.empty()) return;
+            position = keys[0].position;
+            target = keys[0].target;
+            up = keys[0].up.normalized();
+            return;
+        }
+        size_t segment = getSegment(cameraPath, time);
+        position = catmullRom(cameraPath, segment, time, &CameraKeyframe::position);
+        target = catmullRom(cameraPath, segment, time, &CameraKeyframe::target);
+        up = catmullRom(cameraPath, segment, time, &CameraKeyframe::up);
+        // Interpolated unit vectors can shrink, and point along the view direction for opposite keys
+        if (up.squaredNorm() < 1e-12f) up = keys[segment].up;
+        up.normalize();
+    }
+
+    bool advance(CameraPathComponent &cameraPath, CameraParametersComponent &camera) {
+        const uint32_t frameCount = getFrameCount(cameraPath);
+        if (cameraPath.finished || frameCount == 0) return false;
+
+        const float start = cameraPath.keyframes.front().time;
+        cameraPath.time = std::min(start + static_cast<float>(cameraPath.frame) * cameraPath.timeStep,
+                                   cameraPath.keyframes.back().time);
+        evaluate(cameraPath, cameraPath.time, camera.position, camera.target, camera.up);
+        camera.distance = (camera.position - camera.target).norm();
+        camera.dirtyView = true;
+
+        if (++cameraPath.frame >= frameCount) {
+            if (cameraPath.loop) {
+                cameraPath.frame = 0;
+            } else {
+                cameraPath.finished = true;
+            }
+        }
+        return true;
+    }
+}
@@ -0,0 +1,39 @@
+//
+// Created by alex on 5/5/25.
+//
+
+#ifndef CAMERAPATHUTILS_H
+#define CAMERAPATHUTILS_H
+
+#include <string>
+
+#include "CameraComponent.h"
+#include "CameraPathComponent.h"
+
+namespace Bcg::CameraPathUtils {
+    // Reads a text file, one statement per line, '#' starts a comment:
+    //   step <seconds>       Time step per frame (default 1/60)
+    //   loop                 Start over at the end instead of finishing
+    //   key <time> <px py pz> <tx ty tz> <ux uy uz> [label]
+    // At least two keyframes with increasing times are required. Logs the first error and returns false.
+    bool load(const std::string &path, CameraPathComponent &cameraPath);
+
+    float getDuration(const CameraPathComponent &cameraPath);
+
+    // Frames from the start to the last keyframe at the path's time step, including both ends
+    uint32_t getFrameCount(const CameraPathComponent &cameraPath);
+
+    // Segment containing the time, the last one for the end of the path
+    uint32_t getSegment(const CameraPathComponent &cameraPath, float time);
+
+    // Interpolated pose at the time (clamped to the path), up is normalized
+    void evaluate(const CameraPathComponent &cameraPath, float time, Vector3f &position, Vector3f &target,
+                  Vector3f &up);
+
+    // Moves the camera to the pose of the path's next frame (marked for CameraUtils::update), the last frame is
+    // clamped to the end. Returns false without touching the camera once all frames were applied, a looping path
+    // starts over instead.
+    bool advance(CameraPathComponent &cameraPath, CameraParametersComponent &camera);
+}
+
+#endif //CAMERAPATHUTILS_H
@@ -4,12 +4,15 @@
 
 #include "CameraSystem.h"
 #include "WindowManager.h"
+#include "CameraUtils.h"
+#include "CameraPathUtils.h"
 
 namespace Bcg {
     void CameraSystem::initialize(ApplicationContext *context) {
         this->context = context;
 
         auto camera_id = context->cameraSystem->createCamera();
+        m_cameraEntity = camera_id;
         auto &camera = context->registry->get<CameraParametersComponent>(camera_id);
 
         camera.aspectRatio = context->windowManager->getWidth() / context->windowManager->getHeight();
@@ -64,4 +67,60 @@ namespace Bcg {
         m_camera = camera;
     }
 
+    CameraPathComponent *CameraSystem::setPath(CameraPathComponent &&cameraPath) {
+        if (!context->registry->valid(m_cameraEntity)) {
+            return nullptr;
+        }
+        return &context->registry->emplace_or_replace<CameraPathComponent>(m_cameraEntity, std::move(cameraPath));
+    }
+
+    CameraPathComponent *CameraSystem::getPath() {
+        if (!context->registry->valid(m_cameraEntity)) {
+            return nullptr;
+        }
+        return context->registry->try_get<CameraPathComponent>(m_cameraEntity);
+    }
+
+    bool CameraSystem::updatePath() {
+        auto *cameraPath = getPath();
+        if (!cameraPath || !m_camera) {
+            return false;
+        }
+        return CameraPathUtils::advance(*cameraPath, *m_camera);
+    }
+
+    uint32_t CameraSystem::getViewCount(ViewLayout layout) {
+        switch (layout) {
+            case ViewLayout::SideBySide:
+                return 2;
+            case ViewLayout::Quad:
+                return 4;
+            default:
+                return 1;
+        }
+    }
+
+    void CameraSystem::getViews(std::vector<CameraView> &views) {
+        views.clear();
+        if (!m_camera) return;
+        CameraUtils::update(*m_camera);
+
+        const uint32_t count = getViewCount(m_layout);
+        const uint32_t columns = count == 1 ? 1 : 2;
+        const uint32_t rows = count == 4 ? 2 : 1;
+        for (uint32_t i = 0; i < count; ++i) {
+            CameraView view;
+            view.viewport = Vector4f(static_cast<float>(i % columns) / columns,
+                                     static_cast<float>(i / columns) / rows, 1.0f / columns, 1.0f / rows);
+            view.camera = *m_camera;
+            if (count > 1) {
+                // The camera's aspect ratio is the one of the whole framebuffer
+                view.camera.aspectRatio = m_camera->aspectRatio * rows / columns;
+                view.camera.dirtyProjection = true;
+                if (i > 0) CameraUtils::orbit(view.camera, radians(90.0f * static_cast<float>(i)));
+                CameraUtils::update(view.camera);
+            }
+            views.push_back(view);
+        }
+    }
 }
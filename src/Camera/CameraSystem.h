@@ -11,9 +11,25 @@
 
 #include "System.h"
 #include "CameraComponent.h"
+#include "CameraPathComponent.h"
 #include "Mouse.h"
 
+#include <vector>
+
 namespace Bcg {
+    // Split of the framebuffer into views of the scene
+    enum class ViewLayout : uint8_t {
+        Single,
+        SideBySide, // Left and right half
+        Quad // 2x2, row by row
+    };
+
+    // A camera and its part of the framebuffer
+    struct CameraView {
+        CameraParametersComponent camera; // Matrices up to date, projection for the aspect ratio of the rectangle
+        Vector4f viewport; // x, y, width, height in [0, 1] of the framebuffer, y down
+    };
+
     class CameraSystem : public System {
     public:
         ~CameraSystem() override = default;
@@ -36,9 +52,28 @@ namespace Bcg {
 
         void setCurrentCamera(CameraParametersComponent *camera);
 
+        // Attaches a flythrough to the camera created by initialize(), replacing a previous one
+        CameraPathComponent *setPath(CameraPathComponent &&cameraPath);
+
+        CameraPathComponent *getPath();
+
+        // Applies the next frame of the path to the current camera, false without a path or once it finished
+        bool updatePath();
+
+        void setViewLayout(ViewLayout layout) { m_layout = layout; }
+
+        ViewLayout getViewLayout() const { return m_layout; }
+
+        static uint32_t getViewCount(ViewLayout layout);
+
+        // Updates the current camera and fills one view per rectangle of the layout: the current camera in the
+        // first, the others orbit its target in 90 degree steps so the views follow the camera controls
+        void getViews(std::vector<CameraView> &views);
 
     private:
         CameraParametersComponent *m_camera;
+        entt::entity m_cameraEntity = entt::null;
+        ViewLayout m_layout = ViewLayout::Single;
         Vector2f m_arcball_last = Vector2f(0, 0);
     };
 }
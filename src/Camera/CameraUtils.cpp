@@ -89,4 +89,10 @@ namespace Bcg::CameraUtils{
         // Mark the view matrix as needing update (if applicable).
         camera.dirtyView = true;
     }
-}
\ No newline at end of file
+
+    void orbit(CameraParametersComponent &camera, float angleRadians) {
+        Eigen::AngleAxisf rotation(angleRadians, camera.up.normalized());
+        camera.position = camera.target + rotation * (camera.position - camera.target);
+        camera.dirtyView = true;
+    }
+}
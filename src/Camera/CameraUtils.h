@@ -21,6 +21,9 @@ namespace Bcg::CameraUtils{
      void zoom(CameraParametersComponent &camera, float delta);
 
      void arcball(CameraParametersComponent &camera, const Mouse &mouse);
+
+     // Rotates the camera about its target around its up axis, e.g. for further views of the same target
+     void orbit(CameraParametersComponent &camera, float angleRadians);
 }
 
 #endif //CAMERAUTILS_H
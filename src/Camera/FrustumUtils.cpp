@@ -0,0 +1,49 @@
+//
+// Created by alex on 4/29/25.
+//
+
+#include "FrustumUtils.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace Bcg::FrustumUtils {
+    Frustum extract(const Matrix4f &viewProjection) {
+        const Vector4f r0 = viewProjection.row(0).transpose();
+        const Vector4f r1 = viewProjection.row(1).transpose();
+        const Vector4f r2 = viewProjection.row(2).transpose();
+        const Vector4f r3 = viewProjection.row(3).transpose();
+
+        Frustum frustum;
+        frustum.planes[0] = r3 + r0; // left
+        frustum.planes[1] = r3 - r0; // right
+        frustum.planes[2] = r3 + r1; // bottom
+        frustum.planes[3] = r3 - r1; // top
+        // The projection maps depth to [-w, w] (GL convention), Vulkan clips at 0. Using -w keeps the test
+        // conservative for both.
+        frustum.planes[4] = r3 + r2; // near
+        frustum.planes[5] = r3 - r2; // far
+
+        for (auto &plane: frustum.planes) {
+            float length = plane.head<3>().norm();
+            if (length > 0.0f) plane /= length;
+        }
+        return frustum;
+    }
+
+    float slack(const Frustum &frustum, const Matrix4f &model, const Vector3f &min, const Vector3f &max) {
+        // Center/extents form: the world AABB of the transformed box has extents |M| * e
+        const Vector3f center = 0.5f * (min + max);
+        const Vector3f extents = 0.5f * (max - min);
+        const Vector3f worldCenter = model.topLeftCorner<3, 3>() * center + model.topRightCorner<3, 1>();
+        const Vector3f worldExtents = model.topLeftCorner<3, 3>().cwiseAbs() * extents;
+
+        float result = std::numeric_limits<float>::max();
+        for (const auto &plane: frustum.planes) {
+            float distance = plane.head<3>().dot(worldCenter) + plane.w();
+            float radius = plane.head<3>().cwiseAbs().dot(worldExtents);
+            result = std::min(result, distance + radius);
+        }
+        return result;
+    }
+}
@@ -0,0 +1,31 @@
+//
+// Created by alex on 4/29/25.
+//
+
+#ifndef FRUSTUMUTILS_H
+#define FRUSTUMUTILS_H
+
+#include "MatVec.h"
+
+namespace Bcg {
+    // Planes (a, b, c, d) with normalized (a, b, c) pointing inwards: a point p is inside if dot(n, p) + d >= 0.
+    // Order: left, right, bottom, top, near, far.
+    struct Frustum {
+        Vector4f planes[6];
+    };
+}
+
+namespace Bcg::FrustumUtils {
+    // Gribb/Hartmann extraction from a column-vector view-projection matrix (world space planes).
+    Frustum extract(const Matrix4f &viewProjection);
+
+    // Smallest signed distance of the world space AABB of the object space box [min, max] to the frustum planes,
+    // the box is (conservatively) visible if this is >= 0. Mirrors the test in shaders/cull.slang.
+    float slack(const Frustum &frustum, const Matrix4f &model, const Vector3f &min, const Vector3f &max);
+
+    inline bool isVisible(const Frustum &frustum, const Matrix4f &model, const Vector3f &min, const Vector3f &max) {
+        return slack(frustum, model, min, max) >= 0.0f;
+    }
+}
+
+#endif //FRUSTUMUTILS_H
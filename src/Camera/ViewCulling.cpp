@@ -0,0 +1,55 @@
+//
+// Created by alex on 5/5/25.
+//
+
+#include "ViewCulling.h"
+
+#include <limits>
+
+namespace Bcg {
+    void ViewCulling::begin(const std::vector<Matrix4f> &viewProjections, size_t objectCount) {
+        m_frusta.clear();
+        m_candidates.clear();
+        m_candidates.reserve(objectCount);
+
+        constexpr float infinity = std::numeric_limits<float>::infinity();
+        m_unionMin = Vector3f::Constant(infinity);
+        m_unionMax = Vector3f::Constant(-infinity);
+        for (const Matrix4f &viewProjection: viewProjections) {
+            m_frusta.push_back(FrustumUtils::extract(viewProjection));
+
+            // Corners of the clip space cube in world space, depth in [-1, 1] like the planes
+            const Matrix4f inverse = viewProjection.inverse();
+            for (int corner = 0; corner < 8; ++corner) {
+                Vector4f clip((corner & 1) ? 1.0f : -1.0f, (corner & 2) ? 1.0f : -1.0f,
+                              (corner & 4) ? 1.0f : -1.0f, 1.0f);
+                Vector4f world = inverse * clip;
+                Vector3f point = world.head<3>() / world.w();
+                if (!(world.w() > 0.0f) || !point.allFinite()) {
+                    // Degenerate projection, keep every object
+                    m_unionMin = Vector3f::Constant(-infinity);
+                    m_unionMax = Vector3f::Constant(infinity);
+                    return;
+                }
+                m_unionMin = m_unionMin.cwiseMin(point);
+                m_unionMax = m_unionMax.cwiseMax(point);
+            }
+        }
+    }
+
+    bool ViewCulling::add(uint32_t object, const Matrix4f &model, const Vector3f &min, const Vector3f &max) {
+        const Vector3f center = 0.5f * (min + max);
+        const Vector3f extents = 0.5f * (max - min);
+        Candidate candidate;
+        candidate.center = model.topLeftCorner<3, 3>() * center + model.topRightCorner<3, 1>();
+        candidate.extents = model.topLeftCorner<3, 3>().cwiseAbs() * extents;
+        candidate.object = object;
+
+        if (((candidate.center + candidate.extents).array() < m_unionMin.array()).any() ||
+            ((candidate.center - candidate.extents).array() > m_unionMax.array()).any()) {
+            return false;
+        }
+        m_candidates.push_back(candidate);
+        return true;
+    }
+}
@@ -0,0 +1,63 @@
+//
+// Created by alex on 5/5/25.
+//
+
+#ifndef VIEWCULLING_H
+#define VIEWCULLING_H
+
+#include <cstdint>
+#include <vector>
+
+#include "FrustumUtils.h"
+
+namespace Bcg {
+    // Frustum culling of one object list for several views. add() computes the world AABB of an object once and
+    // rejects it against the box around all view frusta, forEachVisible() only tests the remaining candidates
+    // against the planes of one view. Same conservative test as FrustumUtils::slack.
+    class ViewCulling {
+    public:
+        // One view-projection per view (GL depth convention like FrustumUtils::extract), room for objectCount
+        void begin(const std::vector<Matrix4f> &viewProjections, size_t objectCount);
+
+        // Object space box [min, max] of the object, false if it is outside of every view
+        bool add(uint32_t object, const Matrix4f &model, const Vector3f &min, const Vector3f &max);
+
+        // Calls function(uint32_t object) for the objects visible in the view, in add() order. Views may be
+        // filtered concurrently once all objects were added.
+        template<typename Function>
+        void forEachVisible(size_t view, Function &&function) const {
+            const Frustum &frustum = m_frusta[view];
+            for (const Candidate &candidate: m_candidates) {
+                bool visible = true;
+                for (const auto &plane: frustum.planes) {
+                    float distance = plane.head<3>().dot(candidate.center) + plane.w();
+                    float radius = plane.head<3>().cwiseAbs().dot(candidate.extents);
+                    if (distance + radius < 0.0f) {
+                        visible = false;
+                        break;
+                    }
+                }
+                if (visible) function(candidate.object);
+            }
+        }
+
+        size_t getViewCount() const { return m_frusta.size(); }
+
+        // Objects that passed the union test of the last begin()
+        size_t getCandidateCount() const { return m_candidates.size(); }
+
+    private:
+        struct Candidate {
+            Vector3f center; // World space
+            Vector3f extents;
+            uint32_t object;
+        };
+
+        std::vector<Frustum> m_frusta;
+        Vector3f m_unionMin = Vector3f::Zero();
+        Vector3f m_unionMax = Vector3f::Zero();
+        std::vector<Candidate> m_candidates;
+    };
+}
+
+#endif //VIEWCULLING_H
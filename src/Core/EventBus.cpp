@@ -0,0 +1,54 @@
+//
+// Created by alex on 5/5/25.
+//
+
+#include "EventBus.h"
+
+#include <chrono>
+
+#include "Profiler.h"
+
+namespace Bcg {
+    size_t EventBus::update(double budgetMilliseconds) {
+        BCG_PROFILE_FUNCTION();
+        const auto start = std::chrono::steady_clock::now();
+        const auto budget = std::chrono::duration<double, std::milli>(budgetMilliseconds);
+        size_t count = 0;
+        while (auto *queue = nextQueue()) {
+            if (count > 0 && std::chrono::steady_clock::now() - start >= budget) {
+                ++m_carriedOverCount;
+                break;
+            }
+            // Popped first, the call may publish into the same queue
+            std::function<void()> call = std::move(queue->front());
+            queue->pop_front();
+            call();
+            ++count;
+        }
+        return count;
+    }
+
+    size_t EventBus::drain() {
+        size_t count = 0;
+        while (auto *queue = nextQueue()) {
+            std::function<void()> call = std::move(queue->front());
+            queue->pop_front();
+            call();
+            ++count;
+        }
+        return count;
+    }
+
+    size_t EventBus::getPendingCount() const {
+        size_t count = 0;
+        for (const auto &queue: m_queues) count += queue.size();
+        return count;
+    }
+
+    std::deque<std::function<void()> > *EventBus::nextQueue() {
+        for (auto &queue: m_queues) {
+            if (!queue.empty()) return &queue;
+        }
+        return nullptr;
+    }
+}
@@ -0,0 +1,97 @@
+//
+// Created by alex on 5/5/25.
+//
+
+#ifndef EVENTBUS_H
+#define EVENTBUS_H
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <typeindex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace Bcg {
+    enum class EventPriority : uint8_t {
+        High, // Runs before everything queued with a lower priority, e.g. resizes
+        Normal,
+        Low, // Background work such as preloading
+        Count
+    };
+
+    enum class EventDelivery : uint8_t {
+        Immediate, // Inside publish(), for cheap handlers whose effect is needed in the same frame
+        Deferred // Queued and run by update() within the frame's budget, for loads and other long work
+    };
+
+    // Event bus of the main loop thread. publish() runs the immediate handlers of the event and queues a call of
+    // each deferred handler. update() runs queued calls, highest priority first and in publish order within a
+    // priority, until the frame's budget is spent and carries the rest over to the next frame. At least one call
+    // runs per update(), so a call longer than the budget delays the queue by frames but never stalls it.
+    class EventBus {
+    public:
+        template<typename Event>
+        void subscribe(std::function<void(const Event &)> handler, EventDelivery delivery = EventDelivery::Immediate) {
+            HandlerList<Event> &handlers = getHandlers<Event>();
+            auto &list = delivery == EventDelivery::Immediate ? handlers.immediate : handlers.deferred;
+            list.push_back(std::move(handler));
+        }
+
+        template<typename Event>
+        void publish(const Event &event, EventPriority priority = EventPriority::Normal) {
+            HandlerList<Event> &handlers = getHandlers<Event>();
+            // By index, a handler may subscribe further handlers
+            for (size_t i = 0; i < handlers.immediate.size(); ++i) handlers.immediate[i](event);
+            if (handlers.deferred.empty()) return;
+
+            // One copy of the event shared by all queued calls
+            auto shared = std::make_shared<const Event>(event);
+            auto &queue = m_queues[static_cast<size_t>(priority)];
+            for (const auto &handler: handlers.deferred) {
+                queue.emplace_back([handler, shared]() { handler(*shared); });
+            }
+        }
+
+        // Runs queued calls for about budgetMilliseconds, returns how many ran
+        size_t update(double budgetMilliseconds);
+
+        // Runs every queued call, including those queued meanwhile
+        size_t drain();
+
+        size_t getPendingCount() const;
+
+        // Frames that ended with queued calls left, over the whole run
+        uint64_t getCarriedOverCount() const { return m_carriedOverCount; }
+
+    private:
+        struct HandlerListBase {
+            virtual ~HandlerListBase() = default;
+        };
+
+        template<typename Event>
+        struct HandlerList : HandlerListBase {
+            std::vector<std::function<void(const Event &)> > immediate;
+            std::vector<std::function<void(const Event &)> > deferred;
+        };
+
+        template<typename Event>
+        HandlerList<Event> &getHandlers() {
+            auto &slot = m_handlers[std::type_index(typeid(Event))];
+            if (!slot) slot = std::make_unique<HandlerList<Event> >();
+            return static_cast<HandlerList<Event> &>(*slot);
+        }
+
+        // Highest priority queue with a call, nullptr if all are empty
+        std::deque<std::function<void()> > *nextQueue();
+
+        std::unordered_map<std::type_index, std::unique_ptr<HandlerListBase> > m_handlers;
+        std::array<std::deque<std::function<void()> >, static_cast<size_t>(EventPriority::Count)> m_queues;
+        uint64_t m_carriedOverCount = 0;
+    };
+}
+
+#endif //EVENTBUS_H
@@ -26,6 +26,7 @@ namespace Bcg {
         Vector3f initialPosition = Vector3f::Zero();
         Rotation initialRot = Rotation::Identity();
         Vector3f initialScale = Vector3f::Ones();
+        bool replaceScene = false; // Waits for the GPU, clears the scene and focuses the camera on the model
     };
 }
 
@@ -0,0 +1,182 @@
+//
+// Created by alex on 5/5/25.
+//
+
+#include "FrameStats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+#include "JsonWriter.h"
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace Bcg {
+    namespace {
+        constexpr size_t MetricCount = static_cast<size_t>(FrameMetric::Count);
+
+        // Weight of the newest frame in the hitch baseline, roughly the average of the last 20 frames
+        constexpr double AverageWeight = 0.05;
+
+        // Nearest-rank percentile of sorted values
+        double percentile(const std::vector<float> &sorted, double p) {
+            auto rank = static_cast<size_t>(std::ceil(p / 100.0 * static_cast<double>(sorted.size())));
+            return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+        }
+    }
+
+    const char *toString(FrameMetric metric) {
+        switch (metric) {
+            case FrameMetric::Cpu: return "cpu";
+            case FrameMetric::FenceWait: return "fence_wait";
+            case FrameMetric::Acquire: return "acquire";
+            case FrameMetric::Present: return "present";
+            case FrameMetric::Simulation: return "simulation";
+            case FrameMetric::Latency: return "latency";
+            case FrameMetric::Ui: return "ui";
+            default: return "unknown";
+        }
+    }
+
+    FrameStats::FrameStats(size_t capacity) : m_capacity(std::max<size_t>(capacity, 1)) {
+        for (auto &history: m_history) history.assign(m_capacity, 0.0f);
+        m_scratch.reserve(m_capacity);
+    }
+
+    void FrameStats::record(const FrameTimes &times) {
+        for (size_t i = 0; i < MetricCount; ++i) {
+            m_history[i][m_next] = static_cast<float>(times[i]);
+            m_runMax[i] = std::max(m_runMax[i], times[i]);
+        }
+        m_next = (m_next + 1) % m_capacity;
+        m_size = std::min(m_size + 1, m_capacity);
+
+        double cpu = times[static_cast<size_t>(FrameMetric::Cpu)];
+        if (m_frameCount == 0) {
+            m_averageCpu = cpu;
+        } else {
+            if (cpu > hitchFactor * m_averageCpu) ++m_hitchCount;
+            m_averageCpu += AverageWeight * (cpu - m_averageCpu);
+        }
+        if (cpu > budgetMilliseconds) ++m_overBudgetCount;
+        ++m_frameCount;
+    }
+
+    FrameTimeSummary FrameStats::summarize(FrameMetric metric, size_t frames) const {
+        FrameTimeSummary summary;
+        size_t count = frames == 0 ? m_size : std::min(frames, m_size);
+        if (count == 0) return summary;
+
+        m_scratch.clear();
+        for (size_t i = 0; i < count; ++i) m_scratch.push_back(getRecent(metric, i));
+        std::sort(m_scratch.begin(), m_scratch.end());
+
+        double sum = 0.0;
+        for (float value: m_scratch) sum += value;
+        summary.count = count;
+        summary.mean = sum / static_cast<double>(count);
+        summary.min = m_scratch.front();
+        summary.p50 = percentile(m_scratch, 50.0);
+        summary.p95 = percentile(m_scratch, 95.0);
+        summary.p99 = percentile(m_scratch, 99.0);
+        summary.max = m_scratch.back();
+        return summary;
+    }
+
+    float FrameStats::getRecent(FrameMetric metric, size_t i) const {
+        return m_history[static_cast<size_t>(metric)][(m_next + m_capacity - 1 - i) % m_capacity];
+    }
+
+    void FrameStats::recordActivity(bool idle, double seconds, double cpuSeconds) {
+        ActivityTime &activity = m_activity[idle ? 1 : 0];
+        activity.seconds += seconds;
+        activity.cpuSeconds += cpuSeconds;
+    }
+
+    double FrameStats::processCpuSeconds() {
+#ifdef _WIN32
+        FILETIME creation, exit, kernel, user;
+        if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user)) return 0.0;
+        auto ticks = [](const FILETIME &time) {
+            return static_cast<double>((static_cast<uint64_t>(time.dwHighDateTime) << 32) | time.dwLowDateTime);
+        };
+        return (ticks(kernel) + ticks(user)) * 1e-7; // 100 ns ticks
+#else
+        rusage usage{};
+        if (getrusage(RUSAGE_SELF, &usage) != 0) return 0.0;
+        auto seconds = [](const timeval &time) {
+            return static_cast<double>(time.tv_sec) + static_cast<double>(time.tv_usec) * 1e-6;
+        };
+        return seconds(usage.ru_utime) + seconds(usage.ru_stime);
+#endif
+    }
+
+    void FrameStats::reset() {
+        m_next = 0;
+        m_size = 0;
+        m_runMax = {};
+        m_frameCount = 0;
+        m_hitchCount = 0;
+        m_overBudgetCount = 0;
+        m_averageCpu = 0.0;
+        m_activity = {};
+    }
+
+    bool FrameStats::writeJson(const std::string &path,
+                               const std::vector<std::pair<std::string, std::string> > &info) const {
+        std::ofstream file(path, std::ios::trunc);
+        if (!file.is_open()) return false;
+
+        JsonWriter json(file);
+        json.beginObject();
+        json.key("info").beginObject();
+        for (const auto &[key, value]: info) json.field(key, value);
+        json.endObject();
+        json.field("frames", m_frameCount);
+        json.field("window_frames", static_cast<uint64_t>(m_size));
+        json.field("hitch_factor", hitchFactor);
+        json.field("hitches", m_hitchCount);
+        json.field("budget_ms", budgetMilliseconds);
+        json.field("over_budget", m_overBudgetCount);
+        json.key("metrics");
+        writeMetrics(json);
+        json.key("cpu_usage").beginObject();
+        for (bool idle: {false, true}) {
+            const ActivityTime &activity = getActivity(idle);
+            json.key(idle ? "idle" : "interactive").beginObject();
+            json.field("seconds", activity.seconds);
+            json.field("cpu_seconds", activity.cpuSeconds);
+            json.field("cpu_percent", activity.cpuPercent());
+            json.endObject();
+        }
+        json.endObject();
+        json.endObject();
+        file << '\n';
+        return static_cast<bool>(file);
+    }
+
+    void FrameStats::writeMetrics(JsonWriter &json) const {
+        json.beginObject();
+        for (size_t i = 0; i < MetricCount; ++i) {
+            auto metric = static_cast<FrameMetric>(i);
+            FrameTimeSummary summary = summarize(metric);
+            json.key(toString(metric)).beginObject();
+            json.field("count", summary.count);
+            json.field("mean_ms", summary.mean);
+            json.field("min_ms", summary.min);
+            json.field("p50_ms", summary.p50);
+            json.field("p95_ms", summary.p95);
+            json.field("p99_ms", summary.p99);
+            json.field("max_ms", summary.max);
+            json.field("run_max_ms", m_runMax[i]);
+            json.endObject();
+        }
+        json.endObject();
+    }
+}
@@ -0,0 +1,121 @@
+//
+// Created by alex on 5/5/25.
+//
+
+#ifndef FRAMESTATS_H
+#define FRAMESTATS_H
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Bcg {
+    class JsonWriter;
+
+    enum class FrameMetric : uint32_t {
+        Cpu, // Whole main loop iteration (threaded: render thread iteration), including the waits below
+        FenceWait, // vkWaitForFences on the frame in flight
+        Acquire, // vkAcquireNextImageKHR
+        Present, // vkQueuePresentKHR
+        Simulation, // Input, systems and UI of the rendered frame
+        Latency, // From polling the input of the rendered frame until it was presented
+        Ui, // Building and copying the UI of the rendered frame, part of Simulation, close to 0 while it is static
+        Count
+    };
+
+    const char *toString(FrameMetric metric); // "cpu", "fence_wait", ...
+
+    // Milliseconds of one frame, indexed by FrameMetric
+    using FrameTimes = std::array<double, static_cast<size_t>(FrameMetric::Count)>;
+
+    struct FrameTimeSummary {
+        uint64_t count = 0;
+        double mean = 0.0;
+        double min = 0.0;
+        double p50 = 0.0;
+        double p95 = 0.0;
+        double p99 = 0.0;
+        double max = 0.0;
+    };
+
+    // Wall and process CPU time spent in one state of the main loop
+    struct ActivityTime {
+        double seconds = 0.0;
+        double cpuSeconds = 0.0;
+
+        // Of one core, e.g. 100 for a busy loop on one thread
+        double cpuPercent() const { return seconds > 0.0 ? 100.0 * cpuSeconds / seconds : 0.0; }
+    };
+
+    // Frame timings of the newest `capacity` frames in one ring per metric. record() neither locks nor allocates;
+    // percentiles are computed on demand. A frame is a hitch if its CPU time exceeds hitchFactor times the moving
+    // average of the previous frames, it is over budget if it exceeds budgetMilliseconds. Both counts, the frame
+    // count and the maxima cover the whole run, the percentiles only the frames in the ring.
+    class FrameStats {
+    public:
+        explicit FrameStats(size_t capacity = 1u << 16);
+
+        void record(const FrameTimes &times);
+
+        // Over the newest `frames` recorded frames, 0 for all in the ring
+        FrameTimeSummary summarize(FrameMetric metric, size_t frames = 0) const;
+
+        // i-th newest value of the ring, i < getWindowSize()
+        float getRecent(FrameMetric metric, size_t i) const;
+
+        size_t getWindowSize() const { return m_size; }
+
+        size_t getCapacity() const { return m_capacity; }
+
+        uint64_t getFrameCount() const { return m_frameCount; }
+
+        uint64_t getHitchCount() const { return m_hitchCount; }
+
+        uint64_t getOverBudgetCount() const { return m_overBudgetCount; }
+
+        double getRunMax(FrameMetric metric) const { return m_runMax[static_cast<size_t>(metric)]; }
+
+        // Time since the previous call, attributed to the idle state (waiting for events, minimized) or to the
+        // interactive state (updating and rendering)
+        void recordActivity(bool idle, double seconds, double cpuSeconds);
+
+        const ActivityTime &getActivity(bool idle) const { return m_activity[idle ? 1 : 0]; }
+
+        // User plus system CPU time of the process since it started
+        static double processCpuSeconds();
+
+        void reset();
+
+        double hitchFactor = 2.0;
+        double budgetMilliseconds = 1000.0 / 60.0;
+
+        // { "info": {...}, "frames", "window_frames", "hitch_factor", "hitches", "budget_ms", "over_budget",
+        //   "metrics": { "cpu": { "count", "mean_ms", "min_ms", "p50_ms", "p95_ms", "p99_ms", "max_ms",
+        //   "run_max_ms" }, "fence_wait": {...}, ... },
+        //   "cpu_usage": { "interactive": { "seconds", "cpu_seconds", "cpu_percent" }, "idle": {...} } }
+        bool writeJson(const std::string &path,
+                       const std::vector<std::pair<std::string, std::string> > &info = {}) const;
+
+        // The "metrics" object of writeJson() as the next value of the writer
+        void writeMetrics(JsonWriter &json) const;
+
+    private:
+        size_t m_capacity;
+        size_t m_next = 0; // Ring position of the next frame
+        size_t m_size = 0;
+        std::array<std::vector<float>, static_cast<size_t>(FrameMetric::Count)> m_history;
+        FrameTimes m_runMax{};
+
+        uint64_t m_frameCount = 0;
+        uint64_t m_hitchCount = 0;
+        uint64_t m_overBudgetCount = 0;
+        double m_averageCpu = 0.0; // Exponential moving average, the hitch baseline
+        std::array<ActivityTime, 2> m_activity{}; // Interactive, idle
+
+        mutable std::vector<float> m_scratch; // Sorted copy for the percentiles, reserved once
+    };
+}
+
+#endif //FRAMESTATS_H
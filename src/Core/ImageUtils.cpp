@@ -0,0 +1,30 @@
+//
+// Created by alex on 5/2/25.
+//
+
+#include "ImageUtils.h"
+
+#include <fstream>
+
+namespace Bcg::ImageUtils {
+    bool writePpm(const std::string &path, uint32_t width, uint32_t height, const std::vector<uint8_t> &pixels,
+                  bool swapRedBlue) {
+        if (pixels.size() < static_cast<size_t>(width) * height * 4) return false;
+
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) return false;
+
+        file << "P6\n" << width << " " << height << "\n255\n";
+        std::vector<uint8_t> row(static_cast<size_t>(width) * 3);
+        for (uint32_t y = 0; y < height; ++y) {
+            const uint8_t *source = pixels.data() + static_cast<size_t>(y) * width * 4;
+            for (uint32_t x = 0; x < width; ++x) {
+                row[x * 3 + 0] = source[x * 4 + (swapRedBlue ? 2 : 0)];
+                row[x * 3 + 1] = source[x * 4 + 1];
+                row[x * 3 + 2] = source[x * 4 + (swapRedBlue ? 0 : 2)];
+            }
+            file.write(reinterpret_cast<const char *>(row.data()), static_cast<std::streamsize>(row.size()));
+        }
+        return static_cast<bool>(file);
+    }
+}
@@ -0,0 +1,19 @@
+//
+// Created by alex on 5/2/25.
+//
+
+#ifndef IMAGEUTILS_H
+#define IMAGEUTILS_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Bcg::ImageUtils {
+    // Writes tightly packed 8 bit RGBA pixels (top row first) as binary PPM (P6), alpha is dropped.
+    // If swapRedBlue is set the input is BGRA. Returns false if the file cannot be written.
+    bool writePpm(const std::string &path, uint32_t width, uint32_t height, const std::vector<uint8_t> &pixels,
+                  bool swapRedBlue = false);
+}
+
+#endif //IMAGEUTILS_H
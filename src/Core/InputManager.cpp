@@ -2,6 +2,8 @@
 // Created by alex on 4/9/25.
 //
 
+#include <iterator>
+
 #include <GLFW/glfw3.h>
 
 #include "InputManager.h"
@@ -9,8 +11,15 @@
 #include "CameraUtils.h"
 #include "Application.h"
 #include "WindowManager.h"
+#include "Logger.h"
 
 namespace Bcg {
+    namespace {
+        // Polled by processInput, bit i of the recorded key mask
+        constexpr int TrackedKeys[] = {GLFW_KEY_W, GLFW_KEY_A, GLFW_KEY_S, GLFW_KEY_D};
+        constexpr uint32_t KeyW = 1u << 0, KeyA = 1u << 1, KeyS = 1u << 2, KeyD = 1u << 3;
+    }
+
     InputManager::InputManager() : Manager() {
 
     }
@@ -27,6 +36,17 @@ namespace Bcg {
     }
 
     void InputManager::processInput(float deltaTime) {
+        uint32_t keyMask = m_replayKeyMask;
+        if (!m_recorder.isReplaying()) {
+            keyMask = 0;
+            auto h_window = context->windowManager->getGLFWHandle();
+            for (size_t i = 0; h_window && i < std::size(TrackedKeys); ++i) {
+                if (glfwGetKey(h_window, TrackedKeys[i]) == GLFW_PRESS) keyMask |= 1u << i;
+            }
+        }
+        m_recorder.endFrame(deltaTime, keyMask);
+        m_keyMask = keyMask;
+
         // Reset movement flag at the start of input processing
         auto camera = context->cameraSystem->getCurrentCamera();
         if (!camera) return;
@@ -42,20 +62,19 @@ namespace Bcg {
         Vector3f moveDirection = Vector3f::Zero(); // Accumulate movement
 
         // Check WASD keys
-        auto h_window = context->windowManager->getGLFWHandle();
-        if (glfwGetKey(h_window, GLFW_KEY_W) == GLFW_PRESS) {
+        if (keyMask & KeyW) {
             moveDirection += forwardDirXZ;
             moved = true;
         }
-        if (glfwGetKey(h_window, GLFW_KEY_S) == GLFW_PRESS) {
+        if (keyMask & KeyS) {
             moveDirection -= forwardDirXZ;
             moved = true;
         }
-        if (glfwGetKey(h_window, GLFW_KEY_A) == GLFW_PRESS) {
+        if (keyMask & KeyA) {
             moveDirection -= rightDirXZ; // Move left
             moved = true;
         }
-        if (glfwGetKey(h_window, GLFW_KEY_D) == GLFW_PRESS) {
+        if (keyMask & KeyD) {
             moveDirection += rightDirXZ; // Move right
             moved = true;
         }
@@ -86,24 +105,27 @@ namespace Bcg {
     }
 
     void InputManager::handleKey(int key, int scancode, int action, int mods) {
-        if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS) {
+        m_recorder.addEvent({InputEventType::Key, 0.0, {key, scancode, action, mods}});
+        auto h_window = context->windowManager->getGLFWHandle();
+        if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS && h_window) {
             // Need a way to signal shutdown, maybe:
             // m_windowManager->setShouldClose(true); // If Window class has such a method
             // Or set an internal flag:
             // m_shouldQuit = true;
-            glfwSetWindowShouldClose(context->windowManager->getGLFWHandle(), GLFW_TRUE); // Access via Window object
+            glfwSetWindowShouldClose(h_window, GLFW_TRUE); // Access via Window object
         }
         if (key == GLFW_KEY_L && action == GLFW_PRESS) {
             static int model_idx = 0;
             std::string models[] = {"models/star.obj", "models/suzanne.obj", "models/sphere.obj"};
             int num_models = sizeof(models) / sizeof(models[0]);
-            context->dispatcher->trigger<LoadModelEvent>({models[model_idx % num_models]});
+            context->eventBus->publish(LoadModelEvent{models[model_idx % num_models]});
             model_idx++;
         }
         // Add other key handling
     }
 
     void InputManager::handleMouseButton(int button, int action, int mods) {
+        m_recorder.addEvent({InputEventType::MouseButton, 0.0, {button, action, mods}});
         m_mouse.is_left_button_pressed = button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS;
         m_mouse.is_middle_button_pressed = button == GLFW_MOUSE_BUTTON_MIDDLE && action == GLFW_PRESS;
         m_mouse.is_right_button_pressed = button == GLFW_MOUSE_BUTTON_RIGHT && action == GLFW_PRESS;
@@ -127,6 +149,7 @@ namespace Bcg {
     }
 
     void InputManager::handleCursorPos(double xpos, double ypos) {
+        m_recorder.addEvent({InputEventType::CursorPos, 0.0, {}, {xpos, ypos}});
         m_mouse.is_moving = true;
         m_mouse.is_idle = false;
         m_mouse.current.cursor_position = Vector2f(xpos, ypos);
@@ -138,6 +161,7 @@ namespace Bcg {
     }
 
     void InputManager::handleScroll(double xoffset, double yoffset) {
+        m_recorder.addEvent({InputEventType::Scroll, 0.0, {}, {xoffset, yoffset}});
         m_mouse.is_scrolling = true;
         m_mouse.is_idle = false;
         m_mouse.scrollxy = Vector2f(xoffset, yoffset);
@@ -147,5 +171,85 @@ namespace Bcg {
     }
 
     void InputManager::handleChar(unsigned int c) {
+        m_recorder.addEvent({InputEventType::Char, 0.0, {static_cast<int32_t>(c)}});
+    }
+
+    void InputManager::queueEvent(const InputEvent &event) {
+        m_queue.push(event);
+    }
+
+    void InputManager::dispatchEvents() {
+        m_queue.drain(m_events);
+        for (const auto &event: m_events) dispatch(event);
+
+        uint64_t dropped = m_queue.getDroppedCount();
+        if (dropped != m_reportedDrops) {
+            Log::Warn("[InputManager::dispatchEvents] Input queue full, {} events dropped", dropped - m_reportedDrops);
+            m_reportedDrops = dropped;
+        }
+    }
+
+    void InputManager::startRecording() {
+        m_recorder.startRecording();
+    }
+
+    bool InputManager::saveRecording(const std::string &path) {
+        if (!m_recorder.isRecording()) return false;
+        if (!m_recorder.save(path)) {
+            Log::Error("[InputManager::saveRecording] Could not write {}", path);
+            return false;
+        }
+        Log::Info("[InputManager::saveRecording] {} frames written to {}", m_recorder.getFrameCount(), path);
+        return true;
+    }
+
+    bool InputManager::startReplay(const std::string &path) {
+        if (!m_recorder.startReplay(path)) {
+            Log::Error("[InputManager::startReplay] {} is not a valid input recording", path);
+            return false;
+        }
+        m_mouse = Mouse();
+        m_replayKeyMask = 0;
+        Log::Info("[InputManager::startReplay] Replaying {} frames from {}", m_recorder.getFrameCount(), path);
+        return true;
+    }
+
+    bool InputManager::isReplaying() const {
+        return m_recorder.isReplaying();
+    }
+
+    size_t InputManager::getReplayFrameCount() const {
+        return m_recorder.isReplaying() ? m_recorder.getFrameCount() : 0;
+    }
+
+    bool InputManager::replayFrame(float &deltaTime) {
+        InputFrame frame;
+        const InputEvent *events = nullptr;
+        if (!m_recorder.nextFrame(frame, events)) return false;
+
+        for (uint32_t i = 0; i < frame.eventCount; ++i) dispatch(events[i]);
+        m_replayKeyMask = frame.keyMask;
+        deltaTime = frame.deltaTime;
+        return true;
+    }
+
+    void InputManager::dispatch(const InputEvent &event) {
+        switch (event.type) {
+            case InputEventType::Key:
+                handleKey(event.ints[0], event.ints[1], event.ints[2], event.ints[3]);
+                break;
+            case InputEventType::MouseButton:
+                handleMouseButton(event.ints[0], event.ints[1], event.ints[2]);
+                break;
+            case InputEventType::CursorPos:
+                handleCursorPos(event.values[0], event.values[1]);
+                break;
+            case InputEventType::Scroll:
+                handleScroll(event.values[0], event.values[1]);
+                break;
+            case InputEventType::Char:
+                handleChar(static_cast<unsigned int>(event.ints[0]));
+                break;
+        }
     }
 }
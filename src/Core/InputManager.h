@@ -8,6 +8,8 @@
 #include "Manager.h"
 #include "Mouse.h"
 #include "MatVec.h"
+#include "InputRecorder.h"
+#include "InputQueue.h"
 
 namespace Bcg {
     class InputManager : public Manager{
@@ -24,6 +26,9 @@ namespace Bcg {
 
         [[nodiscard]] const Mouse &getMouse() const;
 
+        // Any movement key held in the last processInput, the camera keeps moving
+        [[nodiscard]] bool hasHeldKeys() const { return m_keyMask != 0; }
+
         void handleKey(int key, int scancode, int action, int mods);
 
         void handleMouseButton(int button, int action, int mods);
@@ -34,8 +39,38 @@ namespace Bcg {
 
         void handleChar(unsigned int c);
 
+        // Called by the GLFW callbacks instead of the handlers, which dispatchEvents calls once per frame
+        void queueEvent(const InputEvent &event);
+
+        // Drains and coalesces the queued events and passes them to the handlers, call after polling the window
+        void dispatchEvents();
+
+        // Records every handled event and the per-frame state of processInput until saveRecording
+        void startRecording();
+
+        bool saveRecording(const std::string &path);
+
+        // Replaces the GLFW callbacks and key polling with the recorded input, false if the file is invalid
+        bool startReplay(const std::string &path);
+
+        [[nodiscard]] bool isReplaying() const;
+
+        [[nodiscard]] size_t getReplayFrameCount() const;
+
+        // Delivers the next recorded frame's events and sets deltaTime to its recorded value. Call in place of the
+        // GLFW callbacks, before processInput; false once the recording ended.
+        bool replayFrame(float &deltaTime);
+
     private:
+        void dispatch(const InputEvent &event);
+
         Mouse m_mouse;
+        InputRecorder m_recorder;
+        InputQueue m_queue;
+        std::vector<InputEvent> m_events; // Drained from m_queue, kept to reuse its capacity
+        uint64_t m_reportedDrops = 0;
+        uint32_t m_replayKeyMask = 0;
+        uint32_t m_keyMask = 0; // Of the last processInput
     };
 }
 
@@ -0,0 +1,43 @@
+//
+// Created by alex on 5/5/25.
+//
+
+#include "InputQueue.h"
+
+namespace Bcg {
+    InputQueue::InputQueue(size_t capacity) : m_queue(capacity) {
+    }
+
+    bool InputQueue::push(const InputEvent &event) {
+        if (m_queue.tryPush(event)) return true;
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    void InputQueue::drain(std::vector<InputEvent> &events) {
+        events.clear();
+        // Index of the merged cursor and scroll event since the last discrete event, or -1
+        std::ptrdiff_t cursor = -1, scroll = -1;
+        InputEvent event;
+        while (m_queue.tryPop(event)) {
+            if (event.type == InputEventType::CursorPos) {
+                if (cursor >= 0) {
+                    events[cursor] = event;
+                    continue;
+                }
+                cursor = static_cast<std::ptrdiff_t>(events.size());
+            } else if (event.type == InputEventType::Scroll) {
+                if (scroll >= 0) {
+                    events[scroll].values[0] += event.values[0];
+                    events[scroll].values[1] += event.values[1];
+                    continue;
+                }
+                scroll = static_cast<std::ptrdiff_t>(events.size());
+            } else {
+                cursor = -1;
+                scroll = -1;
+            }
+            events.push_back(event);
+        }
+    }
+}
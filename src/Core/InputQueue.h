@@ -0,0 +1,38 @@
+//
+// Created by alex on 5/5/25.
+//
+
+#ifndef INPUTQUEUE_H
+#define INPUTQUEUE_H
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "InputRecorder.h"
+#include "SpscQueue.h"
+
+namespace Bcg {
+    // Raw input events pushed by the GLFW callbacks and drained once per frame by InputManager, so the callbacks do
+    // no camera or scene work however many events the devices deliver.
+    class InputQueue {
+    public:
+        explicit InputQueue(size_t capacity = 4096);
+
+        // Producer side, false (and counted as dropped) if the queue is full
+        bool push(const InputEvent &event);
+
+        // Consumer side: pops every queued event into events (cleared first). Consecutive cursor moves collapse into
+        // the last position, which carries their summed delta, and consecutive scroll events into one with the
+        // summed offsets. Keys, buttons and characters keep their order relative to the merged moves.
+        void drain(std::vector<InputEvent> &events);
+
+        uint64_t getDroppedCount() const { return m_dropped.load(std::memory_order_relaxed); }
+
+    private:
+        SpscQueue<InputEvent> m_queue;
+        std::atomic<uint64_t> m_dropped{0};
+    };
+}
+
+#endif //INPUTQUEUE_H
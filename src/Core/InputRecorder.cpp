@@ -0,0 +1,155 @@
+//
+// Created by alex on 5/5/25.
+//
+
+#include "InputRecorder.h"
+
+#include <cstring>
+#include <fstream>
+
+namespace Bcg {
+    namespace {
+        constexpr char Magic[8] = {'B', 'C', 'G', 'I', 'N', 'P', 'U', 'T'};
+        constexpr uint32_t Version = 1;
+        // Sizes in the file, an event has at least its type and time
+        constexpr uint64_t FrameBytes = sizeof(float) + 2 * sizeof(uint32_t);
+        constexpr uint64_t MinEventBytes = sizeof(uint8_t) + sizeof(double);
+
+        template<typename T>
+        void write(std::ostream &stream, const T &value) {
+            stream.write(reinterpret_cast<const char *>(&value), sizeof(T));
+        }
+
+        template<typename T>
+        bool read(std::istream &stream, T &value) {
+            return static_cast<bool>(stream.read(reinterpret_cast<char *>(&value), sizeof(T)));
+        }
+
+        uint32_t intCount(InputEventType type) {
+            switch (type) {
+                case InputEventType::Key: return 4;
+                case InputEventType::MouseButton: return 3;
+                case InputEventType::Char: return 1;
+                default: return 0;
+            }
+        }
+
+        uint32_t valueCount(InputEventType type) {
+            return type == InputEventType::CursorPos || type == InputEventType::Scroll ? 2 : 0;
+        }
+    }
+
+    void InputRecorder::startRecording() {
+        m_frames.clear();
+        m_events.clear();
+        m_frameEvents = 0;
+        m_replaying = false;
+        m_recording = true;
+        m_start = std::chrono::steady_clock::now();
+    }
+
+    void InputRecorder::addEvent(InputEvent event) {
+        if (!m_recording) return;
+        event.time = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+        m_events.push_back(event);
+        ++m_frameEvents;
+    }
+
+    void InputRecorder::endFrame(float deltaTime, uint32_t keyMask) {
+        if (!m_recording) return;
+        InputFrame frame;
+        frame.deltaTime = deltaTime;
+        frame.keyMask = keyMask;
+        frame.firstEvent = static_cast<uint32_t>(m_events.size() - m_frameEvents);
+        frame.eventCount = m_frameEvents;
+        m_frames.push_back(frame);
+        m_frameEvents = 0;
+    }
+
+    bool InputRecorder::save(const std::string &path) const {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) return false;
+
+        file.write(Magic, sizeof(Magic));
+        write(file, Version);
+        write(file, static_cast<uint32_t>(m_frames.size()));
+        // Events after the last complete frame are dropped
+        uint32_t eventCount = m_frames.empty() ? 0 : m_frames.back().firstEvent + m_frames.back().eventCount;
+        write(file, eventCount);
+        for (const auto &frame: m_frames) {
+            write(file, frame.deltaTime);
+            write(file, frame.keyMask);
+            write(file, frame.eventCount);
+        }
+        for (uint32_t i = 0; i < eventCount; ++i) {
+            const InputEvent &event = m_events[i];
+            write(file, static_cast<uint8_t>(event.type));
+            write(file, event.time);
+            for (uint32_t j = 0; j < intCount(event.type); ++j) write(file, event.ints[j]);
+            for (uint32_t j = 0; j < valueCount(event.type); ++j) write(file, event.values[j]);
+        }
+        return static_cast<bool>(file);
+    }
+
+    bool InputRecorder::startReplay(const std::string &path) {
+        m_recording = false;
+        m_replaying = false;
+        m_frames.clear();
+        m_events.clear();
+
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open()) return false;
+
+        char magic[sizeof(Magic)];
+        uint32_t version = 0, frameCount = 0, eventCount = 0;
+        if (!file.read(magic, sizeof(magic)) || std::memcmp(magic, Magic, sizeof(Magic)) != 0) return false;
+        if (!read(file, version) || version != Version) return false;
+        if (!read(file, frameCount) || !read(file, eventCount)) return false;
+
+        // The counts of a truncated or corrupt file must not size the buffers before the reads fail
+        const std::streamoff headerEnd = file.tellg();
+        file.seekg(0, std::ios::end);
+        const auto remaining = static_cast<uint64_t>(file.tellg() - headerEnd);
+        file.seekg(headerEnd);
+        const uint64_t framesBytes = static_cast<uint64_t>(frameCount) * FrameBytes;
+        if (framesBytes > remaining || static_cast<uint64_t>(eventCount) * MinEventBytes > remaining - framesBytes) {
+            return false;
+        }
+
+        m_frames.resize(frameCount);
+        uint64_t firstEvent = 0;
+        for (auto &frame: m_frames) {
+            if (!read(file, frame.deltaTime) || !read(file, frame.keyMask) || !read(file, frame.eventCount)) {
+                return false;
+            }
+            frame.firstEvent = static_cast<uint32_t>(firstEvent);
+            firstEvent += frame.eventCount;
+        }
+        if (firstEvent != eventCount) return false;
+
+        m_events.resize(eventCount);
+        for (auto &event: m_events) {
+            uint8_t type = 0;
+            if (!read(file, type) || type > static_cast<uint8_t>(InputEventType::Char)) return false;
+            event.type = static_cast<InputEventType>(type);
+            if (!read(file, event.time)) return false;
+            for (uint32_t j = 0; j < intCount(event.type); ++j) {
+                if (!read(file, event.ints[j])) return false;
+            }
+            for (uint32_t j = 0; j < valueCount(event.type); ++j) {
+                if (!read(file, event.values[j])) return false;
+            }
+        }
+
+        m_replayFrame = 0;
+        m_replaying = true;
+        return true;
+    }
+
+    bool InputRecorder::nextFrame(InputFrame &frame, const InputEvent *&events) {
+        if (!m_replaying || m_replayFrame >= m_frames.size()) return false;
+        frame = m_frames[m_replayFrame++];
+        events = m_events.data() + frame.firstEvent;
+        return true;
+    }
+}
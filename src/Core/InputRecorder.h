@@ -0,0 +1,76 @@
+//
+// Created by alex on 5/5/25.
+//
+
+#ifndef INPUTRECORDER_H
+#define INPUTRECORDER_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Bcg {
+    enum class InputEventType : uint8_t {
+        Key, // ints: key, scancode, action, mods
+        MouseButton, // ints: button, action, mods
+        CursorPos, // values: x, y
+        Scroll, // values: x offset, y offset
+        Char // ints: codepoint
+    };
+
+    struct InputEvent {
+        InputEventType type = InputEventType::Key;
+        double time = 0.0; // Seconds since the recording started
+        int32_t ints[4] = {};
+        double values[2] = {};
+    };
+
+    struct InputFrame {
+        float deltaTime = 0.0f; // As passed to InputManager::processInput
+        uint32_t keyMask = 0; // Held keys polled by processInput, bit i for InputManager's tracked key i
+        uint32_t firstEvent = 0;
+        uint32_t eventCount = 0; // Events delivered before processInput of this frame
+    };
+
+    // Input of a session for deterministic replay: per frame the callback events, the frame's deltaTime and the
+    // polled key states. Recorded in memory and saved as a compact binary file:
+    //   "BCGINPUT" uint32 version, uint32 frameCount, uint32 eventCount,
+    //   frames (float deltaTime, uint32 keyMask, uint32 eventCount),
+    //   events (uint8 type, float64 time, payload: Key 4 x int32, MouseButton 3 x int32, CursorPos and Scroll
+    //   2 x float64, Char 1 x int32).
+    // Values are stored in host byte order (little endian on every platform we build for).
+    class InputRecorder {
+    public:
+        void startRecording();
+
+        void addEvent(InputEvent event); // Its time is set here
+
+        void endFrame(float deltaTime, uint32_t keyMask);
+
+        bool isRecording() const { return m_recording; }
+
+        bool save(const std::string &path) const;
+
+        // Loads a recording and starts replaying it from the first frame, false if the file is invalid
+        bool startReplay(const std::string &path);
+
+        bool isReplaying() const { return m_replaying; }
+
+        // The next recorded frame and its events, false once all frames were replayed
+        bool nextFrame(InputFrame &frame, const InputEvent *&events);
+
+        size_t getFrameCount() const { return m_frames.size(); }
+
+    private:
+        std::vector<InputFrame> m_frames;
+        std::vector<InputEvent> m_events;
+        bool m_recording = false;
+        bool m_replaying = false;
+        size_t m_replayFrame = 0;
+        uint32_t m_frameEvents = 0; // Of the frame being recorded
+        std::chrono::steady_clock::time_point m_start;
+    };
+}
+
+#endif //INPUTRECORDER_H
@@ -0,0 +1,143 @@
+//
+// Created by alex on 5/2/25.
+//
+
+#include "JsonWriter.h"
+
+#include <cmath>
+#include <cstdio>
+
+namespace Bcg {
+    JsonWriter::JsonWriter(std::ostream &stream, bool pretty) : m_stream(stream), m_pretty(pretty) {
+    }
+
+    JsonWriter &JsonWriter::beginObject() {
+        beforeValue();
+        m_stream << '{';
+        m_scopes.push_back({false, true});
+        return *this;
+    }
+
+    JsonWriter &JsonWriter::endObject() {
+        bool empty = m_scopes.back().empty;
+        m_scopes.pop_back();
+        if (!empty) newline();
+        m_stream << '}';
+        return *this;
+    }
+
+    JsonWriter &JsonWriter::beginArray() {
+        beforeValue();
+        m_stream << '[';
+        m_scopes.push_back({true, true});
+        return *this;
+    }
+
+    JsonWriter &JsonWriter::endArray() {
+        bool empty = m_scopes.back().empty;
+        m_scopes.pop_back();
+        if (!empty) newline();
+        m_stream << ']';
+        return *this;
+    }
+
+    JsonWriter &JsonWriter::key(const std::string &name) {
+        Scope &scope = m_scopes.back();
+        if (!scope.empty) m_stream << ',';
+        scope.empty = false;
+        newline();
+        writeEscaped(m_stream, name);
+        m_stream << (m_pretty ? ": " : ":");
+        m_afterKey = true;
+        return *this;
+    }
+
+    JsonWriter &JsonWriter::value(const std::string &text) {
+        beforeValue();
+        writeEscaped(m_stream, text);
+        return *this;
+    }
+
+    JsonWriter &JsonWriter::value(const char *text) {
+        return text ? value(std::string(text)) : null();
+    }
+
+    JsonWriter &JsonWriter::value(double number) {
+        // JSON has no representation for NaN and infinity
+        if (!std::isfinite(number)) return null();
+        beforeValue();
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%.*g", m_precision, number);
+        m_stream << buffer;
+        return *this;
+    }
+
+    JsonWriter &JsonWriter::value(int64_t number) {
+        beforeValue();
+        m_stream << number;
+        return *this;
+    }
+
+    JsonWriter &JsonWriter::value(uint64_t number) {
+        beforeValue();
+        m_stream << number;
+        return *this;
+    }
+
+    JsonWriter &JsonWriter::value(bool flag) {
+        beforeValue();
+        m_stream << (flag ? "true" : "false");
+        return *this;
+    }
+
+    JsonWriter &JsonWriter::null() {
+        beforeValue();
+        m_stream << "null";
+        return *this;
+    }
+
+    void JsonWriter::beforeValue() {
+        if (m_afterKey) {
+            m_afterKey = false;
+            return;
+        }
+        if (m_scopes.empty()) return;
+        Scope &scope = m_scopes.back();
+        if (!scope.empty) m_stream << ',';
+        scope.empty = false;
+        newline();
+    }
+
+    void JsonWriter::newline() {
+        if (!m_pretty) return;
+        m_stream << '\n';
+        for (size_t i = 0; i < m_scopes.size(); ++i) m_stream << "  ";
+    }
+
+    void JsonWriter::writeEscaped(std::ostream &stream, const std::string &text) {
+        stream << '"';
+        for (char c: text) {
+            switch (c) {
+                case '"': stream << "\\\"";
+                    break;
+                case '\\': stream << "\\\\";
+                    break;
+                case '\n': stream << "\\n";
+                    break;
+                case '\r': stream << "\\r";
+                    break;
+                case '\t': stream << "\\t";
+                    break;
+                default:
+                    if (static_cast<unsigned char>(c) < 0x20) {
+                        char buffer[8];
+                        std::snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+                        stream << buffer;
+                    } else {
+                        stream << c;
+                    }
+            }
+        }
+        stream << '"';
+    }
+}
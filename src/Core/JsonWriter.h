@@ -0,0 +1,77 @@
+//
+// Created by alex on 5/2/25.
+//
+
+#ifndef JSONWRITER_H
+#define JSONWRITER_H
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace Bcg {
+    // Minimal streaming JSON writer for reports. Commas and indentation are handled, nesting is the caller's
+    // responsibility (every begin needs its end). Inside objects every value is preceded by key().
+    class JsonWriter {
+    public:
+        explicit JsonWriter(std::ostream &stream, bool pretty = true);
+
+        JsonWriter &beginObject();
+
+        JsonWriter &endObject();
+
+        JsonWriter &beginArray();
+
+        JsonWriter &endArray();
+
+        JsonWriter &key(const std::string &name);
+
+        JsonWriter &value(const std::string &text);
+
+        JsonWriter &value(const char *text);
+
+        JsonWriter &value(double number);
+
+        JsonWriter &value(int64_t number);
+
+        JsonWriter &value(uint64_t number);
+
+        JsonWriter &value(int number) { return value(static_cast<int64_t>(number)); }
+
+        JsonWriter &value(uint32_t number) { return value(static_cast<uint64_t>(number)); }
+
+        JsonWriter &value(bool flag);
+
+        JsonWriter &null();
+
+        // Significant digits of doubles, 6 by default
+        void setPrecision(int digits) { m_precision = digits; }
+
+        template<typename T>
+        JsonWriter &field(const std::string &name, const T &fieldValue) {
+            key(name);
+            return value(fieldValue);
+        }
+
+    private:
+        void beforeValue();
+
+        void newline();
+
+        static void writeEscaped(std::ostream &stream, const std::string &text);
+
+        struct Scope {
+            bool isArray;
+            bool empty;
+        };
+
+        std::ostream &m_stream;
+        std::vector<Scope> m_scopes;
+        bool m_pretty;
+        bool m_afterKey = false;
+        int m_precision = 6;
+    };
+}
+
+#endif //JSONWRITER_H
@@ -0,0 +1,95 @@
+//
+// Created by alex on 5/5/25.
+//
+
+#ifndef LOGRINGBUFFER_H
+#define LOGRINGBUFFER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include <spdlog/common.h>
+
+namespace Bcg {
+    // One formatted message, longer messages are cut and marked as truncated
+    struct LogRecord {
+        static constexpr size_t MaxText = 472;
+
+        spdlog::log_clock::time_point time;
+        spdlog::level::level_enum level = spdlog::level::info;
+        uint32_t length = 0;
+        bool truncated = false;
+        char text[MaxText];
+    };
+
+    // Bounded multi-producer / single-consumer queue of preallocated LogRecords (Vyukov's bounded queue: every slot
+    // carries a sequence number, producers claim positions with one CAS). Producers format directly into their
+    // claimed slot, so pushing neither locks nor allocates.
+    class LogRingBuffer {
+    public:
+        // capacity is rounded up to a power of two
+        explicit LogRingBuffer(size_t capacity) {
+            size_t size = 1;
+            while (size < capacity) size <<= 1;
+            m_mask = size - 1;
+            m_slots.reset(new Slot[size]);
+            for (size_t i = 0; i < size; ++i) m_slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+
+        // Calls fill(LogRecord &) on a free slot and publishes it, returns false without calling fill if full
+        template<typename Fill>
+        bool tryPush(Fill &&fill) {
+            size_t position = m_enqueuePosition.load(std::memory_order_relaxed);
+            Slot *slot;
+            while (true) {
+                slot = &m_slots[position & m_mask];
+                size_t sequence = slot->sequence.load(std::memory_order_acquire);
+                auto difference = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position);
+                if (difference == 0) {
+                    if (m_enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                        break;
+                    }
+                } else if (difference < 0) {
+                    return false; // The consumer has not released this slot yet
+                } else {
+                    position = m_enqueuePosition.load(std::memory_order_relaxed);
+                }
+            }
+            fill(slot->record);
+            slot->sequence.store(position + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Calls consume(const LogRecord &) for up to maxCount published records in order, single consumer only
+        template<typename Consume>
+        size_t consume(Consume &&consume, size_t maxCount) {
+            size_t count = 0;
+            while (count < maxCount) {
+                Slot &slot = m_slots[m_dequeuePosition & m_mask];
+                if (slot.sequence.load(std::memory_order_acquire) != m_dequeuePosition + 1) break;
+                consume(slot.record);
+                slot.sequence.store(m_dequeuePosition + m_mask + 1, std::memory_order_release);
+                ++m_dequeuePosition;
+                ++count;
+            }
+            return count;
+        }
+
+        size_t capacity() const { return m_mask + 1; }
+
+    private:
+        struct Slot {
+            std::atomic<size_t> sequence{0};
+            LogRecord record;
+        };
+
+        std::unique_ptr<Slot[]> m_slots;
+        size_t m_mask = 0;
+        alignas(64) std::atomic<size_t> m_enqueuePosition{0};
+        alignas(64) size_t m_dequeuePosition = 0;
+    };
+}
+
+#endif //LOGRINGBUFFER_H
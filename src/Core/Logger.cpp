@@ -3,33 +3,72 @@
 //
 
 #include "Logger.h"
+#include <condition_variable>
+#include <mutex>
 #include <vector> // For sink list
 
 namespace Bcg {
-    // Define the static member
+    // Define the static members
     std::shared_ptr<spdlog::logger> Log::s_Logger;
+    std::atomic<LogRingBuffer *> Log::s_Queue{nullptr};
+    LogOverflowPolicy Log::s_OverflowPolicy = LogOverflowPolicy::Drop;
+    std::atomic<uint64_t> Log::s_Dropped{0};
+
+    namespace {
+        // Records handed to the sinks per wakeup before the writer checks for flushing again
+        constexpr size_t WriterBatchSize = 256;
+        // The writer polls, producers never wake it (that would need a syscall on every log call)
+        constexpr std::chrono::milliseconds WriterIdleSleep{5};
+
+        struct AsyncWriter {
+            std::unique_ptr<LogRingBuffer> queue; // Kept until the next Init, late producers may still hold it
+            std::thread thread;
+            std::mutex mutex;
+            std::condition_variable wakeup;
+            bool stop = false;
+            std::chrono::milliseconds flushInterval{200};
+
+            // Without Log::Shutdown() (e.g. an exception escaped main) the thread must still be joined
+            ~AsyncWriter() { Log::Shutdown(); }
+        };
+
+        AsyncWriter s_writer;
+
+        size_t writeBatch(spdlog::logger &logger, LogRingBuffer &queue, bool &flushNow) {
+            return queue.consume([&](const LogRecord &record) {
+                if (record.truncated) {
+                    logger.log(record.time, {}, record.level,
+                               fmt::format("{} [...]", spdlog::string_view_t(record.text, record.length)));
+                } else {
+                    logger.log(record.time, {}, record.level, spdlog::string_view_t(record.text, record.length));
+                }
+                flushNow |= record.level >= spdlog::level::err;
+            }, WriterBatchSize);
+        }
+    }
+
+    void Log::Init(const LogConfig &config) {
+        Shutdown();
+        spdlog::drop("APP");
 
-    void Log::Init() {
         // Create sinks: one for console, one for file
         std::vector<spdlog::sink_ptr> sinks;
         // Console Sink (colored)
-        sinks.push_back(std::make_shared<spdlog::sinks::stdout_color_sink_mt>());
-        // File Sink (e.g., "logs/app.log") - Ensure "logs" directory exists!
-         try {
-             sinks.push_back(std::make_shared<spdlog::sinks::basic_file_sink_mt>("logs/VulkanApp.log", true)); // true = truncate
-         } catch (const spdlog::spdlog_ex& ex) {
-             // Fallback or just use console if file fails
-             spdlog::error("Log file creation failed: {}", ex.what());
-             // Or just use console sink:
-             // sinks.clear();
-             // sinks.push_back(std::make_shared<spdlog::sinks::stdout_color_sink_mt>());
-         }
-
-
-        // Set custom pattern [%Timestamp] [Level] [LoggerName]: Message
-        sinks[0]->set_pattern("%^[%T.%e] [%l] %n: %v%$"); // Console pattern with color
-        if (sinks.size() > 1) {
-            sinks[1]->set_pattern("[%Y-%m-%d %T.%e] [%l] %n: %v"); // File pattern
+        if (config.console) {
+            auto console = std::make_shared<spdlog::sinks::stdout_color_sink_mt>();
+            console->set_pattern("%^[%T.%e] [%l] %n: %v%$"); // Console pattern with color
+            sinks.push_back(console);
+        }
+        // File Sink (e.g., "logs/app.log") - spdlog creates the directory
+        if (!config.filePath.empty()) {
+            try {
+                auto file = std::make_shared<spdlog::sinks::basic_file_sink_mt>(config.filePath, true); // truncate
+                file->set_pattern("[%Y-%m-%d %T.%e] [%l] %n: %v"); // File pattern
+                sinks.push_back(file);
+            } catch (const spdlog::spdlog_ex &ex) {
+                // Fallback: just use the console
+                spdlog::error("Log file creation failed: {}", ex.what());
+            }
         }
 
         // Create a logger with multiple sinks
@@ -41,14 +80,82 @@ namespace Bcg {
         // Set the logging level (e.g., trace for debug, info for release)
 #ifdef NDEBUG // Release mode
         s_Logger->set_level(spdlog::level::info);
-        s_Logger->flush_on(spdlog::level::info); // Flush on info level and above
 #else // Debug mode
         s_Logger->set_level(spdlog::level::trace);
-        s_Logger->flush_on(spdlog::level::trace); // Flush immediately in debug
 #endif
+        if (config.async) {
+            // The writer thread flushes in batches, see below
+            s_Logger->flush_on(spdlog::level::off);
+        } else {
+#ifdef NDEBUG
+            s_Logger->flush_on(spdlog::level::info); // Flush on info level and above
+#else
+            s_Logger->flush_on(spdlog::level::trace); // Flush immediately in debug
+#endif
+        }
         // Set spdlog's default logger in case other libraries use it indirectly
         spdlog::set_default_logger(s_Logger);
 
-         Info("Logging Initialized."); // Use the logger
+        s_Dropped.store(0, std::memory_order_relaxed);
+        if (config.async) {
+            s_OverflowPolicy = config.overflowPolicy;
+            s_writer.queue = std::make_unique<LogRingBuffer>(config.queueCapacity);
+            s_writer.flushInterval = config.flushInterval;
+            s_writer.stop = false;
+            s_writer.thread = std::thread([logger = s_Logger, queue = s_writer.queue.get()]() {
+                auto lastFlush = std::chrono::steady_clock::now();
+                uint64_t reportedDrops = 0;
+                bool dirty = false;
+                while (true) {
+                    bool flushNow = false;
+                    size_t written = writeBatch(*logger, *queue, flushNow);
+                    dirty |= written > 0;
+
+                    uint64_t drops = s_Dropped.load(std::memory_order_relaxed);
+                    if (drops != reportedDrops) {
+                        logger->warn("[Log] {} messages dropped, the log queue was full.", drops - reportedDrops);
+                        reportedDrops = drops;
+                        dirty = true;
+                    }
+
+                    auto now = std::chrono::steady_clock::now();
+                    if (dirty && (flushNow || now - lastFlush >= s_writer.flushInterval)) {
+                        logger->flush();
+                        lastFlush = now;
+                        dirty = false;
+                    }
+                    if (written == WriterBatchSize) continue; // More is waiting
+
+                    std::unique_lock<std::mutex> lock(s_writer.mutex);
+                    if (s_writer.stop) break;
+                    s_writer.wakeup.wait_for(lock, WriterIdleSleep, [] { return s_writer.stop; });
+                }
+                // Drain what was queued before Shutdown()
+                bool flushNow = false;
+                while (writeBatch(*logger, *queue, flushNow) > 0) {
+                }
+                logger->flush();
+            });
+            s_Queue.store(s_writer.queue.get(), std::memory_order_release);
+        }
+
+        Info("Logging Initialized ({}).", config.async ? "async" : "sync"); // Use the logger
+    }
+
+    void Log::Shutdown() {
+        if (!s_writer.thread.joinable()) return;
+        // New calls log synchronously from here on. A call that picked up the queue just before may still push
+        // after the final drain, its message is lost.
+        s_Queue.store(nullptr, std::memory_order_release);
+        {
+            std::lock_guard<std::mutex> lock(s_writer.mutex);
+            s_writer.stop = true;
+        }
+        s_writer.wakeup.notify_one();
+        s_writer.thread.join();
+        if (s_Logger) {
+            s_Logger->flush_on(spdlog::level::info);
+            s_Logger->flush();
+        }
     }
-} // namespace Bcg
\ No newline at end of file
+} // namespace Bcg
@@ -8,51 +8,146 @@
 #include <spdlog/spdlog.h>
 #include <spdlog/sinks/stdout_color_sinks.h> // For console logging
 #include <spdlog/sinks/basic_file_sink.h>   // For file logging
+#include <spdlog/fmt/fmt.h>
+#include <atomic>
+#include <chrono>
 #include <memory>
+#include <string>
+#include <thread>
+
+#include "LogRingBuffer.h"
+
+// Calls below this level are removed at compile time (spdlog level numbers: 0 trace ... 5 critical, 6 off).
+// Set with the CMake cache variable BCG_LOG_LEVEL. Log::Trace() and Log::Debug() only skip the formatting, their
+// arguments are still evaluated; BCG_LOG_TRACE and BCG_LOG_DEBUG (below) remove the whole call.
+#ifndef BCG_LOG_ACTIVE_LEVEL
+#ifdef NDEBUG
+#define BCG_LOG_ACTIVE_LEVEL 1 // Debug and above
+#else
+#define BCG_LOG_ACTIVE_LEVEL 0 // Everything
+#endif
+#endif
 
 namespace Bcg {
+    enum class LogOverflowPolicy {
+        Drop, // Discard the message and count it, the writer reports the number of dropped messages. Errors block.
+        Block // Spin until the writer thread made room
+    };
+
+    struct LogConfig {
+        // Messages are formatted on the calling thread into a preallocated ring and written by a background
+        // thread; otherwise every call writes (and possibly flushes) synchronously.
+        bool async = true;
+        LogOverflowPolicy overflowPolicy = LogOverflowPolicy::Drop;
+        size_t queueCapacity = 8192; // Records of LogRecord::MaxText characters
+        std::chrono::milliseconds flushInterval{200}; // Async only, errors are flushed immediately
+        bool console = true;
+        std::string filePath = "logs/VulkanApp.log"; // Empty for no log file
+    };
+
     class Log {
     public:
-        static void Init(); // Call once at startup
+        static void Init(const LogConfig &config = {}); // Call once at startup
+
+        // Drains the queue and stops the writer thread, later calls log synchronously
+        static void Shutdown();
 
         static void setLevel(spdlog::level::level_enum level) {
             s_Logger->set_level(level);
         }
 
+        // Async messages discarded because the ring was full (LogOverflowPolicy::Drop)
+        static uint64_t getDroppedCount() { return s_Dropped.load(std::memory_order_relaxed); }
+
         // Template functions for different levels
         template<typename... Args>
         static void Trace(spdlog::format_string_t<Args...> fmt, Args &&... args) {
-            s_Logger->trace(fmt, std::forward<Args>(args)...);
+            if constexpr (BCG_LOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_TRACE) {
+                log(spdlog::level::trace, fmt, std::forward<Args>(args)...);
+            }
         }
 
         template<typename... Args>
         static void Debug(spdlog::format_string_t<Args...> fmt, Args &&... args) {
-            s_Logger->debug(fmt, std::forward<Args>(args)...);
+            if constexpr (BCG_LOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_DEBUG) {
+                log(spdlog::level::debug, fmt, std::forward<Args>(args)...);
+            }
         }
 
         template<typename... Args>
         static void Info(spdlog::format_string_t<Args...> fmt, Args &&... args) {
-            s_Logger->info(fmt, std::forward<Args>(args)...);
+            if constexpr (BCG_LOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_INFO) {
+                log(spdlog::level::info, fmt, std::forward<Args>(args)...);
+            }
         }
 
         template<typename... Args>
         static void Warn(spdlog::format_string_t<Args...> fmt, Args &&... args) {
-            s_Logger->warn(fmt, std::forward<Args>(args)...);
+            if constexpr (BCG_LOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_WARN) {
+                log(spdlog::level::warn, fmt, std::forward<Args>(args)...);
+            }
         }
 
         template<typename... Args>
         static void Error(spdlog::format_string_t<Args...> fmt, Args &&... args) {
-            s_Logger->error(fmt, std::forward<Args>(args)...);
+            if constexpr (BCG_LOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_ERROR) {
+                log(spdlog::level::err, fmt, std::forward<Args>(args)...);
+            }
         }
 
         template<typename... Args>
         static void Critical(spdlog::format_string_t<Args...> fmt, Args &&... args) {
-            s_Logger->critical(fmt, std::forward<Args>(args)...);
+            if constexpr (BCG_LOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_CRITICAL) {
+                log(spdlog::level::critical, fmt, std::forward<Args>(args)...);
+            }
         }
 
     private:
+        template<typename... Args>
+        static void log(spdlog::level::level_enum level, spdlog::format_string_t<Args...> fmt, Args &&... args) {
+            if (!s_Logger->should_log(level)) return;
+            LogRingBuffer *queue = s_Queue.load(std::memory_order_acquire);
+            if (!queue) {
+                s_Logger->log(level, fmt, std::forward<Args>(args)...);
+                return;
+            }
+
+            auto fill = [&](LogRecord &record) {
+                record.time = spdlog::log_clock::now();
+                record.level = level;
+                auto result = fmt::format_to_n(record.text, LogRecord::MaxText, fmt, std::forward<Args>(args)...);
+                record.truncated = result.size > LogRecord::MaxText;
+                record.length = static_cast<uint32_t>(record.truncated ? LogRecord::MaxText : result.size);
+            };
+            while (!queue->tryPush(fill)) {
+                // Errors are never dropped
+                if (s_OverflowPolicy == LogOverflowPolicy::Drop && level < spdlog::level::err) {
+                    s_Dropped.fetch_add(1, std::memory_order_relaxed);
+                    return;
+                }
+                std::this_thread::yield();
+            }
+        }
+
         static std::shared_ptr<spdlog::logger> s_Logger;
+        static std::atomic<LogRingBuffer *> s_Queue; // Set while the writer thread runs
+        static LogOverflowPolicy s_OverflowPolicy;
+        static std::atomic<uint64_t> s_Dropped;
     };
 } // namespace Bcg
 
+// For hot paths, like SPDLOG_TRACE/SPDLOG_DEBUG: below BCG_LOG_ACTIVE_LEVEL the call and its arguments are removed
+//   BCG_LOG_TRACE("[WindowManager::cursorPosCallback] ({}, {})", xpos, ypos);
+#if BCG_LOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_TRACE
+#define BCG_LOG_TRACE(...) ::Bcg::Log::Trace(__VA_ARGS__)
+#else
+#define BCG_LOG_TRACE(...) (void) 0
+#endif
+
+#if BCG_LOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_DEBUG
+#define BCG_LOG_DEBUG(...) ::Bcg::Log::Debug(__VA_ARGS__)
+#else
+#define BCG_LOG_DEBUG(...) (void) 0
+#endif
+
 #endif //LOGGER_H
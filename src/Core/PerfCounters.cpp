@@ -0,0 +1,101 @@
+//
+// Created by alex on 5/5/25.
+//
+
+#include "PerfCounters.h"
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Bcg {
+    namespace {
+        struct Registry {
+            std::mutex mutex;
+            std::vector<std::unique_ptr<PerfCounters::ThreadCounters> > counters; // Never freed, threads may exit
+        };
+
+        Registry &registry() {
+            static Registry instance;
+            return instance;
+        }
+
+        // Only touched by endFrame() and the readers
+        struct History {
+            PerfCounters::Values totals{}; // Sum of all threads at the last endFrame()
+            std::array<PerfCounters::Values, PerfCounters::HistoryFrames> frames{};
+            size_t next = 0;
+            size_t size = 0;
+        };
+
+        History &history() {
+            static History instance;
+            return instance;
+        }
+    }
+
+    const char *toString(PerfCounter counter) {
+        switch (counter) {
+            case PerfCounter::DrawCalls: return "draw_calls";
+            case PerfCounter::Triangles: return "triangles";
+            case PerfCounter::PipelineBinds: return "pipeline_binds";
+            case PerfCounter::BufferBinds: return "buffer_binds";
+            case PerfCounter::DescriptorBinds: return "descriptor_binds";
+            case PerfCounter::UploadBytes: return "upload_bytes";
+            case PerfCounter::Allocations: return "allocations";
+            case PerfCounter::TransformsUpdated: return "transforms_updated";
+            case PerfCounter::BoundsUpdated: return "bounds_updated";
+            case PerfCounter::CullingTested: return "culling_tested";
+            case PerfCounter::CullingVisible: return "culling_visible";
+            case PerfCounter::LoadedVertices: return "loaded_vertices";
+            case PerfCounter::Count: break;
+        }
+        return "unknown";
+    }
+
+    void PerfCounters::endFrame() {
+        Values totals{};
+        {
+            auto &instance = registry();
+            std::lock_guard<std::mutex> lock(instance.mutex);
+            for (const auto &counters: instance.counters) {
+                for (uint32_t i = 0; i < CounterCount; ++i) {
+                    totals[i] += counters->totals[i].load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        History &state = history();
+        Values &frame = state.frames[state.next];
+        for (uint32_t i = 0; i < CounterCount; ++i) frame[i] = totals[i] - state.totals[i];
+        state.totals = totals;
+        state.next = (state.next + 1) % HistoryFrames;
+        if (state.size < HistoryFrames) ++state.size;
+    }
+
+    uint64_t PerfCounters::getLast(PerfCounter counter) {
+        return getHistorySize() > 0 ? getRecent(counter, 0) : 0;
+    }
+
+    uint64_t PerfCounters::getTotal(PerfCounter counter) {
+        return history().totals[static_cast<uint32_t>(counter)];
+    }
+
+    uint64_t PerfCounters::getRecent(PerfCounter counter, size_t age) {
+        const History &state = history();
+        return state.frames[(state.next + HistoryFrames - 1 - age) % HistoryFrames][static_cast<uint32_t>(counter)];
+    }
+
+    size_t PerfCounters::getHistorySize() {
+        return history().size;
+    }
+
+    PerfCounters::ThreadCounters &PerfCounters::threadCounters() {
+        if (!t_counters) {
+            auto &instance = registry();
+            std::lock_guard<std::mutex> lock(instance.mutex);
+            t_counters = instance.counters.emplace_back(std::make_unique<ThreadCounters>()).get();
+        }
+        return *t_counters;
+    }
+}
@@ -0,0 +1,87 @@
+//
+// Created by alex on 5/5/25.
+//
+
+#ifndef PERFCOUNTERS_H
+#define PERFCOUNTERS_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Work counters, e.g. draw calls or uploaded bytes, summed over all threads once per frame. Compiled out together
+// with the profiler scopes (BCG_PROFILER_DISABLED).
+//   BCG_COUNT(DrawCalls, 1);
+//   BCG_COUNT(UploadBytes, size);
+#ifndef BCG_PROFILER_DISABLED
+#define BCG_COUNT(counter, value) ::Bcg::PerfCounters::add(::Bcg::PerfCounter::counter, value)
+#else
+#define BCG_COUNT(counter, value) ((void) sizeof(value))
+#endif
+
+namespace Bcg {
+    enum class PerfCounter : uint32_t {
+        DrawCalls, // vkCmdDraw* calls of the scene
+        Triangles, // Submitted by the scene draws, before GPU culling
+        PipelineBinds,
+        BufferBinds, // Vertex and index buffers
+        DescriptorBinds, // Descriptor set binds
+        UploadBytes, // Copied through the staging uploader
+        Allocations, // Sub-allocations of the GPU memory allocator
+        TransformsUpdated,
+        BoundsUpdated,
+        CullingTested, // Objects tested by the CPU view culling or, frames late, the GPU culling
+        CullingVisible, // Of these, the ones that passed
+        LoadedVertices, // Parsed by the model loader
+        Count
+    };
+
+    // Snake case name, as in the benchmark JSON
+    const char *toString(PerfCounter counter);
+
+    // Per-thread counters with a per-frame history. add() is lock-free: each thread increments its own block of
+    // monotonic totals, which only it writes, endFrame() sums the blocks of all threads and stores the difference
+    // to the previous sum as the frame's values. endFrame() and the readers must not run concurrently (main or
+    // render thread, under the renderer mutex in the threaded loop).
+    class PerfCounters {
+    public:
+        static constexpr uint32_t CounterCount = static_cast<uint32_t>(PerfCounter::Count);
+        static constexpr size_t HistoryFrames = 240;
+
+        using Values = std::array<uint64_t, CounterCount>;
+
+        static void add(PerfCounter counter, uint64_t value) {
+            ThreadCounters &counters = t_counters ? *t_counters : threadCounters();
+            std::atomic<uint64_t> &total = counters.totals[static_cast<uint32_t>(counter)];
+            // Single writer, a relaxed load and store instead of a locked read-modify-write
+            total.store(total.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+        }
+
+        // Closes the frame: counts added since the previous call become its values
+        static void endFrame();
+
+        // Of the last frame closed by endFrame()
+        static uint64_t getLast(PerfCounter counter);
+
+        // Since the start, up to the last endFrame()
+        static uint64_t getTotal(PerfCounter counter);
+
+        // Value of the frame age frames before the last one, age < getHistorySize()
+        static uint64_t getRecent(PerfCounter counter, size_t age);
+
+        static size_t getHistorySize();
+
+        // Own cache lines, threads do not share them with each other's counters
+        struct alignas(64) ThreadCounters {
+            std::array<std::atomic<uint64_t>, CounterCount> totals{};
+        };
+
+    private:
+        static ThreadCounters &threadCounters();
+
+        static inline thread_local ThreadCounters *t_counters = nullptr;
+    };
+}
+
+#endif //PERFCOUNTERS_H
@@ -0,0 +1,219 @@
+//
+// Created by alex on 5/4/25.
+//
+
+#include "Profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+
+#include "JsonWriter.h"
+
+namespace Bcg {
+    // Fields are relaxed atomics so that readers may race with the writer without undefined behavior, on x86-64
+    // these are plain moves.
+    struct Profiler::ThreadBuffer {
+        struct Slot {
+            std::atomic<const char *> name{nullptr};
+            std::atomic<uint64_t> start{0};
+            std::atomic<uint64_t> end{0};
+            std::atomic<uint32_t> depth{0};
+        };
+
+        std::unique_ptr<Slot[]> slots{new Slot[EventsPerThread]};
+        std::atomic<uint64_t> started{0}; // Slots the writer began, may overwrite index started - EventsPerThread
+        std::atomic<uint64_t> written{0}; // Slots that are complete
+        uint32_t index = 0;
+        std::string name; // Guarded by the registry mutex
+    };
+
+    namespace {
+        struct Registry {
+            std::mutex mutex;
+            std::vector<std::unique_ptr<Profiler::ThreadBuffer> > buffers; // Never freed, threads may exit
+        };
+
+        Registry &registry() {
+            static Registry instance;
+            return instance;
+        }
+
+        // Reference points to convert ticks, taken when the profiler is first used
+        struct Calibration {
+            uint64_t ticks = Profiler::now();
+            std::chrono::steady_clock::time_point time = std::chrono::steady_clock::now();
+        };
+
+        const Calibration &calibration() {
+            static Calibration instance;
+            return instance;
+        }
+
+        std::atomic<uint32_t> s_frameThread{~0u};
+        std::atomic<uint64_t> s_frameStart{0}; // Of the current iteration
+        std::atomic<uint64_t> s_lastFrameStart{0}; // Of the previous one
+    }
+
+    void Profiler::record(const char *name, uint64_t start, uint64_t end, uint32_t depth) {
+        ThreadBuffer &buffer = t_buffer ? *t_buffer : threadBuffer();
+        uint64_t index = buffer.written.load(std::memory_order_relaxed);
+        // Seqlock style: announce the slot before overwriting it, readers check this after copying
+        buffer.started.store(index + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        ThreadBuffer::Slot &slot = buffer.slots[index & (EventsPerThread - 1)];
+        slot.name.store(name, std::memory_order_relaxed);
+        slot.start.store(start, std::memory_order_relaxed);
+        slot.end.store(end, std::memory_order_relaxed);
+        slot.depth.store(depth, std::memory_order_relaxed);
+        buffer.written.store(index + 1, std::memory_order_release);
+    }
+
+    void Profiler::setThreadName(const std::string &name) {
+        ThreadBuffer &buffer = threadBuffer();
+        std::lock_guard<std::mutex> lock(registry().mutex);
+        buffer.name = name;
+    }
+
+    void Profiler::markFrame() {
+        s_frameThread.store(threadBuffer().index, std::memory_order_relaxed);
+        s_lastFrameStart.store(s_frameStart.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        s_frameStart.store(now(), std::memory_order_relaxed);
+    }
+
+    void Profiler::getLastFrame(std::vector<ProfileEvent> &events, uint64_t &frameStart, uint64_t &frameEnd) {
+        events.clear();
+        frameStart = s_lastFrameStart.load(std::memory_order_relaxed);
+        frameEnd = s_frameStart.load(std::memory_order_relaxed);
+        uint32_t thread = s_frameThread.load(std::memory_order_relaxed);
+        if (frameStart == 0 || thread == ~0u) return;
+
+        const ThreadBuffer *buffer = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(registry().mutex);
+            buffer = registry().buffers[thread].get();
+        }
+        copyEvents(*buffer, events);
+        events.erase(std::remove_if(events.begin(), events.end(), [&](const ProfileEvent &event) {
+            return event.start < frameStart || event.start >= frameEnd;
+        }), events.end());
+        std::sort(events.begin(), events.end(), [](const ProfileEvent &a, const ProfileEvent &b) {
+            return a.start < b.start || (a.start == b.start && a.depth < b.depth);
+        });
+    }
+
+    double Profiler::ticksToMilliseconds(uint64_t ticks) {
+        return static_cast<double>(ticks) / ticksPerMillisecond();
+    }
+
+    bool Profiler::writeChromeTrace(const std::string &path) {
+        std::ofstream file(path, std::ios::trunc);
+        if (!file.is_open()) return false;
+
+        std::vector<std::pair<const ThreadBuffer *, std::string> > buffers;
+        {
+            std::lock_guard<std::mutex> lock(registry().mutex);
+            for (const auto &buffer: registry().buffers) buffers.emplace_back(buffer.get(), buffer->name);
+        }
+
+        const double ticksPerMicrosecond = ticksPerMillisecond() * 1e-3;
+        const uint64_t origin = calibration().ticks;
+        std::vector<ProfileEvent> events;
+
+        JsonWriter json(file, false);
+        json.setPrecision(15); // Microseconds since the start, a 6 digit default would lose everything below 1 s
+        json.beginObject();
+        json.field("displayTimeUnit", "ms");
+        json.key("traceEvents").beginArray();
+        for (const auto &[buffer, name]: buffers) {
+            json.beginObject();
+            json.field("name", "thread_name").field("ph", "M").field("pid", 1).field("tid", buffer->index);
+            json.key("args").beginObject();
+            json.field("name", name.empty() ? "Thread " + std::to_string(buffer->index) : name);
+            json.endObject();
+            json.endObject();
+
+            copyEvents(*buffer, events);
+            for (const auto &event: events) {
+                json.beginObject();
+                json.field("name", event.name).field("cat", "cpu").field("ph", "X");
+                // Scopes that were open when the first thread registered start before the origin
+                auto start = static_cast<int64_t>(event.start - origin);
+                json.field("ts", static_cast<double>(start) / ticksPerMicrosecond);
+                json.field("dur", static_cast<double>(event.end - event.start) / ticksPerMicrosecond);
+                json.field("pid", 1).field("tid", event.thread);
+                json.endObject();
+            }
+        }
+        json.endArray();
+        json.endObject();
+        file << '\n';
+        return static_cast<bool>(file);
+    }
+
+    uint64_t Profiler::nowSteady() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    Profiler::ThreadBuffer &Profiler::threadBuffer() {
+        if (!t_buffer) {
+            calibration();
+            auto &instance = registry();
+            std::lock_guard<std::mutex> lock(instance.mutex);
+            auto buffer = std::make_unique<ThreadBuffer>();
+            buffer->index = static_cast<uint32_t>(instance.buffers.size());
+            t_buffer = buffer.get();
+            instance.buffers.push_back(std::move(buffer));
+        }
+        return *t_buffer;
+    }
+
+    void Profiler::copyEvents(const ThreadBuffer &buffer, std::vector<ProfileEvent> &events) {
+        events.clear();
+        uint64_t written = buffer.written.load(std::memory_order_acquire);
+        uint64_t first = written > EventsPerThread ? written - EventsPerThread : 0;
+        events.reserve(written - first);
+        for (uint64_t i = first; i < written; ++i) {
+            const ThreadBuffer::Slot &slot = buffer.slots[i & (EventsPerThread - 1)];
+            ProfileEvent event;
+            event.name = slot.name.load(std::memory_order_relaxed);
+            event.start = slot.start.load(std::memory_order_relaxed);
+            event.end = slot.end.load(std::memory_order_relaxed);
+            event.depth = slot.depth.load(std::memory_order_relaxed);
+            event.thread = buffer.index;
+            events.push_back(event);
+        }
+
+        // Slots below started - EventsPerThread may have been overwritten while they were copied
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t started = buffer.started.load(std::memory_order_relaxed);
+        if (started > EventsPerThread && started - EventsPerThread > first) {
+            uint64_t stale = std::min(started - EventsPerThread, written) - first;
+            events.erase(events.begin(), events.begin() + static_cast<std::ptrdiff_t>(stale));
+        }
+    }
+
+    double Profiler::ticksPerMillisecond() {
+#ifdef BCG_PROFILER_RDTSC
+        // The TSC is invariant on every x86-64 CPU we run on, its rate follows from the time since calibration
+        // and is fixed once a second has passed.
+        static std::atomic<double> fixedRate{0.0};
+        double rate = fixedRate.load(std::memory_order_relaxed);
+        if (rate > 0.0) return rate;
+
+        const Calibration &reference = calibration();
+        double milliseconds = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - reference.time).count();
+        if (milliseconds < 1.0) return 1e6; // Too early to tell, assume 1 GHz
+        rate = static_cast<double>(now() - reference.ticks) / milliseconds;
+        if (milliseconds > 1000.0) fixedRate.store(rate, std::memory_order_relaxed);
+        return rate;
+#else
+        return 1e6; // Nanoseconds
+#endif
+    }
+}
@@ -0,0 +1,131 @@
+//
+// Created by alex on 5/4/25.
+//
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#define BCG_PROFILER_RDTSC 1
+#endif
+
+// Scoped CPU timers. Defining BCG_PROFILER_DISABLED (CMake option BCG_PROFILER=OFF) compiles them out.
+//   void update() { BCG_PROFILE_FUNCTION(); ... { BCG_PROFILE_SCOPE("Collide"); ... } }
+// Names must be string literals (or otherwise outlive the profiler), only the pointer is recorded.
+#ifndef BCG_PROFILER_DISABLED
+#define BCG_PROFILE_CONCAT_INNER(a, b) a##b
+#define BCG_PROFILE_CONCAT(a, b) BCG_PROFILE_CONCAT_INNER(a, b)
+#define BCG_PROFILE_SCOPE(name) ::Bcg::ProfileScope BCG_PROFILE_CONCAT(bcgProfileScope, __LINE__)(name)
+#define BCG_PROFILE_FUNCTION() BCG_PROFILE_SCOPE(__func__)
+#define BCG_PROFILE_FRAME() ::Bcg::Profiler::markFrame()
+#define BCG_PROFILE_THREAD(name) ::Bcg::Profiler::setThreadName(name)
+#else
+#define BCG_PROFILE_SCOPE(name) ((void) 0)
+#define BCG_PROFILE_FUNCTION() ((void) 0)
+#define BCG_PROFILE_FRAME() ((void) 0)
+#define BCG_PROFILE_THREAD(name) ((void) sizeof(name))
+#endif
+
+namespace Bcg {
+    struct ProfileEvent {
+        const char *name = nullptr;
+        uint64_t start = 0; // Profiler::now() ticks
+        uint64_t end = 0;
+        uint32_t depth = 0; // Nesting level on its thread, 0 = outermost
+        uint32_t thread = 0; // Index in registration order, the main thread is usually 0
+    };
+
+    // Hierarchical CPU profiler. Every thread records into its own fixed ring buffer of completed scopes; the
+    // owning thread is the only writer and publishes with a release store, readers (trace dump, UI) copy the
+    // ring and drop entries that were overwritten while copying. Recording takes no lock and never allocates.
+    class Profiler {
+    public:
+        static constexpr uint32_t EventsPerThread = 1u << 15; // Power of two, the oldest events are overwritten
+
+        // Ticks of the TSC on x86-64, of steady_clock otherwise
+        static uint64_t now() {
+#ifdef BCG_PROFILER_RDTSC
+            return __rdtsc();
+#else
+            return nowSteady();
+#endif
+        }
+
+        static void record(const char *name, uint64_t start, uint64_t end, uint32_t depth);
+
+        static void setEnabled(bool enabled) { s_enabled.store(enabled, std::memory_order_relaxed); }
+
+        static bool isEnabled() { return s_enabled.load(std::memory_order_relaxed); }
+
+        // Names the calling thread in traces
+        static void setThreadName(const std::string &name);
+
+        // Marks the start of a main loop iteration, call on the main thread
+        static void markFrame();
+
+        // Events of the main thread between the last two markFrame() calls, ordered by start time
+        static void getLastFrame(std::vector<ProfileEvent> &events, uint64_t &frameStart, uint64_t &frameEnd);
+
+        static double ticksToMilliseconds(uint64_t ticks);
+
+        // Chrome trace-event JSON (chrome://tracing, ui.perfetto.dev) of everything still in the buffers
+        static bool writeChromeTrace(const std::string &path);
+
+        struct ThreadBuffer; // Per-thread ring, defined in Profiler.cpp
+
+    private:
+        friend class ProfileScope;
+
+        static uint64_t nowSteady();
+
+        static ThreadBuffer &threadBuffer();
+
+        static void copyEvents(const ThreadBuffer &buffer, std::vector<ProfileEvent> &events);
+
+        static double ticksPerMillisecond();
+
+        // Constant initialized inline, so that accesses need no TLS wrapper call
+        static inline std::atomic<bool> s_enabled{true};
+        static inline thread_local ThreadBuffer *t_buffer = nullptr;
+        static inline thread_local uint32_t t_depth = 0;
+    };
+
+    class ProfileScope {
+    public:
+        explicit ProfileScope(const char *name) : m_name(Profiler::isEnabled() ? name : nullptr) {
+            if (m_name) {
+                m_depth = Profiler::t_depth++;
+                m_start = Profiler::now();
+            }
+        }
+
+        ~ProfileScope() {
+            if (m_name) {
+                uint64_t end = Profiler::now();
+                --Profiler::t_depth;
+                Profiler::record(m_name, m_start, end, m_depth);
+            }
+        }
+
+        ProfileScope(const ProfileScope &) = delete;
+
+        ProfileScope &operator=(const ProfileScope &) = delete;
+
+    private:
+        const char *m_name;
+        uint64_t m_start = 0;
+        uint32_t m_depth = 0;
+    };
+}
+
+#endif //PROFILER_H
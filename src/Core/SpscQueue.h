@@ -0,0 +1,64 @@
+//
+// Created by alex on 5/5/25.
+//
+
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+namespace Bcg {
+    // Bounded single-producer / single-consumer ring buffer. Each side owns one index and keeps a cached copy of the
+    // other, so pushing and popping touch the shared cache lines only when the cached copy says full or empty.
+    // Neither side locks or allocates; T is copied in and out.
+    template<typename T>
+    class SpscQueue {
+    public:
+        // capacity is rounded up to a power of two
+        explicit SpscQueue(size_t capacity) {
+            size_t size = 1;
+            while (size < capacity) size <<= 1;
+            m_mask = size - 1;
+            m_slots.reset(new T[size]);
+        }
+
+        // Producer only, false if full
+        bool tryPush(const T &value) {
+            const size_t tail = m_tail.load(std::memory_order_relaxed);
+            if (tail - m_cachedHead > m_mask) {
+                m_cachedHead = m_head.load(std::memory_order_acquire);
+                if (tail - m_cachedHead > m_mask) return false;
+            }
+            m_slots[tail & m_mask] = value;
+            m_tail.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Consumer only, false if empty
+        bool tryPop(T &value) {
+            const size_t head = m_head.load(std::memory_order_relaxed);
+            if (head == m_cachedTail) {
+                m_cachedTail = m_tail.load(std::memory_order_acquire);
+                if (head == m_cachedTail) return false;
+            }
+            value = m_slots[head & m_mask];
+            m_head.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        size_t capacity() const { return m_mask + 1; }
+
+    private:
+        std::unique_ptr<T[]> m_slots;
+        size_t m_mask = 0;
+
+        alignas(64) std::atomic<size_t> m_head{0}; // Next slot to pop, written by the consumer
+        size_t m_cachedTail = 0; // Consumer's copy of m_tail
+        alignas(64) std::atomic<size_t> m_tail{0}; // Next slot to push, written by the producer
+        size_t m_cachedHead = 0; // Producer's copy of m_head
+    };
+}
+
+#endif //SPSCQUEUE_H
@@ -0,0 +1,127 @@
+//
+// Created by alex on 5/5/25.
+//
+
+#include "TaskGraph.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "Profiler.h"
+
+namespace Bcg {
+    TaskGraph::TaskId TaskGraph::add(const char *name, std::function<void()> work,
+                                     const std::vector<TaskId> &dependencies, TaskThread thread) {
+        auto id = static_cast<TaskId>(m_tasks.size());
+        for (TaskId dependency: dependencies) {
+            if (dependency >= id) {
+                throw std::invalid_argument(std::string("Task '") + name + "' depends on a task added after it");
+            }
+            m_tasks[dependency].dependents.push_back(id);
+        }
+        m_tasks.push_back({name, std::move(work), dependencies, {}, thread});
+        return id;
+    }
+
+    void TaskGraph::run(uint32_t workerCount) {
+        const auto start = std::chrono::steady_clock::now();
+        auto milliseconds = [start]() {
+            return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        };
+
+        const size_t taskCount = m_tasks.size();
+        m_timings.assign(taskCount, {});
+        std::vector<size_t> waitingFor(taskCount);
+        std::deque<TaskId> readyWorker, readyMain;
+        size_t workerTasks = 0;
+        for (TaskId id = 0; id < taskCount; ++id) {
+            const Task &task = m_tasks[id];
+            m_timings[id].name = task.name;
+            m_timings[id].thread = task.thread;
+            waitingFor[id] = task.dependencies.size();
+            if (task.thread == TaskThread::Worker) ++workerTasks;
+            if (waitingFor[id] == 0) (task.thread == TaskThread::Main ? readyMain : readyWorker).push_back(id);
+        }
+
+        std::mutex mutex;
+        std::condition_variable changed;
+        size_t finished = 0;
+        bool failed = false;
+        std::exception_ptr firstError;
+
+        // Takes a ready task of the calling thread's kind and runs it, false once nothing is left for it
+        auto runNext = [&](std::deque<TaskId> &ready) {
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait(lock, [&] { return !ready.empty() || finished == taskCount || failed; });
+            if (ready.empty() || failed) return false;
+            TaskId id = ready.front();
+            ready.pop_front();
+            lock.unlock();
+
+            m_timings[id].start = milliseconds();
+            std::exception_ptr error;
+            try {
+                BCG_PROFILE_SCOPE(m_tasks[id].name);
+                m_tasks[id].work();
+            } catch (...) {
+                error = std::current_exception();
+            }
+            m_timings[id].end = milliseconds();
+
+            lock.lock();
+            ++finished;
+            if (error) {
+                failed = true;
+                if (!firstError) firstError = error;
+            }
+            for (TaskId dependent: m_tasks[id].dependents) {
+                if (--waitingFor[dependent] > 0) continue;
+                (m_tasks[dependent].thread == TaskThread::Main ? readyMain : readyWorker).push_back(dependent);
+            }
+            lock.unlock();
+            changed.notify_all();
+            return true;
+        };
+
+        if (workerCount == 0) workerCount = std::max(1u, std::thread::hardware_concurrency()) - 1;
+        workerCount = static_cast<uint32_t>(std::min<size_t>(std::max(workerCount, 1u), workerTasks));
+        std::vector<std::thread> workers;
+        for (uint32_t i = 0; i < workerCount; ++i) {
+            workers.emplace_back([&, i]() {
+                BCG_PROFILE_THREAD("Startup worker " + std::to_string(i));
+                while (runNext(readyWorker)) {
+                }
+            });
+        }
+        while (runNext(readyMain)) {
+        }
+        // Nothing more runs on the main thread, the workers finish the rest
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait(lock, [&] { return finished == taskCount || failed; });
+        }
+        changed.notify_all();
+        for (auto &worker: workers) worker.join();
+        if (firstError) std::rethrow_exception(firstError);
+    }
+
+    double TaskGraph::getCriticalPathMilliseconds() const {
+        // Dependencies come first, one pass in insertion order is enough
+        std::vector<double> longest(m_timings.size(), 0.0);
+        double result = 0.0;
+        for (size_t id = 0; id < m_timings.size(); ++id) {
+            double before = 0.0;
+            for (TaskId dependency: m_tasks[id].dependencies) before = std::max(before, longest[dependency]);
+            longest[id] = before + (m_timings[id].end - m_timings[id].start);
+            result = std::max(result, longest[id]);
+        }
+        return result;
+    }
+}
@@ -0,0 +1,61 @@
+//
+// Created by alex on 5/5/25.
+//
+
+#ifndef TASKGRAPH_H
+#define TASKGRAPH_H
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace Bcg {
+    enum class TaskThread : uint8_t {
+        Worker, // Any of the graph's worker threads
+        Main // The thread calling run(), for GLFW and other thread-affine APIs
+    };
+
+    // Start and end of a task relative to the start of run(), in milliseconds
+    struct TaskTiming {
+        const char *name = nullptr;
+        double start = 0.0;
+        double end = 0.0;
+        TaskThread thread = TaskThread::Worker;
+    };
+
+    // One-shot dependency graph of startup work. Every task runs once all of its dependencies finished; independent
+    // worker tasks run concurrently while run() executes the main thread tasks. Dependencies must have been added
+    // before the task, so the graph is acyclic by construction.
+    class TaskGraph {
+    public:
+        using TaskId = uint32_t;
+
+        // name must be a string literal, it is recorded by the profiler
+        TaskId add(const char *name, std::function<void()> work, const std::vector<TaskId> &dependencies = {},
+                   TaskThread thread = TaskThread::Worker);
+
+        // Runs all tasks on up to workerCount threads (0 for one less than the hardware threads). After a task
+        // throws no further task starts; the first exception is rethrown once the running ones finished.
+        void run(uint32_t workerCount = 0);
+
+        // In the order the tasks were added, valid after run()
+        const std::vector<TaskTiming> &getTimings() const { return m_timings; }
+
+        // Longest chain of dependent tasks by their measured durations, valid after run()
+        double getCriticalPathMilliseconds() const;
+
+    private:
+        struct Task {
+            const char *name;
+            std::function<void()> work;
+            std::vector<TaskId> dependencies;
+            std::vector<TaskId> dependents;
+            TaskThread thread;
+        };
+
+        std::vector<Task> m_tasks;
+        std::vector<TaskTiming> m_timings;
+    };
+}
+
+#endif //TASKGRAPH_H
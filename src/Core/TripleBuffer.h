@@ -0,0 +1,54 @@
+//
+// Created by alex on 5/5/25.
+//
+
+#ifndef TRIPLEBUFFER_H
+#define TRIPLEBUFFER_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace Bcg {
+    // Lock-free handoff of the newest value from one writer to one reader. The writer fills back() and publishes it,
+    // the reader takes the newest published value with update() and reads front(). Neither side ever waits for the
+    // other: the third slot holds the last published value until one of them swaps it out. Values the reader did
+    // not take in time are overwritten, slots are reused and keep their allocations.
+    template<typename T>
+    class TripleBuffer {
+    public:
+        // Writer only
+        T &back() { return m_slots[m_back]; }
+
+        // Writer only: makes back() the newest value, back() then refers to another slot
+        void publish() {
+            uint32_t previous = m_middle.exchange(m_back | NewBit, std::memory_order_acq_rel);
+            m_back = previous & IndexMask;
+        }
+
+        // Reader only: takes the newest published value into front(), false if nothing was published since
+        bool update() {
+            if (!hasNew()) return false;
+            uint32_t previous = m_middle.exchange(m_front, std::memory_order_acq_rel);
+            m_front = previous & IndexMask;
+            return true;
+        }
+
+        // Reader only, the slot is the reader's until the next update()
+        T &front() { return m_slots[m_front]; }
+
+        // Either side
+        bool hasNew() const { return (m_middle.load(std::memory_order_acquire) & NewBit) != 0; }
+
+    private:
+        static constexpr uint32_t NewBit = 4;
+        static constexpr uint32_t IndexMask = 3;
+
+        std::array<T, 3> m_slots{};
+        uint32_t m_back = 0; // Writer's slot
+        alignas(64) std::atomic<uint32_t> m_middle{1}; // Slot index, NewBit if published and not yet taken
+        alignas(64) uint32_t m_front = 2; // Reader's slot
+    };
+}
+
+#endif //TRIPLEBUFFER_H
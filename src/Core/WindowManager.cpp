@@ -57,6 +57,16 @@ namespace Bcg {
         glfwPollEvents();
     }
 
+    void WindowManager::waitEvents(double timeoutSeconds) {
+        glfwWaitEventsTimeout(timeoutSeconds);
+    }
+
+    bool WindowManager::isMinimized() const {
+        int width = 0, height = 0;
+        glfwGetFramebufferSize(m_window, &width, &height);
+        return width == 0 || height == 0 || glfwGetWindowAttrib(m_window, GLFW_ICONIFIED);
+    }
+
     // --- Private Methods ---
 
     void WindowManager::initWindow() {
@@ -84,6 +94,7 @@ namespace Bcg {
         glfwSetCursorPosCallback(m_window, cursorPosCallback);
         glfwSetScrollCallback(m_window, scrollCallback);
         glfwSetCharCallback(m_window, charCallback); // Needed for ImGui text
+        glfwSetWindowRefreshCallback(m_window, windowRefreshCallback);
     }
 
     void WindowManager::setWindowSize(int width, int height) {
@@ -97,19 +108,21 @@ namespace Bcg {
     // These functions retrieve the Application pointer and forward the event
 
     void WindowManager::framebufferResizeCallback(GLFWwindow *window, int width, int height) {
-        Log::Trace("[WindowManager::framebufferResizeCallback] {}x{}", width, height);
+        BCG_LOG_TRACE("[WindowManager::framebufferResizeCallback] {}x{}", width, height);
+        countEvent(window);
         auto context = reinterpret_cast<ApplicationContext *>(glfwGetWindowUserPointer(window));
         if (context) {
             // Option 1: Call a specific context method in Application
             // context->handleFramebufferResize(width, height);
 
-            // Option 2: Use the existing event dispatcher (more flexible)
-            context->dispatcher->trigger(WindowResizeEvent{width, height});
+            // Option 2: Use the event bus (more flexible)
+            context->eventBus->publish(WindowResizeEvent{width, height}, EventPriority::High);
         }
     }
 
     void WindowManager::keyCallback(GLFWwindow *window, int key, int scancode, int action, int mods) {
-        Log::Trace("[WindowManager::keyCallback] Key: {}", key);
+        BCG_LOG_TRACE("[WindowManager::keyCallback] Key: {}", key);
+        countEvent(window);
         // Always forward to ImGui first if it's initialized
         if (ImGui::GetCurrentContext() != nullptr) {
             // Ensure ImGui is setup
@@ -122,13 +135,14 @@ namespace Bcg {
 
         // Forward to application if ImGui didn't handle it
         auto context = reinterpret_cast<ApplicationContext *>(glfwGetWindowUserPointer(window));
-        if (context) {
-            context->inputManager->handleKey(key, scancode, action, mods); // Call a new context method in Application
+        if (context && !context->inputManager->isReplaying()) {
+            context->inputManager->queueEvent({InputEventType::Key, 0.0, {key, scancode, action, mods}});
         }
     }
 
     void WindowManager::mouseButtonCallback(GLFWwindow *window, int button, int action, int mods) {
-        Log::Trace("[WindowManager::mouseButtonCallback] Button: {}, Action: {}, Mods: {}", button, action, mods);
+        BCG_LOG_TRACE("[WindowManager::mouseButtonCallback] Button: {}, Action: {}, Mods: {}", button, action, mods);
+        countEvent(window);
         if (ImGui::GetCurrentContext() != nullptr) {
             //ImGui_ImplGlfw_MouseButtonCallback(window, button, action, mods);
             ImGuiIO &io = ImGui::GetIO();
@@ -138,13 +152,14 @@ namespace Bcg {
         }
 
         auto context = reinterpret_cast<ApplicationContext *>(glfwGetWindowUserPointer(window));
-        if (context) {
-            context->inputManager->handleMouseButton(button, action, mods);
+        if (context && !context->inputManager->isReplaying()) {
+            context->inputManager->queueEvent({InputEventType::MouseButton, 0.0, {button, action, mods}});
         }
     }
 
     void WindowManager::cursorPosCallback(GLFWwindow *window, double xpos, double ypos) {
-        Log::Trace("[WindowManager::cursorPosCallback] ({}, {})", xpos, ypos);
+        BCG_LOG_TRACE("[WindowManager::cursorPosCallback] ({}, {})", xpos, ypos);
+        countEvent(window);
         // ImGui captures this implicitly via NewFrame reading mouse state
         if (ImGui::GetCurrentContext() != nullptr) {
             ImGuiIO &io = ImGui::GetIO();
@@ -154,13 +169,14 @@ namespace Bcg {
         }
 
         auto context = reinterpret_cast<ApplicationContext *>(glfwGetWindowUserPointer(window));
-        if (context) {
-            context->inputManager->handleCursorPos(xpos, ypos);
+        if (context && !context->inputManager->isReplaying()) {
+            context->inputManager->queueEvent({InputEventType::CursorPos, 0.0, {}, {xpos, ypos}});
         }
     }
 
     void WindowManager::scrollCallback(GLFWwindow *window, double xoffset, double yoffset) {
-        Log::Trace("[WindowManager::scrollCallback] ({}, {})", xoffset, yoffset);
+        BCG_LOG_TRACE("[WindowManager::scrollCallback] ({}, {})", xoffset, yoffset);
+        countEvent(window);
         if (ImGui::GetCurrentContext() != nullptr) {
             //ImGui_ImplGlfw_ScrollCallback(window, xoffset, yoffset);
             ImGuiIO &io = ImGui::GetIO();
@@ -170,13 +186,14 @@ namespace Bcg {
         }
 
         auto context = reinterpret_cast<ApplicationContext *>(glfwGetWindowUserPointer(window));
-        if (context) {
-            context->inputManager->handleScroll(xoffset, yoffset);
+        if (context && !context->inputManager->isReplaying()) {
+            context->inputManager->queueEvent({InputEventType::Scroll, 0.0, {}, {xoffset, yoffset}});
         }
     }
 
     void WindowManager::charCallback(GLFWwindow *window, unsigned int c) {
-        Log::Trace("[WindowManager::charCallback] {}", c);
+        BCG_LOG_TRACE("[WindowManager::charCallback] {}", c);
+        countEvent(window);
         if (ImGui::GetCurrentContext() != nullptr) {
             //ImGui_ImplGlfw_CharCallback(window, c);
             ImGuiIO &io = ImGui::GetIO();
@@ -186,8 +203,18 @@ namespace Bcg {
         }
 
         auto context = reinterpret_cast<ApplicationContext *>(glfwGetWindowUserPointer(window));
-        if (context) {
-            context->inputManager->handleChar(c);
+        if (context && !context->inputManager->isReplaying()) {
+            context->inputManager->queueEvent({InputEventType::Char, 0.0, {static_cast<int32_t>(c)}});
         }
     }
+
+    void WindowManager::windowRefreshCallback(GLFWwindow *window) {
+        BCG_LOG_TRACE("[WindowManager::windowRefreshCallback]");
+        countEvent(window);
+    }
+
+    void WindowManager::countEvent(GLFWwindow *window) {
+        auto context = reinterpret_cast<ApplicationContext *>(glfwGetWindowUserPointer(window));
+        if (context && context->windowManager) ++context->windowManager->m_eventCount;
+    }
 }
@@ -5,6 +5,7 @@
 #ifndef WINDOWMANAGER_H
 #define WINDOWMANAGER_H
 
+#include <cstdint>
 #include <string>
 
 #include "Manager.h"
@@ -34,6 +35,15 @@ namespace Bcg {
 
         static void pollEvents();
 
+        // Sleeps until an event arrives or timeoutSeconds passed, then processes the events like pollEvents
+        static void waitEvents(double timeoutSeconds);
+
+        // Iconified or a 0x0 framebuffer, nothing can be presented
+        bool isMinimized() const;
+
+        // Callbacks received so far, including input ImGui captured. A change means the window needs a redraw.
+        uint64_t getEventCount() const { return m_eventCount; }
+
         // Accessors
         GLFWwindow *getGLFWHandle() const { return m_window; }
 
@@ -56,14 +66,18 @@ namespace Bcg {
 
         static void charCallback(GLFWwindow *window, unsigned int c); // Optional but needed for ImGui text input
 
-        bool m_framebufferResized = false;
+        static void windowRefreshCallback(GLFWwindow *window); // The contents were damaged, e.g. uncovered
+
     private:
         void initWindow(); // Private helper for constructor
 
+        static void countEvent(GLFWwindow *window);
+
         GLFWwindow *m_window = nullptr;
         int m_width;
         int m_height;
         std::string m_title;
+        uint64_t m_eventCount = 0;
     };
 }
 
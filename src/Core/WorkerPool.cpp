@@ -0,0 +1,87 @@
+//
+// Created by alex on 5/5/25.
+//
+
+#include "WorkerPool.h"
+
+#include <utility>
+
+#include "Profiler.h"
+
+namespace Bcg {
+    WorkerPool::WorkerPool(uint32_t threadCount, std::string name) : m_name(std::move(name)) {
+        m_threads.reserve(threadCount);
+        for (uint32_t i = 0; i < threadCount; ++i) {
+            m_threads.emplace_back(&WorkerPool::workerMain, this, i);
+        }
+    }
+
+    WorkerPool::~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_started.notify_all();
+        for (auto &thread: m_threads) thread.join();
+    }
+
+    void WorkerPool::parallelFor(uint32_t count, const std::function<void(uint32_t)> &function) {
+        if (count == 0) return;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_function = &function;
+            m_count = count;
+            m_next = 0;
+            m_done = 0;
+            m_error = nullptr;
+            ++m_job;
+        }
+        // A single piece runs on the caller alone
+        if (count > 1) m_started.notify_all();
+        runIndices();
+
+        std::exception_ptr error;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_finished.wait(lock, [this] { return m_done == m_count; });
+            m_function = nullptr;
+            error = m_error;
+        }
+        if (error) std::rethrow_exception(error);
+    }
+
+    void WorkerPool::workerMain(uint32_t index) {
+        BCG_PROFILE_THREAD(m_name + " " + std::to_string(index));
+        uint64_t seenJob = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_started.wait(lock, [&] { return m_stop || m_job != seenJob; });
+                if (m_stop) return;
+                seenJob = m_job;
+            }
+            runIndices();
+        }
+    }
+
+    void WorkerPool::runIndices() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        // A worker may wake after the job it was notified for finished
+        while (m_function && m_next < m_count) {
+            uint32_t index = m_next++;
+            const auto &function = *m_function;
+            lock.unlock();
+
+            std::exception_ptr error;
+            try {
+                function(index);
+            } catch (...) {
+                error = std::current_exception();
+            }
+
+            lock.lock();
+            if (error && !m_error) m_error = error;
+            if (++m_done == m_count) m_finished.notify_all();
+        }
+    }
+}
@@ -0,0 +1,60 @@
+//
+// Created by alex on 5/5/25.
+//
+
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Bcg {
+    // Persistent threads for per-frame work split into a few large pieces (e.g. one per view). The calling thread
+    // takes part, a pool of n threads runs up to n + 1 pieces at once. Threads are created once: per-frame threads
+    // would cost more than the pieces and each would register a new profiler buffer.
+    class WorkerPool {
+    public:
+        // name is the prefix of the threads' names in profiler traces
+        WorkerPool(uint32_t threadCount, std::string name);
+
+        ~WorkerPool();
+
+        WorkerPool(const WorkerPool &) = delete;
+
+        WorkerPool &operator=(const WorkerPool &) = delete;
+
+        // Runs function(i) for every i in [0, count) and returns once all calls finished. The first exception of a
+        // call is rethrown, the remaining indices still run. Not reentrant, call from one thread at a time.
+        void parallelFor(uint32_t count, const std::function<void(uint32_t)> &function);
+
+        uint32_t getThreadCount() const { return static_cast<uint32_t>(m_threads.size()); }
+
+    private:
+        void workerMain(uint32_t index);
+
+        // Runs indices of the current job until none is left
+        void runIndices();
+
+        std::vector<std::thread> m_threads;
+        std::string m_name;
+
+        std::mutex m_mutex;
+        std::condition_variable m_started;
+        std::condition_variable m_finished;
+        const std::function<void(uint32_t)> *m_function = nullptr;
+        uint64_t m_job = 0; // Incremented per parallelFor()
+        uint32_t m_count = 0;
+        uint32_t m_next = 0; // Next index to run
+        uint32_t m_done = 0;
+        std::exception_ptr m_error;
+        bool m_stop = false;
+    };
+}
+
+#endif //WORKERPOOL_H
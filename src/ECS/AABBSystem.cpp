@@ -7,6 +7,7 @@
 
 #include "AABBUtils.h"
 #include "GeometryAccessComponents.h"
+#include "PerfCounters.h"
 #include "TransformComponent.h"
 
 namespace Bcg {
@@ -21,6 +22,7 @@ namespace Bcg {
         auto &registry = context->registry;
         auto view = registry->view<GeometryVertexPositionsComponent, AABBComponent, NeedsAABBUpdate, TransformComponent>();
 
+        uint64_t updated = 0;
         for (auto entity: view) {
             auto &aabb = view.get<AABBComponent>(entity);
             auto &geometry = view.get<GeometryVertexPositionsComponent>(entity);
@@ -32,7 +34,9 @@ namespace Bcg {
                 AABBUtils::clear(aabb);
             }
             registry->remove<NeedsAABBUpdate>(entity);
+            ++updated;
         }
+        BCG_COUNT(BoundsUpdated, updated);
     }
 
     void AABBSystem::update(AABBComponent &aabb) {
@@ -6,14 +6,19 @@
 #define RENDERCOMPONENTS_H
 
 #include "VulkanUtils.h"
+#include "MatVec.h"
+#include "StagingUploader.h"
+#include "GeometryPool.h"
 
 namespace Bcg{
 
     struct VulkanMeshComponent {
-        AllocatedBuffer vertexBuffer;
-        AllocatedBuffer indexBuffer;
+        GeometryHandle geometry = InvalidGeometry; // Vertex/index ranges inside VulkanContext::geometryPool
         uint32_t indexCount = 0;
         uint32_t vertexCount = 0;
+        UploadTicket uploadTicket = 0; // Buffers must not be read before this ticket is signaled
+        Vector3f localMin = Vector3f::Zero(); // Object space bounds, used for frustum culling
+        Vector3f localMax = Vector3f::Zero();
         // Material ID / reference could go here
     };
 
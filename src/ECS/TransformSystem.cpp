@@ -4,6 +4,7 @@
 
 #include "TransformSystem.h"
 #include "TransformUtils.h"
+#include "PerfCounters.h"
 
 namespace Bcg {
     void TransformSystem::initialize(ApplicationContext *context) {
@@ -16,11 +17,14 @@ namespace Bcg {
     void TransformSystem::update() {
         auto &registry = context->registry;
         auto view = registry->view<TransformComponent, TransformNeedsUpdate>();
+        uint64_t updated = 0;
         for (auto entity: view) {
             auto &transform = view.get<TransformComponent>(entity);
             TransformUtils::update(transform);
             registry->remove<TransformNeedsUpdate>(entity);
+            ++updated;
         }
+        BCG_COUNT(TransformsUpdated, updated);
     }
 
 }
@@ -0,0 +1,257 @@
+//
+// Created by alex on 4/28/25.
+//
+
+#include "GeometryPool.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "VulkanContext.h"
+#include "Logger.h"
+
+namespace Bcg {
+    void GeometryPool::init(VulkanContext *context, uint32_t vertexCapacity, uint32_t indexCapacity) {
+        m_context = context;
+        createBuffers(vertexCapacity, indexCapacity, m_vertexBuffer, m_indexBuffer);
+        m_vertexRanges.reset(vertexCapacity);
+        m_indexRanges.reset(indexCapacity);
+        Log::Info("[GeometryPool::init] {} vertices ({:.1f} MiB), {} indices ({:.1f} MiB).", vertexCapacity,
+                  vertexCapacity * sizeof(Vertex) / (1024.0 * 1024.0), indexCapacity,
+                  indexCapacity * sizeof(uint32_t) / (1024.0 * 1024.0));
+    }
+
+    void GeometryPool::cleanup() {
+        if (!m_context) return;
+        VkDevice device = m_context->device;
+        if (m_meshCount > 0) {
+            Log::Warn("[GeometryPool::cleanup] {} meshes were not freed.", m_meshCount);
+        }
+        for (auto &retired: m_retiredBuffers) {
+            retired.vertexBuffer.destroy(device);
+            retired.indexBuffer.destroy(device);
+        }
+        m_retiredBuffers.clear();
+        m_pendingFrees.clear();
+        m_slots.clear();
+        m_freeSlots.clear();
+        m_vertexBuffer.destroy(device);
+        m_indexBuffer.destroy(device);
+        m_vertexRanges.reset(0);
+        m_indexRanges.reset(0);
+        m_meshCount = 0;
+        m_newestTicket = 0;
+        m_context = nullptr;
+    }
+
+    GeometryHandle GeometryPool::allocate(const std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices,
+                                          UploadTicket &ticket) {
+        if (vertices.empty() || indices.empty()) {
+            Log::Warn("[GeometryPool::allocate] Empty mesh ({} vertices, {} indices) not added.", vertices.size(),
+                      indices.size());
+            ticket = 0;
+            return InvalidGeometry;
+        }
+        auto vertexAllocation = m_vertexRanges.allocate(vertices.size());
+        auto indexAllocation = m_indexRanges.allocate(indices.size());
+        if (!vertexAllocation.valid() || !indexAllocation.valid()) {
+            m_vertexRanges.free(vertexAllocation);
+            m_indexRanges.free(indexAllocation);
+            grow(vertices.size(), indices.size());
+            vertexAllocation = m_vertexRanges.allocate(vertices.size());
+            indexAllocation = m_indexRanges.allocate(indices.size());
+            if (!vertexAllocation.valid() || !indexAllocation.valid()) {
+                throw std::runtime_error("GeometryPool: mesh does not fit after growing the pool!");
+            }
+        }
+
+        uint32_t index;
+        if (!m_freeSlots.empty()) {
+            index = m_freeSlots.back();
+            m_freeSlots.pop_back();
+        } else {
+            index = static_cast<uint32_t>(m_slots.size());
+            m_slots.emplace_back();
+        }
+
+        Slot &slot = m_slots[index];
+        slot.live = true;
+        slot.vertexAllocation = vertexAllocation;
+        slot.indexAllocation = indexAllocation;
+        slot.range.vertexOffset = static_cast<int32_t>(vertexAllocation.offset);
+        slot.range.vertexCount = static_cast<uint32_t>(vertices.size());
+        slot.range.firstIndex = static_cast<uint32_t>(indexAllocation.offset);
+        slot.range.indexCount = static_cast<uint32_t>(indices.size());
+        ++m_meshCount;
+
+        auto &uploader = m_context->uploader;
+        uploader.uploadBuffer(m_vertexBuffer.buffer, vertexAllocation.offset * sizeof(Vertex), vertices.data(),
+                              vertices.size() * sizeof(Vertex));
+        ticket = uploader.uploadBuffer(m_indexBuffer.buffer, indexAllocation.offset * sizeof(uint32_t),
+                                       indices.data(), indices.size() * sizeof(uint32_t));
+        m_newestTicket = ticket;
+        return makeHandle(index, slot.generation);
+    }
+
+    void GeometryPool::free(GeometryHandle handle) {
+        if (!valid(handle)) return;
+        Slot &slot = m_slots[indexOf(handle)];
+        m_pendingFrees.push_back({slot.vertexAllocation, slot.indexAllocation, m_frame});
+        // Handles of the freed mesh no longer match once the slot is reused
+        const uint32_t generation = slot.generation + 1;
+        slot = Slot{};
+        slot.generation = generation;
+        m_freeSlots.push_back(indexOf(handle));
+        --m_meshCount;
+    }
+
+    bool GeometryPool::valid(GeometryHandle handle) const {
+        const uint32_t index = indexOf(handle);
+        return index < m_slots.size() && m_slots[index].live &&
+               m_slots[index].generation == static_cast<uint32_t>(handle >> 32);
+    }
+
+    void GeometryPool::beginFrame() {
+        ++m_frame;
+        // Frame F is known to be complete once the fence of its slot was waited again, MAX_FRAMES_IN_FLIGHT later.
+        const uint64_t framesInFlight = static_cast<uint64_t>(m_context->MAX_FRAMES_IN_FLIGHT);
+        auto done = [&](uint64_t frame) { return frame + framesInFlight <= m_frame; };
+
+        auto pendingEnd = std::partition(m_pendingFrees.begin(), m_pendingFrees.end(),
+                                         [&](const PendingFree &pending) { return !done(pending.frame); });
+        for (auto it = pendingEnd; it != m_pendingFrees.end(); ++it) {
+            m_vertexRanges.free(it->vertexAllocation);
+            m_indexRanges.free(it->indexAllocation);
+        }
+        m_pendingFrees.erase(pendingEnd, m_pendingFrees.end());
+
+        auto retiredEnd = std::partition(m_retiredBuffers.begin(), m_retiredBuffers.end(),
+                                         [&](const RetiredBuffers &retired) { return !done(retired.frame); });
+        for (auto it = retiredEnd; it != m_retiredBuffers.end(); ++it) {
+            it->vertexBuffer.destroy(m_context->device);
+            it->indexBuffer.destroy(m_context->device);
+        }
+        m_retiredBuffers.erase(retiredEnd, m_retiredBuffers.end());
+    }
+
+    bool GeometryPool::needsCompaction() const {
+        // Only repack once the freed ranges are back in the allocators, otherwise there is nothing to gain
+        if (!m_pendingFrees.empty()) return false;
+        auto vertexStats = m_vertexRanges.getStats();
+        auto indexStats = m_indexRanges.getStats();
+        return (vertexStats.freeRangeCount > 1 && vertexStats.fragmentation() > CompactionThreshold) ||
+               (indexStats.freeRangeCount > 1 && indexStats.fragmentation() > CompactionThreshold);
+    }
+
+    void GeometryPool::compact(VkCommandBuffer commandBuffer) {
+        auto before = getStats();
+        rebuild(commandBuffer, m_vertexRanges.getCapacity(), m_indexRanges.getCapacity());
+        ++m_compactions;
+        Log::Info("[GeometryPool::compact] Repacked {} meshes (fragmentation vertices {:.2f}, indices {:.2f}).",
+                  m_meshCount, before.vertexFragmentation, before.indexFragmentation);
+    }
+
+    GeometryPoolStats GeometryPool::getStats() const {
+        GeometryPoolStats stats;
+        auto vertexStats = m_vertexRanges.getStats();
+        auto indexStats = m_indexRanges.getStats();
+        stats.meshCount = m_meshCount;
+        stats.vertexCapacity = vertexStats.capacity;
+        stats.vertexUsed = vertexStats.usedBytes;
+        stats.indexCapacity = indexStats.capacity;
+        stats.indexUsed = indexStats.usedBytes;
+        stats.vertexFragmentation = vertexStats.fragmentation();
+        stats.indexFragmentation = indexStats.fragmentation();
+        stats.compactions = m_compactions;
+        stats.growths = m_growths;
+        return stats;
+    }
+
+    void GeometryPool::createBuffers(uint64_t vertexCapacity, uint64_t indexCapacity, AllocatedBuffer &vertexBuffer,
+                                     AllocatedBuffer &indexBuffer) {
+        // TRANSFER_SRC so that compaction can copy ranges out of the old buffers
+        m_context->createBuffer(vertexCapacity * sizeof(Vertex),
+                                VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+                                VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vertexBuffer);
+        m_context->createBuffer(indexCapacity * sizeof(uint32_t),
+                                VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+                                VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indexBuffer);
+    }
+
+    void GeometryPool::rebuild(VkCommandBuffer commandBuffer, uint64_t vertexCapacity, uint64_t indexCapacity) {
+        AllocatedBuffer vertexBuffer, indexBuffer;
+        createBuffers(vertexCapacity, indexCapacity, vertexBuffer, indexBuffer);
+
+        // Allocating in slot order from empty allocators packs all meshes back to back
+        TlsfAllocator vertexRanges(vertexCapacity);
+        TlsfAllocator indexRanges(indexCapacity);
+        std::vector<VkBufferCopy> vertexCopies, indexCopies;
+        for (auto &slot: m_slots) {
+            if (!slot.live) continue;
+            auto vertexAllocation = vertexRanges.allocate(slot.vertexAllocation.size);
+            auto indexAllocation = indexRanges.allocate(slot.indexAllocation.size);
+
+            vertexCopies.push_back({
+                slot.vertexAllocation.offset * sizeof(Vertex), vertexAllocation.offset * sizeof(Vertex),
+                slot.vertexAllocation.size * sizeof(Vertex)
+            });
+            indexCopies.push_back({
+                slot.indexAllocation.offset * sizeof(uint32_t), indexAllocation.offset * sizeof(uint32_t),
+                slot.indexAllocation.size * sizeof(uint32_t)
+            });
+
+            slot.vertexAllocation = vertexAllocation;
+            slot.indexAllocation = indexAllocation;
+            slot.range.vertexOffset = static_cast<int32_t>(vertexAllocation.offset);
+            slot.range.firstIndex = static_cast<uint32_t>(indexAllocation.offset);
+        }
+
+        if (!vertexCopies.empty()) {
+            vkCmdCopyBuffer(commandBuffer, m_vertexBuffer.buffer, vertexBuffer.buffer,
+                            static_cast<uint32_t>(vertexCopies.size()), vertexCopies.data());
+            vkCmdCopyBuffer(commandBuffer, m_indexBuffer.buffer, indexBuffer.buffer,
+                            static_cast<uint32_t>(indexCopies.size()), indexCopies.data());
+
+            VkMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                                 0, 1, &barrier, 0, nullptr, 0, nullptr);
+        }
+
+        // Frames in flight may still read the old buffers, and pending frees refer to the old allocators.
+        m_retiredBuffers.push_back({m_vertexBuffer, m_indexBuffer, m_frame});
+        m_pendingFrees.clear();
+        m_vertexBuffer = vertexBuffer;
+        m_indexBuffer = indexBuffer;
+        m_vertexRanges = std::move(vertexRanges);
+        m_indexRanges = std::move(indexRanges);
+    }
+
+    void GeometryPool::grow(uint64_t vertexCount, uint64_t indexCount) {
+        uint64_t vertexCapacity = m_vertexRanges.getCapacity();
+        uint64_t indexCapacity = m_indexRanges.getCapacity();
+        while (vertexCapacity < m_vertexRanges.getUsedBytes() + vertexCount) vertexCapacity *= 2;
+        while (indexCapacity < m_indexRanges.getUsedBytes() + indexCount) indexCapacity *= 2;
+        // Fragmentation alone can make an allocation fail, repacking into a larger pool fixes both cases
+        if (vertexCapacity == m_vertexRanges.getCapacity() && indexCapacity == m_indexRanges.getCapacity()) {
+            vertexCapacity *= 2;
+            indexCapacity *= 2;
+        }
+
+        Log::Warn("[GeometryPool::grow] Growing pool to {} vertices / {} indices, this stalls the GPU.",
+                  vertexCapacity, indexCapacity);
+
+        // Uploads that are still queued target the old buffers, they have to land before the copy
+        auto &uploader = m_context->uploader;
+        uploader.wait(uploader.flush());
+
+        VkCommandBuffer commandBuffer = m_context->beginSingleTimeCommands(m_context->commandPool);
+        rebuild(commandBuffer, vertexCapacity, indexCapacity);
+        m_context->endSingleTimeCommands(commandBuffer, m_context->graphicsQueue, m_context->commandPool);
+        ++m_growths;
+    }
+}
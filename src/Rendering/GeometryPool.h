@@ -0,0 +1,141 @@
+//
+// Created by alex on 4/28/25.
+//
+
+#ifndef GEOMETRYPOOL_H
+#define GEOMETRYPOOL_H
+
+#include <vector>
+
+#include "VulkanUtils.h"
+#include "TlsfAllocator.h"
+#include "StagingUploader.h"
+#include "ShaderData.h"
+
+namespace Bcg {
+    struct VulkanContext;
+
+    // Stable id of a mesh inside the pool, survives compaction (offsets do not). Slot index in the low 32 bits, the
+    // slot's generation in the high ones: a handle kept after free() (e.g. by a render snapshot) stays invalid
+    // when the slot is reused for another mesh.
+    using GeometryHandle = uint64_t;
+    constexpr GeometryHandle InvalidGeometry = ~0ull;
+
+    struct GeometryRange {
+        int32_t vertexOffset = 0; // First vertex inside the pool vertex buffer, added to every index
+        uint32_t vertexCount = 0;
+        uint32_t firstIndex = 0;
+        uint32_t indexCount = 0;
+    };
+
+    struct GeometryPoolStats {
+        uint32_t meshCount = 0;
+        uint64_t vertexCapacity = 0;
+        uint64_t vertexUsed = 0;
+        uint64_t indexCapacity = 0;
+        uint64_t indexUsed = 0;
+        float vertexFragmentation = 0.0f;
+        float indexFragmentation = 0.0f;
+        uint32_t compactions = 0;
+        uint32_t growths = 0;
+    };
+
+    // All mesh geometry lives in one device local vertex buffer and one index buffer. Meshes are ranges inside
+    // them (allocated with a TlsfAllocator in units of vertices/indices), so a whole scene is drawn with one
+    // buffer binding and one multi-draw-indirect call.
+    class GeometryPool {
+    public:
+        static constexpr uint32_t DefaultVertexCapacity = 1u << 20;
+        static constexpr uint32_t DefaultIndexCapacity = 1u << 22;
+        static constexpr float CompactionThreshold = 0.5f; // Fragmentation above which compact() repacks
+
+        void init(VulkanContext *context, uint32_t vertexCapacity = DefaultVertexCapacity,
+                  uint32_t indexCapacity = DefaultIndexCapacity);
+
+        void cleanup();
+
+        // Reserves ranges and queues the upload on the StagingUploader. Grows the pool (blocking) if it is full.
+        // InvalidGeometry for an empty mesh.
+        GeometryHandle allocate(const std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices,
+                                UploadTicket &ticket);
+
+        // The ranges are only reused once no frame in flight can read them anymore.
+        void free(GeometryHandle handle);
+
+        bool valid(GeometryHandle handle) const;
+
+        const GeometryRange &getRange(GeometryHandle handle) const { return m_slots[indexOf(handle)].range; }
+
+        // Call once per frame after the frame's fence was waited: releases deferred frees and retired buffers.
+        void beginFrame();
+
+        bool needsCompaction() const;
+
+        // Repacks all live meshes into fresh buffers. The copies are recorded into commandBuffer (outside a render
+        // pass) followed by a barrier for vertex input, the old buffers are destroyed once no frame uses them.
+        void compact(VkCommandBuffer commandBuffer);
+
+        // Of the newest mesh upload. Tickets complete in order, so a draw from the pool is safe once this one is.
+        UploadTicket getNewestTicket() const { return m_newestTicket; }
+
+        VkBuffer getVertexBuffer() const { return m_vertexBuffer.buffer; }
+
+        VkBuffer getIndexBuffer() const { return m_indexBuffer.buffer; }
+
+        GeometryPoolStats getStats() const;
+
+    private:
+        struct Slot {
+            GeometryRange range;
+            TlsfAllocator::Allocation vertexAllocation;
+            TlsfAllocator::Allocation indexAllocation;
+            uint32_t generation = 0; // Incremented by free()
+            bool live = false;
+        };
+
+        static uint32_t indexOf(GeometryHandle handle) { return static_cast<uint32_t>(handle); }
+
+        static GeometryHandle makeHandle(uint32_t index, uint32_t generation) {
+            return static_cast<GeometryHandle>(generation) << 32 | index;
+        }
+
+        struct PendingFree {
+            TlsfAllocator::Allocation vertexAllocation;
+            TlsfAllocator::Allocation indexAllocation;
+            uint64_t frame = 0;
+        };
+
+        struct RetiredBuffers {
+            AllocatedBuffer vertexBuffer;
+            AllocatedBuffer indexBuffer;
+            uint64_t frame = 0;
+        };
+
+        void createBuffers(uint64_t vertexCapacity, uint64_t indexCapacity, AllocatedBuffer &vertexBuffer,
+                           AllocatedBuffer &indexBuffer);
+
+        void rebuild(VkCommandBuffer commandBuffer, uint64_t vertexCapacity, uint64_t indexCapacity);
+
+        void grow(uint64_t vertexCount, uint64_t indexCount);
+
+        VulkanContext *m_context = nullptr;
+
+        AllocatedBuffer m_vertexBuffer;
+        AllocatedBuffer m_indexBuffer;
+        TlsfAllocator m_vertexRanges;
+        TlsfAllocator m_indexRanges;
+
+        std::vector<Slot> m_slots;
+        std::vector<uint32_t> m_freeSlots;
+        std::vector<PendingFree> m_pendingFrees;
+        std::vector<RetiredBuffers> m_retiredBuffers;
+
+        uint64_t m_frame = 0;
+        UploadTicket m_newestTicket = 0;
+        uint32_t m_meshCount = 0;
+        uint32_t m_compactions = 0;
+        uint32_t m_growths = 0;
+    };
+}
+
+#endif //GEOMETRYPOOL_H
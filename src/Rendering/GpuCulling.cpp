@@ -0,0 +1,301 @@
+//
+// Created by alex on 4/29/25.
+//
+
+#include "GpuCulling.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <stdexcept>
+
+#include "VulkanContext.h"
+#include "Logger.h"
+#include "PerfCounters.h"
+
+namespace Bcg {
+    namespace {
+        // Objects this close to a plane may be classified differently by the GPU (fma, evaluation order)
+        constexpr float ValidationTolerance = 1e-3f;
+    }
+
+    void GpuCulling::init(VulkanContext *context) {
+        m_context = context;
+        m_frames.resize(context->MAX_FRAMES_IN_FLIGHT);
+        createLayouts();
+        createDescriptors();
+        // Built concurrently with the other pipelines, waited for by VulkanContext::finishPipelineJobs()
+        context->enqueuePipelineJob("Culling pipeline", [this]() { createPipeline(); });
+
+        if (std::getenv("BCG_VALIDATE_CULLING")) {
+            validate = true;
+        }
+        Log::Info("[GpuCulling::init] Culling initialized (validation {}).", validate ? "on" : "off");
+    }
+
+    void GpuCulling::cleanup() {
+        if (!m_context) return;
+        VkDevice device = m_context->device;
+        for (auto &frame: m_frames) {
+            frame.objects.destroy(device);
+            frame.drawCommands.destroy(device);
+            frame.drawCount.destroy(device);
+        }
+        m_frames.clear();
+        if (m_descriptorPool != VK_NULL_HANDLE) {
+            vkDestroyDescriptorPool(device, m_descriptorPool, nullptr); // Frees the sets
+            m_descriptorPool = VK_NULL_HANDLE;
+        }
+        if (m_pipeline != VK_NULL_HANDLE) {
+            vkDestroyPipeline(device, m_pipeline, nullptr);
+            m_pipeline = VK_NULL_HANDLE;
+        }
+        if (m_pipelineLayout != VK_NULL_HANDLE) {
+            vkDestroyPipelineLayout(device, m_pipelineLayout, nullptr);
+            m_pipelineLayout = VK_NULL_HANDLE;
+        }
+        if (m_setLayout != VK_NULL_HANDLE) {
+            vkDestroyDescriptorSetLayout(device, m_setLayout, nullptr);
+            m_setLayout = VK_NULL_HANDLE;
+        }
+        m_context = nullptr;
+    }
+
+    CullObject *GpuCulling::mapObjects(uint32_t frameIndex, uint32_t objectCount) {
+        FrameResources &frame = m_frames[frameIndex];
+        if (objectCount > frame.capacity) {
+            uint32_t capacity = std::max<uint32_t>(256, frame.capacity);
+            while (capacity < objectCount) capacity *= 2;
+
+            // The frame's fence was waited, nothing reads these anymore
+            VkDevice device = m_context->device;
+            frame.objects.destroy(device);
+            frame.drawCommands.destroy(device);
+            frame.drawCount.destroy(device);
+
+            // Host visible: objects are written every frame, commands and count are read back for validation
+            const VkMemoryPropertyFlags hostVisible =
+                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+            m_context->createBuffer(capacity * sizeof(CullObject), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, hostVisible,
+                                    frame.objects);
+            m_context->createBuffer(capacity * sizeof(VkDrawIndexedIndirectCommand),
+                                    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+                                    hostVisible, frame.drawCommands);
+            m_context->createBuffer(sizeof(uint32_t),
+                                    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+                                    VK_BUFFER_USAGE_TRANSFER_DST_BIT, hostVisible, frame.drawCount);
+            frame.capacity = capacity;
+            frame.recorded = false;
+        }
+        return static_cast<CullObject *>(frame.objects.mappedData);
+    }
+
+    void GpuCulling::record(VkCommandBuffer commandBuffer, uint32_t frameIndex, uint32_t objectCount,
+                            const AllocatedBuffer &instanceBuffer, const Frustum &frustum) {
+        FrameResources &frame = m_frames[frameIndex];
+        frame.objectCount = objectCount;
+        frame.frustum = frustum;
+        frame.recorded = objectCount > 0;
+        if (objectCount == 0) return;
+
+        // The buffers may have been recreated since the last frame, the set is not in use (fence waited)
+        VkDescriptorBufferInfo uniformInfo{m_context->uniformBuffers[frameIndex].buffer, 0, sizeof(GlobalUBO)};
+        VkDescriptorBufferInfo objectsInfo{frame.objects.buffer, 0, objectCount * sizeof(CullObject)};
+        VkDescriptorBufferInfo instancesInfo{instanceBuffer.buffer, 0, objectCount * sizeof(InstanceData)};
+        VkDescriptorBufferInfo commandsInfo{
+            frame.drawCommands.buffer, 0, objectCount * sizeof(VkDrawIndexedIndirectCommand)
+        };
+        VkDescriptorBufferInfo countInfo{frame.drawCount.buffer, 0, sizeof(uint32_t)};
+        std::array<VkDescriptorBufferInfo *, 5> infos = {
+            &uniformInfo, &objectsInfo, &instancesInfo, &commandsInfo, &countInfo
+        };
+
+        std::array<VkWriteDescriptorSet, 5> writes{};
+        for (uint32_t i = 0; i < writes.size(); ++i) {
+            writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            writes[i].dstSet = frame.descriptorSet;
+            writes[i].dstBinding = i;
+            writes[i].descriptorCount = 1;
+            writes[i].descriptorType = i == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            writes[i].pBufferInfo = infos[i];
+        }
+        vkUpdateDescriptorSets(m_context->device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+
+        // --- Reset the draw count ---
+        vkCmdFillBuffer(commandBuffer, frame.drawCount.buffer, 0, sizeof(uint32_t), 0);
+
+        VkMemoryBarrier clearBarrier{};
+        clearBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        clearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+                             1, &clearBarrier, 0, nullptr, 0, nullptr);
+
+        // --- Cull ---
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0, 1,
+                                &frame.descriptorSet, 0, nullptr);
+        BCG_COUNT(PipelineBinds, 1);
+        BCG_COUNT(DescriptorBinds, 1);
+        vkCmdPushConstants(commandBuffer, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(uint32_t),
+                           &objectCount);
+        vkCmdDispatch(commandBuffer, (objectCount + WorkgroupSize - 1) / WorkgroupSize, 1, 1);
+
+        // --- Make the commands visible to the indirect draw and to the host readback ---
+        VkMemoryBarrier cullBarrier{};
+        cullBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        cullBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        cullBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_HOST_READ_BIT;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &cullBarrier, 0,
+                             nullptr, 0, nullptr);
+    }
+
+    void GpuCulling::draw(VkCommandBuffer commandBuffer, uint32_t frameIndex) const {
+        const FrameResources &frame = m_frames[frameIndex];
+        if (!frame.recorded) return;
+        vkCmdDrawIndexedIndirectCount(commandBuffer, frame.drawCommands.buffer, 0, frame.drawCount.buffer, 0,
+                                      frame.objectCount, sizeof(VkDrawIndexedIndirectCommand));
+    }
+
+    void GpuCulling::readback(uint32_t frameIndex, const InstanceData *instances) {
+        FrameResources &frame = m_frames[frameIndex];
+        if (!frame.recorded) return;
+        frame.recorded = false; // Consumed, record() sets it again while culling stays enabled
+
+        m_stats.objectCount = frame.objectCount;
+        m_stats.visibleCount = *static_cast<const uint32_t *>(frame.drawCount.mappedData);
+        // Of the frame that used these resources, counted in the frame that reads them back
+        BCG_COUNT(CullingTested, m_stats.objectCount);
+        BCG_COUNT(CullingVisible, m_stats.visibleCount);
+        if (!validate || !instances) return;
+
+        uint32_t mismatches = validateFrame(frame, instances);
+        ++m_stats.validatedFrames;
+        m_stats.lastMismatches = mismatches;
+        if (mismatches > 0) {
+            ++m_stats.mismatchedFrames;
+            Log::Error("[GpuCulling::readback] {} of {} objects differ from the CPU reference ({} visible on the GPU).",
+                       mismatches, frame.objectCount, m_stats.visibleCount);
+        }
+    }
+
+    uint32_t GpuCulling::validateFrame(const FrameResources &frame, const InstanceData *instances) const {
+        const auto *objects = static_cast<const CullObject *>(frame.objects.mappedData);
+        const auto *commands = static_cast<const VkDrawIndexedIndirectCommand *>(frame.drawCommands.mappedData);
+        uint32_t visibleCount = *static_cast<const uint32_t *>(frame.drawCount.mappedData);
+        if (visibleCount > frame.objectCount) {
+            return visibleCount - frame.objectCount;
+        }
+
+        // firstInstance is the object index, every object may appear at most once
+        std::vector<uint8_t> gpuVisible(frame.objectCount, 0);
+        uint32_t mismatches = 0;
+        for (uint32_t i = 0; i < visibleCount; ++i) {
+            const VkDrawIndexedIndirectCommand &command = commands[i];
+            uint32_t index = command.firstInstance;
+            if (index >= frame.objectCount || gpuVisible[index]) {
+                ++mismatches;
+                continue;
+            }
+            gpuVisible[index] = 1;
+            const CullObject &object = objects[index];
+            if (command.indexCount != object.indexCount || command.firstIndex != object.firstIndex ||
+                command.vertexOffset != object.vertexOffset || command.instanceCount != 1) {
+                ++mismatches;
+            }
+        }
+
+        for (uint32_t i = 0; i < frame.objectCount; ++i) {
+            const CullObject &object = objects[i];
+            float slack = FrustumUtils::slack(frame.frustum, instances[i].model, object.boundsMin.head<3>(),
+                                              object.boundsMax.head<3>());
+            if (std::abs(slack) <= ValidationTolerance) continue; // Touches a plane, either answer is fine
+            if ((slack > 0.0f) != (gpuVisible[i] != 0)) {
+                ++mismatches;
+            }
+        }
+        return mismatches;
+    }
+
+    void GpuCulling::createLayouts() {
+        // binding 0: GlobalUBO, 1: CullObject[], 2: InstanceData[], 3: draw commands, 4: draw count
+        std::array<VkDescriptorSetLayoutBinding, 5> bindings{};
+        for (uint32_t i = 0; i < bindings.size(); ++i) {
+            bindings[i].binding = i;
+            bindings[i].descriptorType = i == 0
+                                             ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER
+                                             : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            bindings[i].descriptorCount = 1;
+            bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        }
+
+        VkDescriptorSetLayoutCreateInfo layoutInfo{};
+        layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+        layoutInfo.pBindings = bindings.data();
+        VK_CHECK(vkCreateDescriptorSetLayout(m_context->device, &layoutInfo, nullptr, &m_setLayout));
+
+        VkPushConstantRange pushConstantRange{};
+        pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        pushConstantRange.offset = 0;
+        pushConstantRange.size = sizeof(uint32_t); // CullParams::objectCount
+
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutInfo.setLayoutCount = 1;
+        pipelineLayoutInfo.pSetLayouts = &m_setLayout;
+        pipelineLayoutInfo.pushConstantRangeCount = 1;
+        pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+        VK_CHECK(vkCreatePipelineLayout(m_context->device, &pipelineLayoutInfo, nullptr, &m_pipelineLayout));
+    }
+
+    void GpuCulling::createPipeline() {
+        VkShaderModule computeShaderModule = m_context->compileSlangShader("shaders/cull.slang",
+                                                                           SlangStage::SLANG_STAGE_COMPUTE);
+        if (computeShaderModule == VK_NULL_HANDLE) {
+            throw std::runtime_error("Failed to create the culling shader module!");
+        }
+
+        VkComputePipelineCreateInfo pipelineInfo{};
+        pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        pipelineInfo.stage.module = computeShaderModule;
+        pipelineInfo.stage.pName = "main"; // Slang renames the entry point to main
+        pipelineInfo.layout = m_pipelineLayout;
+        VK_CHECK(vkCreateComputePipelines(m_context->device, m_context->pipelineCache, 1, &pipelineInfo, nullptr,
+                                          &m_pipeline));
+
+        vkDestroyShaderModule(m_context->device, computeShaderModule, nullptr);
+    }
+
+    void GpuCulling::createDescriptors() {
+        const uint32_t frameCount = static_cast<uint32_t>(m_frames.size());
+        std::array<VkDescriptorPoolSize, 2> poolSizes{};
+        poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        poolSizes[0].descriptorCount = frameCount;
+        poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        poolSizes[1].descriptorCount = 4 * frameCount;
+
+        VkDescriptorPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+        poolInfo.pPoolSizes = poolSizes.data();
+        poolInfo.maxSets = frameCount;
+        VK_CHECK(vkCreateDescriptorPool(m_context->device, &poolInfo, nullptr, &m_descriptorPool));
+
+        std::vector<VkDescriptorSetLayout> layouts(frameCount, m_setLayout);
+        std::vector<VkDescriptorSet> sets(frameCount);
+        VkDescriptorSetAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocInfo.descriptorPool = m_descriptorPool;
+        allocInfo.descriptorSetCount = frameCount;
+        allocInfo.pSetLayouts = layouts.data();
+        VK_CHECK(vkAllocateDescriptorSets(m_context->device, &allocInfo, sets.data()));
+        for (uint32_t i = 0; i < frameCount; ++i) {
+            m_frames[i].descriptorSet = sets[i];
+        }
+    }
+}
@@ -0,0 +1,88 @@
+//
+// Created by alex on 4/29/25.
+//
+
+#ifndef GPUCULLING_H
+#define GPUCULLING_H
+
+#include <vector>
+
+#include "VulkanUtils.h"
+#include "ShaderData.h"
+#include "FrustumUtils.h"
+
+namespace Bcg {
+    struct VulkanContext;
+
+    struct GpuCullingStats {
+        uint32_t objectCount = 0; // Of the last frame that was read back
+        uint32_t visibleCount = 0;
+        uint32_t validatedFrames = 0;
+        uint32_t mismatchedFrames = 0;
+        uint32_t lastMismatches = 0;
+    };
+
+    // Frustum culling in a compute pass (shaders/cull.slang). Per frame in flight it owns the CullObject input,
+    // the compacted VkDrawIndexedIndirectCommand output and the draw count, all host visible so that results can
+    // be read back once the frame's fence was waited and compared against FrustumUtils (the CPU reference).
+    class GpuCulling {
+    public:
+        static constexpr uint32_t WorkgroupSize = 64; // numthreads of computeMain
+
+        void init(VulkanContext *context);
+
+        void cleanup();
+
+        // Mapped CullObject array of this frame with room for objectCount entries, index i culls InstanceData i.
+        CullObject *mapObjects(uint32_t frameIndex, uint32_t objectCount);
+
+        // Records the count reset, the dispatch and the barrier to the indirect draw. Outside of a render pass.
+        void record(VkCommandBuffer commandBuffer, uint32_t frameIndex, uint32_t objectCount,
+                    const AllocatedBuffer &instanceBuffer, const Frustum &frustum);
+
+        // vkCmdDrawIndexedIndirectCount with the results of record(), inside the render pass.
+        void draw(VkCommandBuffer commandBuffer, uint32_t frameIndex) const;
+
+        // Reads the results of the last submission of this frame, its fence must have been waited and the
+        // instances must still be the ones it was recorded with. Compares against the CPU culler if validate is set.
+        // Call before record() of the same frame.
+        void readback(uint32_t frameIndex, const InstanceData *instances);
+
+        const GpuCullingStats &getStats() const { return m_stats; }
+
+        bool enabled = true;
+        bool validate = false; // Also enabled by the environment variable BCG_VALIDATE_CULLING
+
+    private:
+        struct FrameResources {
+            AllocatedBuffer objects; // CullObject
+            AllocatedBuffer drawCommands; // VkDrawIndexedIndirectCommand
+            AllocatedBuffer drawCount; // uint32_t
+            VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+            uint32_t capacity = 0;
+            uint32_t objectCount = 0; // Recorded with the last submission
+            Frustum frustum;
+            bool recorded = false;
+        };
+
+        void createLayouts();
+
+        void createPipeline();
+
+        void createDescriptors();
+
+        uint32_t validateFrame(const FrameResources &frame, const InstanceData *instances) const;
+
+        VulkanContext *m_context = nullptr;
+
+        VkDescriptorSetLayout m_setLayout = VK_NULL_HANDLE;
+        VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
+        VkPipeline m_pipeline = VK_NULL_HANDLE;
+        VkDescriptorPool m_descriptorPool = VK_NULL_HANDLE;
+
+        std::vector<FrameResources> m_frames;
+        GpuCullingStats m_stats;
+    };
+}
+
+#endif //GPUCULLING_H
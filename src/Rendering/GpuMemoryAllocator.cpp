@@ -0,0 +1,223 @@
+//
+// Created by alex on 4/26/25.
+//
+
+#include "GpuMemoryAllocator.h"
+
+#include <stdexcept>
+#include <algorithm>
+
+#include "VulkanUtils.h"
+#include "Logger.h"
+#include "PerfCounters.h"
+
+namespace Bcg {
+    void GpuMemoryAllocator::init(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize blockSize) {
+        m_device = device;
+        m_blockSize = blockSize;
+
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+        m_bufferImageGranularity = std::max<VkDeviceSize>(1, properties.limits.bufferImageGranularity);
+        m_maxAllocationCount = properties.limits.maxMemoryAllocationCount;
+
+        vkGetPhysicalDeviceMemoryProperties(physicalDevice, &m_memoryProperties);
+
+        Log::Info("[GpuMemoryAllocator::init] Block size: {} MiB, bufferImageGranularity: {}, maxMemoryAllocationCount: {}",
+                  m_blockSize / (1024 * 1024), m_bufferImageGranularity, m_maxAllocationCount);
+    }
+
+    void GpuMemoryAllocator::cleanup() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto &blocks: m_blocks) {
+            for (auto &block: blocks) {
+                if (!block) continue;
+                if (!block->allocator.empty()) {
+                    Log::Warn("[GpuMemoryAllocator::cleanup] Block still holds {} live allocations ({} bytes).",
+                              block->allocator.getAllocationCount(), block->allocator.getUsedBytes());
+                }
+                freeDeviceMemory(block->memory, block->mappedData);
+            }
+            blocks.clear();
+        }
+        if (m_dedicatedCount > 0) {
+            Log::Warn("[GpuMemoryAllocator::cleanup] {} dedicated allocations were not freed.", m_dedicatedCount);
+        }
+        m_dedicatedCount = 0;
+        m_dedicatedBytes = 0;
+    }
+
+    GpuAllocation GpuMemoryAllocator::allocate(const VkMemoryRequirements &requirements,
+                                               VkMemoryPropertyFlags properties, GpuResourceKind kind) {
+        BCG_COUNT(Allocations, 1);
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        GpuAllocation allocation;
+        allocation.memoryType = findMemoryType(requirements.memoryTypeBits, properties);
+        allocation.size = requirements.size;
+
+        // Large resources get their own VkDeviceMemory, they would only fragment the shared blocks.
+        if (requirements.size > m_blockSize / 2) {
+            allocation.memory = allocateDeviceMemory(requirements.size, allocation.memoryType,
+                                                     &allocation.mappedData);
+            allocation.offset = 0;
+            ++m_dedicatedCount;
+            m_dedicatedBytes += requirements.size;
+            return allocation;
+        }
+
+        // Resources of different kinds only need separate blocks if the device has a granularity restriction.
+        bool separateKinds = m_bufferImageGranularity > 1;
+        auto &blocks = m_blocks[allocation.memoryType];
+
+        auto tryBlock = [&](uint32_t blockIndex) {
+            MemoryBlock &block = *blocks[blockIndex];
+            auto range = block.allocator.allocate(requirements.size, requirements.alignment);
+            if (!range.valid()) return false;
+
+            allocation.memory = block.memory;
+            allocation.offset = range.offset;
+            allocation.range = range;
+            allocation.blockIndex = blockIndex;
+            allocation.mappedData = block.mappedData
+                                        ? static_cast<char *>(block.mappedData) + range.offset
+                                        : nullptr;
+            return true;
+        };
+
+        for (uint32_t i = 0; i < blocks.size(); ++i) {
+            if (!blocks[i] || (separateKinds && blocks[i]->kind != kind)) continue;
+            if (tryBlock(i)) return allocation;
+        }
+
+        // No block had room, create a new one (reusing an empty slot keeps block indices stable).
+        auto block = std::make_unique<MemoryBlock>();
+        block->size = std::max(m_blockSize, requirements.size);
+        block->kind = kind;
+        block->memory = allocateDeviceMemory(block->size, allocation.memoryType, &block->mappedData);
+        block->allocator.reset(block->size);
+
+        auto slot = std::find(blocks.begin(), blocks.end(), nullptr);
+        uint32_t blockIndex = static_cast<uint32_t>(slot - blocks.begin());
+        if (slot == blocks.end()) {
+            blocks.push_back(std::move(block));
+        } else {
+            *slot = std::move(block);
+        }
+
+        Log::Info("[GpuMemoryAllocator::allocate] New {} MiB block for memory type {} ({} blocks).",
+                  blocks[blockIndex]->size / (1024 * 1024), allocation.memoryType, blocks.size());
+
+        if (!tryBlock(blockIndex)) {
+            throw std::runtime_error("GpuMemoryAllocator: allocation does not fit into a fresh block!");
+        }
+        return allocation;
+    }
+
+    void GpuMemoryAllocator::free(GpuAllocation &allocation) {
+        if (!allocation.valid()) return;
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (allocation.dedicated()) {
+            freeDeviceMemory(allocation.memory, allocation.mappedData);
+            --m_dedicatedCount;
+            m_dedicatedBytes -= allocation.size;
+        } else {
+            auto &blocks = m_blocks[allocation.memoryType];
+            auto &block = blocks[allocation.blockIndex];
+            block->allocator.free(allocation.range);
+
+            // Release empty blocks, but keep at least one per memory type to avoid allocate/free churn.
+            if (block->allocator.empty()) {
+                auto liveBlocks = std::count_if(blocks.begin(), blocks.end(),
+                                                [](const auto &b) { return b != nullptr; });
+                if (liveBlocks > 1) {
+                    freeDeviceMemory(block->memory, block->mappedData);
+                    block.reset();
+                }
+            }
+        }
+        allocation = GpuAllocation{};
+    }
+
+    uint32_t GpuMemoryAllocator::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const {
+        for (uint32_t i = 0; i < m_memoryProperties.memoryTypeCount; i++) {
+            if ((typeFilter & (1 << i)) && (m_memoryProperties.memoryTypes[i].propertyFlags & properties) ==
+                properties) {
+                return i;
+            }
+        }
+        throw std::runtime_error("Failed to find suitable memory type!");
+    }
+
+    GpuMemoryStats GpuMemoryAllocator::getStats() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        GpuMemoryStats stats;
+        stats.dedicatedCount = m_dedicatedCount;
+        stats.allocationCount = m_dedicatedCount;
+        stats.deviceAllocationCount = m_deviceAllocationCount;
+        stats.reservedBytes = m_dedicatedBytes;
+        stats.usedBytes = m_dedicatedBytes;
+
+        for (const auto &blocks: m_blocks) {
+            for (const auto &block: blocks) {
+                if (!block) continue;
+                auto blockStats = block->allocator.getStats();
+                ++stats.blockCount;
+                stats.allocationCount += blockStats.allocationCount;
+                stats.reservedBytes += block->size;
+                stats.usedBytes += blockStats.usedBytes;
+                stats.freeBytes += blockStats.freeBytes;
+                stats.largestFreeRange = std::max(stats.largestFreeRange, blockStats.largestFreeRange);
+                stats.fragmentation = std::max(stats.fragmentation, blockStats.fragmentation());
+            }
+        }
+        return stats;
+    }
+
+    void GpuMemoryAllocator::logStats() const {
+        auto stats = getStats();
+        Log::Info("[GpuMemoryAllocator] {} allocations in {} blocks + {} dedicated ({} vkAllocateMemory calls)",
+                  stats.allocationCount, stats.blockCount, stats.dedicatedCount, stats.deviceAllocationCount);
+        Log::Info("[GpuMemoryAllocator] used {:.2f} / {:.2f} MiB ({:.1f}%), fragmentation {:.3f}",
+                  stats.usedBytes / (1024.0 * 1024.0), stats.reservedBytes / (1024.0 * 1024.0),
+                  100.0f * stats.utilization(), stats.fragmentation);
+    }
+
+    VkDeviceMemory GpuMemoryAllocator::allocateDeviceMemory(VkDeviceSize size, uint32_t memoryType,
+                                                            void **mappedData) {
+        if (m_deviceAllocationCount + 1 > m_maxAllocationCount) {
+            throw std::runtime_error("GpuMemoryAllocator: maxMemoryAllocationCount exceeded!");
+        }
+
+        VkMemoryAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = size;
+        allocInfo.memoryTypeIndex = memoryType;
+
+        VkDeviceMemory memory;
+        VK_CHECK(vkAllocateMemory(m_device, &allocInfo, nullptr, &memory));
+        ++m_deviceAllocationCount;
+
+        // Persistently map host visible memory, a VkDeviceMemory can only be mapped once at a time.
+        *mappedData = nullptr;
+        if (isHostVisible(memoryType)) {
+            VK_CHECK(vkMapMemory(m_device, memory, 0, VK_WHOLE_SIZE, 0, mappedData));
+        }
+        return memory;
+    }
+
+    void GpuMemoryAllocator::freeDeviceMemory(VkDeviceMemory memory, void *mappedData) {
+        if (memory == VK_NULL_HANDLE) return;
+        if (mappedData) {
+            vkUnmapMemory(m_device, memory);
+        }
+        vkFreeMemory(m_device, memory, nullptr);
+        --m_deviceAllocationCount;
+    }
+
+    bool GpuMemoryAllocator::isHostVisible(uint32_t memoryType) const {
+        return (m_memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0;
+    }
+}
@@ -0,0 +1,104 @@
+//
+// Created by alex on 4/26/25.
+//
+
+#ifndef GPUMEMORYALLOCATOR_H
+#define GPUMEMORYALLOCATOR_H
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <array>
+#include <memory>
+#include <mutex>
+
+#include "TlsfAllocator.h"
+
+namespace Bcg {
+    // Buffers and linear images must not share a bufferImageGranularity page with optimal images.
+    enum class GpuResourceKind : uint8_t {
+        Linear,
+        Optimal
+    };
+
+    struct GpuAllocation {
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceSize offset = 0;
+        VkDeviceSize size = 0;
+        void *mappedData = nullptr; // Non-null if the memory type is host visible (persistently mapped)
+
+        uint32_t memoryType = ~0u;
+        uint32_t blockIndex = ~0u; // ~0u for dedicated allocations
+        TlsfAllocator::Allocation range;
+
+        bool valid() const { return memory != VK_NULL_HANDLE; }
+
+        bool dedicated() const { return blockIndex == ~0u; }
+    };
+
+    struct GpuMemoryStats {
+        uint32_t blockCount = 0;
+        uint32_t dedicatedCount = 0;
+        uint32_t allocationCount = 0;
+        uint32_t deviceAllocationCount = 0; // Number of live vkAllocateMemory calls
+        VkDeviceSize reservedBytes = 0; // Sum of all VkDeviceMemory sizes
+        VkDeviceSize usedBytes = 0;
+        VkDeviceSize freeBytes = 0; // Unused bytes inside blocks
+        VkDeviceSize largestFreeRange = 0;
+        float fragmentation = 0.0f; // Worst block, 0 = contiguous free space
+
+        float utilization() const { return reservedBytes > 0 ? float(usedBytes) / float(reservedBytes) : 0.0f; }
+    };
+
+    // Sub-allocates resources from large VkDeviceMemory blocks (one block list per memory type) instead of
+    // calling vkAllocateMemory per buffer/image. Host visible blocks are mapped once for their whole lifetime.
+    class GpuMemoryAllocator {
+    public:
+        static constexpr VkDeviceSize DefaultBlockSize = 64ull * 1024 * 1024;
+
+        void init(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize blockSize = DefaultBlockSize);
+
+        void cleanup();
+
+        GpuAllocation allocate(const VkMemoryRequirements &requirements, VkMemoryPropertyFlags properties,
+                               GpuResourceKind kind);
+
+        void free(GpuAllocation &allocation);
+
+        uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+
+        GpuMemoryStats getStats() const;
+
+        void logStats() const;
+
+    private:
+        struct MemoryBlock {
+            VkDeviceMemory memory = VK_NULL_HANDLE;
+            VkDeviceSize size = 0;
+            void *mappedData = nullptr;
+            GpuResourceKind kind = GpuResourceKind::Linear;
+            TlsfAllocator allocator;
+        };
+
+        VkDeviceMemory allocateDeviceMemory(VkDeviceSize size, uint32_t memoryType, void **mappedData);
+
+        void freeDeviceMemory(VkDeviceMemory memory, void *mappedData);
+
+        bool isHostVisible(uint32_t memoryType) const;
+
+        VkDevice m_device = VK_NULL_HANDLE;
+        VkDeviceSize m_blockSize = DefaultBlockSize;
+        VkDeviceSize m_bufferImageGranularity = 1;
+        uint32_t m_maxAllocationCount = 4096;
+        uint32_t m_deviceAllocationCount = 0;
+        uint32_t m_dedicatedCount = 0;
+        VkDeviceSize m_dedicatedBytes = 0;
+        VkPhysicalDeviceMemoryProperties m_memoryProperties{};
+
+        // Blocks are never moved once created so that GpuAllocation::blockIndex stays valid; empty slots are reused.
+        std::array<std::vector<std::unique_ptr<MemoryBlock> >, VK_MAX_MEMORY_TYPES> m_blocks;
+
+        mutable std::mutex m_mutex;
+    };
+}
+
+#endif //GPUMEMORYALLOCATOR_H
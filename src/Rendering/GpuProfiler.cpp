@@ -0,0 +1,197 @@
+//
+// Created by alex on 5/3/25.
+//
+
+#include "GpuProfiler.h"
+
+#include "VulkanContext.h"
+#include "Logger.h"
+
+namespace Bcg {
+    namespace {
+        constexpr VkQueryPipelineStatisticFlags StatisticFlags =
+                VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT |
+                VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
+                VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+                VK_QUERY_PIPELINE_STATISTIC_CLIPPING_INVOCATIONS_BIT |
+                VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+                VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+
+        constexpr uint32_t TimestampCount = 2 + 2 * GpuProfiler::MaxScopes;
+    }
+
+    void GpuProfiler::init(VulkanContext *context) {
+        m_context = context;
+
+        uint32_t familyCount = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(context->physicalDevice, &familyCount, nullptr);
+        std::vector<VkQueueFamilyProperties> families(familyCount);
+        vkGetPhysicalDeviceQueueFamilyProperties(context->physicalDevice, &familyCount, families.data());
+        if (families[context->queueFamilyIndices.graphicsFamily.value()].timestampValidBits != 0) {
+            VkPhysicalDeviceProperties properties;
+            vkGetPhysicalDeviceProperties(context->physicalDevice, &properties);
+            m_timestampPeriod = properties.limits.timestampPeriod;
+        } else {
+            Log::Warn("[GpuProfiler::init] The graphics queue has no timestamps, GPU times are not measured.");
+        }
+        m_statisticsSupported = context->pipelineStatisticsQuery;
+
+        m_frames.resize(context->MAX_FRAMES_IN_FLIGHT);
+        for (auto &frame: m_frames) {
+            if (isTimestampSupported()) {
+                VkQueryPoolCreateInfo poolInfo{};
+                poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+                poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+                poolInfo.queryCount = TimestampCount;
+                VK_CHECK(vkCreateQueryPool(context->device, &poolInfo, nullptr, &frame.timestamps));
+            }
+            if (m_statisticsSupported) {
+                VkQueryPoolCreateInfo poolInfo{};
+                poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+                poolInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+                poolInfo.queryCount = 1;
+                poolInfo.pipelineStatistics = StatisticFlags;
+                VK_CHECK(vkCreateQueryPool(context->device, &poolInfo, nullptr, &frame.statistics));
+            }
+            frame.scopeNames.reserve(MaxScopes);
+        }
+        Log::Info("[GpuProfiler::init] Timestamps: {}, pipeline statistics: {}, upload timestamps: {}",
+                  isTimestampSupported(), m_statisticsSupported, context->uploader.isTimed());
+    }
+
+    void GpuProfiler::cleanup() {
+        if (!m_context) return;
+        for (auto &frame: m_frames) {
+            if (frame.timestamps != VK_NULL_HANDLE) vkDestroyQueryPool(m_context->device, frame.timestamps, nullptr);
+            if (frame.statistics != VK_NULL_HANDLE) vkDestroyQueryPool(m_context->device, frame.statistics, nullptr);
+        }
+        m_frames.clear();
+        m_history.clear();
+        m_recording = nullptr;
+        m_context = nullptr;
+    }
+
+    void GpuProfiler::beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex, uint64_t frameNumber) {
+        m_recording = nullptr;
+        if (!enabled || !isTimestampSupported()) return;
+
+        FrameQueries &frame = m_frames[frameIndex];
+        frame.scopeNames.clear();
+        frame.frameNumber = frameNumber;
+        frame.statisticsRecorded = false;
+        m_recording = &frame;
+
+        vkCmdResetQueryPool(commandBuffer, frame.timestamps, 0, TimestampCount);
+        if (frame.statistics != VK_NULL_HANDLE) vkCmdResetQueryPool(commandBuffer, frame.statistics, 0, 1);
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frame.timestamps, 0);
+    }
+
+    uint32_t GpuProfiler::beginScope(VkCommandBuffer commandBuffer, const char *name) {
+        if (!m_recording || m_recording->scopeNames.size() >= MaxScopes) return NoScope;
+
+        auto scope = static_cast<uint32_t>(m_recording->scopeNames.size());
+        m_recording->scopeNames.emplace_back(name);
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_recording->timestamps, 2 + 2 * scope);
+        return scope;
+    }
+
+    void GpuProfiler::endScope(VkCommandBuffer commandBuffer, uint32_t scope) {
+        if (!m_recording || scope == NoScope) return;
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_recording->timestamps,
+                            3 + 2 * scope);
+    }
+
+    void GpuProfiler::beginStatistics(VkCommandBuffer commandBuffer) {
+        if (!m_recording || m_recording->statistics == VK_NULL_HANDLE || m_recording->statisticsRecorded) return;
+        vkCmdBeginQuery(commandBuffer, m_recording->statistics, 0, 0);
+        m_recording->statisticsRecorded = true;
+    }
+
+    void GpuProfiler::endStatistics(VkCommandBuffer commandBuffer) {
+        if (!m_recording || !m_recording->statisticsRecorded) return;
+        vkCmdEndQuery(commandBuffer, m_recording->statistics, 0);
+    }
+
+    void GpuProfiler::endFrame(VkCommandBuffer commandBuffer) {
+        if (!m_recording) return;
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_recording->timestamps, 1);
+        m_recording->recorded = true;
+        m_recording = nullptr;
+    }
+
+    void GpuProfiler::collect(uint32_t frameIndex) {
+        if (m_frames.empty()) return;
+        FrameQueries &frame = m_frames[frameIndex];
+        if (!frame.recorded) return;
+        frame.recorded = false;
+
+        // Without WAIT_BIT: an unpaired scope leaves its query unavailable and drops the frame instead of hanging
+        uint64_t timestamps[TimestampCount] = {};
+        uint32_t queryCount = 2 + 2 * static_cast<uint32_t>(frame.scopeNames.size());
+        VkResult result = vkGetQueryPoolResults(m_context->device, frame.timestamps, 0, queryCount,
+                                                sizeof(timestamps), timestamps, sizeof(uint64_t),
+                                                VK_QUERY_RESULT_64_BIT);
+        if (result != VK_SUCCESS) {
+            Log::Warn("[GpuProfiler::collect] Timestamps of frame {} are not available.", frame.frameNumber);
+            return;
+        }
+
+        auto toMilliseconds = [this](uint64_t begin, uint64_t end) {
+            return end < begin ? 0.0 : static_cast<double>(end - begin) * m_timestampPeriod * 1e-6;
+        };
+        GpuFrameProfile &profile = m_lastProfile;
+        profile.frame = frame.frameNumber;
+        profile.totalMilliseconds = toMilliseconds(timestamps[0], timestamps[1]);
+        profile.scopes.clear();
+        for (size_t i = 0; i < frame.scopeNames.size(); ++i) {
+            double milliseconds = toMilliseconds(timestamps[2 + 2 * i], timestamps[3 + 2 * i]);
+            profile.scopes.push_back({frame.scopeNames[i], milliseconds});
+        }
+        if (m_context->uploader.isTimed()) {
+            // Transfer queue time of the batches that completed since the last frame was collected
+            profile.scopes.push_back({"Uploads", m_context->uploader.takeGpuMilliseconds()});
+        }
+
+        profile.hasStatistics = false;
+        if (frame.statisticsRecorded) {
+            result = vkGetQueryPoolResults(m_context->device, frame.statistics, 0, 1, sizeof(GpuPipelineStatistics),
+                                           &profile.statistics, sizeof(GpuPipelineStatistics),
+                                           VK_QUERY_RESULT_64_BIT);
+            profile.hasStatistics = result == VK_SUCCESS;
+        }
+
+        addSample("Frame", profile.totalMilliseconds);
+        for (const auto &scope: profile.scopes) addSample(scope.name, scope.milliseconds);
+        if (onFrameProfile) onFrameProfile(profile);
+    }
+
+    void GpuProfiler::collectAll(uint32_t currentFrame) {
+        auto frameCount = static_cast<uint32_t>(m_frames.size());
+        for (uint32_t i = 0; i < frameCount; ++i) {
+            collect((currentFrame + i) % frameCount);
+        }
+    }
+
+    void GpuProfiler::addSample(const std::string &name, double milliseconds) {
+        ScopeHistory *history = nullptr;
+        for (auto &entry: m_history) {
+            if (entry.name == name) {
+                history = &entry;
+                break;
+            }
+        }
+        if (!history) {
+            history = &m_history.emplace_back();
+            history->name = name;
+            history->milliseconds.assign(HistorySize, 0.0f);
+        }
+
+        history->milliseconds[history->offset] = static_cast<float>(milliseconds);
+        history->offset = (history->offset + 1) % HistorySize;
+        if (history->sampleCount < HistorySize) ++history->sampleCount;
+        // Slots not written yet are zero and add nothing
+        double sum = 0.0;
+        for (float value: history->milliseconds) sum += value;
+        history->average = static_cast<float>(sum / history->sampleCount);
+    }
+}
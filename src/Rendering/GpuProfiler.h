@@ -0,0 +1,122 @@
+//
+// Created by alex on 5/3/25.
+//
+
+#ifndef GPUPROFILER_H
+#define GPUPROFILER_H
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "VulkanUtils.h"
+
+namespace Bcg {
+    struct VulkanContext;
+
+    // Results of the pipeline statistics query, in the order of the VkQueryPipelineStatisticFlagBits
+    struct GpuPipelineStatistics {
+        uint64_t inputAssemblyVertices = 0;
+        uint64_t inputAssemblyPrimitives = 0;
+        uint64_t vertexShaderInvocations = 0;
+        uint64_t clippingInvocations = 0;
+        uint64_t clippingPrimitives = 0;
+        uint64_t fragmentShaderInvocations = 0;
+    };
+
+    struct GpuScopeTiming {
+        std::string name;
+        double milliseconds = 0.0;
+    };
+
+    struct GpuFrameProfile {
+        uint64_t frame = 0; // RendererSystem frame number
+        double totalMilliseconds = 0.0; // beginFrame() to endFrame()
+        std::vector<GpuScopeTiming> scopes; // In recording order, "Uploads" last if the uploads are timed
+        bool hasStatistics = false;
+        GpuPipelineStatistics statistics;
+    };
+
+    // Named GPU scopes and pipeline statistics of the frame's command buffer. Every frame in flight has its own
+    // timestamp and statistics query pool; results are read after the frame's fence was waited, i.e.
+    // MAX_FRAMES_IN_FLIGHT frames late, so reading them never stalls. The time the transfer queue spent on uploads
+    // (StagingUploader) is reported as the "Uploads" scope of the frame that collected it.
+    class GpuProfiler {
+    public:
+        static constexpr uint32_t MaxScopes = 16; // Per frame, further scopes are not measured
+        static constexpr uint32_t HistorySize = 240; // Samples per scope for the UI graphs
+        static constexpr uint32_t NoScope = ~0u;
+
+        struct ScopeHistory {
+            std::string name;
+            std::vector<float> milliseconds; // Ring buffer of HistorySize, oldest at offset
+            uint32_t offset = 0;
+            uint32_t sampleCount = 0; // In the history, up to HistorySize
+            float average = 0.0f; // Over the samples in the history
+        };
+
+        void init(VulkanContext *context);
+
+        void cleanup();
+
+        // Resets the queries of this frame and writes the frame start. Outside of a render pass.
+        void beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex, uint64_t frameNumber);
+
+        // Returns NoScope if timestamps are not supported or MaxScopes was reached, endScope() ignores it
+        uint32_t beginScope(VkCommandBuffer commandBuffer, const char *name);
+
+        void endScope(VkCommandBuffer commandBuffer, uint32_t scope);
+
+        // Pipeline statistics of everything recorded in between, at most once per frame and within one subpass
+        void beginStatistics(VkCommandBuffer commandBuffer);
+
+        void endStatistics(VkCommandBuffer commandBuffer);
+
+        void endFrame(VkCommandBuffer commandBuffer);
+
+        // Reads the results of the last submission of this frame, its fence must have been waited.
+        // Call before beginFrame() of the same frame.
+        void collect(uint32_t frameIndex);
+
+        // Reads the results of all frames in flight, oldest first. The device must be idle.
+        void collectAll(uint32_t currentFrame);
+
+        bool isTimestampSupported() const { return m_timestampPeriod > 0.0; }
+
+        bool isStatisticsSupported() const { return m_statisticsSupported; }
+
+        const GpuFrameProfile &getLastProfile() const { return m_lastProfile; }
+
+        // One entry per scope name that was ever collected, the frame total is called "Frame"
+        const std::vector<ScopeHistory> &getHistory() const { return m_history; }
+
+        // Called with every collected frame, in frame order
+        std::function<void(const GpuFrameProfile &)> onFrameProfile;
+
+        bool enabled = true;
+
+    private:
+        struct FrameQueries {
+            VkQueryPool timestamps = VK_NULL_HANDLE; // Frame start/end, then start/end of every scope
+            VkQueryPool statistics = VK_NULL_HANDLE;
+            std::vector<std::string> scopeNames;
+            uint64_t frameNumber = 0;
+            bool recorded = false; // Submitted and not collected yet
+            bool statisticsRecorded = false;
+        };
+
+        void addSample(const std::string &name, double milliseconds);
+
+        VulkanContext *m_context = nullptr;
+        std::vector<FrameQueries> m_frames;
+        FrameQueries *m_recording = nullptr; // Between beginFrame() and endFrame()
+
+        double m_timestampPeriod = 0.0; // Nanoseconds per tick, 0 if not supported
+        bool m_statisticsSupported = false;
+
+        GpuFrameProfile m_lastProfile;
+        std::vector<ScopeHistory> m_history;
+    };
+}
+
+#endif //GPUPROFILER_H
@@ -0,0 +1,51 @@
+//
+// Created by alex on 5/5/25.
+//
+
+#ifndef RENDERSNAPSHOT_H
+#define RENDERSNAPSHOT_H
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "MatVec.h"
+#include "RenderComponents.h"
+#include "UiDrawData.h"
+
+namespace Bcg {
+    struct RenderDraw {
+        Matrix4f model;
+        VulkanMeshComponent mesh;
+    };
+
+    // A camera and its rectangle of the framebuffer, see CameraSystem::getViews
+    struct RenderView {
+        Matrix4f view = Matrix4f::Identity();
+        Matrix4f projection = Matrix4f::Identity();
+        Vector3f cameraPosition = Vector3f::Zero();
+        Vector4f viewport = Vector4f(0.0f, 0.0f, 1.0f, 1.0f); // x, y, width, height in [0, 1]
+    };
+
+    // Everything RendererSystem reads of a simulated frame. Captured by the simulation thread and handed to the
+    // render thread, which then never touches the registry, the camera or the ImGui context.
+    struct RenderSnapshot {
+        // Single-threaded the renderer reads the draws directly from the registry instead of copying them
+        bool fromRegistry = false;
+        std::vector<RenderDraw> draws;
+
+        std::vector<RenderView> views; // Empty without a camera, at most VulkanContext::MaxViews
+
+        bool hasUi = false;
+        UiDrawData ui;
+        uint64_t uiVersion = 0; // UIManager::getVersion() of the draw data, unchanged while the UI is static
+        double uiMilliseconds = 0.0; // Building and copying the UI, close to 0 while it is static
+
+        uint64_t simulationFrame = 0;
+        int32_t cameraPathSegment = -1; // Of the camera during the simulated frame, -1 without a camera path
+        std::chrono::steady_clock::time_point inputTime; // Input polled, start of the input-to-present latency
+        double simulationMilliseconds = 0.0; // Input, systems, UI and the capture
+    };
+}
+
+#endif //RENDERSNAPSHOT_H
@@ -3,12 +3,17 @@
 //
 
 #include <iostream>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
 
 #include "imgui.h"
 
 #include "RendererSystem.h"
 
 #include <CameraUtils.h>
+#include <FrustumUtils.h>
 
 #include "Logger.h"
 #include "CameraSystem.h"
@@ -17,10 +22,39 @@
 #include "ShaderData.h"
 #include "UIManager.h"
 #include "TransformComponent.h"
+#include "ApplicationConfig.h"
+#include "ImageUtils.h"
+#include "PerfCounters.h"
+#include "Profiler.h"
 #include "entt/entity/registry.hpp"
 
 
 namespace Bcg{
+    namespace {
+        double millisecondsSince(std::chrono::steady_clock::time_point start) {
+            return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+
+        // Viewport and scissor of the rectangle (x, y, width, height in [0, 1]) of the framebuffer
+        void setViewport(VkCommandBuffer commandBuffer, const VkExtent2D &extent, const Vector4f &rectangle) {
+            const auto width = static_cast<float>(extent.width);
+            const auto height = static_cast<float>(extent.height);
+            VkViewport viewport{};
+            viewport.x = std::round(rectangle[0] * width);
+            viewport.y = std::round(rectangle[1] * height);
+            viewport.width = std::round((rectangle[0] + rectangle[2]) * width) - viewport.x;
+            viewport.height = std::round((rectangle[1] + rectangle[3]) * height) - viewport.y;
+            viewport.minDepth = 0.0f;
+            viewport.maxDepth = 1.0f;
+            vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+            VkRect2D scissor{};
+            scissor.offset = {static_cast<int32_t>(viewport.x), static_cast<int32_t>(viewport.y)};
+            scissor.extent = {static_cast<uint32_t>(viewport.width), static_cast<uint32_t>(viewport.height)};
+            vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+        }
+    }
+
 // --- Renderer Method Implementations ---
 
     RendererSystem::~RendererSystem() {
@@ -32,13 +66,32 @@ namespace Bcg{
         m_vkContext = &context->registry->ctx().emplace<VulkanContext>();
         // Renderer initialization (if any needed beyond VulkanContext)
         // Example: Create specific pipelines, render targets, etc.
-        m_vkContext->init(context->windowManager->getGLFWHandle()); // Init Vulkan context
+        if (context->config && context->config->headless) {
+            m_vkContext->initHeadless(context->config->width, context->config->height);
+        } else {
+            m_vkContext->init(context->windowManager->getGLFWHandle()); // Init Vulkan context
+        }
+        m_gpuCulling.init(m_vkContext);
+        m_gpuProfiler.init(m_vkContext);
+        // The pipelines are still built on workers, the application waits with VulkanContext::finishPipelineJobs()
         Log::Info("Renderer Initialized.");
     }
 
     void RendererSystem::shutdown() {
         // Cleanup renderer-specific resources (pipelines, etc.)
         // Note: VulkanContext cleanup is handled by Application
+        for (auto &buffer: m_instanceBuffers) buffer.destroy(m_vkContext->device);
+        for (auto &buffer: m_indirectBuffers) buffer.destroy(m_vkContext->device);
+        m_instanceBuffers.clear();
+        m_indirectBuffers.clear();
+        m_recordingPool.reset();
+        for (auto &secondary: m_secondaryCommands) {
+            // Frees its command buffer
+            vkDestroyCommandPool(m_vkContext->device, secondary.pool, nullptr);
+        }
+        m_secondaryCommands.clear();
+        m_gpuCulling.cleanup();
+        m_gpuProfiler.cleanup();
         Log::Info("Renderer Shutdown.");
     }
 
@@ -55,66 +108,28 @@ namespace Bcg{
 
         auto registry = context->registry;
 
-        VkDeviceSize vertexBufferSize = sizeof(vertices[0]) * vertices.size();
-        VkDeviceSize indexBufferSize = sizeof(indices[0]) * indices.size();
-        VkDeviceSize totalSize = vertexBufferSize + indexBufferSize;
-
-        // --- Create Staging Buffer (CPU Visible) ---
-        AllocatedBuffer stagingBuffer;
-        m_vkContext->createBuffer(totalSize,
-                                  VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                                  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                                  stagingBuffer);
-
-        // --- Map and Copy Data to Staging Buffer ---
-        void *data;
-        VK_CHECK(vkMapMemory(m_vkContext->device, stagingBuffer.memory, 0, totalSize, 0, &data));
-        memcpy(data, vertices.data(), static_cast<size_t>(vertexBufferSize));
-        memcpy(static_cast<char *>(data) + vertexBufferSize, indices.data(), static_cast<size_t>(indexBufferSize));
-        vkUnmapMemory(m_vkContext->device, stagingBuffer.memory);
-
-        // --- Create Device Local Buffers (GPU Only) ---
+        // --- Allocate ranges in the geometry pool ---
         // Get or create the VulkanMeshComponent for the entity
         auto &meshComp = registry->get_or_emplace<VulkanMeshComponent>(entity);
 
-        // Destroy old buffers if they exist before creating new ones
-        meshComp.vertexBuffer.destroy(m_vkContext->device);
-        meshComp.indexBuffer.destroy(m_vkContext->device);
-
-        m_vkContext->createBuffer(vertexBufferSize,
-                                  VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-                                  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-                                  meshComp.vertexBuffer);
-
-        m_vkContext->createBuffer(indexBufferSize,
-                                  VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-                                  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-                                  meshComp.indexBuffer);
-
-        // --- Copy from Staging to Device Local ---
-        VkCommandBuffer commandBuffer = m_vkContext->beginSingleTimeCommands(m_vkContext->commandPool);
-        // Use graphics pool
-
-        VkBufferCopy vertexCopyRegion{};
-        vertexCopyRegion.srcOffset = 0;
-        vertexCopyRegion.dstOffset = 0;
-        vertexCopyRegion.size = vertexBufferSize;
-        vkCmdCopyBuffer(commandBuffer, stagingBuffer.buffer, meshComp.vertexBuffer.buffer, 1, &vertexCopyRegion);
-
-        VkBufferCopy indexCopyRegion{};
-        indexCopyRegion.srcOffset = vertexBufferSize; // Index data starts after vertex data in staging buffer
-        indexCopyRegion.dstOffset = 0;
-        indexCopyRegion.size = indexBufferSize;
-        vkCmdCopyBuffer(commandBuffer, stagingBuffer.buffer, meshComp.indexBuffer.buffer, 1, &indexCopyRegion);
-
-        m_vkContext->endSingleTimeCommands(commandBuffer, m_vkContext->graphicsQueue, m_vkContext->commandPool);
+        // Release the old ranges if they exist (reused once no frame in flight reads them)
+        auto &geometryPool = m_vkContext->geometryPool;
+        geometryPool.free(meshComp.geometry);
 
-        // --- Cleanup Staging Buffer ---
-        stagingBuffer.destroy(m_vkContext->device);
+        // Nothing blocks here: the copies are submitted on the transfer queue with the next flush and
+        // drawFrame makes the graphics submission wait for the ticket on the device.
+        meshComp.geometry = geometryPool.allocate(vertices, indices, meshComp.uploadTicket);
 
         // --- Store Mesh Info in Component ---
         meshComp.vertexCount = static_cast<uint32_t>(vertices.size());
         meshComp.indexCount = static_cast<uint32_t>(indices.size());
+        meshComp.localMin = meshComp.localMax = vertices[0].pos;
+        for (const auto &vertex: vertices) {
+            meshComp.localMin = meshComp.localMin.cwiseMin(vertex.pos);
+            meshComp.localMax = meshComp.localMax.cwiseMax(vertex.pos);
+        }
+        // Filled in place, on_update tells observers (the entity inspector) about the new mesh
+        registry->patch<VulkanMeshComponent>(entity);
 
         // Remove the dirty flag if it exists
         registry->remove<DirtyGPUResource>(entity);
@@ -125,72 +140,164 @@ namespace Bcg{
 
 
     void RendererSystem::drawFrame() {
+        captureSnapshot(m_snapshot, false);
+        render(m_snapshot);
+    }
+
+    void RendererSystem::captureSnapshot(RenderSnapshot &snapshot, bool copyDraws) {
+        BCG_PROFILE_FUNCTION();
+        context->cameraSystem->getViews(m_cameraViews);
+        snapshot.views.clear();
+        for (const auto &cameraView: m_cameraViews) {
+            const CameraParametersComponent &camera = cameraView.camera;
+            snapshot.views.push_back({camera.viewMatrix.matrix(), camera.projectionMatrix, camera.position,
+                                      cameraView.viewport});
+        }
+
+        snapshot.fromRegistry = !copyDraws;
+        snapshot.draws.clear();
+        if (copyDraws) {
+            auto view = context->registry->view<TransformComponent, VulkanMeshComponent>();
+            for (auto entity: view) {
+                snapshot.draws.push_back({view.get<TransformComponent>(entity).cachedModelMatrix.matrix(),
+                                          view.get<VulkanMeshComponent>(entity)});
+            }
+        }
+
+        snapshot.hasUi = !m_vkContext->headless;
+        if (snapshot.hasUi) {
+            BCG_PROFILE_SCOPE("buildUI");
+            auto uiStart = std::chrono::steady_clock::now();
+            // A static UI is not built again, its draw data is only copied into snapshots that lack this version
+            context->uiManager->update();
+            snapshot.uiVersion = context->uiManager->getVersion();
+            if (copyDraws) snapshot.ui.capture(snapshot.uiVersion);
+            snapshot.uiMilliseconds = millisecondsSince(uiStart);
+        }
+    }
+
+    bool RendererSystem::render(RenderSnapshot &snapshot) {
+        BCG_PROFILE_FUNCTION();
+        m_lastFrameTimes = {};
+        m_lastFrameTimes[static_cast<size_t>(FrameMetric::Ui)] = snapshot.uiMilliseconds;
+        // The window's thread has not recreated the swapchain yet
+        if (m_swapChainRecreationRequested.load(std::memory_order_acquire)) return false;
+
         // --- Wait for Previous Frame ---
         // Wait for the fence associated with the frame we are about to render
-        VK_CHECK(
-            vkWaitForFences(m_vkContext->device, 1, &m_vkContext->inFlightFences[m_vkContext->currentFrame], VK_TRUE
-                ,
-                UINT64_MAX));
+        {
+            BCG_PROFILE_SCOPE("waitForFence");
+            auto waitStart = std::chrono::steady_clock::now();
+            VK_CHECK(vkWaitForFences(m_vkContext->device, 1, &m_vkContext->inFlightFences[m_vkContext->currentFrame],
+                                     VK_TRUE, UINT64_MAX));
+            m_lastFrameTimes[static_cast<size_t>(FrameMetric::FenceWait)] = millisecondsSince(waitStart);
+        }
 
         // --- Acquire Image from Swapchain ---
-        uint32_t imageIndex;
-        VkResult result = vkAcquireNextImageKHR(m_vkContext->device, m_vkContext->swapChain, UINT64_MAX,
-                                                m_vkContext->imageAvailableSemaphores[m_vkContext->currentFrame],
-                                                VK_NULL_HANDLE, &imageIndex);
+        // Headless there is one offscreen image per frame in flight, free once the fence was waited
+        const bool headless = m_vkContext->headless;
+        uint32_t imageIndex = m_vkContext->currentFrame;
+        VkResult result = VK_SUCCESS;
+        if (!headless) {
+            BCG_PROFILE_SCOPE("acquireImage");
+            auto acquireStart = std::chrono::steady_clock::now();
+            result = vkAcquireNextImageKHR(m_vkContext->device, m_vkContext->swapChain, UINT64_MAX,
+                                           m_vkContext->imageAvailableSemaphores[m_vkContext->currentFrame],
+                                           VK_NULL_HANDLE, &imageIndex);
+            m_lastFrameTimes[static_cast<size_t>(FrameMetric::Acquire)] = millisecondsSince(acquireStart);
+        }
 
         if (result == VK_ERROR_OUT_OF_DATE_KHR) {
             // Swapchain is outdated (e.g., window resize), recreate and try again next frame
-            m_vkContext->recreateSwapChain(context->windowManager->getGLFWHandle());
-            return;
+            requestSwapChainRecreation();
+            return false;
         } else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
             // Suboptimal is okay, but other errors are fatal
             throw std::runtime_error("Failed to acquire swap chain image!");
         }
 
+        // The simulation thread uploads, frees geometry and builds the UI under the same lock
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // --- GPU profile of the previous use of this frame ---
+        m_gpuProfiler.collect(m_vkContext->currentFrame);
+
         // --- Reset Fence ---
         // Only reset the fence if we are submitting work, ensures fence is signaled before waiting
         VK_CHECK(vkResetFences(m_vkContext->device, 1, &m_vkContext->inFlightFences[m_vkContext->currentFrame]));
 
-        // --- Update Uniform Buffers ---
-        updateUniformBuffer(m_vkContext->currentFrame); // Update UBO for the current frame in flight
+        // --- Release geometry that no frame in flight can read anymore ---
+        m_vkContext->geometryPool.beginFrame();
 
-        context->uiManager->beginFrame();
-
-        // --- Build ImGui UI --- <<< ADD (Do this in Application::mainLoop or a dedicated function)
-        // Example: Call a function in Application to build the UI
-        context->uiManager->buildUI(); // We will create this function next
-        // --- End Build ImGui UI ---
+        // --- Culling results of the previous use of this frame (before its instances are overwritten) ---
+        if (!m_instanceBuffers.empty()) {
+            const auto &instanceBuffer = m_instanceBuffers[m_vkContext->currentFrame];
+            m_gpuCulling.readback(m_vkContext->currentFrame,
+                                  static_cast<const InstanceData *>(instanceBuffer.mappedData));
+        }
 
-        context->uiManager->endFrame();
+        // --- Update Uniform Buffers ---
+        updateUniformBuffer(m_vkContext->currentFrame, snapshot); // Update UBO for the current frame in flight
+
+        // --- Pending Uploads ---
+        // Submit queued copies. The draws wait for the pool's newest upload while it is in flight, which covers every
+        // visible mesh without a pass over them (and at worst waits for a mesh that is not drawn yet).
+        auto &uploader = m_vkContext->uploader;
+        UploadTicket uploadWaitValue = 0;
+        {
+            BCG_PROFILE_SCOPE("flushUploads");
+            uploader.flush();
+            UploadTicket newest = m_vkContext->geometryPool.getNewestTicket();
+            if (newest > uploader.getCompletedTicket()) uploadWaitValue = newest;
+        }
 
         // --- Record Command Buffer ---
-        // Reuse primary command buffers if possible, or re-record each frame
-        // For simplicity here, we just allocate and record one primary CB per frame
-        // A better approach uses command buffer pools and vkResetCommandBuffer
-
-        // Allocate a command buffer for this frame
-        VkCommandBufferAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-        allocInfo.commandPool = m_vkContext->commandPool;
-        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-        allocInfo.commandBufferCount = 1;
+        // One primary command buffer per frame in flight, reset and re-recorded every frame
+        VkCommandBuffer commandBuffer = m_vkContext->commandBuffers[m_vkContext->currentFrame];
+        VK_CHECK(vkResetCommandBuffer(commandBuffer, 0));
 
-        VkCommandBuffer commandBuffer;
-        VK_CHECK(vkAllocateCommandBuffers(m_vkContext->device, &allocInfo, &commandBuffer));
-
-        // Begin recording
         VkCommandBufferBeginInfo beginInfo{};
         beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-        beginInfo.flags = 0; // Optional flags (e.g., ONE_TIME_SUBMIT)
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
         beginInfo.pInheritanceInfo = nullptr; // Optional (for secondary command buffers)
 
         VK_CHECK(vkBeginCommandBuffer(commandBuffer, &beginInfo));
 
+        m_gpuProfiler.beginFrame(commandBuffer, m_vkContext->currentFrame, m_frameNumber);
+
+        // --- Defragment Geometry ---
+        // Copies must be recorded outside of the render pass and before the draws read the new ranges.
+        auto &geometryPool = m_vkContext->geometryPool;
+        if (geometryPool.needsCompaction()) {
+            geometryPool.compact(commandBuffer);
+            // The copy reads data that uploads wrote into the old buffers
+            uploadWaitValue = std::max(uploadWaitValue, uploader.getLastSubmittedTicket());
+        }
+
+        // --- Build Indirect Draws ---
+        uint32_t drawCount = 0;
+        {
+            BCG_PROFILE_SCOPE("buildDrawCommands");
+            drawCount = buildDrawCommands(m_vkContext->currentFrame, snapshot);
+        }
+
+        // --- Frustum Culling ---
+        // Compacts the visible draws into the indirect buffer of the culling pass, also outside of the render pass.
+        // Several views are culled on the CPU in buildDrawCommands() and recordViews() instead.
+        const bool multiView = snapshot.views.size() > 1;
+        if (!multiView && m_gpuCulling.enabled && drawCount > 0) {
+            uint32_t cullingScope = m_gpuProfiler.beginScope(commandBuffer, "Culling");
+            m_gpuCulling.record(commandBuffer, m_vkContext->currentFrame, drawCount,
+                                m_instanceBuffers[m_vkContext->currentFrame], m_frustum);
+            m_gpuProfiler.endScope(commandBuffer, cullingScope);
+        }
+
         // --- Begin Render Pass ---
         VkRenderPassBeginInfo renderPassInfo{};
         renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
         renderPassInfo.renderPass = m_vkContext->renderPass; // The render pass to begin
-        renderPassInfo.framebuffer = m_vkContext->swapChainFramebuffers[imageIndex]; // Target framebuffer
+        VkFramebuffer framebuffer = m_vkContext->swapChainFramebuffers[imageIndex];
+        renderPassInfo.framebuffer = framebuffer; // Target framebuffer
         renderPassInfo.renderArea.offset = {0, 0};
         renderPassInfo.renderArea.extent = m_vkContext->swapChainExtent;
 
@@ -200,79 +307,88 @@ namespace Bcg{
         renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
         renderPassInfo.pClearValues = clearValues.data();
 
-        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE); // Commands in primary CB
-
-        // --- Bind Pipeline and Global Descriptors ---
-        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_vkContext->graphicsPipeline);
-
-        // Bind the global descriptor set (camera UBO etc.) to set 0
-        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_vkContext->pipelineLayout,
-                                0, 1, &m_vkContext->globalDescriptorSets[m_vkContext->currentFrame],
-                                0, nullptr);
-
-
-        // --- Set Dynamic State (Viewport and Scissor) ---
-        VkViewport viewport{};
-        viewport.x = 0.0f;
-        viewport.y = 0.0f;
-        viewport.width = static_cast<float>(m_vkContext->swapChainExtent.width);
-        viewport.height = static_cast<float>(m_vkContext->swapChainExtent.height);
-        viewport.minDepth = 0.0f;
-        viewport.maxDepth = 1.0f;
-        vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
-
-        VkRect2D scissor{};
-        scissor.offset = {0, 0};
-        scissor.extent = m_vkContext->swapChainExtent;
-        vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
-
-
-        // --- Render Scene Geometry ---
-        // Iterate through entities with Transform and VulkanMesh
-        auto view = context->registry->view<TransformComponent, VulkanMeshComponent>();
-        for (auto entity: view) {
-            auto &transform = view.get<TransformComponent>(entity);
-            auto &mesh = view.get<VulkanMeshComponent>(entity);
-
-            if (mesh.vertexBuffer.buffer == VK_NULL_HANDLE || mesh.indexBuffer.buffer == VK_NULL_HANDLE || mesh.indexCount == 0)
-                continue;
-
-            // Bind vertex and index buffers
-            VkBuffer vertexBuffers[] = {mesh.vertexBuffer.buffer};
-            VkDeviceSize offsets[] = {0};
-            vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
-            vkCmdBindIndexBuffer(commandBuffer, mesh.indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
-
-            // --- Push the model matrix --- <<< UNCOMMENT THIS LINE
-            // Ensure the transform component's matrix is up-to-date if needed
-            // transform.updateModelMatrix(); // If position/rotation/scale changed
-            vkCmdPushConstants(
-                commandBuffer,
-                m_vkContext->pipelineLayout,    // Pipeline layout that defines the push constant range
-                VK_SHADER_STAGE_VERTEX_BIT,     // Stage(s) accessing the push constants
-                0,                              // Offset within the push constant block
-                sizeof(Matrix4f),              // Size of the data being pushed
-                &transform.cachedModelMatrix                // Pointer to the data (model matrix)
-            );
-            // --- End Push Constant ---
-
-            // Draw indexed geometry
-            vkCmdDrawIndexed(commandBuffer, mesh.indexCount, 1, 0, 0, 0);
+        // Both subpasses of the render pass: the scene, then the UI from its (possibly cached) secondary buffer
+        VkCommandBuffer uiCommands = snapshot.hasUi ? recordUi(m_vkContext->currentFrame, snapshot) : VK_NULL_HANDLE;
+        if (multiView) {
+            recordViews(m_vkContext->currentFrame, framebuffer, drawCount, snapshot);
+            // Only vkCmdExecuteCommands may be recorded inside the pass, the scene scope includes the UI then.
+            // No pipeline statistics: secondaries must not execute during a query without inheritedQueries.
+            uint32_t sceneScope = m_gpuProfiler.beginScope(commandBuffer, "Scene");
+            vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+            vkCmdExecuteCommands(commandBuffer, static_cast<uint32_t>(m_executedCommands.size()),
+                                 m_executedCommands.data());
+            vkCmdNextSubpass(commandBuffer, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+            if (uiCommands != VK_NULL_HANDLE) vkCmdExecuteCommands(commandBuffer, 1, &uiCommands);
+            vkCmdEndRenderPass(commandBuffer);
+            m_gpuProfiler.endScope(commandBuffer, sceneScope);
+        } else {
+            m_viewCount = 0;
+            // The scene scope includes the clears of the render pass
+            uint32_t sceneScope = m_gpuProfiler.beginScope(commandBuffer, "Scene");
+            vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE); // Commands in primary CB
+            m_gpuProfiler.beginStatistics(commandBuffer);
+
+            // --- Bind Pipeline and Global Descriptors ---
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_vkContext->graphicsPipeline);
+            BCG_COUNT(PipelineBinds, 1);
+
+            // Bind the global descriptor set (camera UBO etc.) to set 0, the GlobalUBO of the first view
+            uint32_t uniformOffset = 0;
+            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_vkContext->pipelineLayout,
+                                    0, 1, &m_vkContext->globalDescriptorSets[m_vkContext->currentFrame],
+                                    1, &uniformOffset);
+            BCG_COUNT(DescriptorBinds, 1);
+
+
+            // --- Set Dynamic State (Viewport and Scissor) ---
+            setViewport(commandBuffer, m_vkContext->swapChainExtent, Vector4f(0.0f, 0.0f, 1.0f, 1.0f));
+
+
+            // --- Render Scene Geometry ---
+            // All meshes share the pool buffers: one bind and one multi-draw-indirect call for the whole scene
+            if (drawCount > 0) {
+                VkBuffer vertexBuffers[] = {
+                    geometryPool.getVertexBuffer(), m_instanceBuffers[m_vkContext->currentFrame].buffer
+                };
+                VkDeviceSize offsets[] = {0, 0};
+                vkCmdBindVertexBuffers(commandBuffer, 0, 2, vertexBuffers, offsets);
+                vkCmdBindIndexBuffer(commandBuffer, geometryPool.getIndexBuffer(), 0, VK_INDEX_TYPE_UINT32);
+                BCG_COUNT(BufferBinds, 2);
+                BCG_COUNT(DrawCalls, 1);
+                if (m_gpuCulling.enabled) {
+                    m_gpuCulling.draw(commandBuffer, m_vkContext->currentFrame);
+                } else {
+                    vkCmdDrawIndexedIndirect(commandBuffer, m_indirectBuffers[m_vkContext->currentFrame].buffer, 0,
+                                             drawCount, sizeof(VkDrawIndexedIndirectCommand));
+                }
+            }
+            m_gpuProfiler.endStatistics(commandBuffer);
+            m_gpuProfiler.endScope(commandBuffer, sceneScope);
+
+            // --- TODO: Render Point Clouds ---
+            // Bind point cloud pipeline
+            // Iterate through PointCloudComponent entities
+            // Bind vertex buffer (positions, colors)
+            // vkCmdDraw(...)
+
+            // --- TODO: Execute Other Render Passes ---
+            // vkCmdNextSubpass(...) or vkCmdEndRenderPass() and vkCmdBeginRenderPass(...)
+
+            // --- UI Subpass and End Render Pass ---
+            if (uiCommands != VK_NULL_HANDLE) {
+                // No timestamps in a subpass of secondary command buffers, the UI scope ends after the pass
+                uint32_t uiScope = m_gpuProfiler.beginScope(commandBuffer, "UI");
+                vkCmdNextSubpass(commandBuffer, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+                vkCmdExecuteCommands(commandBuffer, 1, &uiCommands);
+                vkCmdEndRenderPass(commandBuffer);
+                m_gpuProfiler.endScope(commandBuffer, uiScope);
+            } else {
+                vkCmdNextSubpass(commandBuffer, VK_SUBPASS_CONTENTS_INLINE);
+                vkCmdEndRenderPass(commandBuffer);
+            }
         }
 
-        // --- TODO: Render Point Clouds ---
-        // Bind point cloud pipeline
-        // Iterate through PointCloudComponent entities
-        // Bind vertex buffer (positions, colors)
-        // vkCmdDraw(...)
-
-        // --- TODO: Execute Other Render Passes ---
-        // vkCmdNextSubpass(...) or vkCmdEndRenderPass() and vkCmdBeginRenderPass(...)
-
-        context->uiManager->recordDrawCommands(commandBuffer);
-
-        // --- End Render Pass ---
-        vkCmdEndRenderPass(commandBuffer);
+        m_gpuProfiler.endFrame(commandBuffer);
 
         // --- End Recording Command Buffer ---
         VK_CHECK(vkEndCommandBuffer(commandBuffer));
@@ -281,25 +397,55 @@ namespace Bcg{
         VkSubmitInfo submitInfo{};
         submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-        VkSemaphore waitSemaphores[] = {m_vkContext->imageAvailableSemaphores[m_vkContext->currentFrame]};
-        VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT}; // Wait at this stage
-        submitInfo.waitSemaphoreCount = 1;
-        submitInfo.pWaitSemaphores = waitSemaphores;
-        submitInfo.pWaitDstStageMask = waitStages;
+        // The swapchain image (not headless) and the uploads (if a visible mesh still depends on one)
+        std::array<VkSemaphore, 2> waitSemaphores{};
+        std::array<VkPipelineStageFlags, 2> waitStages{};
+        // Binary semaphores ignore their value, only the timeline entry matters
+        std::array<uint64_t, 2> waitValues{};
+        uint32_t waitCount = 0;
+        if (!headless) {
+            waitSemaphores[waitCount] = m_vkContext->imageAvailableSemaphores[m_vkContext->currentFrame];
+            waitStages[waitCount++] = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT; // Wait at this stage
+        }
+        if (uploadWaitValue > 0) {
+            waitSemaphores[waitCount] = uploader.getTimelineSemaphore();
+            // Uploaded vertex/index data is first read here (or copied by the geometry pool compaction)
+            waitStages[waitCount] = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT;
+            waitValues[waitCount++] = uploadWaitValue;
+        }
+        VkTimelineSemaphoreSubmitInfo timelineInfo{};
+        timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        timelineInfo.waitSemaphoreValueCount = waitCount;
+        timelineInfo.pWaitSemaphoreValues = waitValues.data();
+        submitInfo.pNext = &timelineInfo;
+        submitInfo.waitSemaphoreCount = waitCount;
+        submitInfo.pWaitSemaphores = waitSemaphores.data();
+        submitInfo.pWaitDstStageMask = waitStages.data();
 
         submitInfo.commandBufferCount = 1;
         submitInfo.pCommandBuffers = &commandBuffer; // Submit the recorded command buffer
 
+        // Nobody would wait for the binary semaphore when headless, it must not be signaled then
         VkSemaphore signalSemaphores[] = {m_vkContext->renderFinishedSemaphores[m_vkContext->currentFrame]};
-        submitInfo.signalSemaphoreCount = 1;
+        submitInfo.signalSemaphoreCount = headless ? 0 : 1;
         submitInfo.pSignalSemaphores = signalSemaphores; // Signal this semaphore when done
 
         // Submit to the graphics queue, signal the fence when done
-        VK_CHECK(
-            vkQueueSubmit(m_vkContext->graphicsQueue, 1, &submitInfo, m_vkContext->inFlightFences[m_vkContext->
-                currentFrame]));
+        {
+            BCG_PROFILE_SCOPE("submit");
+            VK_CHECK(vkQueueSubmit(m_vkContext->graphicsQueue, 1, &submitInfo,
+                                   m_vkContext->inFlightFences[m_vkContext->currentFrame]));
+        }
+
+        m_lastImageIndex = imageIndex;
+        ++m_frameNumber;
 
         // --- Presentation ---
+        if (headless) {
+            m_vkContext->currentFrame = (m_vkContext->currentFrame + 1) % m_vkContext->MAX_FRAMES_IN_FLIGHT;
+            return true;
+        }
+
         VkPresentInfoKHR presentInfo{};
         presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
         presentInfo.waitSemaphoreCount = 1;
@@ -311,54 +457,323 @@ namespace Bcg{
         presentInfo.pImageIndices = &imageIndex; // Index of the swapchain image to present
         presentInfo.pResults = nullptr; // Optional
 
-        result = vkQueuePresentKHR(m_vkContext->presentQueue, &presentInfo);
+        {
+            BCG_PROFILE_SCOPE("present");
+            auto presentStart = std::chrono::steady_clock::now();
+            result = vkQueuePresentKHR(m_vkContext->presentQueue, &presentInfo);
+            m_lastFrameTimes[static_cast<size_t>(FrameMetric::Present)] = millisecondsSince(presentStart);
+        }
 
-        if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || context->windowManager->m_framebufferResized) {
+        bool resized = m_framebufferResized.exchange(false, std::memory_order_relaxed);
+        if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || resized) {
             // Swapchain needs recreation (or was suboptimal)
-            context->windowManager->m_framebufferResized = false; // Reset resize flag
-            m_vkContext->recreateSwapChain(context->windowManager->getGLFWHandle());
+            requestSwapChainRecreation();
         } else if (result != VK_SUCCESS) {
             throw std::runtime_error("Failed to present swap chain image!");
         }
 
         // --- Advance Frame Index ---
         m_vkContext->currentFrame = (m_vkContext->currentFrame + 1) % m_vkContext->MAX_FRAMES_IN_FLIGHT;
-
-        // --- Free the command buffer used for this frame ---
-        // Note: A more robust system might use command buffer pools and reuse buffers.
-        // For simplicity, we allocate/free per frame.
-        //vkFreeCommandBuffers(m_vkContext->device, m_vkContext->commandPool, 1, &commandBuffer);
+        return true;
     }
 
 
-    void RendererSystem::updateUniformBuffer(uint32_t currentImage) {
-        // Get camera data from the application/camera system
-        auto camera = context->cameraSystem->getCurrentCamera();
-        if (!camera) return;
+    void RendererSystem::requestSwapChainRecreation() {
+        if (m_deferSwapChainRecreation) {
+            m_swapChainRecreationRequested.store(true, std::memory_order_release);
+        } else {
+            m_vkContext->recreateSwapChain(context->windowManager->getGLFWHandle());
+        }
+    }
 
-        CameraUtils::update(*camera);
-        const auto &view = camera->viewMatrix; // Assuming Application has getCamera()
+    bool RendererSystem::recreateSwapChainIfRequested() {
+        if (!m_swapChainRecreationRequested.load(std::memory_order_acquire)) return false;
+        // The render thread returns from render() without touching Vulkan until the flag is cleared
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_vkContext->recreateSwapChain(context->windowManager->getGLFWHandle());
+        m_swapChainRecreationRequested.store(false, std::memory_order_release);
+        return true;
+    }
 
-        GlobalUBO ubo{};
-        ubo.view = view.matrix();
-        ubo.proj = camera->projectionMatrix;
+    void RendererSystem::collectGpuFrameTimes() {
+        // currentFrame holds the oldest submission, so that frames are reported in order
+        m_gpuProfiler.collectAll(m_vkContext->currentFrame);
+    }
 
-        // Calculate camera position from view matrix (inverse)
-        ubo.cameraPos.head<3>() = camera->position;
-        ubo.cameraPos[3] = 1.0f; // Homogeneous coordinate
+    bool RendererSystem::saveLastFrame(const std::string &path) {
+        if (!m_vkContext->headless || m_frameNumber == 0) return false;
 
-        // TODO: Update light direction or other global params if needed
+        std::vector<uint8_t> pixels;
+        m_vkContext->readOffscreenImage(m_lastImageIndex, pixels);
+        const VkExtent2D &extent = m_vkContext->swapChainExtent;
+        if (!ImageUtils::writePpm(path, extent.width, extent.height, pixels)) {
+            Log::Error("[RendererSystem::saveLastFrame] Cannot write {}", path);
+            return false;
+        }
+        Log::Info("[RendererSystem::saveLastFrame] Wrote frame {} to {}", m_frameNumber - 1, path);
+        return true;
+    }
 
-        // Copy data to the mapped buffer for the current frame in flight
-        if (m_vkContext->uniformBuffers[currentImage].mappedData) {
-            memcpy(m_vkContext->uniformBuffers[currentImage].mappedData, &ubo, sizeof(ubo));
+    template<typename Function>
+    void RendererSystem::forEachDraw(const RenderSnapshot &snapshot, Function &&function) {
+        if (snapshot.fromRegistry) {
+            auto view = context->registry->view<TransformComponent, VulkanMeshComponent>();
+            for (auto entity: view) {
+                function(view.get<TransformComponent>(entity).cachedModelMatrix.matrix(),
+                         view.get<VulkanMeshComponent>(entity));
+            }
         } else {
-            // If not persistently mapped (should be in this setup, but handle just in case)
-            void *data;
-            vkMapMemory(m_vkContext->device, m_vkContext->uniformBuffers[currentImage].memory, 0, sizeof(ubo), 0,
-                        &data);
-            memcpy(data, &ubo, sizeof(ubo));
-            vkUnmapMemory(m_vkContext->device, m_vkContext->uniformBuffers[currentImage].memory);
+            for (const auto &draw: snapshot.draws) function(draw.model, draw.mesh);
+        }
+    }
+
+    uint32_t RendererSystem::buildDrawCommands(uint32_t frameIndex, const RenderSnapshot &snapshot) {
+        auto &geometryPool = m_vkContext->geometryPool;
+
+        // Upper bound of the draw count, the buffers of this frame are not in use (its fence was waited)
+        auto maxDrawCount = static_cast<uint32_t>(snapshot.fromRegistry
+                                                      ? context->registry->view<VulkanMeshComponent>().size()
+                                                      : snapshot.draws.size());
+        // Several views: one command range per view, written by recordViews() from m_drawRanges
+        const auto viewCount = static_cast<uint32_t>(snapshot.views.size());
+        const bool multiView = viewCount > 1;
+        ensureDrawBufferCapacity(frameIndex, maxDrawCount, multiView ? maxDrawCount * viewCount : maxDrawCount);
+        auto *commands = static_cast<VkDrawIndexedIndirectCommand *>(m_indirectBuffers[frameIndex].mappedData);
+        auto *instances = static_cast<InstanceData *>(m_instanceBuffers[frameIndex].mappedData);
+        // With GPU culling the commands are written by the culling pass from these
+        CullObject *objects = !multiView && m_gpuCulling.enabled ? m_gpuCulling.mapObjects(frameIndex, maxDrawCount)
+                                                                 : nullptr;
+        if (multiView) {
+            m_viewCulling.begin(m_viewProjections, maxDrawCount);
+            m_drawRanges.resize(maxDrawCount);
+        }
+
+        uint32_t drawCount = 0;
+        uint64_t triangles = 0; // Of one view, recordViews() counts the visible ones per view
+        // A snapshot may still name geometry the simulation has freed since, valid() skips it
+        forEachDraw(snapshot, [&](const Matrix4f &model, const VulkanMeshComponent &mesh) {
+            if (!geometryPool.valid(mesh.geometry) || mesh.indexCount == 0) return;
+
+            const GeometryRange &range = geometryPool.getRange(mesh.geometry);
+            instances[drawCount].model = model;
+            if (objects) {
+                CullObject &object = objects[drawCount];
+                object.boundsMin << mesh.localMin, 0.0f;
+                object.boundsMax << mesh.localMax, 0.0f;
+                object.indexCount = range.indexCount;
+                object.firstIndex = range.firstIndex;
+                object.vertexOffset = range.vertexOffset;
+            } else {
+                VkDrawIndexedIndirectCommand &command = multiView ? m_drawRanges[drawCount] : commands[drawCount];
+                command.indexCount = range.indexCount;
+                command.instanceCount = 1;
+                command.firstIndex = range.firstIndex;
+                command.vertexOffset = range.vertexOffset;
+                command.firstInstance = drawCount; // Selects the InstanceData of this draw
+                // World bounds and the rejection outside of all views once, the per view tests in recordViews()
+                if (multiView) m_viewCulling.add(drawCount, model, mesh.localMin, mesh.localMax);
+            }
+            triangles += range.indexCount / 3;
+            ++drawCount;
+        });
+        if (!multiView) BCG_COUNT(Triangles, triangles);
+        return drawCount;
+    }
+
+    void RendererSystem::ensureDrawBufferCapacity(uint32_t frameIndex, uint32_t drawCount, uint32_t commandCount) {
+        if (m_instanceBuffers.empty()) {
+            m_instanceBuffers.resize(m_vkContext->MAX_FRAMES_IN_FLIGHT);
+            m_indirectBuffers.resize(m_vkContext->MAX_FRAMES_IN_FLIGHT);
+            m_drawCapacities.resize(m_vkContext->MAX_FRAMES_IN_FLIGHT, 0);
+            m_commandCapacities.resize(m_vkContext->MAX_FRAMES_IN_FLIGHT, 0);
+        }
+        auto grow = [](uint32_t capacity, uint32_t count) {
+            capacity = std::max<uint32_t>(256, capacity);
+            while (capacity < count) capacity *= 2;
+            return capacity;
+        };
+
+        // Host visible and persistently mapped: written directly every frame
+        if (drawCount > m_drawCapacities[frameIndex]) {
+            uint32_t capacity = grow(m_drawCapacities[frameIndex], drawCount);
+            m_instanceBuffers[frameIndex].destroy(m_vkContext->device);
+            // The instances are also read by the culling pass as a storage buffer
+            m_vkContext->createBuffer(capacity * sizeof(InstanceData),
+                                      VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                      m_instanceBuffers[frameIndex]);
+            m_drawCapacities[frameIndex] = capacity;
+        }
+        if (commandCount > m_commandCapacities[frameIndex]) {
+            uint32_t capacity = grow(m_commandCapacities[frameIndex], commandCount);
+            m_indirectBuffers[frameIndex].destroy(m_vkContext->device);
+            m_vkContext->createBuffer(capacity * sizeof(VkDrawIndexedIndirectCommand),
+                                      VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+                                      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                      m_indirectBuffers[frameIndex]);
+            m_commandCapacities[frameIndex] = capacity;
+        }
+    }
+
+    VkCommandBuffer RendererSystem::beginSecondary(uint32_t frameIndex, uint32_t slot, VkFramebuffer framebuffer) {
+        SecondaryCommands &secondary = m_secondaryCommands[frameIndex * SecondarySlots + slot];
+        // The frame's fence was waited, the previous recording is not executed anymore
+        VK_CHECK(vkResetCommandPool(m_vkContext->device, secondary.pool, 0));
+
+        VkCommandBufferInheritanceInfo inheritanceInfo{};
+        inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+        inheritanceInfo.renderPass = m_vkContext->renderPass;
+        inheritanceInfo.subpass = VulkanContext::SceneSubpass;
+        inheritanceInfo.framebuffer = framebuffer;
+
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT |
+                          VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+        beginInfo.pInheritanceInfo = &inheritanceInfo;
+        VK_CHECK(vkBeginCommandBuffer(secondary.commandBuffer, &beginInfo));
+        return secondary.commandBuffer;
+    }
+
+    void RendererSystem::recordViews(uint32_t frameIndex, VkFramebuffer framebuffer, uint32_t drawCount,
+                                     const RenderSnapshot &snapshot) {
+        BCG_PROFILE_FUNCTION();
+        createSecondaryCommands();
+        if (!m_recordingPool) {
+            // The render thread records one view itself
+            m_recordingPool = std::make_unique<WorkerPool>(VulkanContext::MaxViews - 1, "Recording worker");
+        }
+
+        const auto viewCount = static_cast<uint32_t>(snapshot.views.size());
+        m_viewCount = viewCount;
+        auto *commands = static_cast<VkDrawIndexedIndirectCommand *>(m_indirectBuffers[frameIndex].mappedData);
+        const VkBuffer indirectBuffer = m_indirectBuffers[frameIndex].buffer;
+        const auto &geometryPool = m_vkContext->geometryPool;
+        VkBuffer vertexBuffers[] = {geometryPool.getVertexBuffer(), m_instanceBuffers[frameIndex].buffer};
+
+        // Every view writes only its own command range, visible count and secondary command buffer
+        m_recordingPool->parallelFor(viewCount, [&](uint32_t view) {
+            BCG_PROFILE_SCOPE("recordView");
+            VkDrawIndexedIndirectCommand *viewCommands = commands + static_cast<size_t>(view) * drawCount;
+            uint32_t visibleCount = 0;
+            uint64_t triangles = 0;
+            m_viewCulling.forEachVisible(view, [&](uint32_t draw) {
+                viewCommands[visibleCount++] = m_drawRanges[draw];
+                triangles += m_drawRanges[draw].indexCount / 3;
+            });
+            m_viewVisibleCounts[view] = visibleCount;
+            // Counted by the recording thread, summed at the end of the frame
+            BCG_COUNT(CullingTested, drawCount);
+            BCG_COUNT(CullingVisible, visibleCount);
+            BCG_COUNT(Triangles, triangles);
+
+            VkCommandBuffer commandBuffer = beginSecondary(frameIndex, view, framebuffer);
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_vkContext->graphicsPipeline);
+            auto uniformOffset = static_cast<uint32_t>(view * m_vkContext->uniformStride);
+            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_vkContext->pipelineLayout,
+                                    0, 1, &m_vkContext->globalDescriptorSets[frameIndex], 1, &uniformOffset);
+            BCG_COUNT(PipelineBinds, 1);
+            BCG_COUNT(DescriptorBinds, 1);
+            setViewport(commandBuffer, m_vkContext->swapChainExtent, snapshot.views[view].viewport);
+            if (visibleCount > 0) {
+                VkDeviceSize offsets[] = {0, 0};
+                vkCmdBindVertexBuffers(commandBuffer, 0, 2, vertexBuffers, offsets);
+                vkCmdBindIndexBuffer(commandBuffer, geometryPool.getIndexBuffer(), 0, VK_INDEX_TYPE_UINT32);
+                BCG_COUNT(BufferBinds, 2);
+                BCG_COUNT(DrawCalls, 1);
+                vkCmdDrawIndexedIndirect(commandBuffer, indirectBuffer,
+                                         static_cast<VkDeviceSize>(view) * drawCount *
+                                         sizeof(VkDrawIndexedIndirectCommand),
+                                         visibleCount, sizeof(VkDrawIndexedIndirectCommand));
+            }
+            VK_CHECK(vkEndCommandBuffer(commandBuffer));
+        });
+
+        m_executedCommands.clear();
+        for (uint32_t view = 0; view < viewCount; ++view) {
+            m_executedCommands.push_back(m_secondaryCommands[frameIndex * SecondarySlots + view].commandBuffer);
+        }
+    }
+
+    void RendererSystem::createSecondaryCommands() {
+        if (!m_secondaryCommands.empty()) return;
+        m_secondaryCommands.resize(m_vkContext->MAX_FRAMES_IN_FLIGHT * SecondarySlots);
+        for (auto &secondary: m_secondaryCommands) {
+            VkCommandPoolCreateInfo poolInfo{};
+            poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+            poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT; // Reset as a whole on every recording
+            poolInfo.queueFamilyIndex = m_vkContext->queueFamilyIndices.graphicsFamily.value();
+            VK_CHECK(vkCreateCommandPool(m_vkContext->device, &poolInfo, nullptr, &secondary.pool));
+
+            VkCommandBufferAllocateInfo allocInfo{};
+            allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocInfo.commandPool = secondary.pool;
+            allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+            allocInfo.commandBufferCount = 1;
+            VK_CHECK(vkAllocateCommandBuffers(m_vkContext->device, &allocInfo, &secondary.commandBuffer));
+        }
+        m_uiVersions.assign(m_vkContext->MAX_FRAMES_IN_FLIGHT, 0);
+    }
+
+    VkCommandBuffer RendererSystem::recordUi(uint32_t frameIndex, const RenderSnapshot &snapshot) {
+        createSecondaryCommands();
+        SecondaryCommands &secondary = m_secondaryCommands[frameIndex * SecondarySlots + UiSlot];
+        ++m_uiFrames;
+        // Unchanged since the slot's last recording: no upload of the draw data and no recording
+        if (snapshot.uiVersion != 0 && m_uiVersions[frameIndex] == snapshot.uiVersion) return secondary.commandBuffer;
+
+        BCG_PROFILE_FUNCTION();
+        // The frame's fence was waited, the previous recording is not executed anymore
+        VK_CHECK(vkResetCommandPool(m_vkContext->device, secondary.pool, 0));
+
+        VkCommandBufferInheritanceInfo inheritanceInfo{};
+        inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+        inheritanceInfo.renderPass = m_vkContext->renderPass;
+        inheritanceInfo.subpass = VulkanContext::OverlaySubpass;
+        inheritanceInfo.framebuffer = VK_NULL_HANDLE; // Executed with every swapchain image
+
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        // Not one-time: executed again by the frames in this slot until the UI changes
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+        beginInfo.pInheritanceInfo = &inheritanceInfo;
+        VK_CHECK(vkBeginCommandBuffer(secondary.commandBuffer, &beginInfo));
+        // Over all views, the ImGui backend sets its own viewport and uploads the vertices and indices
+        context->uiManager->recordDrawCommands(secondary.commandBuffer, snapshot.fromRegistry ? ImGui::GetDrawData()
+                                                                                              : snapshot.ui.get());
+        VK_CHECK(vkEndCommandBuffer(secondary.commandBuffer));
+        m_uiVersions[frameIndex] = snapshot.uiVersion;
+        ++m_uiRecordings;
+        return secondary.commandBuffer;
+    }
+
+    void RendererSystem::updateUniformBuffer(uint32_t currentImage, const RenderSnapshot &snapshot) {
+        // Camera data captured from the camera system, one GlobalUBO per view
+        m_viewProjections.clear();
+        auto *mapped = static_cast<uint8_t *>(m_vkContext->uniformBuffers[currentImage].mappedData);
+        const size_t viewCount = std::min<size_t>(snapshot.views.size(), VulkanContext::MaxViews);
+        for (size_t i = 0; i < viewCount; ++i) {
+            const RenderView &view = snapshot.views[i];
+            GlobalUBO ubo{};
+            ubo.view = view.view;
+            ubo.proj = view.projection;
+
+            ubo.cameraPos.head<3>() = view.cameraPosition;
+            ubo.cameraPos[3] = 1.0f; // Homogeneous coordinate
+
+            // Culling planes, used by the culling pass on the GPU and as its CPU reference
+            m_viewProjections.push_back(ubo.proj * ubo.view);
+            Frustum frustum = FrustumUtils::extract(m_viewProjections.back());
+            for (int plane = 0; plane < 6; ++plane) {
+                ubo.frustumPlanes[plane] = frustum.planes[plane];
+            }
+            if (i == 0) m_frustum = frustum;
+
+            // TODO: Update light direction or other global params if needed
+
+            // Copy data to the mapped buffer for the current frame in flight
+            // (host visible memory is persistently mapped by the allocator, the block must not be mapped twice)
+            memcpy(mapped + i * m_vkContext->uniformStride, &ubo, sizeof(ubo));
         }
     }
 }
@@ -5,9 +5,21 @@
 #ifndef RENDERER_H
 #define RENDERER_H
 
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+
 #include "System.h"
 #include "VulkanContext.h"
 #include "ShaderData.h"
+#include "GpuCulling.h"
+#include "GpuProfiler.h"
+#include "FrameStats.h"
+#include "RenderSnapshot.h"
+#include "CameraSystem.h"
+#include "ViewCulling.h"
+#include "WorkerPool.h"
 
 namespace Bcg{
     struct VulkanContext;
@@ -20,10 +32,57 @@ namespace Bcg{
 
         void shutdown() override;
 
+        // Single-threaded: captures the frame from the registry and renders it
         void drawFrame();
 
+        // Simulation thread: camera matrices of the views, the UI (the ImGui frame is built here) and, if copyDraws,
+        // the meshes of the registry. Without copyDraws the snapshot refers to the registry and ImGui's own draw data.
+        void captureSnapshot(RenderSnapshot &snapshot, bool copyDraws);
+
+        // Render thread: waits for the frame in flight, records, submits and presents the snapshot. Everything after
+        // the fence wait and the image acquire runs under getMutex(). False if no frame was submitted.
+        bool render(RenderSnapshot &snapshot);
+
+        // Serializes the render thread with simulation thread code that uploads or frees geometry, builds the UI
+        // or otherwise uses the Vulkan context
+        std::mutex &getMutex() { return m_mutex; }
+
+        // Threaded the swapchain (which queries the GLFW window) is recreated on the window's thread: render() only
+        // requests it and skips frames until recreateSwapChainIfRequested() was called there
+        void setDeferSwapChainRecreation(bool defer) { m_deferSwapChainRecreation = defer; }
+
+        bool recreateSwapChainIfRequested();
+
+        void notifyFramebufferResized() { m_framebufferResized.store(true, std::memory_order_relaxed); }
+
         VulkanContext *getVulkanContext();
 
+        GpuCulling &getGpuCulling() { return m_gpuCulling; }
+
+        // Views of the last multi-view frame (0 after a single view frame) and their visible draws
+        uint32_t getViewCount() const { return m_viewCount; }
+
+        uint32_t getViewVisibleCount(uint32_t view) const { return m_viewVisibleCounts[view]; }
+
+        // Frames that rendered a UI and those that recorded (and uploaded) it instead of reusing the recording
+        uint64_t getUiFrameCount() const { return m_uiFrames; }
+
+        uint64_t getUiRecordCount() const { return m_uiRecordings; }
+
+        // Number of the next frame drawFrame() submits, counts from 0
+        uint64_t getFrameNumber() const { return m_frameNumber; }
+
+        GpuProfiler &getGpuProfiler() { return m_gpuProfiler; }
+
+        // Host side waits of the last drawFrame() in milliseconds (fence wait, acquire, present), CPU is left 0
+        const FrameTimes &getLastFrameTimes() const { return m_lastFrameTimes; }
+
+        // Collects the GPU profiles of all submitted frames, the device must be idle
+        void collectGpuFrameTimes();
+
+        // Headless only: writes the image of the last submitted frame as PPM, waits for the device to be idle
+        bool saveLastFrame(const std::string &path);
+
         // Called by Application or Systems to upload data
         void uploadMesh(entt::entity entity, const std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices);
 
@@ -34,9 +93,81 @@ namespace Bcg{
     private:
         void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex);
 
-        void updateUniformBuffer(uint32_t currentImage); // Update global uniforms (camera)
+        // Global uniforms (camera) of every view
+        void updateUniformBuffer(uint32_t currentImage, const RenderSnapshot &snapshot);
+
+        // Fills the instance data and either the indirect commands, the input of the GPU culling pass or (several
+        // views) the shared CPU culling, returns the number of draws (before culling)
+        uint32_t buildDrawCommands(uint32_t frameIndex, const RenderSnapshot &snapshot);
+
+        // Several views: culls and records every view into its own secondary command buffer on the recording
+        // workers, listed in m_executedCommands
+        void recordViews(uint32_t frameIndex, VkFramebuffer framebuffer, uint32_t drawCount,
+                         const RenderSnapshot &snapshot);
+
+        // Begins the secondary command buffer of a view's slot inside the scene subpass
+        VkCommandBuffer beginSecondary(uint32_t frameIndex, uint32_t slot, VkFramebuffer framebuffer);
+
+        // Pools and command buffers of all slots, on first use
+        void createSecondaryCommands();
+
+        // Secondary command buffer of the UI for the overlay subpass. Recorded once per UI version and frame in
+        // flight and then executed again while the UI is static, without uploading its draw data.
+        VkCommandBuffer recordUi(uint32_t frameIndex, const RenderSnapshot &snapshot);
+
+        // Calls function(const Matrix4f &model, const VulkanMeshComponent &mesh) for every draw of the snapshot
+        template<typename Function>
+        void forEachDraw(const RenderSnapshot &snapshot, Function &&function);
+
+        void requestSwapChainRecreation();
+
+        // Room for drawCount instances and commandCount indirect commands
+        void ensureDrawBufferCapacity(uint32_t frameIndex, uint32_t drawCount, uint32_t commandCount);
 
         VulkanContext *m_vkContext;
+
+        // Per frame in flight
+        std::vector<AllocatedBuffer> m_instanceBuffers; // InstanceData, vertex binding 1
+        std::vector<AllocatedBuffer> m_indirectBuffers; // VkDrawIndexedIndirectCommand, several views: one range each
+        std::vector<uint32_t> m_drawCapacities;
+        std::vector<uint32_t> m_commandCapacities;
+
+        GpuCulling m_gpuCulling;
+        Frustum m_frustum; // Of the first view, updated with the uniform buffer
+
+        // Several views: culled once on the CPU for all of them, each view is recorded by its own thread into a
+        // secondary command buffer. Slots MaxViews + 1 per frame in flight, the last one records the UI.
+        static constexpr uint32_t SecondarySlots = VulkanContext::MaxViews + 1;
+        static constexpr uint32_t UiSlot = VulkanContext::MaxViews;
+        struct SecondaryCommands {
+            VkCommandPool pool = VK_NULL_HANDLE; // One per slot, pools are not thread safe
+            VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        };
+        std::vector<SecondaryCommands> m_secondaryCommands;
+        std::vector<uint64_t> m_uiVersions; // UI version recorded into the UI slot per frame in flight, 0 for none
+        uint64_t m_uiFrames = 0; // Frames with a UI, and those that recorded it
+        uint64_t m_uiRecordings = 0;
+        std::vector<VkCommandBuffer> m_executedCommands; // Of the frame being recorded
+        std::unique_ptr<WorkerPool> m_recordingPool; // Created with the first multi-view frame
+        std::vector<Matrix4f> m_viewProjections; // Updated with the uniform buffer
+        ViewCulling m_viewCulling;
+        std::vector<VkDrawIndexedIndirectCommand> m_drawRanges; // Command of draw i, firstInstance = i
+        uint32_t m_viewCount = 0;
+        std::array<uint32_t, VulkanContext::MaxViews> m_viewVisibleCounts{};
+
+        GpuProfiler m_gpuProfiler; // Scopes: Culling, Scene, UI (+ Uploads on the transfer queue)
+
+        FrameTimes m_lastFrameTimes{};
+
+        uint64_t m_frameNumber = 0;
+        uint32_t m_lastImageIndex = 0;
+
+        RenderSnapshot m_snapshot; // Of drawFrame(), refers to the registry
+        std::vector<CameraView> m_cameraViews; // Of captureSnapshot()
+        std::mutex m_mutex;
+        bool m_deferSwapChainRecreation = false;
+        std::atomic<bool> m_swapChainRecreationRequested{false};
+        std::atomic<bool> m_framebufferResized{false};
     };
 }
 
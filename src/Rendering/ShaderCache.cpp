@@ -0,0 +1,234 @@
+//
+// Created by alex on 4/30/25.
+//
+
+#include "ShaderCache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <string_view>
+
+#include "Logger.h"
+
+namespace Bcg {
+    namespace {
+        constexpr uint32_t SpirvMagic = 0x07230203;
+
+        // FNV-1a, 64 bit
+        constexpr uint64_t FnvOffsetBasis = 0xcbf29ce484222325ull;
+        constexpr uint64_t FnvPrime = 0x100000001b3ull;
+
+        void hashBytes(uint64_t &hash, const void *data, size_t size) {
+            const auto *bytes = static_cast<const unsigned char *>(data);
+            for (size_t i = 0; i < size; ++i) {
+                hash ^= bytes[i];
+                hash *= FnvPrime;
+            }
+        }
+
+        void hashString(uint64_t &hash, const std::string &value) {
+            // Length first, so that concatenations of different fields cannot collide
+            uint64_t size = value.size();
+            hashBytes(hash, &size, sizeof(size));
+            hashBytes(hash, value.data(), value.size());
+        }
+
+        bool readFile(const std::filesystem::path &path, std::string &content) {
+            std::ifstream file(path, std::ios::binary);
+            if (!file.is_open()) return false;
+            std::ostringstream stream;
+            stream << file.rdbuf();
+            content = stream.str();
+            return true;
+        }
+
+        // Module or file names referenced by `import a.b;`, `__include "x.slang";` and `#include "x"`
+        std::vector<std::string> parseDependencies(const std::string &source) {
+            std::vector<std::string> dependencies;
+            std::istringstream stream(source);
+            std::string line;
+            while (std::getline(stream, line)) {
+                size_t start = line.find_first_not_of(" \t");
+                if (start == std::string::npos) continue;
+                std::string_view text(line.c_str() + start, line.size() - start);
+
+                std::string_view rest;
+                bool isModule = false;
+                for (const char *keyword: {"import ", "__include ", "#include "}) {
+                    std::string_view prefix(keyword);
+                    if (text.substr(0, prefix.size()) == prefix) {
+                        rest = text.substr(prefix.size());
+                        isModule = prefix != "#include ";
+                        break;
+                    }
+                }
+                if (rest.empty()) continue;
+
+                size_t begin = rest.find_first_not_of(" \t");
+                if (begin == std::string_view::npos) continue;
+                rest = rest.substr(begin);
+                if (rest.front() == '"') {
+                    size_t end = rest.find('"', 1);
+                    if (end != std::string_view::npos) dependencies.emplace_back(rest.substr(1, end - 1));
+                } else if (isModule) {
+                    size_t end = rest.find_first_of("; \t");
+                    std::string module(rest.substr(0, end));
+                    std::replace(module.begin(), module.end(), '.', '/');
+                    dependencies.push_back(module + ".slang");
+                }
+            }
+            return dependencies;
+        }
+
+        std::filesystem::path resolve(const std::string &name, const std::filesystem::path &includingDirectory,
+                                      const std::filesystem::path &rootDirectory) {
+            std::string dashed = name;
+            std::replace(dashed.begin(), dashed.end(), '_', '-'); // Slang maps module_name to module-name.slang
+            for (const auto &directory: {includingDirectory, rootDirectory}) {
+                for (const auto &candidate: {name, dashed}) {
+                    std::filesystem::path path = directory / candidate;
+                    std::error_code error;
+                    if (std::filesystem::is_regular_file(path, error)) return path.lexically_normal();
+                }
+            }
+            return {};
+        }
+
+        // Hashes the file and, depth first in source order, everything it imports. Every file is visited once.
+        void hashSourceTree(uint64_t &hash, const std::filesystem::path &path, const std::filesystem::path &root,
+                            std::set<std::filesystem::path> &visited) {
+            if (!visited.insert(path).second) return;
+
+            std::string source;
+            if (!readFile(path, source)) {
+                hashString(hash, "<unreadable>" + path.generic_string());
+                return;
+            }
+            hashString(hash, path.filename().generic_string());
+            hashString(hash, source);
+
+            for (const auto &dependency: parseDependencies(source)) {
+                std::filesystem::path resolved = resolve(dependency, path.parent_path(), root);
+                if (resolved.empty()) {
+                    // Built-in module or not found, only the name can contribute
+                    hashString(hash, "<unresolved>" + dependency);
+                    continue;
+                }
+                hashSourceTree(hash, resolved, root, visited);
+            }
+        }
+    }
+
+    void ShaderCache::init(const std::string &directory, const std::string &compilerVersion) {
+        m_directory = directory;
+        m_compilerVersion = compilerVersion;
+        std::error_code error;
+        std::filesystem::create_directories(m_directory, error);
+        if (error) {
+            Log::Warn("[ShaderCache::init] Cannot create {}: {}. Shaders will not be cached.", m_directory,
+                      error.message());
+            m_directory.clear();
+        }
+    }
+
+    uint64_t ShaderCache::computeKey(const std::string &shaderPath, const std::string &entryPoint, int stage,
+                                     const std::string &variantKey) const {
+        std::filesystem::path path = std::filesystem::path(shaderPath).lexically_normal();
+        std::error_code error;
+        if (!std::filesystem::is_regular_file(path, error)) return 0;
+
+        uint64_t hash = FnvOffsetBasis;
+        hashString(hash, m_compilerVersion);
+        hashString(hash, entryPoint);
+        hashBytes(hash, &stage, sizeof(stage));
+        hashString(hash, variantKey);
+        std::set<std::filesystem::path> visited;
+        hashSourceTree(hash, path, path.parent_path(), visited);
+        return hash != 0 ? hash : 1;
+    }
+
+    bool ShaderCache::load(uint64_t key, std::vector<uint32_t> &spirv) const {
+        if (key == 0) return false;
+        {
+            std::lock_guard<std::mutex> lock(m_memoryMutex);
+            auto it = m_memory.find(key);
+            if (it != m_memory.end()) {
+                spirv = it->second;
+                return true;
+            }
+        }
+        if (m_directory.empty()) return false;
+
+        std::string content;
+        if (!readFile(entryPath(key), content)) return false;
+        if (content.size() < sizeof(uint32_t) || content.size() % sizeof(uint32_t) != 0) {
+            Log::Warn("[ShaderCache::load] Ignoring corrupt entry {}.", entryPath(key));
+            return false;
+        }
+        spirv.resize(content.size() / sizeof(uint32_t));
+        std::copy(content.begin(), content.end(), reinterpret_cast<char *>(spirv.data()));
+        if (spirv[0] != SpirvMagic) {
+            Log::Warn("[ShaderCache::load] Ignoring entry without SPIR-V magic {}.", entryPath(key));
+            spirv.clear();
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(m_memoryMutex);
+        m_memory[key] = spirv;
+        return true;
+    }
+
+    void ShaderCache::store(uint64_t key, const std::vector<uint32_t> &spirv) const {
+        if (key == 0 || spirv.empty()) return;
+        {
+            std::lock_guard<std::mutex> lock(m_memoryMutex);
+            m_memory[key] = spirv;
+        }
+        if (m_directory.empty()) return;
+
+        // Write to a temporary file and rename, a crash or a concurrent instance never leaves a partial entry
+        std::string path = entryPath(key);
+        std::string temporaryPath = path + ".tmp";
+        {
+            std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+            if (!file.is_open()) {
+                Log::Warn("[ShaderCache::store] Cannot write {}.", temporaryPath);
+                return;
+            }
+            file.write(reinterpret_cast<const char *>(spirv.data()),
+                       static_cast<std::streamsize>(spirv.size() * sizeof(uint32_t)));
+        }
+        std::error_code error;
+        std::filesystem::rename(temporaryPath, path, error);
+        if (error) {
+            Log::Warn("[ShaderCache::store] Cannot move {} into place: {}.", temporaryPath, error.message());
+            std::filesystem::remove(temporaryPath, error);
+        }
+    }
+
+    void ShaderCache::recordHit(double milliseconds) {
+        std::lock_guard<std::mutex> lock(m_statsMutex);
+        ++m_stats.hits;
+        m_stats.hitMilliseconds += milliseconds;
+    }
+
+    void ShaderCache::recordMiss(double milliseconds) {
+        std::lock_guard<std::mutex> lock(m_statsMutex);
+        ++m_stats.misses;
+        m_stats.missMilliseconds += milliseconds;
+    }
+
+    ShaderCacheStats ShaderCache::getStats() const {
+        std::lock_guard<std::mutex> lock(m_statsMutex);
+        return m_stats;
+    }
+
+    std::string ShaderCache::entryPath(uint64_t key) const {
+        char name[32];
+        std::snprintf(name, sizeof(name), "%016llx.spv", static_cast<unsigned long long>(key));
+        return (std::filesystem::path(m_directory) / name).string();
+    }
+}
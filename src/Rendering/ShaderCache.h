@@ -0,0 +1,61 @@
+//
+// Created by alex on 4/30/25.
+//
+
+#ifndef SHADERCACHE_H
+#define SHADERCACHE_H
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Bcg {
+    struct ShaderCacheStats {
+        uint32_t hits = 0;
+        uint32_t misses = 0;
+        double hitMilliseconds = 0.0; // Time spent hashing and loading on hits
+        double missMilliseconds = 0.0; // Time spent compiling (including the Slang session) on misses
+    };
+
+    // On-disk cache of compiled SPIR-V. The key covers everything the output depends on: the source file, all
+    // of its transitive imports/includes, the entry point, the stage, the variant constants and the compiler
+    // version. Entries are plain .spv files named after the key, so stale ones are never hit and can simply be
+    // deleted. Loaded and stored entries are also kept in memory, switching back to a variant does not touch the
+    // disk again. Thread safe.
+    class ShaderCache {
+    public:
+        static constexpr const char *DefaultDirectory = "shader_cache";
+
+        void init(const std::string &directory, const std::string &compilerVersion);
+
+        // Returns 0 if the source file cannot be read.
+        uint64_t computeKey(const std::string &shaderPath, const std::string &entryPoint, int stage,
+                            const std::string &variantKey = {}) const;
+
+        bool load(uint64_t key, std::vector<uint32_t> &spirv) const;
+
+        void store(uint64_t key, const std::vector<uint32_t> &spirv) const;
+
+        void recordHit(double milliseconds);
+
+        void recordMiss(double milliseconds);
+
+        ShaderCacheStats getStats() const;
+
+        const std::string &getDirectory() const { return m_directory; }
+
+    private:
+        std::string entryPath(uint64_t key) const;
+
+        std::string m_directory;
+        std::string m_compilerVersion;
+        ShaderCacheStats m_stats;
+        mutable std::mutex m_statsMutex;
+        mutable std::unordered_map<uint64_t, std::vector<uint32_t> > m_memory;
+        mutable std::mutex m_memoryMutex;
+    };
+}
+
+#endif //SHADERCACHE_H
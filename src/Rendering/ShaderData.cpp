@@ -6,7 +6,7 @@
 
 namespace Bcg {
 
-    VkVertexInputBindingDescription Vertex::getBindingDescription() {
+    VkVertexInputBindingDescription getVertexBindingDescription() {
         VkVertexInputBindingDescription bindingDescription{};
         bindingDescription.binding = 0; // Binding index
         bindingDescription.stride = sizeof(Vertex);
@@ -14,7 +14,7 @@ namespace Bcg {
         return bindingDescription;
     }
 
-    std::array<VkVertexInputAttributeDescription, 4> Vertex::getAttributeDescriptions() {
+    std::array<VkVertexInputAttributeDescription, 4> getVertexAttributeDescriptions() {
         std::array<VkVertexInputAttributeDescription, 4> attributeDescriptions{};
 
         // Position
@@ -44,4 +44,26 @@ namespace Bcg {
 
         return attributeDescriptions;
     }
-}
\ No newline at end of file
+
+    VkVertexInputBindingDescription InstanceData::getBindingDescription() {
+        VkVertexInputBindingDescription bindingDescription{};
+        bindingDescription.binding = 1; // Binding index, binding 0 holds the vertices
+        bindingDescription.stride = sizeof(InstanceData);
+        bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE; // Per-draw data
+        return bindingDescription;
+    }
+
+    std::array<VkVertexInputAttributeDescription, 4> InstanceData::getAttributeDescriptions() {
+        std::array<VkVertexInputAttributeDescription, 4> attributeDescriptions{};
+
+        // Model matrix columns, layout(location = 4..7) in shader
+        for (uint32_t i = 0; i < 4; ++i) {
+            attributeDescriptions[i].binding = 1;
+            attributeDescriptions[i].location = 4 + i;
+            attributeDescriptions[i].format = VK_FORMAT_R32G32B32A32_SFLOAT; // vec4
+            attributeDescriptions[i].offset = offsetof(InstanceData, model) + i * sizeof(Vector4f);
+        }
+
+        return attributeDescriptions;
+    }
+}
@@ -5,8 +5,10 @@
 #ifndef SHADERDATA_H
 #define SHADERDATA_H
 
+#include <array>
 #include <vulkan/vulkan.h>
 #include "MatVec.h"
+#include "Vertex.h"
 
 namespace Bcg{
     // Structure for Global Uniform Buffer Object
@@ -16,62 +18,33 @@ namespace Bcg{
         // Add light direction, camera position etc. if needed
         Vector4f lightDir = Vector4f(0.5f, -1.0f, 0.3f, 0.0f); // w=0 for directional
         Vector4f cameraPos;
+        Vector4f frustumPlanes[6]; // World space, see FrustumUtils::extract (read by shaders/cull.slang)
     };
 
-    struct Vertex {
-        Vector3f pos;
-        Vector3f normal;
-        Vector2f texCoord;
-        Vector3f color; // Optional: can be derived or default
+    // Vertex input of Vertex (binding 0, locations 0-3), free functions so that Vertex.h needs no Vulkan headers
+    VkVertexInputBindingDescription getVertexBindingDescription();
 
-        static VkVertexInputBindingDescription getBindingDescription();
+    std::array<VkVertexInputAttributeDescription, 4> getVertexAttributeDescriptions();
 
-        static std::array<VkVertexInputAttributeDescription, 4> getAttributeDescriptions();
+    // Per-draw data, fetched with VK_VERTEX_INPUT_RATE_INSTANCE at the firstInstance of each indirect command
+    struct InstanceData {
+        Matrix4f model; // Column major, one float4 attribute per column
 
-        bool operator==(const Vertex &other) const {
-            return pos == other.pos && normal == other.normal && texCoord == other.texCoord && color == other.color;
-        }
-    };
-}// namespace Bcg
+        static VkVertexInputBindingDescription getBindingDescription();
 
-namespace std {
-    template<>
-    struct hash<Bcg::Vector3f> {
-        size_t operator()(const Bcg::Vector3f &vec) const noexcept {
-            size_t seed = 0;
-            for (int i = 0; i < vec.size(); ++i) {
-                seed ^= std::hash<float>()(vec[i]) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
-            }
-            return seed;
-        }
+        static std::array<VkVertexInputAttributeDescription, 4> getAttributeDescriptions();
     };
 
-    template<>
-    struct hash<Bcg::Vector2f> {
-        size_t operator()(const Bcg::Vector2f &vec) const noexcept {
-            size_t seed = 0;
-            for (int i = 0; i < vec.size(); ++i) {
-                seed ^= std::hash<float>()(vec[i]) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
-            }
-            return seed;
-        }
+    // Input of the culling compute shader, one per draw (std430, matches CullObject in shaders/cull.slang).
+    // The model matrix is read from the InstanceData of the same index.
+    struct CullObject {
+        Vector4f boundsMin; // Object space AABB, w unused
+        Vector4f boundsMax;
+        uint32_t indexCount = 0;
+        uint32_t firstIndex = 0;
+        int32_t vertexOffset = 0;
+        uint32_t padding = 0;
     };
+}// namespace Bcg
 
-    template<>
-    struct hash<Bcg::Vertex> {
-        size_t operator()(Bcg::Vertex const &vertex) const noexcept {
-            size_t h1 = hash<Bcg::Vector3f>()(vertex.pos);
-            size_t h2 = hash<Bcg::Vector3f>()(vertex.normal);
-            size_t h3 = hash<Bcg::Vector2f>()(vertex.texCoord);
-            size_t h4 = hash<Bcg::Vector3f>()(vertex.color);
-            // Combine hashes (boost::hash_combine style)
-            size_t seed = 0;
-            seed ^= h1 + 0x9e3779b9 + (seed << 6) + (seed >> 2);
-            seed ^= h2 + 0x9e3779b9 + (seed << 6) + (seed >> 2);
-            seed ^= h3 + 0x9e3779b9 + (seed << 6) + (seed >> 2);
-            seed ^= h4 + 0x9e3779b9 + (seed << 6) + (seed >> 2);
-            return seed;
-        }
-    };
-} // namespace std
 #endif //SHADERDATA_H
@@ -0,0 +1,50 @@
+//
+// Created by alex on 5/1/25.
+//
+
+#include "ShaderVariant.h"
+
+#include <algorithm>
+
+namespace Bcg {
+    ShaderVariant &ShaderVariant::set(const std::string &name, int value) {
+        auto it = std::lower_bound(m_constants.begin(), m_constants.end(), name,
+                                   [](const auto &constant, const std::string &key) { return constant.first < key; });
+        if (it != m_constants.end() && it->first == name) {
+            it->second = value;
+        } else {
+            m_constants.insert(it, {name, value});
+        }
+        return *this;
+    }
+
+    int ShaderVariant::get(const std::string &name, int fallback) const {
+        for (const auto &[constant, value]: m_constants) {
+            if (constant == name) return value;
+        }
+        return fallback;
+    }
+
+    std::string ShaderVariant::key() const {
+        std::string result;
+        for (const auto &[name, value]: m_constants) {
+            result += name + "=" + std::to_string(value) + ";";
+        }
+        return result;
+    }
+
+    std::string ShaderVariant::constantsSource() const {
+        std::string source;
+        for (const auto &[name, value]: m_constants) {
+            source += "export static const int " + name + " = " + std::to_string(value) + ";\n";
+        }
+        return source;
+    }
+
+    ShaderVariant ShaderVariant::mesh(LightingModel lighting, bool vertexColors) {
+        ShaderVariant variant;
+        variant.set("kLightingModel", static_cast<int>(lighting));
+        variant.set("kVertexColors", vertexColors ? 1 : 0);
+        return variant;
+    }
+}
@@ -0,0 +1,44 @@
+//
+// Created by alex on 5/1/25.
+//
+
+#ifndef SHADERVARIANT_H
+#define SHADERVARIANT_H
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Bcg {
+    // Values of the mesh shader's kLightingModel constant (shaders/simple.slang)
+    enum class LightingModel : int {
+        Unlit = 0,
+        Lambert = 1,
+        BlinnPhong = 2
+    };
+
+    // Values for the `extern static const int` link-time constants of a Slang shader. The compiler links them into
+    // the entry point, so branches on them are resolved at compile time and each variant gets its own lean SPIR-V.
+    // A shader must get a value for every constant it declares, shaders without constants use an empty variant.
+    class ShaderVariant {
+    public:
+        ShaderVariant &set(const std::string &name, int value);
+
+        int get(const std::string &name, int fallback = 0) const;
+
+        bool empty() const { return m_constants.empty(); }
+
+        // Canonical "name=value;..." string (sorted by name), identifies the variant in the shader caches.
+        std::string key() const;
+
+        // Slang source of the module exporting the constants, linked together with the shader module.
+        std::string constantsSource() const;
+
+        static ShaderVariant mesh(LightingModel lighting, bool vertexColors);
+
+    private:
+        std::vector<std::pair<std::string, int> > m_constants; // Sorted by name
+    };
+}
+
+#endif //SHADERVARIANT_H
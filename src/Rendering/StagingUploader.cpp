@@ -0,0 +1,334 @@
+//
+// Created by alex on 4/27/25.
+//
+
+#include "StagingUploader.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "VulkanContext.h"
+#include "Logger.h"
+#include "PerfCounters.h"
+
+namespace Bcg {
+    namespace {
+        // Keeps every copy source offset aligned for vkCmdCopyBuffer and optimalBufferCopyOffsetAlignment
+        constexpr VkDeviceSize RingAlignment = 16;
+
+        inline VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+            return (value + alignment - 1) & ~(alignment - 1);
+        }
+    }
+
+    void StagingUploader::init(VulkanContext *context, VkDeviceSize ringSize) {
+        m_context = context;
+        m_ringSize = alignUp(ringSize, RingAlignment);
+        m_queue = context->transferQueue;
+        m_commandPool = context->transferCommandPool;
+
+        VkSemaphoreTypeCreateInfo timelineInfo{};
+        timelineInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+        timelineInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+        timelineInfo.initialValue = 0;
+
+        VkSemaphoreCreateInfo semaphoreInfo{};
+        semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        semaphoreInfo.pNext = &timelineInfo;
+        VK_CHECK(vkCreateSemaphore(context->device, &semaphoreInfo, nullptr, &m_timeline));
+
+        context->createBuffer(m_ringSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                              VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, m_ring);
+        if (!m_ring.mappedData) {
+            throw std::runtime_error("Staging ring memory is not mapped!");
+        }
+
+        m_head = 0;
+        m_usedBytes = 0;
+        m_lastSubmitted = 0;
+        createTimestampQueries();
+        Log::Info("[StagingUploader::init] {} MiB staging ring on queue family {}.", m_ringSize / (1024 * 1024),
+                  context->queueFamilyIndices.transferFamily.value());
+    }
+
+    void StagingUploader::cleanup() {
+        if (!m_context) return;
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        VkDevice device = m_context->device;
+        if (m_batchCommandBuffer != VK_NULL_HANDLE) {
+            // Recorded but never submitted, nothing on the device depends on it
+            VK_CHECK(vkEndCommandBuffer(m_batchCommandBuffer));
+            m_freeCommandBuffers.push_back(m_batchCommandBuffer);
+            m_batchCommandBuffer = VK_NULL_HANDLE;
+            m_batchTimestampSlot = NoTimestampSlot; // Never written, the query pool is destroyed below
+        }
+        if (!m_inFlight.empty()) {
+            VkSemaphoreWaitInfo waitInfo{};
+            waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+            waitInfo.semaphoreCount = 1;
+            waitInfo.pSemaphores = &m_timeline;
+            waitInfo.pValues = &m_lastSubmitted;
+            VK_CHECK(vkWaitSemaphores(device, &waitInfo, UINT64_MAX));
+        }
+        retireCompleted();
+
+        if (!m_freeCommandBuffers.empty()) {
+            vkFreeCommandBuffers(device, m_commandPool, static_cast<uint32_t>(m_freeCommandBuffers.size()),
+                                 m_freeCommandBuffers.data());
+            m_freeCommandBuffers.clear();
+        }
+        m_ring.destroy(device);
+        if (m_timestampPool != VK_NULL_HANDLE) {
+            vkDestroyQueryPool(device, m_timestampPool, nullptr);
+            m_timestampPool = VK_NULL_HANDLE;
+        }
+        if (m_timeline != VK_NULL_HANDLE) {
+            vkDestroySemaphore(device, m_timeline, nullptr);
+            m_timeline = VK_NULL_HANDLE;
+        }
+        m_context = nullptr;
+    }
+
+    UploadTicket StagingUploader::uploadBuffer(VkBuffer dst, VkDeviceSize dstOffset, const void *data,
+                                               VkDeviceSize size) {
+        if (size == 0) return 0;
+        BCG_COUNT(UploadBytes, size);
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // Large uploads are split so that a single copy never needs more than a quarter of the ring
+        const VkDeviceSize maxChunk = std::max<VkDeviceSize>(RingAlignment, m_ringSize / 4);
+        const char *src = static_cast<const char *>(data);
+        VkDeviceSize copied = 0;
+        while (copied < size) {
+            VkDeviceSize chunk = std::min(size - copied, maxChunk);
+            VkDeviceSize ringOffset = allocateRing(chunk);
+            std::memcpy(static_cast<char *>(m_ring.mappedData) + ringOffset, src + copied, chunk);
+
+            if (m_batchCommandBuffer == VK_NULL_HANDLE) beginBatch();
+            VkBufferCopy region{};
+            region.srcOffset = ringOffset;
+            region.dstOffset = dstOffset + copied;
+            region.size = chunk;
+            vkCmdCopyBuffer(m_batchCommandBuffer, m_ring.buffer, dst, 1, &region);
+            copied += chunk;
+        }
+        // The recording batch signals the next timeline value
+        return m_lastSubmitted + 1;
+    }
+
+    UploadTicket StagingUploader::flush() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return flushLocked();
+    }
+
+    bool StagingUploader::isComplete(UploadTicket ticket) const {
+        return ticket == 0 || getCompletedTicket() >= ticket;
+    }
+
+    UploadTicket StagingUploader::getCompletedTicket() const {
+        uint64_t value = 0;
+        VK_CHECK(vkGetSemaphoreCounterValue(m_context->device, m_timeline, &value));
+        return value;
+    }
+
+    void StagingUploader::wait(UploadTicket ticket) {
+        if (ticket == 0) return;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (ticket > m_lastSubmitted) flushLocked();
+        }
+        VkSemaphoreWaitInfo waitInfo{};
+        waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+        waitInfo.semaphoreCount = 1;
+        waitInfo.pSemaphores = &m_timeline;
+        waitInfo.pValues = &ticket;
+        VK_CHECK(vkWaitSemaphores(m_context->device, &waitInfo, UINT64_MAX));
+    }
+
+    UploadTicket StagingUploader::getLastSubmittedTicket() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_lastSubmitted;
+    }
+
+    VkDeviceSize StagingUploader::getBytesInFlight() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_usedBytes;
+    }
+
+    double StagingUploader::takeGpuMilliseconds() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        // Batches are otherwise only retired when the ring needs space
+        retireCompleted();
+        double milliseconds = m_completedGpuMilliseconds;
+        m_completedGpuMilliseconds = 0.0;
+        return milliseconds;
+    }
+
+    void StagingUploader::createTimestampQueries() {
+        uint32_t family = m_context->queueFamilyIndices.transferFamily.value();
+        uint32_t familyCount = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(m_context->physicalDevice, &familyCount, nullptr);
+        std::vector<VkQueueFamilyProperties> families(familyCount);
+        vkGetPhysicalDeviceQueueFamilyProperties(m_context->physicalDevice, &familyCount, families.data());
+        if (families[family].timestampValidBits == 0 || !m_context->hostQueryReset) {
+            Log::Info("[StagingUploader::createTimestampQueries] Upload batches are not timed.");
+            return;
+        }
+
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(m_context->physicalDevice, &properties);
+        m_timestampPeriod = properties.limits.timestampPeriod;
+
+        VkQueryPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        poolInfo.queryCount = 2 * TimestampSlots;
+        VK_CHECK(vkCreateQueryPool(m_context->device, &poolInfo, nullptr, &m_timestampPool));
+        vkResetQueryPool(m_context->device, m_timestampPool, 0, poolInfo.queryCount);
+
+        m_freeTimestampSlots.clear();
+        for (uint32_t slot = TimestampSlots; slot > 0; --slot) m_freeTimestampSlots.push_back(slot - 1);
+        m_completedGpuMilliseconds = 0.0;
+    }
+
+    void StagingUploader::readTimestamps(uint32_t slot) {
+        // The batch signaled its ticket, the results are available without stalling
+        uint64_t timestamps[2] = {};
+        VkResult result = vkGetQueryPoolResults(m_context->device, m_timestampPool, slot * 2, 2, sizeof(timestamps),
+                                                timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+        if (result == VK_SUCCESS && timestamps[1] >= timestamps[0]) {
+            m_completedGpuMilliseconds += static_cast<double>(timestamps[1] - timestamps[0]) * m_timestampPeriod *
+                                          1e-6;
+        }
+        vkResetQueryPool(m_context->device, m_timestampPool, slot * 2, 2);
+        m_freeTimestampSlots.push_back(slot);
+    }
+
+    VkDeviceSize StagingUploader::allocateRing(VkDeviceSize size) {
+        size = alignUp(size, RingAlignment);
+        while (true) {
+            retireCompleted();
+            if (m_usedBytes == 0) m_head = 0;
+
+            // The used region is [tail, head) modulo the ring size, so all free bytes start at head.
+            VkDeviceSize freeBytes = m_ringSize - m_usedBytes;
+            VkDeviceSize untilEnd = m_ringSize - m_head;
+            if (std::min(untilEnd, freeBytes) >= size) {
+                VkDeviceSize offset = m_head;
+                m_head = (m_head + size) % m_ringSize;
+                m_usedBytes += size;
+                m_batchConsumedBytes += size;
+                return offset;
+            }
+            if (untilEnd < size && freeBytes >= untilEnd + size) {
+                // Skip the tail end of the ring and continue at the front
+                m_usedBytes += untilEnd + size;
+                m_batchConsumedBytes += untilEnd + size;
+                m_head = size;
+                return 0;
+            }
+
+            // Ring is full: submit what we have and block on the oldest batch until space is released.
+            if (m_inFlight.empty()) {
+                if (m_batchCommandBuffer == VK_NULL_HANDLE) {
+                    throw std::runtime_error("StagingUploader: upload does not fit into the staging ring!");
+                }
+                flushLocked();
+            }
+            Log::Warn("[StagingUploader::allocateRing] Staging ring full ({} bytes in flight), waiting.",
+                      m_usedBytes);
+            waitOldest();
+        }
+    }
+
+    void StagingUploader::beginBatch() {
+        // m_batchConsumedBytes already counts the ring range of the first copy, it is reset on submission
+        m_batchCommandBuffer = acquireCommandBuffer();
+
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        VK_CHECK(vkBeginCommandBuffer(m_batchCommandBuffer, &beginInfo));
+
+        if (m_timestampPool != VK_NULL_HANDLE && !m_freeTimestampSlots.empty()) {
+            m_batchTimestampSlot = m_freeTimestampSlots.back();
+            m_freeTimestampSlots.pop_back();
+            vkCmdWriteTimestamp(m_batchCommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_timestampPool,
+                                m_batchTimestampSlot * 2);
+        }
+    }
+
+    UploadTicket StagingUploader::flushLocked() {
+        if (m_batchCommandBuffer == VK_NULL_HANDLE) return m_lastSubmitted;
+
+        if (m_batchTimestampSlot != NoTimestampSlot) {
+            vkCmdWriteTimestamp(m_batchCommandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_timestampPool,
+                                m_batchTimestampSlot * 2 + 1);
+        }
+        VK_CHECK(vkEndCommandBuffer(m_batchCommandBuffer));
+
+        UploadTicket ticket = m_lastSubmitted + 1;
+        VkTimelineSemaphoreSubmitInfo timelineInfo{};
+        timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        timelineInfo.signalSemaphoreValueCount = 1;
+        timelineInfo.pSignalSemaphoreValues = &ticket;
+
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.pNext = &timelineInfo;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &m_batchCommandBuffer;
+        submitInfo.signalSemaphoreCount = 1;
+        submitInfo.pSignalSemaphores = &m_timeline;
+        VK_CHECK(vkQueueSubmit(m_queue, 1, &submitInfo, VK_NULL_HANDLE));
+
+        m_inFlight.push_back({m_batchCommandBuffer, ticket, m_batchConsumedBytes, m_batchTimestampSlot});
+        m_lastSubmitted = ticket;
+        m_batchCommandBuffer = VK_NULL_HANDLE;
+        m_batchConsumedBytes = 0;
+        m_batchTimestampSlot = NoTimestampSlot;
+        return ticket;
+    }
+
+    void StagingUploader::retireCompleted() {
+        if (m_inFlight.empty()) return;
+        UploadTicket value = getCompletedTicket();
+        while (!m_inFlight.empty() && m_inFlight.front().ticket <= value) {
+            m_usedBytes -= m_inFlight.front().consumedBytes;
+            if (m_inFlight.front().timestampSlot != NoTimestampSlot) readTimestamps(m_inFlight.front().timestampSlot);
+            m_freeCommandBuffers.push_back(m_inFlight.front().commandBuffer);
+            m_inFlight.pop_front();
+        }
+    }
+
+    void StagingUploader::waitOldest() {
+        if (m_inFlight.empty()) return;
+        VkSemaphoreWaitInfo waitInfo{};
+        waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+        waitInfo.semaphoreCount = 1;
+        waitInfo.pSemaphores = &m_timeline;
+        waitInfo.pValues = &m_inFlight.front().ticket;
+        VK_CHECK(vkWaitSemaphores(m_context->device, &waitInfo, UINT64_MAX));
+    }
+
+    VkCommandBuffer StagingUploader::acquireCommandBuffer() {
+        if (!m_freeCommandBuffers.empty()) {
+            VkCommandBuffer commandBuffer = m_freeCommandBuffers.back();
+            m_freeCommandBuffers.pop_back();
+            VK_CHECK(vkResetCommandBuffer(commandBuffer, 0));
+            return commandBuffer;
+        }
+
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = m_commandPool;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = 1;
+
+        VkCommandBuffer commandBuffer;
+        VK_CHECK(vkAllocateCommandBuffers(m_context->device, &allocInfo, &commandBuffer));
+        return commandBuffer;
+    }
+}
@@ -0,0 +1,115 @@
+//
+// Created by alex on 4/27/25.
+//
+
+#ifndef STAGINGUPLOADER_H
+#define STAGINGUPLOADER_H
+
+#include <deque>
+#include <vector>
+#include <mutex>
+
+#include "VulkanUtils.h"
+
+namespace Bcg {
+    struct VulkanContext;
+
+    // Timeline semaphore value that is signaled once the upload is visible on the device. 0 = nothing to wait for.
+    using UploadTicket = uint64_t;
+
+    // Streams data to device local buffers through one persistently mapped staging ring. Copies are batched and
+    // submitted on the transfer queue (graphics queue if the device has none); completion is tracked with a
+    // timeline semaphore so neither the caller nor the graphics queue ever has to wait idle.
+    class StagingUploader {
+    public:
+        static constexpr VkDeviceSize DefaultRingSize = 32ull * 1024 * 1024;
+
+        void init(VulkanContext *context, VkDeviceSize ringSize = DefaultRingSize);
+
+        void cleanup();
+
+        // Copies data into the ring and records a copy into dst. Returns the ticket of the batch it belongs to,
+        // the batch is submitted on the next flush().
+        UploadTicket uploadBuffer(VkBuffer dst, VkDeviceSize dstOffset, const void *data, VkDeviceSize size);
+
+        // Submits all pending copies. Returns the ticket of the submitted batch (or the last ticket if empty).
+        UploadTicket flush();
+
+        bool isComplete(UploadTicket ticket) const;
+
+        // Newest ticket the device has finished, every ticket <= this value is complete.
+        UploadTicket getCompletedTicket() const;
+
+        // Blocks the calling thread until the ticket is signaled, flushing first if it is still pending.
+        void wait(UploadTicket ticket);
+
+        VkSemaphore getTimelineSemaphore() const { return m_timeline; }
+
+        UploadTicket getLastSubmittedTicket() const;
+
+        VkDeviceSize getBytesInFlight() const;
+
+        // Device time of the batches that completed since the last call. Every batch is enclosed in timestamps
+        // if the transfer queue supports them (and hostQueryReset), otherwise this is always 0.
+        double takeGpuMilliseconds();
+
+        bool isTimed() const { return m_timestampPool != VK_NULL_HANDLE; }
+
+    private:
+        struct Submission {
+            VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+            UploadTicket ticket = 0;
+            VkDeviceSize consumedBytes = 0; // Ring bytes, including padding skipped when wrapping
+            uint32_t timestampSlot = NoTimestampSlot;
+        };
+
+        // Batches in flight beyond this are not timed
+        static constexpr uint32_t TimestampSlots = 64;
+        static constexpr uint32_t NoTimestampSlot = ~0u;
+
+        void createTimestampQueries();
+
+        void readTimestamps(uint32_t slot);
+
+        VkDeviceSize allocateRing(VkDeviceSize size);
+
+        void beginBatch();
+
+        UploadTicket flushLocked();
+
+        void retireCompleted();
+
+        void waitOldest();
+
+        VkCommandBuffer acquireCommandBuffer();
+
+        VulkanContext *m_context = nullptr;
+        VkQueue m_queue = VK_NULL_HANDLE;
+        VkCommandPool m_commandPool = VK_NULL_HANDLE;
+        VkSemaphore m_timeline = VK_NULL_HANDLE;
+
+        AllocatedBuffer m_ring;
+        VkDeviceSize m_ringSize = 0;
+        VkDeviceSize m_head = 0;
+        VkDeviceSize m_usedBytes = 0;
+
+        // Batch currently being recorded
+        VkCommandBuffer m_batchCommandBuffer = VK_NULL_HANDLE;
+        VkDeviceSize m_batchConsumedBytes = 0;
+        uint32_t m_batchTimestampSlot = NoTimestampSlot;
+
+        // Two queries per slot, reset on the host once read
+        VkQueryPool m_timestampPool = VK_NULL_HANDLE;
+        double m_timestampPeriod = 0.0; // Nanoseconds per tick
+        std::vector<uint32_t> m_freeTimestampSlots;
+        double m_completedGpuMilliseconds = 0.0;
+
+        UploadTicket m_lastSubmitted = 0;
+        std::deque<Submission> m_inFlight;
+        std::vector<VkCommandBuffer> m_freeCommandBuffers;
+
+        mutable std::mutex m_mutex;
+    };
+}
+
+#endif //STAGINGUPLOADER_H
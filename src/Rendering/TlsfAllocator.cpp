@@ -0,0 +1,262 @@
+//
+// Created by alex on 4/26/25.
+//
+
+#include "TlsfAllocator.h"
+
+#include <algorithm>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace Bcg {
+    namespace {
+        inline uint32_t findLastSet(uint64_t value) {
+#ifdef _MSC_VER
+            unsigned long index;
+            _BitScanReverse64(&index, value);
+            return static_cast<uint32_t>(index);
+#else
+            return 63u - static_cast<uint32_t>(__builtin_clzll(value));
+#endif
+        }
+
+        inline uint32_t findFirstSet(uint64_t value) {
+#ifdef _MSC_VER
+            unsigned long index;
+            _BitScanForward64(&index, value);
+            return static_cast<uint32_t>(index);
+#else
+            return static_cast<uint32_t>(__builtin_ctzll(value));
+#endif
+        }
+
+        inline uint64_t alignUp(uint64_t value, uint64_t alignment) {
+            return alignment > 1 ? (value + alignment - 1) & ~(alignment - 1) : value;
+        }
+    }
+
+    TlsfAllocator::TlsfAllocator(uint64_t capacity) {
+        reset(capacity);
+    }
+
+    void TlsfAllocator::reset(uint64_t capacity) {
+        m_capacity = capacity;
+        m_usedBytes = 0;
+        m_allocationCount = 0;
+        m_flBitmap = 0;
+        m_slBitmaps.fill(0);
+        for (auto &heads: m_freeHeads) {
+            heads.fill(InvalidNode);
+        }
+        m_nodes.clear();
+        m_unusedNodes.clear();
+
+        if (capacity == 0) return;
+
+        uint32_t root = createNode();
+        m_nodes[root].offset = 0;
+        m_nodes[root].size = capacity;
+        insertFree(root);
+    }
+
+    TlsfAllocator::Allocation TlsfAllocator::allocate(uint64_t size, uint64_t alignment) {
+        if (size == 0 || size > m_capacity) return {};
+
+        // Searching for size + alignment - 1 guarantees that the aligned range fits into the found node.
+        uint64_t searchSize = size + (alignment > 1 ? alignment - 1 : 0);
+        uint32_t nodeIndex = findFreeNode(searchSize);
+        if (nodeIndex == InvalidNode) return {};
+
+        removeFree(nodeIndex);
+
+        uint64_t alignedOffset = alignUp(m_nodes[nodeIndex].offset, alignment);
+        uint64_t padding = alignedOffset - m_nodes[nodeIndex].offset;
+        if (padding > 0) {
+            // Give the alignment padding back as its own free node in front of the allocation.
+            uint32_t front = createNode();
+            Node &frontNode = m_nodes[front];
+            Node &node = m_nodes[nodeIndex];
+            frontNode.offset = node.offset;
+            frontNode.size = padding;
+            frontNode.prevPhysical = node.prevPhysical;
+            frontNode.nextPhysical = nodeIndex;
+            if (node.prevPhysical != InvalidNode) {
+                m_nodes[node.prevPhysical].nextPhysical = front;
+            }
+            node.prevPhysical = front;
+            node.offset = alignedOffset;
+            node.size -= padding;
+            insertFree(front);
+        }
+
+        uint64_t remaining = m_nodes[nodeIndex].size - size;
+        if (remaining > 0) {
+            uint32_t back = createNode();
+            Node &backNode = m_nodes[back];
+            Node &node = m_nodes[nodeIndex];
+            backNode.offset = node.offset + size;
+            backNode.size = remaining;
+            backNode.prevPhysical = nodeIndex;
+            backNode.nextPhysical = node.nextPhysical;
+            if (node.nextPhysical != InvalidNode) {
+                m_nodes[node.nextPhysical].prevPhysical = back;
+            }
+            node.nextPhysical = back;
+            node.size = size;
+            insertFree(back);
+        }
+
+        Node &node = m_nodes[nodeIndex];
+        node.free = false;
+        m_usedBytes += node.size;
+        ++m_allocationCount;
+        return {node.offset, node.size, nodeIndex};
+    }
+
+    void TlsfAllocator::free(const Allocation &allocation) {
+        if (!allocation.valid() || allocation.node >= m_nodes.size()) return;
+
+        uint32_t nodeIndex = allocation.node;
+        if (m_nodes[nodeIndex].free) return;
+
+        m_nodes[nodeIndex].free = true;
+        m_usedBytes -= m_nodes[nodeIndex].size;
+        --m_allocationCount;
+
+        // Coalesce with the physical neighbours so that no two free nodes are ever adjacent.
+        uint32_t prev = m_nodes[nodeIndex].prevPhysical;
+        if (prev != InvalidNode && m_nodes[prev].free) {
+            removeFree(prev);
+            m_nodes[prev].size += m_nodes[nodeIndex].size;
+            m_nodes[prev].nextPhysical = m_nodes[nodeIndex].nextPhysical;
+            if (m_nodes[nodeIndex].nextPhysical != InvalidNode) {
+                m_nodes[m_nodes[nodeIndex].nextPhysical].prevPhysical = prev;
+            }
+            releaseNode(nodeIndex);
+            nodeIndex = prev;
+        }
+
+        uint32_t next = m_nodes[nodeIndex].nextPhysical;
+        if (next != InvalidNode && m_nodes[next].free) {
+            removeFree(next);
+            m_nodes[nodeIndex].size += m_nodes[next].size;
+            m_nodes[nodeIndex].nextPhysical = m_nodes[next].nextPhysical;
+            if (m_nodes[next].nextPhysical != InvalidNode) {
+                m_nodes[m_nodes[next].nextPhysical].prevPhysical = nodeIndex;
+            }
+            releaseNode(next);
+        }
+
+        insertFree(nodeIndex);
+    }
+
+    TlsfAllocator::Stats TlsfAllocator::getStats() const {
+        Stats stats;
+        stats.capacity = m_capacity;
+        stats.usedBytes = m_usedBytes;
+        stats.freeBytes = m_capacity - m_usedBytes;
+        stats.allocationCount = m_allocationCount;
+
+        for (uint32_t fl = 0; fl < FL_COUNT; ++fl) {
+            if (!(m_flBitmap & (1ull << fl))) continue;
+            for (uint32_t sl = 0; sl < SL_COUNT; ++sl) {
+                for (uint32_t node = m_freeHeads[fl][sl]; node != InvalidNode; node = m_nodes[node].nextFree) {
+                    stats.largestFreeRange = std::max(stats.largestFreeRange, m_nodes[node].size);
+                    ++stats.freeRangeCount;
+                }
+            }
+        }
+        return stats;
+    }
+
+    void TlsfAllocator::mapping(uint64_t size, uint32_t &fl, uint32_t &sl) {
+        if (size < SL_COUNT) {
+            // Small sizes are kept in a linear first-level bucket
+            fl = 0;
+            sl = static_cast<uint32_t>(size);
+        } else {
+            uint32_t msb = findLastSet(size);
+            sl = static_cast<uint32_t>(size >> (msb - SL_LOG2)) ^ SL_COUNT;
+            fl = msb - SL_LOG2 + 1;
+        }
+    }
+
+    uint32_t TlsfAllocator::findFreeNode(uint64_t size) const {
+        // Round the request up to the next second-level class so that every node of that class fits.
+        if (size >= SL_COUNT) {
+            size += (1ull << (findLastSet(size) - SL_LOG2)) - 1;
+        }
+
+        uint32_t fl, sl;
+        mapping(size, fl, sl);
+        if (fl >= FL_COUNT) return InvalidNode;
+
+        uint32_t slMap = m_slBitmaps[fl] & (~0u << sl);
+        if (slMap == 0) {
+            if (fl + 1 >= FL_COUNT) return InvalidNode;
+            uint64_t flMap = m_flBitmap & (~0ull << (fl + 1));
+            if (flMap == 0) return InvalidNode;
+            fl = findFirstSet(flMap);
+            slMap = m_slBitmaps[fl];
+        }
+        sl = findFirstSet(slMap);
+        return m_freeHeads[fl][sl];
+    }
+
+    void TlsfAllocator::insertFree(uint32_t nodeIndex) {
+        Node &node = m_nodes[nodeIndex];
+        uint32_t fl, sl;
+        mapping(node.size, fl, sl);
+
+        node.free = true;
+        node.prevFree = InvalidNode;
+        node.nextFree = m_freeHeads[fl][sl];
+        if (node.nextFree != InvalidNode) {
+            m_nodes[node.nextFree].prevFree = nodeIndex;
+        }
+        m_freeHeads[fl][sl] = nodeIndex;
+        m_flBitmap |= 1ull << fl;
+        m_slBitmaps[fl] |= 1u << sl;
+    }
+
+    void TlsfAllocator::removeFree(uint32_t nodeIndex) {
+        Node &node = m_nodes[nodeIndex];
+        uint32_t fl, sl;
+        mapping(node.size, fl, sl);
+
+        if (node.prevFree != InvalidNode) {
+            m_nodes[node.prevFree].nextFree = node.nextFree;
+        } else {
+            m_freeHeads[fl][sl] = node.nextFree;
+        }
+        if (node.nextFree != InvalidNode) {
+            m_nodes[node.nextFree].prevFree = node.prevFree;
+        }
+        node.prevFree = node.nextFree = InvalidNode;
+
+        if (m_freeHeads[fl][sl] == InvalidNode) {
+            m_slBitmaps[fl] &= ~(1u << sl);
+            if (m_slBitmaps[fl] == 0) {
+                m_flBitmap &= ~(1ull << fl);
+            }
+        }
+    }
+
+    uint32_t TlsfAllocator::createNode() {
+        if (!m_unusedNodes.empty()) {
+            uint32_t node = m_unusedNodes.back();
+            m_unusedNodes.pop_back();
+            m_nodes[node] = Node{};
+            return node;
+        }
+        m_nodes.emplace_back();
+        return static_cast<uint32_t>(m_nodes.size() - 1);
+    }
+
+    void TlsfAllocator::releaseNode(uint32_t nodeIndex) {
+        m_nodes[nodeIndex] = Node{};
+        m_unusedNodes.push_back(nodeIndex);
+    }
+}
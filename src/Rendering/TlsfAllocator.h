@@ -0,0 +1,101 @@
+//
+// Created by alex on 4/26/25.
+//
+
+#ifndef TLSFALLOCATOR_H
+#define TLSFALLOCATOR_H
+
+#include <cstdint>
+#include <vector>
+#include <array>
+
+namespace Bcg {
+    // Two-Level Segregated Fit range allocator. Manages offsets inside an abstract range [0, capacity)
+    // with O(1) allocate/free. It owns no memory itself, so it can back VkDeviceMemory blocks as well as
+    // ranges inside large buffers.
+    class TlsfAllocator {
+    public:
+        static constexpr uint32_t InvalidNode = ~0u;
+
+        struct Allocation {
+            uint64_t offset = 0;
+            uint64_t size = 0;
+            uint32_t node = InvalidNode;
+
+            bool valid() const { return node != InvalidNode; }
+        };
+
+        struct Stats {
+            uint64_t capacity = 0;
+            uint64_t usedBytes = 0;
+            uint64_t freeBytes = 0;
+            uint64_t largestFreeRange = 0;
+            uint32_t allocationCount = 0;
+            uint32_t freeRangeCount = 0;
+
+            // 0 = all free space is one contiguous range, towards 1 = free space is scattered
+            float fragmentation() const {
+                return freeBytes > 0 ? 1.0f - float(largestFreeRange) / float(freeBytes) : 0.0f;
+            }
+        };
+
+        explicit TlsfAllocator(uint64_t capacity = 0);
+
+        void reset(uint64_t capacity);
+
+        // Returns an invalid allocation if no free range can hold size bytes at the requested alignment.
+        Allocation allocate(uint64_t size, uint64_t alignment = 1);
+
+        void free(const Allocation &allocation);
+
+        uint64_t getCapacity() const { return m_capacity; }
+
+        uint64_t getUsedBytes() const { return m_usedBytes; }
+
+        uint32_t getAllocationCount() const { return m_allocationCount; }
+
+        bool empty() const { return m_allocationCount == 0; }
+
+        Stats getStats() const;
+
+    private:
+        static constexpr uint32_t SL_LOG2 = 4;
+        static constexpr uint32_t SL_COUNT = 1u << SL_LOG2;
+        static constexpr uint32_t FL_COUNT = 64 - SL_LOG2 + 1;
+
+        struct Node {
+            uint64_t offset = 0;
+            uint64_t size = 0;
+            uint32_t prevPhysical = InvalidNode;
+            uint32_t nextPhysical = InvalidNode;
+            uint32_t prevFree = InvalidNode;
+            uint32_t nextFree = InvalidNode;
+            bool free = false;
+        };
+
+        static void mapping(uint64_t size, uint32_t &fl, uint32_t &sl);
+
+        uint32_t findFreeNode(uint64_t size) const;
+
+        void insertFree(uint32_t node);
+
+        void removeFree(uint32_t node);
+
+        uint32_t createNode();
+
+        void releaseNode(uint32_t node);
+
+        uint64_t m_capacity = 0;
+        uint64_t m_usedBytes = 0;
+        uint32_t m_allocationCount = 0;
+
+        uint64_t m_flBitmap = 0;
+        std::array<uint32_t, FL_COUNT> m_slBitmaps{};
+        std::array<std::array<uint32_t, SL_COUNT>, FL_COUNT> m_freeHeads{};
+
+        std::vector<Node> m_nodes;
+        std::vector<uint32_t> m_unusedNodes;
+    };
+}
+
+#endif //TLSFALLOCATOR_H
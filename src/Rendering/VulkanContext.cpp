@@ -4,36 +4,56 @@
 
 #include <iostream>
 #include <set>
+#include <algorithm>
 #include <array>
 #include <fstream>
 #include <sstream>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <cstring>
 
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 
 #include <imgui.h>
 #include <backends/imgui_impl_vulkan.h>
+#include <slang/slang-com-ptr.h>
 
 #include "VulkanContext.h"
 #include "Logger.h"
+#include "Profiler.h"
 #include "ShaderData.h"
 
 
 namespace Bcg {
     void VulkanContext::init(GLFWwindow *window) {
+        auto initStart = std::chrono::steady_clock::now();
         initVulkan(window);
         setupDebugMessenger();
-        createSurface(window);
+        if (!headless) createSurface(window);
         pickPhysicalDevice();
         createLogicalDevice();
-        initSlang(); // Needs logical device
-        initCuda(); // Needs logical device/physical device info
-        createSwapChain(window);
+        memoryAllocator.init(physicalDevice, device);
+        // Slang itself is only initialized on the first shader cache miss
+        shaderCache.init(ShaderCache::DefaultDirectory, spGetBuildTagString());
+        dumpSpirv = std::getenv("BCG_DUMP_SPIRV") != nullptr;
+        serialPipelineJobs = std::getenv("BCG_SERIAL_PIPELINES") != nullptr;
+        ignorePipelineCache = std::getenv("BCG_NO_PIPELINE_CACHE") != nullptr;
+        createPipelineCache();
+        if (headless) {
+            createOffscreenImages(); // swapChainExtent was set by initHeadless
+        } else {
+            createSwapChain(window);
+        }
         createImageViews();
         createRenderPass();
         createDescriptorSetLayout(); // Before pipeline
-        createGraphicsPipeline();
+        // Compiles on a worker while the rest is created, RendererSystem waits with finishPipelineJobs()
+        enqueuePipelineJob("Mesh pipeline", [this]() { createGraphicsPipeline(); });
         createCommandPools();
+        uploader.init(this); // Needs the transfer command pool
+        geometryPool.init(this); // Uploads through the uploader
         createDepthResources();
         createFramebuffers();
         createUniformBuffers();
@@ -41,11 +61,23 @@ namespace Bcg {
         createDescriptorSets();
         createSyncObjects();
 
-        initImGui(); // <<< ADD Init ImGui pool etc.
-        uploadImGuiFonts(); // <<< ADD Upload fonts after init
+        initMilliseconds = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - initStart).count();
+        Log::Info("[VulkanContext::init] Initialized in {:.1f} ms ({} pipeline jobs still running).", initMilliseconds,
+                  m_pipelineJobs.size());
+    }
+
+    void VulkanContext::initHeadless(uint32_t width, uint32_t height) {
+        headless = true;
+        swapChainExtent = {width, height};
+        init(nullptr);
     }
 
     void VulkanContext::cleanup() {
+        // Nothing may be destroyed under a running pipeline job
+        for (auto &job: m_pipelineJobs) job.milliseconds.wait();
+        m_pipelineJobs.clear();
+
         cleanupImGui(); // Cleans ImGui resources
         cleanupSwapChain(); // Cleans swapchain-dependent resources
 
@@ -99,6 +131,10 @@ namespace Bcg {
         // Command Buffers are implicitly freed by destroying the pool
         commandBuffers.clear(); // Just clear the vector
 
+        // Waits for outstanding uploads, frees its command buffers and the staging ring
+        uploader.cleanup();
+        geometryPool.cleanup();
+
         // Destroy command pools
         if (commandPool != VK_NULL_HANDLE) {
             vkDestroyCommandPool(device, commandPool, nullptr);
@@ -109,7 +145,15 @@ namespace Bcg {
             transferCommandPool = VK_NULL_HANDLE;
         }
 
-        // Cleanup Slang
+        savePipelineCache();
+        if (pipelineCache != VK_NULL_HANDLE) {
+            vkDestroyPipelineCache(device, pipelineCache, nullptr);
+            pipelineCache = VK_NULL_HANDLE;
+        }
+
+        // Cleanup Slang, the modules belong to the session
+        slangModules.clear();
+        slangConstantModules.clear();
         if (slangSession) slangSession->release();
         if (slangGlobalSession) slangGlobalSession->release();
         slangSession = nullptr;
@@ -121,6 +165,12 @@ namespace Bcg {
             CUDA_CHECK(cudaStreamDestroy(cudaStream));
         cudaStream = nullptr;
 
+        // Release the memory blocks (all buffers and images must be destroyed by now)
+        if (device != VK_NULL_HANDLE) {
+            memoryAllocator.logStats();
+            memoryAllocator.cleanup();
+        }
+
         // --- Destroy logical device --- (Happens AFTER cleaning dependent objects)
         if (device != VK_NULL_HANDLE) {
             Log::Info("[VulkanContext::cleanup] Destroying Vulkan Logical Device...");
@@ -187,6 +237,11 @@ namespace Bcg {
         }
         swapChainImageViews.clear();
 
+        // Headless targets (their views were destroyed above with the swapchain views)
+        for (auto &image: offscreenImages) image.destroy(device);
+        offscreenImages.clear();
+        if (headless) swapChainImages.clear();
+
         // Destroy swapchain itself
         if (swapChain != VK_NULL_HANDLE) {
             vkDestroySwapchainKHR(device, swapChain, nullptr);
@@ -340,6 +395,9 @@ namespace Bcg {
         if (queueFamilyIndices.computeFamily.has_value()) {
             uniqueQueueFamilies.insert(queueFamilyIndices.computeFamily.value());
         }
+        if (queueFamilyIndices.transferFamily.has_value()) {
+            uniqueQueueFamilies.insert(queueFamilyIndices.transferFamily.value());
+        }
 
 
         float queuePriority = 1.0f;
@@ -352,17 +410,31 @@ namespace Bcg {
             queueCreateInfos.push_back(queueCreateInfo);
         }
 
+        // Optional features the profilers use if available
+        VkPhysicalDeviceVulkan12Features supported12{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES};
+        VkPhysicalDeviceFeatures2 supported{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2};
+        supported.pNext = &supported12;
+        vkGetPhysicalDeviceFeatures2(physicalDevice, &supported);
+        pipelineStatisticsQuery = supported.features.pipelineStatisticsQuery == VK_TRUE;
+        hostQueryReset = supported12.hostQueryReset == VK_TRUE;
+
         VkPhysicalDeviceFeatures deviceFeatures{}; // Enable features needed, e.g., samplerAnisotropy
         // vkGetPhysicalDeviceFeatures(physicalDevice, &deviceFeatures); // Query defaults if needed
         deviceFeatures.samplerAnisotropy = VK_TRUE; // Example feature
         deviceFeatures.geometryShader = VK_FALSE; // Example: disabling a feature
         deviceFeatures.wideLines = VK_TRUE; // Example: Needed for line width > 1.0f
         deviceFeatures.fillModeNonSolid = VK_TRUE; // Example: Needed for wireframe
+        deviceFeatures.multiDrawIndirect = VK_TRUE; // All meshes in one vkCmdDrawIndexedIndirect
+        deviceFeatures.drawIndirectFirstInstance = VK_TRUE; // firstInstance selects the per-draw InstanceData
+        deviceFeatures.pipelineStatisticsQuery = pipelineStatisticsQuery ? VK_TRUE : VK_FALSE;
 
 
         // Vulkan 1.2 Features (Example: buffer device address)
         VkPhysicalDeviceVulkan12Features features12{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES};
         features12.bufferDeviceAddress = VK_TRUE; // Example: If using buffer device addresses
+        features12.timelineSemaphore = VK_TRUE; // Upload tickets of the StagingUploader
+        features12.drawIndirectCount = VK_TRUE; // GPU culling writes the draw count
+        features12.hostQueryReset = hostQueryReset ? VK_TRUE : VK_FALSE; // Upload timestamps
 
         // Vulkan 1.1 Features (Example: external memory for CUDA interop)
         VkPhysicalDeviceVulkan11Features features11{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_1_FEATURES};
@@ -378,8 +450,9 @@ namespace Bcg {
         features11.pNext = &features12;
         // Add more feature structs here if needed (e.g., Ray Tracing)
 
-        createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-        createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+        std::vector<const char *> extensions = getRequiredDeviceExtensions();
+        createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+        createInfo.ppEnabledExtensionNames = extensions.data();
 
         // Device layers (deprecated, use instance layers)
         if (enableValidationLayers) {
@@ -402,6 +475,16 @@ namespace Bcg {
             computeQueue = graphicsQueue;
             queueFamilyIndices.computeFamily = queueFamilyIndices.graphicsFamily;
         }
+        if (queueFamilyIndices.transferFamily.has_value()) {
+            vkGetDeviceQueue(device, queueFamilyIndices.transferFamily.value(), 0, &transferQueue);
+        } else {
+            // Fallback: Uploads go through the graphics queue
+            transferQueue = graphicsQueue;
+            queueFamilyIndices.transferFamily = queueFamilyIndices.graphicsFamily;
+        }
+        Log::Info("[VulkanContext::createLogicalDevice] Queue families: graphics {}, present {}, compute {}, transfer {}",
+                  queueFamilyIndices.graphicsFamily.value(), queueFamilyIndices.presentFamily.value(),
+                  queueFamilyIndices.computeFamily.value(), queueFamilyIndices.transferFamily.value());
     }
 
     void VulkanContext::initSlang() {
@@ -433,15 +516,28 @@ namespace Bcg {
         Log::Info("[VulkanContext::initSlang] Slang session created.");
     }
 
+    void VulkanContext::initUi() {
+        // There is no UI without a window
+        if (headless) return;
+        initImGui(); // <<< ADD Init ImGui pool etc.
+        uploadImGuiFonts(); // <<< ADD Upload fonts after init
+    }
+
+    cudaStream_t VulkanContext::getCudaStream() {
+        std::call_once(m_cudaInitialized, [this]() { initCuda(); });
+        return cudaStream;
+    }
+
     void VulkanContext::initCuda() {
         // --- Basic CUDA Initialization ---
         // This part is minimal. Real integration requires Vulkan-CUDA interop setup
         // using external memory/semaphores.
 
+        // Machines without an NVIDIA driver (e.g. CI on lavapipe) report an error here, CUDA is optional
         int deviceCount = 0;
-        CUDA_CHECK(cudaGetDeviceCount(&deviceCount));
-        if (deviceCount == 0) {
-            Log::Warn("[VulkanContext::initCuda] No CUDA-capable devices found.");
+        cudaError_t error = cudaGetDeviceCount(&deviceCount);
+        if (error != cudaSuccess || deviceCount == 0) {
+            Log::Warn("[VulkanContext::initCuda] No CUDA-capable devices found ({}).", cudaGetErrorString(error));
             return;
         }
 
@@ -496,12 +592,16 @@ namespace Bcg {
         init_info.Device = device;
         init_info.QueueFamily = queueFamilyIndices.graphicsFamily.value();
         init_info.Queue = graphicsQueue;
-        init_info.PipelineCache = VK_NULL_HANDLE; // Optional
+        init_info.PipelineCache = pipelineCache;
         init_info.DescriptorPool = imguiDescriptorPool;
-        init_info.Subpass = 0; // Render ImGui in the first subpass
+        init_info.Subpass = OverlaySubpass;
         // Number of images in swap chain + number of concurrent frames.
         init_info.MinImageCount = static_cast<uint32_t>(swapChainImages.size()); // Typically 2 or 3
-        init_info.ImageCount = static_cast<uint32_t>(swapChainImages.size()); // Should match swapchain image count
+        // Vertex and index buffers the backend cycles through, one per recording. A cached UI recording of each
+        // frame in flight may still be executed while the next one is recorded, which needs one more buffer than
+        // frames in flight (RendererSystem::recordUi).
+        init_info.ImageCount = std::max(static_cast<uint32_t>(swapChainImages.size()),
+                                       static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT) + 1);
         init_info.MSAASamples = VK_SAMPLE_COUNT_1_BIT; // No MSAA in our main render pass
         init_info.Allocator = nullptr; // Use default allocator
         init_info.CheckVkResultFn = [](VkResult err) {
@@ -622,6 +722,21 @@ namespace Bcg {
     }
 
 
+    void VulkanContext::createOffscreenImages() {
+        // Stands in for the swapchain: the same color format family, one image per frame in flight
+        swapChainImageFormat = VK_FORMAT_R8G8B8A8_SRGB;
+        offscreenImages.resize(MAX_FRAMES_IN_FLIGHT);
+        swapChainImages.clear();
+        for (auto &image: offscreenImages) {
+            createImage(swapChainExtent.width, swapChainExtent.height, swapChainImageFormat, VK_IMAGE_TILING_OPTIMAL,
+                        VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+                        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image);
+            swapChainImages.push_back(image.image);
+        }
+        Log::Info("[VulkanContext::createOffscreenImages] {} offscreen targets created ({}x{}).",
+                  offscreenImages.size(), swapChainExtent.width, swapChainExtent.height);
+    }
+
     void VulkanContext::createRenderPass() {
         // --- Color Attachment (Swapchain Image) ---
         VkAttachmentDescription colorAttachment{};
@@ -632,7 +747,10 @@ namespace Bcg {
         colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
         colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
         colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED; // Layout before pass
-        colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR; // Layout after pass for presentation
+        // Layout after pass for presentation, offscreen images are copied out instead
+        colorAttachment.finalLayout = headless
+                                          ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+                                          : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
         VkAttachmentReference colorAttachmentRef{};
         colorAttachmentRef.attachment = 0; // Index in pAttachments array
@@ -653,12 +771,19 @@ namespace Bcg {
         depthAttachmentRef.attachment = 1; // Index in pAttachments array
         depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
-        // --- Subpass ---
-        VkSubpassDescription subpass{};
+        // --- Subpasses ---
+        // The scene, then the UI on top. The UI is recorded into a secondary command buffer of its own subpass, so
+        // that the scene subpass can still be recorded inline.
+        std::array<VkSubpassDescription, 2> subpasses{};
+        VkSubpassDescription &subpass = subpasses[SceneSubpass];
         subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
         subpass.colorAttachmentCount = 1;
         subpass.pColorAttachments = &colorAttachmentRef; // layout(location = 0) out vec4 outColor;
         subpass.pDepthStencilAttachment = &depthAttachmentRef;
+        VkSubpassDescription &overlay = subpasses[OverlaySubpass];
+        overlay.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        overlay.colorAttachmentCount = 1;
+        overlay.pColorAttachments = &colorAttachmentRef; // No depth, ImGui does not test it
 
         // --- Subpass Dependency ---
         // Ensure render pass waits for image availability before writing colors
@@ -673,6 +798,17 @@ namespace Bcg {
         dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
                                    VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
 
+        // The UI blends over the scene's colors
+        VkSubpassDependency overlayDependency{};
+        overlayDependency.srcSubpass = SceneSubpass;
+        overlayDependency.dstSubpass = OverlaySubpass;
+        overlayDependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        overlayDependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        overlayDependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        overlayDependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        overlayDependency.dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+        std::array<VkSubpassDependency, 2> dependencies = {dependency, overlayDependency};
+
 
         // --- Render Pass Create Info ---
         std::array<VkAttachmentDescription, 2> attachments = {colorAttachment, depthAttachment};
@@ -680,10 +816,10 @@ namespace Bcg {
         renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
         renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
         renderPassInfo.pAttachments = attachments.data();
-        renderPassInfo.subpassCount = 1;
-        renderPassInfo.pSubpasses = &subpass;
-        renderPassInfo.dependencyCount = 1;
-        renderPassInfo.pDependencies = &dependency;
+        renderPassInfo.subpassCount = static_cast<uint32_t>(subpasses.size());
+        renderPassInfo.pSubpasses = subpasses.data();
+        renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+        renderPassInfo.pDependencies = dependencies.data();
 
         VK_CHECK(vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass));
         Log::Info("[VulkanContext::createRenderPass] Default Render Pass created.");
@@ -693,7 +829,8 @@ namespace Bcg {
         // Layout for global uniforms (like camera matrices) bound at set 0
         VkDescriptorSetLayoutBinding uboLayoutBinding{};
         uboLayoutBinding.binding = 0; // binding = 0 in shader
-        uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        // Dynamic: one set per frame serves all views, vkCmdBindDescriptorSets selects the view's GlobalUBO
+        uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
         uboLayoutBinding.descriptorCount = 1;
         uboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;;
         // Accessible in vertex and fragment shader
@@ -719,10 +856,11 @@ namespace Bcg {
         // --- Shader Modules ---
         // Compile shaders using Slang
         // NOTE: Paths are relative to execution directory or need absolute paths
+        // Both stages link against the same parsed module, meshVariant selects the specialization
         VkShaderModule vertShaderModule =
-                compileSlangShader("shaders/simple.slang", SlangStage::SLANG_STAGE_VERTEX);
-        VkShaderModule fragShaderModule = compileSlangShader("shaders/simple.slang",
-                                                             SlangStage::SLANG_STAGE_FRAGMENT);
+                compileSlangShader("shaders/simple.slang", SlangStage::SLANG_STAGE_VERTEX, nullptr, meshVariant);
+        VkShaderModule fragShaderModule =
+                compileSlangShader("shaders/simple.slang", SlangStage::SLANG_STAGE_FRAGMENT, nullptr, meshVariant);
 
         if (vertShaderModule == VK_NULL_HANDLE || fragShaderModule == VK_NULL_HANDLE) {
             // Cleanup already created module if one failed
@@ -746,13 +884,18 @@ namespace Bcg {
         VkPipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo, fragShaderStageInfo};
 
         // --- Vertex Input ---
-        auto bindingDescription = Vertex::getBindingDescription();
-        auto attributeDescriptions = Vertex::getAttributeDescriptions();
+        // Binding 0: vertices from the geometry pool, binding 1: per-draw InstanceData
+        std::array<VkVertexInputBindingDescription, 2> bindingDescriptions = {
+            getVertexBindingDescription(), InstanceData::getBindingDescription()
+        };
+        std::vector<VkVertexInputAttributeDescription> attributeDescriptions;
+        for (const auto &attribute: getVertexAttributeDescriptions()) attributeDescriptions.push_back(attribute);
+        for (const auto &attribute: InstanceData::getAttributeDescriptions()) attributeDescriptions.push_back(attribute);
 
         VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
         vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-        vertexInputInfo.vertexBindingDescriptionCount = 1;
-        vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
+        vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindingDescriptions.size());
+        vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions.data();
         vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
         vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
 
@@ -863,22 +1006,15 @@ namespace Bcg {
         dynamicState.pDynamicStates = dynamicStates.data();
 
         // --- Pipeline Layout ---
-        // Specifies uniforms and push constants
-        // Define the push constant range
-        VkPushConstantRange pushConstantRange{};
-        pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT; // Accessible in vertex shader
-        pushConstantRange.offset = 0; // Start at offset 0
-        pushConstantRange.size = sizeof(Matrix4f); // Size of the model matrix
-
+        // Specifies uniforms, the model matrix comes per instance from the vertex input (no push constants)
         VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
         pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
         // Bind the global descriptor set layout at set index 0
         std::array<VkDescriptorSetLayout, 1> setLayouts = {globalSetLayout}; // Use array
         pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
         pipelineLayoutInfo.pSetLayouts = setLayouts.data(); // Pointer to array start
-        // Add the push constant range <<< FIX
-        pipelineLayoutInfo.pushConstantRangeCount = 1;
-        pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+        pipelineLayoutInfo.pushConstantRangeCount = 0;
+        pipelineLayoutInfo.pPushConstantRanges = nullptr;
 
         VK_CHECK(vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout));
 
@@ -897,11 +1033,11 @@ namespace Bcg {
         pipelineInfo.pDynamicState = &dynamicState; // Enable dynamic states
         pipelineInfo.layout = pipelineLayout;
         pipelineInfo.renderPass = renderPass; // Render pass the pipeline will be used with
-        pipelineInfo.subpass = 0; // Index of the subpass
+        pipelineInfo.subpass = SceneSubpass; // Index of the subpass
         pipelineInfo.basePipelineHandle = VK_NULL_HANDLE; // Optional: For pipeline derivatives
         pipelineInfo.basePipelineIndex = -1; // Optional
 
-        VK_CHECK(vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline));
+        VK_CHECK(vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineInfo, nullptr, &graphicsPipeline));
         Log::Info("[VulkanContext::createGraphicsPipeline] Default Graphics Pipeline created.");
 
         // --- Cleanup Shader Modules ---
@@ -910,6 +1046,153 @@ namespace Bcg {
         vkDestroyShaderModule(device, vertShaderModule, nullptr);
     }
 
+    void VulkanContext::setMeshVariant(const ShaderVariant &variant) {
+        if (variant.key() == meshVariant.key() && graphicsPipeline != VK_NULL_HANDLE) return;
+
+        VK_CHECK(vkDeviceWaitIdle(device));
+        if (graphicsPipeline != VK_NULL_HANDLE) {
+            vkDestroyPipeline(device, graphicsPipeline, nullptr);
+            graphicsPipeline = VK_NULL_HANDLE;
+        }
+        if (pipelineLayout != VK_NULL_HANDLE) {
+            vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+            pipelineLayout = VK_NULL_HANDLE;
+        }
+        meshVariant = variant;
+        createGraphicsPipeline(); // Variants seen before come from the in-memory shader cache
+        Log::Info("[VulkanContext::setMeshVariant] Mesh pipeline rebuilt with {}", meshVariant.key());
+    }
+
+    void VulkanContext::createPipelineCache() {
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+        // The driver rejects (or worse, misreads) data of another device/driver, so the header is checked first
+        std::string path = (std::filesystem::path(shaderCache.getDirectory()) / "pipeline_cache.bin").string();
+        std::vector<char> data;
+        std::ifstream file;
+        if (!ignorePipelineCache) file.open(path, std::ios::binary | std::ios::ate);
+        if (file.is_open()) {
+            data.resize(static_cast<size_t>(file.tellg()));
+            file.seekg(0);
+            file.read(data.data(), static_cast<std::streamsize>(data.size()));
+
+            VkPipelineCacheHeaderVersionOne header{};
+            const char *reason = nullptr;
+            if (data.size() < sizeof(header)) {
+                reason = "truncated";
+            } else {
+                memcpy(&header, data.data(), sizeof(header));
+                if (header.headerSize < sizeof(header) ||
+                    header.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE) {
+                    reason = "unknown header";
+                } else if (header.vendorID != properties.vendorID || header.deviceID != properties.deviceID) {
+                    reason = "different device";
+                } else if (memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+                    reason = "different driver";
+                }
+            }
+            if (reason) {
+                Log::Warn("[VulkanContext::createPipelineCache] Ignoring {} ({}).", path, reason);
+                data.clear();
+            }
+        }
+
+        VkPipelineCacheCreateInfo cacheInfo{};
+        cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+        cacheInfo.initialDataSize = data.size();
+        cacheInfo.pInitialData = data.empty() ? nullptr : data.data();
+        VK_CHECK(vkCreatePipelineCache(device, &cacheInfo, nullptr, &pipelineCache));
+        pipelineCacheLoadedBytes = data.size();
+        Log::Info("[VulkanContext::createPipelineCache] Pipeline cache created ({} bytes loaded).", data.size());
+    }
+
+    void VulkanContext::savePipelineCache() {
+        if (pipelineCache == VK_NULL_HANDLE) return;
+
+        size_t size = 0;
+        VK_CHECK(vkGetPipelineCacheData(device, pipelineCache, &size, nullptr));
+        std::vector<char> data(size);
+        VK_CHECK(vkGetPipelineCacheData(device, pipelineCache, &size, data.data()));
+        data.resize(size);
+
+        // Written next to the compiled shaders, via a temporary file so that a crash never leaves a partial cache
+        std::filesystem::path path = std::filesystem::path(shaderCache.getDirectory()) / "pipeline_cache.bin";
+        std::filesystem::path temporaryPath = path;
+        temporaryPath += ".tmp";
+        {
+            std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+            if (!file.is_open()) {
+                Log::Warn("[VulkanContext::savePipelineCache] Cannot write {}.", temporaryPath.string());
+                return;
+            }
+            file.write(data.data(), static_cast<std::streamsize>(data.size()));
+        }
+        std::error_code error;
+        std::filesystem::rename(temporaryPath, path, error);
+        if (error) {
+            Log::Warn("[VulkanContext::savePipelineCache] Cannot move {} into place: {}.", temporaryPath.string(),
+                      error.message());
+            return;
+        }
+        Log::Info("[VulkanContext::savePipelineCache] Saved {} bytes to {}.", data.size(), path.string());
+    }
+
+    void VulkanContext::enqueuePipelineJob(const std::string &name, std::function<void()> job) {
+        auto timedJob = [job = std::move(job)]() {
+            BCG_PROFILE_SCOPE("pipelineJob");
+            auto start = std::chrono::steady_clock::now();
+            job();
+            return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        };
+        if (serialPipelineJobs) {
+            // Built on the calling thread before initialization continues, the failure is rethrown as usual
+            std::promise<double> result;
+            try {
+                result.set_value(timedJob());
+            } catch (...) {
+                result.set_exception(std::current_exception());
+            }
+            m_pipelineJobs.push_back({name, result.get_future()});
+            return;
+        }
+        m_pipelineJobs.push_back({name, std::async(std::launch::async, [name, timedJob = std::move(timedJob)]() {
+            BCG_PROFILE_THREAD("Pipeline job: " + name);
+            return timedJob();
+        })});
+    }
+
+    void VulkanContext::finishPipelineJobs() {
+        auto waitStart = std::chrono::steady_clock::now();
+        double workMilliseconds = 0.0;
+        std::exception_ptr firstError;
+        // Every job is joined before rethrowing, none may outlive the objects it uses
+        for (auto &job: m_pipelineJobs) {
+            try {
+                double milliseconds = job.milliseconds.get();
+                workMilliseconds += milliseconds;
+                Log::Info("[VulkanContext::finishPipelineJobs] {}: {:.1f} ms", job.name, milliseconds);
+            } catch (...) {
+                Log::Error("[VulkanContext::finishPipelineJobs] {} failed.", job.name);
+                if (!firstError) firstError = std::current_exception();
+            }
+        }
+        double waitMilliseconds = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - waitStart).count();
+
+        pipelineWorkMilliseconds = workMilliseconds;
+        pipelineWaitMilliseconds = waitMilliseconds;
+
+        auto cacheStats = shaderCache.getStats();
+        Log::Info("[VulkanContext::finishPipelineJobs] {} pipelines ({}): {:.1f} ms of work, {:.1f} ms not hidden by "
+                  "other initialization. Shaders: {} cached ({:.1f} ms), {} compiled ({:.1f} ms).",
+                  m_pipelineJobs.size(), serialPipelineJobs ? "serial" : "parallel", workMilliseconds,
+                  waitMilliseconds, cacheStats.hits, cacheStats.hitMilliseconds, cacheStats.misses,
+                  cacheStats.missMilliseconds);
+        m_pipelineJobs.clear();
+        if (firstError) std::rethrow_exception(firstError);
+    }
+
     void VulkanContext::createCommandPools() {
         // Pool for graphics commands (drawing, barriers, etc.)
         VkCommandPoolCreateInfo poolInfo{};
@@ -921,18 +1204,14 @@ namespace Bcg {
         VK_CHECK(vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool));
         Log::Info("[VulkanContext::createCommandPools] Graphics Command Pool created.");
 
-        // Optional: Separate pool for transfer operations if using a dedicated transfer queue
-        // This can improve performance by allowing concurrent transfer and graphics work.
-        // If a dedicated transfer queue exists and is different from graphics:
-        // if (queueFamilyIndices.transferFamily.has_value() &&
-        //     queueFamilyIndices.transferFamily.value() != queueFamilyIndices.graphicsFamily.value()) {
-        //     VkCommandPoolCreateInfo transferPoolInfo = poolInfo;
-        //     transferPoolInfo.queueFamilyIndex = queueFamilyIndices.transferFamily.value();
-        //     // Transfers are often short-lived, transient buffers are good
-        //     transferPoolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-        //     VK_CHECK(vkCreateCommandPool(device, &transferPoolInfo, nullptr, &transferCommandPool));
-        //     Log::Info("Transfer Command Pool created." );
-        // }
+        // Separate pool for the transfer queue (same family as graphics if there is no dedicated one),
+        // the StagingUploader records its batches from here so uploads never touch the graphics pool.
+        VkCommandPoolCreateInfo transferPoolInfo = poolInfo;
+        transferPoolInfo.queueFamilyIndex = queueFamilyIndices.transferFamily.value();
+        // Transfers are short-lived, transient buffers are good
+        transferPoolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+        VK_CHECK(vkCreateCommandPool(device, &transferPoolInfo, nullptr, &transferCommandPool));
+        Log::Info("[VulkanContext::createCommandPools] Transfer Command Pool created.");
     }
 
     void VulkanContext::createDepthResources() {
@@ -973,7 +1252,11 @@ namespace Bcg {
 
 
     void VulkanContext::createUniformBuffers() {
-        VkDeviceSize bufferSize = sizeof(GlobalUBO);
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+        const VkDeviceSize alignment = std::max<VkDeviceSize>(1, properties.limits.minUniformBufferOffsetAlignment);
+        uniformStride = (sizeof(GlobalUBO) + alignment - 1) / alignment * alignment;
+        VkDeviceSize bufferSize = uniformStride * MaxViews;
 
         uniformBuffers.resize(MAX_FRAMES_IN_FLIGHT);
 
@@ -982,9 +1265,10 @@ namespace Bcg {
                          VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
                          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
                          uniformBuffers[i]);
-            // Persistently map the buffers for easy updates
-            VK_CHECK(vkMapMemory(device, uniformBuffers[i].memory, 0, bufferSize, 0, &uniformBuffers[i].mappedData))
-            ;
+            // Host visible blocks are persistently mapped by the allocator
+            if (!uniformBuffers[i].mappedData) {
+                throw std::runtime_error("Uniform buffer memory is not mapped!");
+            }
         }
         Log::Info("[VulkanContext::createUniformBuffers] Uniform Buffers created and mapped.");
     }
@@ -992,7 +1276,7 @@ namespace Bcg {
     void VulkanContext::createDescriptorPool() {
         std::array<VkDescriptorPoolSize, 1> poolSizes{}; // Adjust size based on descriptor types
         // Pool size for the global UBOs (one per frame in flight)
-        poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
         poolSizes[0].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
 
         // TODO: Add pool sizes for textures, other buffer types if used globally or by materials
@@ -1023,7 +1307,7 @@ namespace Bcg {
             VkDescriptorBufferInfo bufferInfo{};
             bufferInfo.buffer = uniformBuffers[i].buffer;
             bufferInfo.offset = 0;
-            bufferInfo.range = sizeof(GlobalUBO); // Size of the UBO data
+            bufferInfo.range = sizeof(GlobalUBO); // Size of the UBO data of one view
 
             // TODO: Add VkDescriptorImageInfo for textures/samplers if they are in the global set
 
@@ -1034,7 +1318,7 @@ namespace Bcg {
             descriptorWrites[0].dstSet = globalDescriptorSets[i];
             descriptorWrites[0].dstBinding = 0; // Matches the layout binding
             descriptorWrites[0].dstArrayElement = 0; // Start at array element 0
-            descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+            descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
             descriptorWrites[0].descriptorCount = 1; // Update one descriptor
             descriptorWrites[0].pBufferInfo = &bufferInfo;
             descriptorWrites[0].pImageInfo = nullptr; // Optional
@@ -1098,7 +1382,12 @@ namespace Bcg {
 
             // Check for Presentation support (needs surface)
             VkBool32 presentSupport = false;
-            vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, i, surface, &presentSupport);
+            if (headless) {
+                // Nothing is presented, the graphics family stands in
+                presentSupport = (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0;
+            } else {
+                vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, i, surface, &presentSupport);
+            }
             if (presentSupport) {
                 indices.presentFamily = i;
             }
@@ -1109,11 +1398,6 @@ namespace Bcg {
                 indices.computeFamily = i; // Found dedicated compute
             }
 
-            // Check for dedicated Transfer support (optional, less common)
-            // if ((queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT) && !(queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) && !(queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT)) {
-            // indices.transferFamily = i;
-            // }
-
 
             if (indices.isComplete()) {
                 // Found graphics and present
@@ -1138,6 +1422,30 @@ namespace Bcg {
             indices.computeFamily = indices.graphicsFamily;
         }
 
+        // Transfer: prefer a pure DMA family, then any non-graphics family that can copy, then graphics.
+        // (The loop above stops early, so scan all families here.)
+        for (uint32_t j = 0; j < queueFamilyCount; ++j) {
+            VkQueueFlags flags = queueFamilies[j].queueFlags;
+            if ((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & VK_QUEUE_GRAPHICS_BIT) &&
+                !(flags & VK_QUEUE_COMPUTE_BIT)) {
+                indices.transferFamily = j;
+                break;
+            }
+        }
+        if (!indices.transferFamily.has_value()) {
+            for (uint32_t j = 0; j < queueFamilyCount; ++j) {
+                VkQueueFlags flags = queueFamilies[j].queueFlags;
+                // Compute queues support transfers implicitly
+                if ((flags & (VK_QUEUE_TRANSFER_BIT | VK_QUEUE_COMPUTE_BIT)) && !(flags & VK_QUEUE_GRAPHICS_BIT)) {
+                    indices.transferFamily = j;
+                    break;
+                }
+            }
+        }
+        if (!indices.transferFamily.has_value() && indices.graphicsFamily.has_value()) {
+            indices.transferFamily = indices.graphicsFamily;
+        }
+
 
         return indices;
     }
@@ -1149,7 +1457,8 @@ namespace Bcg {
         std::vector<VkExtensionProperties> availableExtensions(extensionCount);
         vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, availableExtensions.data());
 
-        std::set<std::string> requiredExtensions(deviceExtensions.begin(), deviceExtensions.end());
+        std::vector<const char *> extensions = getRequiredDeviceExtensions();
+        std::set<std::string> requiredExtensions(extensions.begin(), extensions.end());
 
         for (const auto &extension: availableExtensions) {
             requiredExtensions.erase(extension.extensionName);
@@ -1259,19 +1568,8 @@ namespace Bcg {
 
 
     uint32_t VulkanContext::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
-        VkPhysicalDeviceMemoryProperties memProperties;
-        vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
-
-        for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
-            // Check if the memory type's bit is set in typeFilter
-            // AND if the memory type has all the required property flags
-            if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) ==
-                properties) {
-                return i; // Found suitable memory type
-            }
-        }
-
-        throw std::runtime_error("Failed to find suitable memory type!");
+        // The allocator caches the memory properties of the physical device
+        return memoryAllocator.findMemoryType(typeFilter, properties);
     }
 
     void VulkanContext::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties,
@@ -1280,33 +1578,34 @@ namespace Bcg {
         bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
         bufferInfo.size = size;
         bufferInfo.usage = usage;
-        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE; // Simple case
+        // Upload destinations are written on the transfer queue and read on the graphics queue. Concurrent
+        // sharing avoids queue family ownership transfers (release/acquire barriers on both queues).
+        uint32_t queueFamilies[] = {queueFamilyIndices.graphicsFamily.value(),
+                                    queueFamilyIndices.transferFamily.value()};
+        if ((usage & VK_BUFFER_USAGE_TRANSFER_DST_BIT) && queueFamilies[0] != queueFamilies[1]) {
+            bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+            bufferInfo.queueFamilyIndexCount = 2;
+            bufferInfo.pQueueFamilyIndices = queueFamilies;
+        } else {
+            bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE; // Simple case
+        }
 
         VK_CHECK(vkCreateBuffer(device, &bufferInfo, nullptr, &allocatedBuffer.buffer));
 
         VkMemoryRequirements memRequirements;
         vkGetBufferMemoryRequirements(device, allocatedBuffer.buffer, &memRequirements);
 
-        VkMemoryAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memRequirements.size;
-        allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
-
-        // Example: If using VK_KHR_buffer_device_address
-        // VkMemoryAllocateFlagsInfo flagsInfo{VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO};
-        // if (usage & VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT) {
-        //     flagsInfo.flags = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT;
-        //     allocInfo.pNext = &flagsInfo;
-        // }
-
+        // Sub-allocate from a shared block instead of one vkAllocateMemory per buffer
+        allocatedBuffer.allocation = memoryAllocator.allocate(memRequirements, properties, GpuResourceKind::Linear);
+        allocatedBuffer.allocator = &memoryAllocator;
+        allocatedBuffer.memory = allocatedBuffer.allocation.memory;
+        allocatedBuffer.offset = allocatedBuffer.allocation.offset;
 
-        VK_CHECK(vkAllocateMemory(device, &allocInfo, nullptr, &allocatedBuffer.memory));
-
-        // Bind the memory to the buffer
-        VK_CHECK(vkBindBufferMemory(device, allocatedBuffer.buffer, allocatedBuffer.memory, 0)); // Offset 0
+        // Bind the memory range to the buffer
+        VK_CHECK(vkBindBufferMemory(device, allocatedBuffer.buffer, allocatedBuffer.memory, allocatedBuffer.offset));
 
         allocatedBuffer.size = size; // Store requested size, not allocation size
-        allocatedBuffer.mappedData = nullptr; // Not mapped by default here
+        allocatedBuffer.mappedData = allocatedBuffer.allocation.mappedData; // Persistently mapped if host visible
     }
 
     VkCommandBuffer VulkanContext::beginSingleTimeCommands(VkCommandPool pool) {
@@ -1378,13 +1677,13 @@ namespace Bcg {
         VkMemoryRequirements memRequirements;
         vkGetImageMemoryRequirements(device, allocatedImage.image, &memRequirements);
 
-        VkMemoryAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memRequirements.size;
-        allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+        GpuResourceKind kind = tiling == VK_IMAGE_TILING_OPTIMAL ? GpuResourceKind::Optimal : GpuResourceKind::Linear;
+        allocatedImage.allocation = memoryAllocator.allocate(memRequirements, properties, kind);
+        allocatedImage.allocator = &memoryAllocator;
+        allocatedImage.memory = allocatedImage.allocation.memory;
+        allocatedImage.offset = allocatedImage.allocation.offset;
 
-        VK_CHECK(vkAllocateMemory(device, &allocInfo, nullptr, &allocatedImage.memory));
-        VK_CHECK(vkBindImageMemory(device, allocatedImage.image, allocatedImage.memory, 0));
+        VK_CHECK(vkBindImageMemory(device, allocatedImage.image, allocatedImage.memory, allocatedImage.offset));
 
         allocatedImage.format = format;
         allocatedImage.extent = {width, height, 1};
@@ -1514,6 +1813,50 @@ namespace Bcg {
     }
 
 
+    void VulkanContext::readOffscreenImage(uint32_t imageIndex, std::vector<uint8_t> &pixels) {
+        if (imageIndex >= offscreenImages.size()) {
+            throw std::runtime_error("readOffscreenImage: no offscreen image " + std::to_string(imageIndex));
+        }
+        VK_CHECK(vkDeviceWaitIdle(device));
+
+        VkDeviceSize size = static_cast<VkDeviceSize>(swapChainExtent.width) * swapChainExtent.height * 4;
+        AllocatedBuffer readback;
+        createBuffer(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                     VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, readback);
+
+        VkCommandBuffer commandBuffer = beginSingleTimeCommands(commandPool);
+
+        // The render pass left the image in TRANSFER_SRC_OPTIMAL, only make its writes visible to the copy
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = offscreenImages[imageIndex].image;
+        barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                             0, nullptr, 0, nullptr, 1, &barrier);
+
+        VkBufferImageCopy region{};
+        region.bufferOffset = 0;
+        region.bufferRowLength = 0; // Tightly packed
+        region.bufferImageHeight = 0;
+        region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+        region.imageOffset = {0, 0, 0};
+        region.imageExtent = {swapChainExtent.width, swapChainExtent.height, 1};
+        vkCmdCopyImageToBuffer(commandBuffer, offscreenImages[imageIndex].image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                               readback.buffer, 1, &region);
+
+        endSingleTimeCommands(commandBuffer, graphicsQueue, commandPool);
+
+        pixels.resize(static_cast<size_t>(size));
+        memcpy(pixels.data(), readback.mappedData, pixels.size());
+        readback.destroy(device);
+    }
+
     VkShaderModule VulkanContext::createShaderModule(const std::vector<uint32_t> &code) {
         VkShaderModuleCreateInfo createInfo{};
         createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
@@ -1526,83 +1869,178 @@ namespace Bcg {
     }
 
     // --- Slang Shader Compilation ---
-    VkShaderModule VulkanContext::compileSlangShader(const std::string &shaderPath, SlangStage stage) {
-        if (!slangSession) {
-            Log::Error("[VulkanContext::compileSlangShader] Slang session not initialized!");
+    VkShaderModule VulkanContext::compileSlangShader(const std::string &shaderPath, SlangStage stage,
+                                                     const char *entryPointName, const ShaderVariant &variant) {
+        if (!entryPointName) {
+            entryPointName = (stage == SLANG_STAGE_VERTEX)
+                                 ? "vertexMain"
+                                 : (stage == SLANG_STAGE_COMPUTE) ? "computeMain" : "fragmentMain";
+        }
+
+        // --- Shader Cache ---
+        // A hit skips Slang entirely (the session is only created on the first miss)
+        auto start = std::chrono::steady_clock::now();
+        auto elapsedMilliseconds = [&start]() {
+            return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        };
+        uint64_t cacheKey = shaderCache.computeKey(shaderPath, entryPointName, stage, variant.key());
+        std::vector<uint32_t> spirvCode;
+        if (shaderCache.load(cacheKey, spirvCode)) {
+            VkShaderModule shaderModule = createShaderModule(spirvCode);
+            double milliseconds = elapsedMilliseconds();
+            shaderCache.recordHit(milliseconds);
+            Log::Info("[VulkanContext::compileSlangShader] Loaded {} ({}{}) from the shader cache in {:.2f} ms",
+                      shaderPath, entryPointName, variant.empty() ? "" : ", " + variant.key(), milliseconds);
+            return shaderModule;
+        }
+
+        if (!compileSlangToSpirv(shaderPath, stage, entryPointName, variant, spirvCode)) {
             return VK_NULL_HANDLE;
         }
+        shaderCache.store(cacheKey, spirvCode);
 
-        SlangResult result;
-        slang::ICompileRequest *request = nullptr;
-        result = slangSession->createCompileRequest(&request);
-        if (SLANG_FAILED(result) || !request) {
-            Log::Error("[VulkanContext::compileSlangShader] Failed to create Slang compile request for {}",
-                       shaderPath);
-            return VK_NULL_HANDLE;
+        // Create the Vulkan shader module
+        VkShaderModule shaderModule = createShaderModule(spirvCode);
+        double milliseconds = elapsedMilliseconds();
+        shaderCache.recordMiss(milliseconds);
+
+        if (shaderModule != VK_NULL_HANDLE) {
+            Log::Info("[VulkanContext::compileSlangShader] Compiled {} ({}{}) in {:.2f} ms", shaderPath,
+                      entryPointName, variant.empty() ? "" : ", " + variant.key(), milliseconds);
+        } else {
+            // createShaderModule would have thrown via VK_CHECK if vkCreateShaderModule failed,
+            // but good practice to check handle anyway, though likely redundant here.
+            Log::Error("[VulkanContext::compileSlangShader] Failed to create Vulkan Shader Module for, {}, {}",
+                       shaderPath, entryPointName);
         }
 
-        // Add the source file to the request
-        int translationUnitIndex = request->addTranslationUnit(SLANG_SOURCE_LANGUAGE_SLANG, nullptr);
-        request->addTranslationUnitSourceFile(translationUnitIndex, shaderPath.c_str());
+        return shaderModule;
+    }
 
-        // Specify the entry point
-        const char *entryPointName = (stage == SLANG_STAGE_VERTEX) ? "vertexMain" : "fragmentMain";
-        // Adjust as needed
-        int entryPointIndex = request->addEntryPoint(translationUnitIndex, entryPointName, stage);
-        if (entryPointIndex < 0) {
-            Log::Error("[VulkanContext::compileSlangShader] Could not find entry point '({})' in {}", entryPointName,
-                       shaderPath);
-            Log::Error("[VulkanContext::compileSlangShader] Diagnostics \n{}", request->getDiagnosticOutput());
-            request->release();
-            return VK_NULL_HANDLE;
+    namespace {
+        void logSlangDiagnostics(const char *where, slang::IBlob *diagnostics) {
+            if (diagnostics && diagnostics->getBufferSize() > 0) {
+                Log::Warn("[VulkanContext::{}] Slang diagnostics:\n{}", where,
+                          static_cast<const char *>(diagnostics->getBufferPointer()));
+            }
         }
+    }
 
-        // Specify the target (already set in session, but can override)
-        int targetIndex = request->addCodeGenTarget(SLANG_SPIRV);
-        // Optional: Set SPIR-V specific options
-        // slang::TargetDesc spirvTarget = {}; ... request->setTargetDesc(targetIndex, spirvTarget);
+    slang::IModule *VulkanContext::loadSlangModule(const std::string &shaderPath) {
+        auto it = slangModules.find(shaderPath);
+        if (it != slangModules.end()) return it->second;
+
+        auto start = std::chrono::steady_clock::now();
+        Slang::ComPtr<slang::IBlob> diagnostics;
+        slang::IModule *module = slangSession->loadModule(shaderPath.c_str(), diagnostics.writeRef());
+        logSlangDiagnostics("loadSlangModule", diagnostics);
+        if (!module) {
+            Log::Error("[VulkanContext::loadSlangModule] Failed to load {}", shaderPath);
+            return nullptr;
+        }
+        Log::Info("[VulkanContext::loadSlangModule] Parsed and checked {} in {:.2f} ms", shaderPath,
+                  std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        slangModules.emplace(shaderPath, module);
+        return module;
+    }
+
+    slang::IModule *VulkanContext::loadSlangConstants(const ShaderVariant &variant) {
+        std::string key = variant.key();
+        auto it = slangConstantModules.find(key);
+        if (it != slangConstantModules.end()) return it->second;
+
+        // Every variant is its own module, module names must be unique within the session
+        std::string name = "variant_constants_" + std::to_string(slangConstantModules.size());
+        std::string source = variant.constantsSource();
+        Slang::ComPtr<slang::IBlob> diagnostics;
+        slang::IModule *module = slangSession->loadModuleFromSourceString(name.c_str(), (name + ".slang").c_str(),
+                                                                          source.c_str(), diagnostics.writeRef());
+        logSlangDiagnostics("loadSlangConstants", diagnostics);
+        if (!module) {
+            Log::Error("[VulkanContext::loadSlangConstants] Failed to create the constants module for {}", key);
+            return nullptr;
+        }
+        slangConstantModules.emplace(key, module);
+        return module;
+    }
 
+    bool VulkanContext::compileSlangToSpirv(const std::string &shaderPath, SlangStage stage,
+                                            const char *entryPointName, const ShaderVariant &variant,
+                                            std::vector<uint32_t> &spirvCode) {
+        std::lock_guard<std::mutex> lock(slangMutex);
+        if (!slangSession) {
+            initSlang();
+        }
 
-        // Compile the code
-        result = request->compile();
+        // The module is parsed and checked once, every entry point and variant only composes and links
+        slang::IModule *module = loadSlangModule(shaderPath);
+        if (!module) return false;
 
-        // Check for errors and print diagnostics
-        const char *diagnostics = request->getDiagnosticOutput();
+        Slang::ComPtr<slang::IBlob> diagnostics;
+        Slang::ComPtr<slang::IEntryPoint> entryPoint;
+        module->findAndCheckEntryPoint(entryPointName, stage, entryPoint.writeRef(), diagnostics.writeRef());
+        logSlangDiagnostics("compileSlangToSpirv", diagnostics);
+        if (!entryPoint) {
+            Log::Error("[VulkanContext::compileSlangToSpirv] Could not find entry point '({})' in {}", entryPointName,
+                       shaderPath);
+            return false;
+        }
+
+        std::vector<slang::IComponentType *> components = {module, entryPoint.get()};
+        if (!variant.empty()) {
+            slang::IModule *constants = loadSlangConstants(variant);
+            if (!constants) return false;
+            components.push_back(constants);
+        }
+
+        Slang::ComPtr<slang::IComponentType> composite;
+        SlangResult result = slangSession->createCompositeComponentType(
+            components.data(), static_cast<SlangInt>(components.size()), composite.writeRef(),
+            diagnostics.writeRef());
+        logSlangDiagnostics("compileSlangToSpirv", diagnostics);
         if (SLANG_FAILED(result)) {
-            Log::Error("[Vulkan::compileSlangShader] Compilation failed for {} ({})", shaderPath, entryPointName);
-            if (diagnostics && strlen(diagnostics) > 0) {
-                Log::Error("[Vulkan::compileSlangShader] Slang Compilation Diagnostics: \n{}", diagnostics);
-            }
-            request->release();
-            return VK_NULL_HANDLE;
-        } else {
-            if (diagnostics && strlen(diagnostics) > 0) {
-                Log::Info("[Vulkan::compileSlangShader] Slang Compilation Diagnostics for {} ({}):\n{}", shaderPath,
-                          entryPointName, diagnostics);
-            }
+            Log::Error("[VulkanContext::compileSlangToSpirv] Failed to compose {} ({}, {})", shaderPath,
+                       entryPointName, variant.key());
+            return false;
         }
 
-        // Get the compiled code (SPIR-V)
-        size_t dataSize = 0;
-        void const *data = request->getEntryPointCode(entryPointIndex, &dataSize);
-        if (!data || dataSize == 0) {
-            Log::Error("[VulkanContext::compileSlangShader] Slang failed to produce SPIR-V code for {},   ({})",
-                       shaderPath, entryPointName);
-            request->release();
-            return VK_NULL_HANDLE;
+        // Linking resolves the extern constants, code depending on them is specialized from here on
+        Slang::ComPtr<slang::IComponentType> linked;
+        result = composite->link(linked.writeRef(), diagnostics.writeRef());
+        logSlangDiagnostics("compileSlangToSpirv", diagnostics);
+        if (SLANG_FAILED(result)) {
+            Log::Error("[VulkanContext::compileSlangToSpirv] Failed to link {} ({}, {})", shaderPath, entryPointName,
+                       variant.key());
+            return false;
         }
 
-        // --- Dump SPIR-V to file for inspection ---
-        std::string dumpFilename = (stage == SlangStage::SLANG_STAGE_VERTEX)
-                                       ? "dump_vertex.spv"
-                                       : "dump_fragment.spv";
-        std::ofstream dumpFile(dumpFilename, std::ios::binary | std::ios::trunc);
-        if (dumpFile.is_open()) {
-            dumpFile.write(static_cast<const char *>(data), dataSize);
-            dumpFile.close();
-            Log::Info("[VulkanContext::compileSlangShader] Dumped SPIR-V ({} bytes) to: {}", dataSize, dumpFilename);
-        } else {
-            Log::Error("[VulkanContext::compileSlangShader] Failed to open {} for writing SPIR-V dump.", dumpFilename);
+        Slang::ComPtr<slang::IBlob> code;
+        result = linked->getEntryPointCode(0, 0, code.writeRef(), diagnostics.writeRef());
+        logSlangDiagnostics("compileSlangToSpirv", diagnostics);
+        if (SLANG_FAILED(result) || !code || code->getBufferSize() == 0) {
+            Log::Error("[VulkanContext::compileSlangToSpirv] Slang failed to produce SPIR-V code for {},   ({})",
+                       shaderPath, entryPointName);
+            return false;
+        }
+        const void *data = code->getBufferPointer();
+        size_t dataSize = code->getBufferSize();
+
+        // --- Dump SPIR-V to file for inspection (opt-in, BCG_DUMP_SPIRV) ---
+        if (dumpSpirv) {
+            std::string dumpFilename = "dump_" + std::filesystem::path(shaderPath).stem().string() + "_" +
+                                       entryPointName;
+            if (!variant.empty()) dumpFilename += "_" + std::to_string(std::hash<std::string>{}(variant.key()));
+            dumpFilename += ".spv";
+            std::ofstream dumpFile(dumpFilename, std::ios::binary | std::ios::trunc);
+            if (dumpFile.is_open()) {
+                dumpFile.write(static_cast<const char *>(data), dataSize);
+                dumpFile.close();
+                Log::Info("[VulkanContext::compileSlangToSpirv] Dumped SPIR-V ({} bytes) to: {}", dataSize,
+                          dumpFilename);
+            } else {
+                Log::Error("[VulkanContext::compileSlangToSpirv] Failed to open {} for writing SPIR-V dump.",
+                           dumpFilename);
+            }
         }
         // --- End SPIR-V dump ---
 
@@ -1610,33 +2048,14 @@ namespace Bcg {
         // Slang returns raw bytes, Vulkan expects uint32_t*, ensure alignment
         if (dataSize % sizeof(uint32_t) != 0) {
             Log::Error(
-                "[VulkanContext::compileSlangShader] Slang SPIR-V output size ({}) is not a multiple of 4 bytes!",
+                "[VulkanContext::compileSlangToSpirv] Slang SPIR-V output size ({}) is not a multiple of 4 bytes!",
                 dataSize);
-            request->release();
-            return VK_NULL_HANDLE;
+            return false;
         }
         // Using vector ensures proper alignment for uint32_t
-        std::vector<uint32_t> spirvCode(dataSize / sizeof(uint32_t));
+        spirvCode.resize(dataSize / sizeof(uint32_t));
         memcpy(spirvCode.data(), data, dataSize);
-
-
-        // Create the Vulkan shader module
-        VkShaderModule shaderModule = createShaderModule(spirvCode);
-
-        // Clean up the Slang request object
-        request->release();
-
-        if (shaderModule != VK_NULL_HANDLE) {
-            Log::Info("[VulkanContext::compileSlangShader] Successfully created Vulkan Shader Module for: {} ({})",
-                      shaderPath, entryPointName);
-        } else {
-            // createShaderModule would have thrown via VK_CHECK if vkCreateShaderModule failed,
-            // but good practice to check handle anyway, though likely redundant here.
-            Log::Error("[VulkanContext::compileSlangShader] Failed to create Vulkan Shader Module for, {}, {}",
-                       shaderPath, entryPointName);
-        }
-
-        return shaderModule;
+        return true;
     }
 
 
@@ -1666,11 +2085,14 @@ namespace Bcg {
     }
 
     std::vector<const char *> VulkanContext::getRequiredExtensions() {
-        uint32_t glfwExtensionCount = 0;
-        const char **glfwExtensions;
-        glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-
-        std::vector<const char *> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+        std::vector<const char *> extensions;
+        if (!headless) {
+            // Surface extensions, GLFW is not even initialized when headless
+            uint32_t glfwExtensionCount = 0;
+            const char **glfwExtensions;
+            glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+            extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+        }
 
         if (enableValidationLayers) {
             extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -1687,6 +2109,11 @@ namespace Bcg {
         return extensions;
     }
 
+    std::vector<const char *> VulkanContext::getRequiredDeviceExtensions() const {
+        if (headless) return {}; // No swapchain
+        return deviceExtensions;
+    }
+
     VKAPI_ATTR VkBool32 VKAPI_CALL VulkanContext::debugCallback(
         VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
         VkDebugUtilsMessageTypeFlagsEXT messageType,
@@ -1750,8 +2177,8 @@ namespace Bcg {
         QueueFamilyIndices indices = findQueueFamilies(device);
         bool extensionsSupported = checkDeviceExtensionSupport(device);
 
-        bool swapChainAdequate = false;
-        if (extensionsSupported) {
+        bool swapChainAdequate = headless; // No surface to check against
+        if (extensionsSupported && !headless) {
             SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device);
             swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
         }
@@ -1762,7 +2189,9 @@ namespace Bcg {
         // Check for required features (add more as needed)
         bool featuresSupported = supportedFeatures.samplerAnisotropy &&
                                  supportedFeatures.fillModeNonSolid && // For potential wireframe
-                                 supportedFeatures.wideLines; // For lines > 1.0f
+                                 supportedFeatures.wideLines && // For lines > 1.0f
+                                 supportedFeatures.multiDrawIndirect && // Geometry pool draws
+                                 supportedFeatures.drawIndirectFirstInstance;
 
         // Check for required Vulkan 1.1/1.2 features used
         VkPhysicalDeviceVulkan11Features features11{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_1_FEATURES};
@@ -1773,7 +2202,9 @@ namespace Bcg {
         features2.pNext = &features11;
         vkGetPhysicalDeviceFeatures2(device, &features2);
 
-        bool extraFeaturesSupported = features12.bufferDeviceAddress; // If using buffer addresses
+        bool extraFeaturesSupported = features12.bufferDeviceAddress && // If using buffer addresses
+                                      features12.timelineSemaphore && // Upload tickets
+                                      features12.drawIndirectCount; // GPU culling
 
 
         return indices.isComplete() && extensionsSupported && swapChainAdequate && featuresSupported &&
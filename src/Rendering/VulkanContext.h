@@ -8,8 +8,16 @@
 #include <vector>
 #include <optional>
 #include <string>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <unordered_map>
 
 #include "VulkanUtils.h"
+#include "StagingUploader.h"
+#include "GeometryPool.h"
+#include "ShaderCache.h"
+#include "ShaderVariant.h"
 
 #include <cuda_runtime.h>
 #include <slang/slang.h> // Slang shader compilation API
@@ -24,6 +32,7 @@ namespace Bcg{
         std::optional<uint32_t> graphicsFamily;
         std::optional<uint32_t> presentFamily;
         std::optional<uint32_t> computeFamily; // For Vulkan compute / CUDA interop
+        std::optional<uint32_t> transferFamily; // Dedicated DMA queue if available, graphics otherwise
 
         bool isComplete() const {
             return graphicsFamily.has_value() && presentFamily.has_value();
@@ -44,24 +53,41 @@ namespace Bcg{
         VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
         VkDevice device = VK_NULL_HANDLE;
         QueueFamilyIndices queueFamilyIndices;
+        // Optional features, enabled in createLogicalDevice if the device supports them
+        bool pipelineStatisticsQuery = false; // GpuProfiler statistics of the scene pass
+        bool hostQueryReset = false; // vkResetQueryPool, the transfer queue cannot reset queries itself
         VkQueue graphicsQueue = VK_NULL_HANDLE;
         VkQueue presentQueue = VK_NULL_HANDLE;
         VkQueue computeQueue = VK_NULL_HANDLE; // Optional
+        VkQueue transferQueue = VK_NULL_HANDLE; // Falls back to graphicsQueue
 
         VkSwapchainKHR swapChain = VK_NULL_HANDLE;
-        std::vector<VkImage> swapChainImages;
+        std::vector<VkImage> swapChainImages; // Of offscreenImages when headless
         VkFormat swapChainImageFormat;
         VkExtent2D swapChainExtent;
         std::vector<VkImageView> swapChainImageViews;
         std::vector<VkFramebuffer> swapChainFramebuffers; // For the main render pass
 
+        // Headless: no surface and no swapchain. The render pass targets one offscreen color image per frame in
+        // flight (image index == currentFrame), left in TRANSFER_SRC_OPTIMAL so it can be read back.
+        bool headless = false;
+        std::vector<AllocatedImage> offscreenImages;
+
         VkRenderPass renderPass = VK_NULL_HANDLE; // Default render pass
+        // Subpasses of the default render pass, the overlay (UI) draws over the scene without depth
+        static constexpr uint32_t SceneSubpass = 0;
+        static constexpr uint32_t OverlaySubpass = 1;
         VkDescriptorSetLayout globalSetLayout = VK_NULL_HANDLE; // Camera matrices etc.
         VkPipelineLayout pipelineLayout = VK_NULL_HANDLE; // Default mesh pipeline layout
         VkPipeline graphicsPipeline = VK_NULL_HANDLE; // Default mesh pipeline
+        VkPipelineCache pipelineCache = VK_NULL_HANDLE; // Persisted in the shader cache directory, pass to all pipelines
+
+        GpuMemoryAllocator memoryAllocator; // Sub-allocates all buffer/image memory from large blocks
 
         VkCommandPool commandPool = VK_NULL_HANDLE; // For graphics commands
-        VkCommandPool transferCommandPool = VK_NULL_HANDLE; // Optional: for transfer queue
+        VkCommandPool transferCommandPool = VK_NULL_HANDLE; // For the transfer queue family
+        StagingUploader uploader; // Asynchronous buffer uploads on the transfer queue
+        GeometryPool geometryPool; // Vertex/index data of all meshes
 
         AllocatedImage depthImage; // Depth buffer
 
@@ -69,6 +95,9 @@ namespace Bcg{
         VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
         std::vector<VkDescriptorSet> globalDescriptorSets; // One per frame in flight
         std::vector<AllocatedBuffer> uniformBuffers; // For global uniforms like camera
+        // GlobalUBO of view i at i * uniformStride, selected by the dynamic offset of the global descriptor set
+        static constexpr uint32_t MaxViews = 4;
+        VkDeviceSize uniformStride = sizeof(GlobalUBO);
 
         // Synchronization
         std::vector<VkSemaphore> imageAvailableSemaphores;
@@ -83,20 +112,36 @@ namespace Bcg{
         AllocatedImage fontTexture; // We can reuse AllocatedImage struct
         // --- End ImGui Resources ---
 
-        // CUDA context (minimal)
+        // CUDA context (minimal), initialized by the first getCudaStream()
         int cudaDeviceID = -1;
         cudaStream_t cudaStream = nullptr; // For potential async operations
 
         // Function pointers for CUDA interop (load dynamically if used)
         // PFN_vkGetMemoryCudaHandleNV ... etc.
 
-        // Slang session
+        // Slang session, created lazily on the first shader cache miss
         slang::IGlobalSession *slangGlobalSession = nullptr;
         slang::ISession *slangSession = nullptr;
+        // Parsed once and linked per entry point and variant, owned by the session
+        std::unordered_map<std::string, slang::IModule *> slangModules; // By shader path
+        std::unordered_map<std::string, slang::IModule *> slangConstantModules; // By ShaderVariant::key()
+        ShaderCache shaderCache; // Compiled SPIR-V on disk
+        std::mutex slangMutex; // Slang sessions are not thread safe, pipeline jobs compile concurrently
+        bool dumpSpirv = false; // Write dump_<shader>_<entry>.spv for every compile (BCG_DUMP_SPIRV)
+        double initMilliseconds = 0.0; // Of init(), without the pipeline jobs still running then
+        // Startup breakdown switches, for comparing against the default (parallel builds, persisted cache)
+        bool serialPipelineJobs = false; // Build in enqueuePipelineJob() instead of on workers (BCG_SERIAL_PIPELINES)
+        bool ignorePipelineCache = false; // Start with an empty pipeline cache (BCG_NO_PIPELINE_CACHE)
+        size_t pipelineCacheLoadedBytes = 0;
+        double pipelineWorkMilliseconds = 0.0; // Sum of the jobs waited for by the last finishPipelineJobs()
+        double pipelineWaitMilliseconds = 0.0; // Of these, the part not hidden behind other initialization
+        ShaderVariant meshVariant = ShaderVariant::mesh(LightingModel::BlinnPhong, true); // Of graphicsPipeline
 
         // --- Methods ---
         void init(GLFWwindow *window);
 
+        void initHeadless(uint32_t width, uint32_t height);
+
         void cleanup();
 
         void recreateSwapChain(GLFWwindow *window);
@@ -139,9 +184,37 @@ namespace Bcg{
 
         void copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height);
 
+        // Copies an offscreen image (headless) into tightly packed RGBA8 pixels, waits for the device to be idle.
+        void readOffscreenImage(uint32_t imageIndex, std::vector<uint8_t> &pixels);
+
         VkShaderModule createShaderModule(const std::vector<uint32_t> &code);
 
-        VkShaderModule compileSlangShader(const std::string &shaderPath, SlangStage stage);
+        // Entry point defaults to vertexMain / fragmentMain / computeMain depending on the stage. The variant
+        // provides the link-time constants of the shader.
+        VkShaderModule compileSlangShader(const std::string &shaderPath, SlangStage stage,
+                                          const char *entryPointName = nullptr,
+                                          const ShaderVariant &variant = {});
+
+        // Always runs Slang, bypassing the shader cache
+        bool compileSlangToSpirv(const std::string &shaderPath, SlangStage stage, const char *entryPointName,
+                                 const ShaderVariant &variant, std::vector<uint32_t> &spirvCode);
+
+        // Rebuilds graphicsPipeline with another variant of shaders/simple.slang. Waits for the device to be idle.
+        void setMeshVariant(const ShaderVariant &variant);
+
+        // Runs a pipeline build (shader compile + vkCreate*Pipelines) on a worker thread while initialization
+        // continues. The job must only touch objects that exist already and are not changed until
+        // finishPipelineJobs() returns.
+        void enqueuePipelineJob(const std::string &name, std::function<void()> job);
+
+        // Waits for all pipeline jobs, logs the startup breakdown and rethrows the first failure.
+        void finishPipelineJobs();
+
+        // ImGui Vulkan backend and font texture, after init() and once the ImGui font atlas is built. Windowed only.
+        void initUi();
+
+        // Initializes CUDA on the first call, nothing at startup uses it. nullptr without a CUDA device.
+        cudaStream_t getCudaStream();
 
     private:
         void initVulkan(GLFWwindow *window);
@@ -158,12 +231,18 @@ namespace Bcg{
 
         void createImageViews();
 
+        void createOffscreenImages();
+
         void createRenderPass();
 
         void createDescriptorSetLayout();
 
         void createGraphicsPipeline();
 
+        void createPipelineCache();
+
+        void savePipelineCache();
+
         void createCommandPools();
 
         void createDepthResources();
@@ -180,6 +259,11 @@ namespace Bcg{
 
         void initSlang();
 
+        // Both expect slangMutex to be held
+        slang::IModule *loadSlangModule(const std::string &shaderPath);
+
+        slang::IModule *loadSlangConstants(const ShaderVariant &variant);
+
         void initCuda(); // Basic CUDA init
         void initImGui(); // <<< ADD Declaration
         void uploadImGuiFonts(); // <<< ADD Declaration
@@ -205,6 +289,8 @@ namespace Bcg{
 
         std::vector<const char *> getRequiredExtensions();
 
+        std::vector<const char *> getRequiredDeviceExtensions() const;
+
         static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
                                                             VkDebugUtilsMessageTypeFlagsEXT messageType,
                                                             const VkDebugUtilsMessengerCallbackDataEXT *pCallbackData,
@@ -219,6 +305,15 @@ namespace Bcg{
                                            const VkAllocationCallbacks *pAllocator);
 
         bool isDeviceSuitable(VkPhysicalDevice device);
+
+        struct PipelineJob {
+            std::string name;
+            std::future<double> milliseconds;
+        };
+
+        std::vector<PipelineJob> m_pipelineJobs;
+
+        std::once_flag m_cudaInitialized;
     };
 
     class Instance{
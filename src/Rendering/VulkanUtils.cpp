@@ -46,20 +46,20 @@ namespace Bcg{
 
 
     void AllocatedBuffer::destroy(VkDevice device) {
-        if (mappedData) {
-            // Unmap if persistently mapped (though usually done after use for staging)
-            // For persistently mapped buffers, unmapping might not be needed at destroy
-            // vkUnmapMemory(device, memory);
-            // mappedData = nullptr;
-        }
         if (buffer != VK_NULL_HANDLE) {
             vkDestroyBuffer(device, buffer, nullptr);
             buffer = VK_NULL_HANDLE;
         }
-        if (memory != VK_NULL_HANDLE) {
+        if (allocator) {
+            // Sub-allocated: the block stays mapped, only the range is returned to the allocator
+            allocator->free(allocation);
+            allocator = nullptr;
+        } else if (memory != VK_NULL_HANDLE) {
             vkFreeMemory(device, memory, nullptr);
-            memory = VK_NULL_HANDLE;
         }
+        memory = VK_NULL_HANDLE;
+        mappedData = nullptr;
+        offset = 0;
         size = 0;
     }
 
@@ -72,9 +72,13 @@ namespace Bcg{
             vkDestroyImage(device, image, nullptr);
             image = VK_NULL_HANDLE;
         }
-        if (memory != VK_NULL_HANDLE) {
+        if (allocator) {
+            allocator->free(allocation);
+            allocator = nullptr;
+        } else if (memory != VK_NULL_HANDLE) {
             vkFreeMemory(device, memory, nullptr);
-            memory = VK_NULL_HANDLE;
         }
+        memory = VK_NULL_HANDLE;
+        offset = 0;
     }
 }
\ No newline at end of file
@@ -7,6 +7,8 @@
 
 #include <vulkan/vulkan.h>
 
+#include "GpuMemoryAllocator.h"
+
 #ifdef NDEBUG
 #define VK_CHECK(call) (call)
 #else
@@ -44,9 +46,13 @@ namespace Bcg {
 
     struct AllocatedBuffer {
         VkBuffer buffer = VK_NULL_HANDLE;
-        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceMemory memory = VK_NULL_HANDLE; // Shared block, never map this directly
+        VkDeviceSize offset = 0; // Offset of this buffer inside memory
         VkDeviceSize size = 0;
-        void *mappedData = nullptr; // If persistently mapped
+        void *mappedData = nullptr; // If persistently mapped (host visible memory), already offset
+
+        GpuMemoryAllocator *allocator = nullptr; // Owner of the allocation, null if memory was allocated directly
+        GpuAllocation allocation;
 
         // Add cleanup logic (or use VMA)
         void destroy(VkDevice device);
@@ -55,10 +61,14 @@ namespace Bcg {
     struct AllocatedImage {
         VkImage image = VK_NULL_HANDLE;
         VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceSize offset = 0;
         VkImageView imageView = VK_NULL_HANDLE;
         VkFormat format;
         VkExtent3D extent;
 
+        GpuMemoryAllocator *allocator = nullptr;
+        GpuAllocation allocation;
+
         // Add cleanup logic
         void destroy(VkDevice device);
     };
@@ -0,0 +1,66 @@
+//
+// Created by alex on 5/5/25.
+//
+
+#include "ObjMeshBuilder.h"
+
+namespace Bcg {
+    ObjMeshBuilder::ObjMeshBuilder(const std::vector<float> &positions, const std::vector<float> &normals,
+                                   const std::vector<float> &texCoords, const std::vector<float> &colors)
+        : m_positions(positions), m_normals(normals), m_texCoords(texCoords), m_colors(colors) {
+    }
+
+    bool ObjMeshBuilder::addCorner(int positionIndex, int normalIndex, int texCoordIndex) {
+        Vertex vertex{};
+        size_t vertIdxBase = 3 * static_cast<size_t>(positionIndex);
+        if (positionIndex < 0 || vertIdxBase + 2 >= m_positions.size()) return false; // Basic bounds check
+
+        vertex.pos = {
+            m_positions[vertIdxBase + 0],
+            m_positions[vertIdxBase + 1],
+            m_positions[vertIdxBase + 2]
+        };
+
+        // Normals
+        size_t normIdxBase = 3 * static_cast<size_t>(normalIndex);
+        if (normalIndex >= 0 && normIdxBase + 2 < m_normals.size()) {
+            vertex.normal = {
+                m_normals[normIdxBase + 0],
+                m_normals[normIdxBase + 1],
+                m_normals[normIdxBase + 2]
+            };
+        } else {
+            vertex.normal = {0.0f, 1.0f, 0.0f};
+        }
+
+        // TexCoords
+        size_t tcIdxBase = 2 * static_cast<size_t>(texCoordIndex);
+        if (texCoordIndex >= 0 && tcIdxBase + 1 < m_texCoords.size()) {
+            vertex.texCoord = {
+                m_texCoords[tcIdxBase + 0],
+                1.0f - m_texCoords[tcIdxBase + 1] // Flip Y
+            };
+        } else {
+            vertex.texCoord = {0.0f, 0.0f};
+        }
+
+        // Colors
+        if (vertIdxBase + 2 < m_colors.size()) {
+            vertex.color = {
+                m_colors[vertIdxBase + 0],
+                m_colors[vertIdxBase + 1],
+                m_colors[vertIdxBase + 2]
+            };
+        } else {
+            vertex.color = {1.0f, 1.0f, 1.0f};
+        }
+
+        // Deduplicate
+        if (m_uniqueVertices.count(vertex) == 0) {
+            m_uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
+            vertices.push_back(vertex);
+        }
+        indices.push_back(m_uniqueVertices[vertex]);
+        return true;
+    }
+}
@@ -0,0 +1,39 @@
+//
+// Created by alex on 5/5/25.
+//
+
+#ifndef OBJMESHBUILDER_H
+#define OBJMESHBUILDER_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "Vertex.h"
+
+namespace Bcg {
+    // Turns the corners of OBJ faces into an indexed mesh, identical corners share one vertex. The attribute arrays
+    // are the flat float arrays of tinyobj::attrib_t, the corner indices those of tinyobj::index_t (-1 if absent).
+    // Independent of tinyobjloader so that the deduplication can be benchmarked on its own.
+    class ObjMeshBuilder {
+    public:
+        ObjMeshBuilder(const std::vector<float> &positions, const std::vector<float> &normals,
+                       const std::vector<float> &texCoords, const std::vector<float> &colors);
+
+        // Returns false (and adds nothing) if the position index is out of range
+        bool addCorner(int positionIndex, int normalIndex, int texCoordIndex);
+
+        std::vector<Vertex> vertices;
+        std::vector<uint32_t> indices;
+
+    private:
+        const std::vector<float> &m_positions;
+        const std::vector<float> &m_normals;
+        const std::vector<float> &m_texCoords;
+        const std::vector<float> &m_colors; // Per position, may be empty
+
+        std::unordered_map<Vertex, uint32_t> m_uniqueVertices;
+    };
+}
+
+#endif //OBJMESHBUILDER_H
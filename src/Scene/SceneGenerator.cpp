@@ -0,0 +1,184 @@
+//
+// Created by alex on 5/5/25.
+//
+
+#include "SceneGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+#include "AABBSystem.h"
+#include "CameraSystem.h"
+#include "GeometryAccessComponents.h"
+#include "Logger.h"
+#include "RenderComponents.h"
+#include "RendererSystem.h"
+#include "TransformSystem.h"
+
+namespace Bcg {
+    namespace {
+        constexpr float Pi = 3.14159265358979f;
+        constexpr float OrbitSpeed = 0.2f; // Radians per second around the vertical axis, averaged over all
+        // Sphere tessellations cycled through, bounds the pool size of scenes with thousands of distinct meshes
+        constexpr uint32_t SphereLevels = 4;
+
+        // Uniform in [0, 1) from the upper 24 bits, identical with every standard library
+        float unitFloat(std::mt19937 &rng) {
+            return static_cast<float>(rng() >> 8) * (1.0f / 16777216.0f);
+        }
+
+        Vector3f unitVector(std::mt19937 &rng) {
+            Vector3f direction;
+            do {
+                direction = Vector3f(unitFloat(rng), unitFloat(rng), unitFloat(rng)) * 2.0f - Vector3f::Ones();
+            } while (direction.squaredNorm() < 1e-4f || direction.squaredNorm() > 1.0f);
+            return direction.normalized();
+        }
+    }
+
+    void SceneGenerator::generate(ApplicationContext *context, const SceneGeneratorConfig &config) {
+        m_context = context;
+        m_config = config;
+        m_entities.clear();
+        m_meshPositions.clear();
+        m_nextDirty = 0;
+        if (config.entityCount == 0) return;
+
+        auto &registry = *context->registry;
+        std::mt19937 rng(config.seed);
+        const uint32_t meshCount = std::clamp<uint32_t>(config.meshCount, 1, config.entityCount);
+        m_extent = config.spacing * std::cbrt(static_cast<float>(config.entityCount));
+        m_entities.reserve(config.entityCount);
+        m_meshPositions.reserve(meshCount); // GeometryVertexPositionsComponent points into it
+
+        std::vector<Vertex> vertices;
+        std::vector<uint32_t> indices;
+        for (uint32_t i = 0; i < config.entityCount; ++i) {
+            entt::entity entity = registry.create();
+            m_entities.push_back(entity);
+
+            auto &transform = registry.emplace<TransformComponent>(entity);
+            transform.position = (Vector3f(unitFloat(rng), unitFloat(rng), unitFloat(rng)) -
+                                  Vector3f::Constant(0.5f)) * m_extent;
+            transform.rotation = Rotation(2.0f * Pi * unitFloat(rng), unitVector(rng));
+            transform.scale = Vector3f::Constant(0.5f + unitFloat(rng));
+            transform.dirty = true;
+            registry.emplace<TransformNeedsUpdate>(entity);
+
+            // The first meshCount entities upload one mesh each, all others share them
+            uint32_t meshIndex = i < meshCount ? i : rng() % meshCount;
+            if (i < meshCount) {
+                if (i == 0) {
+                    makeCube(vertices, indices);
+                } else {
+                    uint32_t level = 1 + (i - 1) % SphereLevels;
+                    makeSphere(8 + 8 * level, 4 + 4 * level, vertices, indices);
+                }
+                Vector3f color(0.3f + 0.7f * unitFloat(rng), 0.3f + 0.7f * unitFloat(rng),
+                               0.3f + 0.7f * unitFloat(rng));
+                auto &positions = m_meshPositions.emplace_back();
+                for (auto &vertex: vertices) {
+                    vertex.color = color;
+                    positions.push_back(vertex.pos);
+                }
+                context->rendererSystem->uploadMesh(entity, vertices, indices);
+            } else {
+                // Copied first, emplacing may move the component of the mesh's first entity
+                VulkanMeshComponent mesh = registry.get<VulkanMeshComponent>(m_entities[meshIndex]);
+                registry.emplace<VulkanMeshComponent>(entity, mesh);
+            }
+            registry.emplace<GeometryVertexPositionsComponent>(entity, &m_meshPositions[meshIndex]);
+            registry.emplace<AABBComponent>(entity);
+            registry.emplace<NeedsAABBUpdate>(entity);
+        }
+
+        // Look at the whole cube from above one side
+        if (auto *camera = context->cameraSystem->getCurrentCamera()) {
+            camera->target = Vector3f::Zero();
+            camera->position = Vector3f(0.0f, 0.6f, 1.2f) * m_extent;
+            camera->distance = camera->position.norm();
+            camera->farPlane = 4.0f * m_extent;
+            camera->dirtyView = true;
+            camera->dirtyProjection = true;
+        }
+        context->cameraFocusEntity = entt::null;
+
+        Log::Info("[SceneGenerator::generate] {} entities sharing {} meshes in a cube of {:.1f}, seed {}",
+                  config.entityCount, meshCount, m_extent, config.seed);
+    }
+
+    void SceneGenerator::update(float deltaTime) {
+        const size_t count = m_entities.size();
+        const auto moved = std::min(count, static_cast<size_t>(std::llround(m_config.dirtyFraction * count)));
+        if (moved == 0) return;
+
+        // Every entity moves once in count / moved frames, the step makes up for the frames in between
+        auto &registry = *m_context->registry;
+        const float angle = OrbitSpeed * deltaTime * static_cast<float>(count) / static_cast<float>(moved);
+        const Rotation orbit(angle, Vector3f::UnitY());
+        for (size_t i = 0; i < moved; ++i) {
+            entt::entity entity = m_entities[(m_nextDirty + i) % count];
+            auto *transform = registry.try_get<TransformComponent>(entity);
+            if (!transform) continue; // The scene was cleared
+            transform->position = orbit * transform->position;
+            transform->rotation = orbit * transform->rotation;
+            transform->dirty = true;
+            registry.emplace_or_replace<TransformNeedsUpdate>(entity);
+            registry.emplace_or_replace<NeedsAABBUpdate>(entity);
+        }
+        m_nextDirty = (m_nextDirty + moved) % count;
+    }
+
+    void SceneGenerator::makeCube(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices) {
+        vertices.clear();
+        indices.clear();
+        // Four vertices per face for flat normals, counter-clockwise seen from outside
+        for (int axis = 0; axis < 3; ++axis) {
+            for (float sign: {-1.0f, 1.0f}) {
+                Vector3f normal = Vector3f::Zero();
+                normal[axis] = sign;
+                Vector3f u = Vector3f::Zero(), v = Vector3f::Zero();
+                u[(axis + 1) % 3] = 0.5f;
+                v[(axis + 2) % 3] = 0.5f * sign;
+                auto first = static_cast<uint32_t>(vertices.size());
+                const float corners[4][2] = {{-1.0f, -1.0f}, {1.0f, -1.0f}, {1.0f, 1.0f}, {-1.0f, 1.0f}};
+                for (const auto &corner: corners) {
+                    Vertex vertex{};
+                    vertex.pos = 0.5f * normal + corner[0] * u + corner[1] * v;
+                    vertex.normal = normal;
+                    vertex.texCoord = Vector2f(0.5f * (corner[0] + 1.0f), 0.5f * (corner[1] + 1.0f));
+                    vertices.push_back(vertex);
+                }
+                indices.insert(indices.end(), {first, first + 1, first + 2, first, first + 2, first + 3});
+            }
+        }
+    }
+
+    void SceneGenerator::makeSphere(uint32_t segments, uint32_t rings, std::vector<Vertex> &vertices,
+                                    std::vector<uint32_t> &indices) {
+        vertices.clear();
+        indices.clear();
+        // Diameter 1 like the cube, the seam and the poles duplicate vertices for the texture coordinates
+        for (uint32_t ring = 0; ring <= rings; ++ring) {
+            float theta = Pi * static_cast<float>(ring) / static_cast<float>(rings);
+            for (uint32_t segment = 0; segment <= segments; ++segment) {
+                float phi = 2.0f * Pi * static_cast<float>(segment) / static_cast<float>(segments);
+                Vertex vertex{};
+                vertex.normal = Vector3f(std::sin(theta) * std::cos(phi), std::cos(theta),
+                                         -std::sin(theta) * std::sin(phi));
+                vertex.pos = 0.5f * vertex.normal;
+                vertex.texCoord = Vector2f(static_cast<float>(segment) / static_cast<float>(segments),
+                                           static_cast<float>(ring) / static_cast<float>(rings));
+                vertices.push_back(vertex);
+            }
+        }
+        for (uint32_t ring = 0; ring < rings; ++ring) {
+            for (uint32_t segment = 0; segment < segments; ++segment) {
+                uint32_t current = ring * (segments + 1) + segment;
+                uint32_t below = current + segments + 1;
+                indices.insert(indices.end(), {current, below, current + 1, current + 1, below, below + 1});
+            }
+        }
+    }
+}
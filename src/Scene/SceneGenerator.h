@@ -0,0 +1,58 @@
+//
+// Created by alex on 5/5/25.
+//
+
+#ifndef SCENEGENERATOR_H
+#define SCENEGENERATOR_H
+
+#include <cstdint>
+#include <vector>
+
+#include <entt/entt.hpp>
+
+#include "ApplicationContext.h"
+#include "MatVec.h"
+#include "Vertex.h"
+
+namespace Bcg {
+    struct SceneGeneratorConfig {
+        uint32_t entityCount = 10000;
+        // Shared by all entities: a cube and UV spheres of increasing tessellation, each one uploaded on its own
+        uint32_t meshCount = 4;
+        float dirtyFraction = 0.1f; // Of the entities moved (and marked for update) every frame
+        float spacing = 3.0f; // Average distance between neighbouring entities
+        uint32_t seed = 42;
+    };
+
+    // Load test scenes: populates the registry with entityCount entities (TransformComponent, AABBComponent and a
+    // VulkanMeshComponent sharing one of meshCount uploaded meshes), spread uniformly over a cube. update() moves a
+    // rotating window of dirtyFraction * entityCount entities around the vertical axis and tags them for the
+    // transform and AABB systems. Placement and motion depend on the seed only (no std distributions, whose
+    // results differ between standard libraries); with a fixed time step whole runs are reproducible.
+    class SceneGenerator {
+    public:
+        void generate(ApplicationContext *context, const SceneGeneratorConfig &config);
+
+        void update(float deltaTime);
+
+        // Edge length of the populated cube, centered at the origin
+        float getExtent() const { return m_extent; }
+
+        const std::vector<entt::entity> &getEntities() const { return m_entities; }
+
+        static void makeCube(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices);
+
+        static void makeSphere(uint32_t segments, uint32_t rings, std::vector<Vertex> &vertices,
+                               std::vector<uint32_t> &indices);
+
+    private:
+        ApplicationContext *m_context = nullptr;
+        SceneGeneratorConfig m_config;
+        std::vector<entt::entity> m_entities;
+        std::vector<std::vector<Vector3f> > m_meshPositions; // Read by the AABB system, one per mesh
+        float m_extent = 0.0f;
+        size_t m_nextDirty = 0; // Start of the next window of moved entities
+    };
+}
+
+#endif //SCENEGENERATOR_H
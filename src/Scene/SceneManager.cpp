@@ -4,7 +4,6 @@
 
 #include <iostream>
 #include <limits> // For numeric_limits
-#include <unordered_map> // For vertex deduplication
 
 // Include TinyObjLoader implementation detail ONLY here if not done elsewhere
 #define TINYOBJLOADER_IMPLEMENTATION // Should be defined once, e.g., in Application.cpp
@@ -12,9 +11,12 @@
 
 #include "SceneManager.h"
 #include "Logger.h"
+#include "PerfCounters.h"
+#include "Profiler.h"
 #include "RendererSystem.h" // Include Renderer definition
 #include "RenderComponents.h" // Include Renderer definition
 #include "ShaderData.h" // For Vertex struct definition
+#include "ObjMeshBuilder.h"
 #include "Components.h" // Assuming components like TransformComponent are here
 #include "VulkanContext.h" // For VulkanMeshComponent
 #include "Application.h" // Potentially needed to get CameraSystem, or use events
@@ -40,7 +42,14 @@ namespace Bcg {
             return entt::null;
         }
 
-        Log::Info("[SceneManager::loadModel] Loading model...");
+        ModelData model;
+        if (!parseModel(filepath, model)) return entt::null;
+        return createModel(model, filepath);
+    }
+
+    bool SceneManager::parseModel(const std::string &filepath, ModelData &model) {
+        BCG_PROFILE_FUNCTION();
+        Log::Info("[SceneManager::parseModel] Loading model {}...", filepath);
 
         tinyobj::attrib_t attrib;
         std::vector<tinyobj::shape_t> shapes;
@@ -49,87 +58,36 @@ namespace Bcg {
         std::string dir = filepath.substr(0, filepath.find_last_of("/\\") + 1);
 
         if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, filepath.c_str(), dir.c_str())) {
-            Log::Error("[SceneManager::loadModel::TinyObjLoader::Warning] {}", warn);
-            Log::Error("[SceneManager::loadModel::TinyObjLoader::Error] {}", err);
-            Log::Error("[SceneManager::loadModel::TinyObjLoader] Failed to load model {}", filepath);
-            return entt::null;
+            Log::Error("[SceneManager::parseModel::TinyObjLoader::Warning] {}", warn);
+            Log::Error("[SceneManager::parseModel::TinyObjLoader::Error] {}", err);
+            Log::Error("[SceneManager::parseModel::TinyObjLoader] Failed to load model {}", filepath);
+            return false;
         }
         if (!warn.empty()) {
-            Log::Error("[SceneManager::loadModel::TinyObjLoader::Warning] {}", warn);
+            Log::Error("[SceneManager::parseModel::TinyObjLoader::Warning] {}", warn);
         }
 
-        std::vector<Vertex> vertices;
-        std::vector<uint32_t> indices;
-        std::unordered_map<Vertex, uint32_t> uniqueVertices{};
-        bool hasVertices = false;
-        AABBComponent aabb_component;
-
+        ObjMeshBuilder builder(attrib.vertices, attrib.normals, attrib.texcoords, attrib.colors);
         for (const auto &shape: shapes) {
             for (const auto &index: shape.mesh.indices) {
-                Vertex vertex{};
-                int vertIdxBase = 3 * index.vertex_index;
-                if (vertIdxBase + 2 >= attrib.vertices.size()) continue; // Basic bounds check
-
-                vertex.pos = {
-                    attrib.vertices[vertIdxBase + 0],
-                    attrib.vertices[vertIdxBase + 1],
-                    attrib.vertices[vertIdxBase + 2]
-                };
-                AABBSystem::grow(aabb_component, vertex.pos);
-                hasVertices = true;
-
-                // Normals
-                if (index.normal_index >= 0) {
-                    int normIdxBase = 3 * index.normal_index;
-                    if (normIdxBase + 2 < attrib.normals.size()) {
-                        // Bounds check
-                        vertex.normal = {
-                            attrib.normals[normIdxBase + 0],
-                            attrib.normals[normIdxBase + 1],
-                            attrib.normals[normIdxBase + 2]
-                        };
-                    } else { vertex.normal = {0.0f, 1.0f, 0.0f}; }
-                } else {
-                    vertex.normal = {0.0f, 1.0f, 0.0f};
-                }
-
-                // TexCoords
-                if (index.texcoord_index >= 0) {
-                    int tcIdxBase = 2 * index.texcoord_index;
-                    if (tcIdxBase + 1 < attrib.texcoords.size()) {
-                        // Bounds check
-                        vertex.texCoord = {
-                            attrib.texcoords[tcIdxBase + 0],
-                            1.0f - attrib.texcoords[tcIdxBase + 1] // Flip Y
-                        };
-                    } else { vertex.texCoord = {0.0f, 0.0f}; }
-                } else {
-                    vertex.texCoord = {0.0f, 0.0f};
-                }
-
-                // Colors
-                if (!attrib.colors.empty() && vertIdxBase + 2 < attrib.colors.size()) {
-                    // Bounds check
-                    vertex.color = {
-                        attrib.colors[vertIdxBase + 0],
-                        attrib.colors[vertIdxBase + 1],
-                        attrib.colors[vertIdxBase + 2]
-                    };
-                } else {
-                    vertex.color = {1.0f, 1.0f, 1.0f};
-                }
-
-                // Deduplicate
-                if (uniqueVertices.count(vertex) == 0) {
-                    uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
-                    vertices.push_back(vertex);
-                }
-                indices.push_back(uniqueVertices[vertex]);
+                builder.addCorner(index.vertex_index, index.normal_index, index.texcoord_index);
             }
         }
+        model.vertices = std::move(builder.vertices);
+        model.indices = std::move(builder.indices);
+        BCG_COUNT(LoadedVertices, model.vertices.size()); // On the loading thread, in the frame it finishes
+
+        // Every corner is one of the unique vertices, their bounds are those of all corners
+        model.aabb = AABBComponent();
+        for (const auto &vertex: model.vertices) {
+            AABBSystem::grow(model.aabb, vertex.pos);
+        }
+        return true;
+    }
 
-        if (!hasVertices) {
-            Log::Warn( "[SceneManager::loadModel] Model has no vertices: {}", filepath);
+    entt::entity SceneManager::createModel(const ModelData &model, const std::string &filepath) {
+        if (model.vertices.empty()) {
+            Log::Warn( "[SceneManager::createModel] Model has no vertices: {}", filepath);
             return entt::null;
         }
 
@@ -137,9 +95,9 @@ namespace Bcg {
         auto entity = context->registry->create();
 
         // Add mesh component and upload data via Renderer
-        context->registry->emplace<AABBComponent>(entity, aabb_component);
+        context->registry->emplace<AABBComponent>(entity, model.aabb);
         context->registry->emplace<VulkanMeshComponent>(entity);
-        context->rendererSystem->uploadMesh(entity, vertices, indices);
+        context->rendererSystem->uploadMesh(entity, model.vertices, model.indices);
 
         context->cameraFocusEntity = entity; // Set focus to the new model
 
@@ -173,12 +131,15 @@ namespace Bcg {
         if (!context->rendererSystem || !context->rendererSystem->getVulkanContext()) {
             Log::Warn("[SceneManager::clearScene]: Cannot clear GPU resources without Renderer/VulkanContext.");
         } else {
-            VkDevice device = context->rendererSystem->getVulkanContext()->device; // Assuming getter exists
+            auto *vkContext = context->rendererSystem->getVulkanContext();
+            // Copies that are still queued in the staging ring must not land in reused ranges
+            auto &uploader = vkContext->uploader;
+            uploader.wait(uploader.flush());
             auto view = context->registry->view<VulkanMeshComponent>();
             for (auto entity: view) {
                 auto &meshComp = view.get<VulkanMeshComponent>(entity);
-                meshComp.vertexBuffer.destroy(device);
-                meshComp.indexBuffer.destroy(device);
+                vkContext->geometryPool.free(meshComp.geometry); // Ranges are reused once no frame reads them
+                meshComp.geometry = InvalidGeometry;
                 // Also destroy texture resources if managed per-entity
             }
         }
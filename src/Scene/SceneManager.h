@@ -6,8 +6,11 @@
 #define SCENEMANAGER_H
 
 #include <string>
+#include <vector>
 #include <entt/entt.hpp> // Include EnTT registry
 #include "MatVec.h"
+#include "Vertex.h"
+#include "AABBComponent.h"
 
 #include "Manager.h"
 
@@ -15,6 +18,13 @@ namespace Bcg {
     class RendererSystem; // Needs Renderer to upload mesh data
     struct LoadModelEvent; // If handling the event directly
 
+    // CPU side of a loaded model, before it becomes an entity
+    struct ModelData {
+        std::vector<Vertex> vertices;
+        std::vector<uint32_t> indices;
+        AABBComponent aabb;
+    };
+
     class SceneManager : public Manager {
     public:
         // Constructor can optionally take initial registry/renderer references
@@ -32,7 +42,13 @@ namespace Bcg {
         void shutdown() override;
 
         // --- Scene Operations ---
-        entt::entity loadModel(const std::string &filepath);
+        entt::entity loadModel(const std::string &filepath); // parseModel + createModel
+
+        // Reads and deduplicates the OBJ file, touches nothing else and may run on any thread
+        static bool parseModel(const std::string &filepath, ModelData &model);
+
+        // Entity with the model's mesh (uploaded) and bounds, entt::null if it has no vertices
+        entt::entity createModel(const ModelData &model, const std::string &filepath);
 
         void clearScene(); // Destroys all entities and their GPU resources
 
@@ -0,0 +1,248 @@
+//
+// Created by alex on 5/5/25.
+//
+
+#include "EntityInspector.h"
+
+#include <cstdio>
+
+#include "AABBComponent.h"
+#include "CameraComponent.h"
+#include "CameraPathComponent.h"
+#include "Profiler.h"
+#include "RenderComponents.h"
+#include "TransformComponent.h"
+
+namespace Bcg {
+    EntityInspector::EntityInspector() {
+        const char *names[ComponentTypeCount] = {"Transform", "Mesh", "Bounds", "Camera", "CameraPath"};
+        for (uint32_t components = 0; components < m_componentNames.size(); ++components) {
+            for (uint32_t bit = 0; bit < ComponentTypeCount; ++bit) {
+                if (!(components & (1u << bit))) continue;
+                if (!m_componentNames[components].empty()) m_componentNames[components] += ' ';
+                m_componentNames[components] += names[bit];
+            }
+        }
+        m_passes.fill(true);
+    }
+
+    void EntityInspector::attach(entt::registry &registry) {
+        detach();
+        m_registry = &registry;
+        connect<TransformComponent>(registry);
+        connect<VulkanMeshComponent>(registry);
+        connect<AABBComponent>(registry);
+        connect<CameraParametersComponent>(registry);
+        connect<CameraPathComponent>(registry);
+        // The triangle count changes when a mesh is replaced or re-uploaded
+        registry.on_update<VulkanMeshComponent>().connect<&EntityInspector::onChanged>(*this);
+        // Entities created before, queued like new ones
+        indexExisting<TransformComponent>(registry);
+        indexExisting<VulkanMeshComponent>(registry);
+        indexExisting<AABBComponent>(registry);
+        indexExisting<CameraParametersComponent>(registry);
+        indexExisting<CameraPathComponent>(registry);
+    }
+
+    void EntityInspector::detach() {
+        if (!m_registry) return;
+        disconnect<TransformComponent>(*m_registry);
+        disconnect<VulkanMeshComponent>(*m_registry);
+        disconnect<AABBComponent>(*m_registry);
+        disconnect<CameraParametersComponent>(*m_registry);
+        disconnect<CameraPathComponent>(*m_registry);
+        m_registry->on_update<VulkanMeshComponent>().disconnect(this);
+        m_registry = nullptr;
+        m_rows.clear();
+        m_rowOfEntity.clear();
+        m_changed.clear();
+        m_filtered.clear();
+        m_selected = entt::null;
+    }
+
+    void EntityInspector::build() {
+        BCG_PROFILE_FUNCTION();
+        if (!m_registry) {
+            ImGui::TextDisabled("No registry attached.");
+            return;
+        }
+        update();
+
+        if (m_filter.Draw("Filter (\"incl,-excl\")")) rebuildFilter();
+        ImGui::Text("%zu / %zu entities", m_filtered.size(), m_rows.size());
+
+        const ImGuiTableFlags flags = ImGuiTableFlags_ScrollY | ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersOuter;
+        const float height = ImGui::GetTextLineHeightWithSpacing() * 12.0f;
+        if (ImGui::BeginTable("##entities", 3, flags, ImVec2(0.0f, height))) {
+            ImGui::TableSetupScrollFreeze(0, 1);
+            ImGui::TableSetupColumn("Entity", ImGuiTableColumnFlags_WidthFixed);
+            ImGui::TableSetupColumn("Components");
+            ImGui::TableSetupColumn("Triangles", ImGuiTableColumnFlags_WidthFixed);
+            ImGui::TableHeadersRow();
+
+            // Only the rows in the scrolled-to range are submitted
+            ImGuiListClipper clipper;
+            clipper.Begin(static_cast<int>(m_filtered.size()));
+            while (clipper.Step()) {
+                for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i) {
+                    const Row &row = m_rows[m_filtered[i]];
+                    ImGui::TableNextRow();
+                    ImGui::TableNextColumn();
+                    char label[32];
+                    std::snprintf(label, sizeof(label), "%u##%u", static_cast<uint32_t>(entt::to_entity(row.entity)),
+                                  static_cast<uint32_t>(entt::to_integral(row.entity)));
+                    if (ImGui::Selectable(label, row.entity == m_selected, ImGuiSelectableFlags_SpanAllColumns)) {
+                        m_selected = row.entity;
+                    }
+                    ImGui::TableNextColumn();
+                    ImGui::TextUnformatted(m_componentNames[row.components].c_str());
+                    ImGui::TableNextColumn();
+                    if (row.components & Mesh) ImGui::Text("%u", row.triangles);
+                }
+            }
+            ImGui::EndTable();
+        }
+
+        if (m_selected == entt::null || !m_registry->valid(m_selected)) return;
+        // Read live, for the one selected entity
+        ImGui::Separator();
+        ImGui::Text("Entity %u (version %u)", static_cast<uint32_t>(entt::to_entity(m_selected)),
+                    static_cast<uint32_t>(entt::to_version(m_selected)));
+        if (auto *transform = m_registry->try_get<TransformComponent>(m_selected)) {
+            ImGui::Text("Position: (%.2f, %.2f, %.2f)", transform->position.x(), transform->position.y(),
+                        transform->position.z());
+            ImGui::Text("Rotation: %.2f rad about (%.2f, %.2f, %.2f)", transform->rotation.angle(),
+                        transform->rotation.axis().x(), transform->rotation.axis().y(), transform->rotation.axis().z());
+            ImGui::Text("Scale: (%.2f, %.2f, %.2f)", transform->scale.x(), transform->scale.y(), transform->scale.z());
+        }
+        if (auto *bounds = m_registry->try_get<AABBComponent>(m_selected)) {
+            ImGui::Text("Bounds: (%.2f, %.2f, %.2f) - (%.2f, %.2f, %.2f)", bounds->min.x(), bounds->min.y(),
+                        bounds->min.z(), bounds->max.x(), bounds->max.y(), bounds->max.z());
+        }
+        if (auto *mesh = m_registry->try_get<VulkanMeshComponent>(m_selected)) {
+            ImGui::Text("Mesh: %u vertices, %u indices", mesh->vertexCount, mesh->indexCount);
+        }
+        if (auto *camera = m_registry->try_get<CameraParametersComponent>(m_selected)) {
+            ImGui::Text("Camera: (%.2f, %.2f, %.2f) looking at (%.2f, %.2f, %.2f)", camera->position.x(),
+                        camera->position.y(), camera->position.z(), camera->target.x(), camera->target.y(),
+                        camera->target.z());
+        }
+        if (auto *cameraPath = m_registry->try_get<CameraPathComponent>(m_selected)) {
+            ImGui::Text("Camera path: %zu keyframes, at %.2f s%s", cameraPath->keyframes.size(), cameraPath->time,
+                        cameraPath->finished ? ", finished" : "");
+        }
+    }
+
+    template<typename Component>
+    void EntityInspector::connect(entt::registry &registry) {
+        registry.on_construct<Component>().template connect<&EntityInspector::onChanged>(*this);
+        registry.on_destroy<Component>().template connect<&EntityInspector::onChanged>(*this);
+    }
+
+    template<typename Component>
+    void EntityInspector::disconnect(entt::registry &registry) {
+        registry.on_construct<Component>().disconnect(this);
+        registry.on_destroy<Component>().disconnect(this);
+    }
+
+    template<typename Component>
+    void EntityInspector::indexExisting(entt::registry &registry) {
+        for (entt::entity entity: registry.view<Component>()) m_changed.push_back(entity);
+    }
+
+    void EntityInspector::onChanged(entt::registry &, entt::entity entity) {
+        // Deferred: while the component is destroyed it is still attached, while constructed not yet filled in
+        m_changed.push_back(entity);
+    }
+
+    void EntityInspector::update() {
+        if (!m_registry || m_changed.empty()) return;
+        BCG_PROFILE_FUNCTION();
+        for (entt::entity entity: m_changed) {
+            uint32_t row = rowOf(entity);
+            if (row != NoRow && m_rows[row].entity != entity) {
+                removeRow(row); // An earlier version of the entity index
+                row = NoRow;
+            }
+
+            uint32_t components = 0;
+            uint32_t triangles = 0;
+            if (m_registry->valid(entity)) {
+                if (m_registry->all_of<TransformComponent>(entity)) components |= Transform;
+                if (auto *mesh = m_registry->try_get<VulkanMeshComponent>(entity)) {
+                    components |= Mesh;
+                    triangles = mesh->indexCount / 3;
+                }
+                if (m_registry->all_of<AABBComponent>(entity)) components |= Bounds;
+                if (m_registry->all_of<CameraParametersComponent>(entity)) components |= Camera;
+                if (m_registry->all_of<CameraPathComponent>(entity)) components |= CameraPath;
+            }
+
+            if (components == 0) {
+                if (row != NoRow) removeRow(row);
+                if (entity == m_selected) m_selected = entt::null;
+                continue;
+            }
+            if (row == NoRow) {
+                row = static_cast<uint32_t>(m_rows.size());
+                rowOf(entity) = row;
+                m_rows.emplace_back().entity = entity;
+            }
+            m_rows[row].components = components;
+            m_rows[row].triangles = triangles;
+            setFiltered(row, m_passes[components]);
+        }
+        m_changed.clear();
+    }
+
+    void EntityInspector::removeRow(uint32_t row) {
+        setFiltered(row, false);
+        rowOf(m_rows[row].entity) = NoRow;
+        const auto last = static_cast<uint32_t>(m_rows.size() - 1);
+        if (row != last) {
+            m_rows[row] = m_rows[last];
+            rowOf(m_rows[row].entity) = row;
+            if (m_rows[row].filtered != NoRow) m_filtered[m_rows[row].filtered] = row;
+        }
+        m_rows.pop_back();
+    }
+
+    void EntityInspector::setFiltered(uint32_t row, bool passes) {
+        Row &entry = m_rows[row];
+        if (passes == (entry.filtered != NoRow)) return;
+        if (passes) {
+            entry.filtered = static_cast<uint32_t>(m_filtered.size());
+            m_filtered.push_back(row);
+            return;
+        }
+        // Replaced by the last filtered row, the list order changes only where rows leave it
+        const uint32_t position = entry.filtered;
+        const uint32_t moved = m_filtered.back();
+        m_filtered[position] = moved;
+        m_rows[moved].filtered = position;
+        m_filtered.pop_back();
+        entry.filtered = NoRow;
+    }
+
+    void EntityInspector::rebuildFilter() {
+        BCG_PROFILE_FUNCTION();
+        // The filter only sees the component names, decided once per component set
+        for (size_t components = 0; components < m_passes.size(); ++components) {
+            m_passes[components] = m_filter.PassFilter(m_componentNames[components].c_str());
+        }
+        m_filtered.clear();
+        for (uint32_t row = 0; row < m_rows.size(); ++row) {
+            Row &entry = m_rows[row];
+            entry.filtered = NoRow;
+            if (!m_passes[entry.components]) continue;
+            entry.filtered = static_cast<uint32_t>(m_filtered.size());
+            m_filtered.push_back(row);
+        }
+    }
+
+    uint32_t &EntityInspector::rowOf(entt::entity entity) {
+        const auto index = static_cast<size_t>(entt::to_entity(entity));
+        if (index >= m_rowOfEntity.size()) m_rowOfEntity.resize(index + 1, NoRow);
+        return m_rowOfEntity[index];
+    }
+}
@@ -0,0 +1,97 @@
+//
+// Created by alex on 5/5/25.
+//
+
+#ifndef ENTITYINSPECTOR_H
+#define ENTITYINSPECTOR_H
+
+#include <array>
+#include <string>
+#include <vector>
+
+#include <entt/entt.hpp>
+#include <imgui.h>
+
+namespace Bcg {
+    // Scene entity list that stays cheap for millions of entities. The index follows the registry through the
+    // construct and destroy signals of the inspected component types, and the update signal of the mesh for its
+    // triangle count. It is updated once per frame for the entities that changed, the list only builds its visible
+    // rows (ImGuiListClipper). A frame costs O(changed entities + visible rows), only editing the filter scans all
+    // entities.
+    class EntityInspector {
+    public:
+        EntityInspector();
+
+        // Indexes the registry's entities and follows it until detach(), which must be called while the registry
+        // still exists (UIManager::shutdown)
+        void attach(entt::registry &registry);
+
+        void detach();
+
+        // Adds, updates and removes the rows of the entities changed since the last call. Every frame, also while the
+        // list is not shown, so that the queue does not grow.
+        void update();
+
+        // Filter, entity list and the components of the selected entity, inside the current window
+        void build();
+
+        entt::entity getSelected() const { return m_selected; }
+
+        size_t getEntityCount() const { return m_rows.size(); }
+
+    private:
+        // Inspected component types, an entity without any of them is not listed
+        enum ComponentBit : uint32_t {
+            Transform = 1u << 0,
+            Mesh = 1u << 1,
+            Bounds = 1u << 2,
+            Camera = 1u << 3,
+            CameraPath = 1u << 4,
+        };
+
+        static constexpr uint32_t ComponentTypeCount = 5;
+        static constexpr uint32_t NoRow = ~0u;
+
+        // Cached summary of an entity, the text of its component set is shared by all entities with the same set
+        struct Row {
+            entt::entity entity = entt::null;
+            uint32_t components = 0;
+            uint32_t triangles = 0;
+            uint32_t filtered = NoRow; // Position in m_filtered
+        };
+
+        template<typename Component>
+        void connect(entt::registry &registry);
+
+        template<typename Component>
+        void disconnect(entt::registry &registry);
+
+        template<typename Component>
+        void indexExisting(entt::registry &registry);
+
+        // Signal handler, queues the entity for update()
+        void onChanged(entt::registry &registry, entt::entity entity);
+
+        void removeRow(uint32_t row);
+
+        void setFiltered(uint32_t row, bool passes);
+
+        // Rescans all rows, only after the filter text changed
+        void rebuildFilter();
+
+        uint32_t &rowOf(entt::entity entity);
+
+        entt::registry *m_registry = nullptr;
+        std::vector<Row> m_rows; // Dense, removed rows are replaced by the last one
+        std::vector<uint32_t> m_rowOfEntity; // By entity index, NoRow if not listed
+        std::vector<entt::entity> m_changed;
+        std::vector<uint32_t> m_filtered; // Rows passing the filter, in list order
+
+        ImGuiTextFilter m_filter;
+        std::array<std::string, 1u << ComponentTypeCount> m_componentNames; // By component set
+        std::array<bool, 1u << ComponentTypeCount> m_passes{}; // Component set passes the filter
+        entt::entity m_selected = entt::null;
+    };
+}
+
+#endif //ENTITYINSPECTOR_H
@@ -2,7 +2,11 @@
 // Created by alex on 4/9/25.
 //
 
+#include <algorithm>
+#include <cfloat>
+#include <cstdio>
 #include <iostream>
+#include <string_view>
 
 #include <backends/imgui_impl_glfw.h>
 #include <backends/imgui_impl_vulkan.h>
@@ -16,6 +20,9 @@
 #include "WindowManager.h"
 #include "TransformComponent.h"
 #include "UICameraComponent.h"
+#include "ApplicationConfig.h"
+#include "FrameStats.h"
+#include "PerfCounters.h"
 
 namespace Bcg {
     UIManager::~UIManager() {
@@ -33,10 +40,17 @@ namespace Bcg {
         Log::Info("UIManager Initialized.");
         this->context = context;
         initImGui();
+        // Follows the registry from here on, entities are indexed as they are created instead of listed per frame
+        m_entityInspector.attach(*context->registry);
     }
 
     void UIManager::shutdown() {
         Log::Info("UIManager Shutdown.");
+        Log::Info("[UIManager::shutdown] UI built in {} frames ({:.3f} ms each), reused in {} frames ({:.4f} ms each)",
+                  m_builtFrames, m_builtFrames > 0 ? m_builtMilliseconds / static_cast<double>(m_builtFrames) : 0.0,
+                  m_reusedFrames,
+                  m_reusedFrames > 0 ? m_reusedMilliseconds / static_cast<double>(m_reusedFrames) : 0.0);
+        m_entityInspector.detach();
         Log::Info("[UIManager::shuttdown] ImGui GLFW backend Shutdown.");
         ImGui_ImplGlfw_Shutdown();
         // 4. Destroy ImGui Context AFTER Vulkan backend is shut down
@@ -74,6 +88,15 @@ namespace Bcg {
         // --- End ImGui Bindings ---
     }
 
+    void UIManager::buildFontAtlas() {
+        BCG_PROFILE_FUNCTION();
+        unsigned char *pixels = nullptr;
+        int width = 0, height = 0;
+        // The Vulkan backend uploads the atlas built here instead of building it on the main thread
+        ImGui::GetIO().Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+        Log::Info("[UIManager::buildFontAtlas] {}x{} font atlas built.", width, height);
+    }
+
     void UIManager::beginFrame() {
         // --- Start ImGui Frame --- <<< ADD
         ImGui_ImplVulkan_NewFrame();
@@ -88,23 +111,56 @@ namespace Bcg {
         // --- End Render ImGui ---
     }
 
-    void UIManager::recordDrawCommands(VkCommandBuffer commandBuffer) {
+    void UIManager::recordDrawCommands(VkCommandBuffer commandBuffer, ImDrawData *drawData) {
+        if (!drawData) return;
         // --- Render ImGui Draw Data --- <<< ADD (Records ImGui draw commands)
-        ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), commandBuffer);
+        ImGui_ImplVulkan_RenderDrawData(drawData, commandBuffer);
         // --- End Render ImGui Draw Data ---
     }
 
 
-    void UIManager::buildUI() {
-        // Example ImGui Window
+    bool UIManager::update() {
+        // ImGui needs a few frames after an input to settle hover states and layout
+        constexpr uint32_t SettleFrames = 3;
+        auto start = std::chrono::steady_clock::now();
+
+        uint64_t eventCount = context->windowManager->getEventCount();
+        if (eventCount != m_lastEventCount) {
+            m_lastEventCount = eventCount;
+            m_settleFrames = SettleFrames;
+        }
+        const bool cache = !context->config || context->config->uiCache;
+        const double refreshMilliseconds = context->config ? context->config->uiRefreshMilliseconds : 250.0;
+        const bool refresh = std::chrono::duration<double, std::milli>(start - m_lastBuild).count() >=
+                             refreshMilliseconds;
+        if (cache && m_version > 0 && m_settleFrames == 0 && !m_invalid && !refresh) {
+            ++m_reusedFrames;
+            m_reusedMilliseconds += std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - start).count();
+            return false;
+        }
+
+        if (m_settleFrames > 0) --m_settleFrames;
+        m_invalid = false;
+        beginFrame();
+        buildUI();
+        endFrame();
+        ++m_version;
+        m_lastBuild = start;
+        ++m_builtFrames;
+        m_builtMilliseconds += std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start).count();
+        return true;
+    }
 
-        // Uncomment to show the full ImGui demo window
-        ImGui::ShowDemoWindow();
+    void UIManager::buildUI() {
+        if (m_showDemoWindow) ImGui::ShowDemoWindow(&m_showDemoWindow);
 
         ImGui::Begin("Controls"); // Create a window called "Controls"
 
         ImGui::Text("Frame time: %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate,
                     ImGui::GetIO().Framerate);
+        ImGui::Checkbox("ImGui demo", &m_showDemoWindow);
 
 
         if (ImGui::CollapsingHeader("Camera State", ImGuiTreeNodeFlags_DefaultOpen)) {
@@ -115,29 +171,275 @@ namespace Bcg {
         } // End CollapsingHeader
 
 
+        if (ImGui::CollapsingHeader("GPU Memory")) {
+            auto stats = context->rendererSystem->getVulkanContext()->memoryAllocator.getStats();
+            ImGui::Text("Allocations: %u (%u blocks, %u dedicated)", stats.allocationCount, stats.blockCount,
+                        stats.dedicatedCount);
+            ImGui::Text("vkAllocateMemory calls: %u", stats.deviceAllocationCount);
+            ImGui::Text("Used: %.2f / %.2f MiB", stats.usedBytes / (1024.0 * 1024.0),
+                        stats.reservedBytes / (1024.0 * 1024.0));
+            ImGui::ProgressBar(stats.utilization(), ImVec2(-1.0f, 0.0f), "Utilization");
+            ImGui::Text("Largest free range: %.2f MiB", stats.largestFreeRange / (1024.0 * 1024.0));
+            ImGui::Text("Fragmentation: %.3f", stats.fragmentation);
+
+            auto geometry = context->rendererSystem->getVulkanContext()->geometryPool.getStats();
+            ImGui::Separator();
+            ImGui::Text("Geometry Pool");
+            ImGui::Text("Meshes: %u", geometry.meshCount);
+            ImGui::Text("Vertices: %llu / %llu (frag %.3f)", static_cast<unsigned long long>(geometry.vertexUsed),
+                        static_cast<unsigned long long>(geometry.vertexCapacity), geometry.vertexFragmentation);
+            ImGui::Text("Indices: %llu / %llu (frag %.3f)", static_cast<unsigned long long>(geometry.indexUsed),
+                        static_cast<unsigned long long>(geometry.indexCapacity), geometry.indexFragmentation);
+            ImGui::Text("Compactions: %u, growths: %u", geometry.compactions, geometry.growths);
+        }
+
+        if (ImGui::CollapsingHeader("Culling")) {
+            auto &culling = context->rendererSystem->getGpuCulling();
+            ImGui::Checkbox("GPU frustum culling", &culling.enabled);
+            ImGui::Checkbox("Validate against CPU", &culling.validate);
+            const auto &stats = culling.getStats();
+            ImGui::Text("Visible: %u / %u", stats.visibleCount, stats.objectCount);
+            ImGui::Text("Validated frames: %u (%u mismatched, last %u)", stats.validatedFrames,
+                        stats.mismatchedFrames, stats.lastMismatches);
+        }
+
+        if (ImGui::CollapsingHeader("Views")) {
+            // Several views are culled on the CPU once for all of them, GPU culling applies to a single view
+            auto *cameraSystem = context->cameraSystem.get();
+            int layout = static_cast<int>(cameraSystem->getViewLayout());
+            if (ImGui::Combo("Layout", &layout, "Single\0Side by side\0Quad\0")) {
+                cameraSystem->setViewLayout(static_cast<ViewLayout>(layout));
+            }
+            const auto *renderer = context->rendererSystem.get();
+            for (uint32_t view = 0; view < renderer->getViewCount(); ++view) {
+                ImGui::Text("View %u visible: %u", view, renderer->getViewVisibleCount(view));
+            }
+        }
+
+        if (ImGui::CollapsingHeader("Frame Statistics")) {
+            buildFrameStats();
+        }
+
+        if (ImGui::CollapsingHeader("Performance Counters")) {
+            buildPerfCounters();
+        }
+
+        if (ImGui::CollapsingHeader("CPU Profiler")) {
+            buildFlameGraph();
+        }
+
+        if (ImGui::CollapsingHeader("GPU Profiler")) {
+            // Results are MAX_FRAMES_IN_FLIGHT frames old, they are read once the frame's fence was waited
+            auto &profiler = context->rendererSystem->getGpuProfiler();
+            ImGui::Checkbox("Enabled", &profiler.enabled);
+            if (!profiler.isTimestampSupported()) {
+                ImGui::TextDisabled("Timestamps are not supported on the graphics queue.");
+            }
+            for (const auto &history: profiler.getHistory()) {
+                char overlay[64];
+                std::snprintf(overlay, sizeof(overlay), "avg %.3f ms", history.average);
+                ImGui::PlotLines(history.name.c_str(), history.milliseconds.data(),
+                                 static_cast<int>(history.milliseconds.size()), static_cast<int>(history.offset),
+                                 overlay, 0.0f, FLT_MAX, ImVec2(0.0f, 40.0f));
+            }
+
+            const auto &profile = profiler.getLastProfile();
+            if (profile.hasStatistics) {
+                const auto &statistics = profile.statistics;
+                ImGui::Separator();
+                ImGui::Text("Scene pass statistics (frame %llu)", static_cast<unsigned long long>(profile.frame));
+                ImGui::Text("IA vertices: %llu", static_cast<unsigned long long>(statistics.inputAssemblyVertices));
+                ImGui::Text("IA primitives: %llu",
+                            static_cast<unsigned long long>(statistics.inputAssemblyPrimitives));
+                ImGui::Text("VS invocations: %llu",
+                            static_cast<unsigned long long>(statistics.vertexShaderInvocations));
+                ImGui::Text("Clipping: %llu in, %llu out",
+                            static_cast<unsigned long long>(statistics.clippingInvocations),
+                            static_cast<unsigned long long>(statistics.clippingPrimitives));
+                ImGui::Text("FS invocations: %llu",
+                            static_cast<unsigned long long>(statistics.fragmentShaderInvocations));
+            } else if (!profiler.isStatisticsSupported()) {
+                ImGui::TextDisabled("Pipeline statistics queries are not supported.");
+            }
+        }
+
+        if (ImGui::CollapsingHeader("Shading")) {
+            // Every combination is its own shader variant, the pipeline is rebuilt on change
+            auto *vkContext = context->rendererSystem->getVulkanContext();
+            int lighting = vkContext->meshVariant.get("kLightingModel");
+            bool vertexColors = vkContext->meshVariant.get("kVertexColors") != 0;
+            const char *lightingModels[] = {"Unlit", "Lambert", "Blinn-Phong"};
+            bool changed = ImGui::Combo("Lighting", &lighting, lightingModels, IM_ARRAYSIZE(lightingModels));
+            changed |= ImGui::Checkbox("Vertex colors", &vertexColors);
+            if (changed) {
+                vkContext->setMeshVariant(ShaderVariant::mesh(static_cast<LightingModel>(lighting), vertexColors));
+            }
+        }
+
         if (ImGui::CollapsingHeader("Scene")) {
             // Example: Button to reload model
             if (ImGui::Button("Reload Star Model")) {
-                std::cout << "Waiting for GPU idle before reloading model..." << std::endl;
-                VK_CHECK(vkDeviceWaitIdle(context->rendererSystem->getVulkanContext()->device));
-                std::cout << "GPU idle. Proceeding with reload." << std::endl;
+                // The GPU wait, the clear and the load run deferred, within the event budget of a later frame
+                LoadModelEvent event{"models/star.obj"};
+                event.replaceScene = true;
+                context->eventBus->publish(event);
+            }
+            ImGui::Text("Queued events: %zu", context->eventBus->getPendingCount());
+            // Add other scene controls here
+        }
+
+        m_entityInspector.update();
+        if (ImGui::CollapsingHeader("Entities")) {
+            m_entityInspector.build();
+        }
+
+        // TODO: Add controls for lights, materials etc.
+
+        ImGui::End(); // End the window
+    }
+
+    void UIManager::buildFrameStats() {
+        constexpr size_t Window = 600; // Percentiles over the last frames, the exit report uses the whole ring
+        constexpr int PlotFrames = 240;
+        auto &stats = *context->frameStats;
+
+        const size_t plotCount = std::min<size_t>(PlotFrames, stats.getWindowSize());
+        auto newestLast = [](void *data, int i) {
+            auto &frameStats = *static_cast<FrameStats *>(data);
+            size_t count = std::min<size_t>(PlotFrames, frameStats.getWindowSize());
+            return frameStats.getRecent(FrameMetric::Cpu, count - 1 - static_cast<size_t>(i));
+        };
+        ImGui::PlotLines("CPU ms", newestLast, &stats, static_cast<int>(plotCount), 0, nullptr, 0.0f, FLT_MAX,
+                         ImVec2(0.0f, 60.0f));
+
+        ImGui::Text("%-11s %8s %8s %8s %8s", "ms", "p50", "p95", "p99", "max");
+        for (uint32_t i = 0; i < static_cast<uint32_t>(FrameMetric::Count); ++i) {
+            auto metric = static_cast<FrameMetric>(i);
+            FrameTimeSummary summary = stats.summarize(metric, Window);
+            ImGui::Text("%-11s %8.3f %8.3f %8.3f %8.3f", toString(metric), summary.p50, summary.p95, summary.p99,
+                        summary.max);
+        }
 
-                if (context->sceneManager) context->sceneManager->clearScene(); // Use SceneManager to clear
-                context->cameraFocusEntity = entt::null; // Reset focus state in Application
+        ImGui::Separator();
+        ImGui::Text("Frames: %llu", static_cast<unsigned long long>(stats.getFrameCount()));
+        ImGui::Text("Hitches (> %.1fx average): %llu", stats.hitchFactor,
+                    static_cast<unsigned long long>(stats.getHitchCount()));
+        ImGui::Text("Over budget (> %.2f ms): %llu", stats.budgetMilliseconds,
+                    static_cast<unsigned long long>(stats.getOverBudgetCount()));
+        const ActivityTime &interactive = stats.getActivity(false);
+        const ActivityTime &idle = stats.getActivity(true);
+        ImGui::Text("CPU: %.1f%% interactive (%.0f s), %.1f%% idle (%.0f s)", interactive.cpuPercent(),
+                    interactive.seconds, idle.cpuPercent(), idle.seconds);
+        if (ImGui::Button("Reset")) stats.reset();
 
-                // Trigger load event
-                context->dispatcher->trigger<LoadModelEvent>({"models/star.obj"}); // Assuming LoadModelEvent exists
+        // Built: after input or for a refresh, reused: static, no build, no upload and no recording
+        ImGui::Separator();
+        auto average = [](double milliseconds, uint64_t frames) {
+            return frames > 0 ? milliseconds / static_cast<double>(frames) : 0.0;
+        };
+        ImGui::Text("UI built: %llu frames, %.3f ms each", static_cast<unsigned long long>(m_builtFrames),
+                    average(m_builtMilliseconds, m_builtFrames));
+        ImGui::Text("UI reused: %llu frames, %.4f ms each", static_cast<unsigned long long>(m_reusedFrames),
+                    average(m_reusedMilliseconds, m_reusedFrames));
+        const auto *renderer = context->rendererSystem.get();
+        ImGui::Text("UI recorded: %llu of %llu rendered frames",
+                    static_cast<unsigned long long>(renderer->getUiRecordCount()),
+                    static_cast<unsigned long long>(renderer->getUiFrameCount()));
+    }
+
+    void UIManager::buildPerfCounters() {
+        const size_t frames = PerfCounters::getHistorySize();
+        if (frames == 0) {
+            ImGui::TextDisabled("No frame counted yet.");
+            return;
+        }
+        auto newestLast = [](void *data, int i) {
+            auto counter = *static_cast<PerfCounter *>(data);
+            size_t age = PerfCounters::getHistorySize() - 1 - static_cast<size_t>(i);
+            return static_cast<float>(PerfCounters::getRecent(counter, age));
+        };
+        for (uint32_t i = 0; i < PerfCounters::CounterCount; ++i) {
+            auto counter = static_cast<PerfCounter>(i);
+            uint64_t sum = 0;
+            for (size_t age = 0; age < frames; ++age) sum += PerfCounters::getRecent(counter, age);
+            char overlay[64];
+            std::snprintf(overlay, sizeof(overlay), "last %llu, avg %.1f",
+                          static_cast<unsigned long long>(PerfCounters::getLast(counter)),
+                          static_cast<double>(sum) / static_cast<double>(frames));
+            ImGui::PlotLines(toString(counter), newestLast, &counter, static_cast<int>(frames), 0, overlay, 0.0f,
+                             FLT_MAX, ImVec2(0.0f, 40.0f));
+        }
 
-                auto transform = context->registry->try_get<TransformComponent>(context->cameraFocusEntity);
-                auto camera = context->cameraSystem->getCurrentCamera();
-                camera->target = transform->position;
-                camera->dirtyView = true;
+        // Share of the tested objects the culling rejected
+        auto efficiency = [](void *, int i) {
+            size_t age = PerfCounters::getHistorySize() - 1 - static_cast<size_t>(i);
+            uint64_t tested = PerfCounters::getRecent(PerfCounter::CullingTested, age);
+            uint64_t visible = PerfCounters::getRecent(PerfCounter::CullingVisible, age);
+            return tested > 0 ? 1.0f - static_cast<float>(visible) / static_cast<float>(tested) : 0.0f;
+        };
+        char overlay[64];
+        const auto newest = static_cast<int>(frames) - 1;
+        std::snprintf(overlay, sizeof(overlay), "last %.1f%% culled", 100.0f * efficiency(nullptr, newest));
+        ImGui::PlotLines("culling_efficiency", efficiency, nullptr, static_cast<int>(frames), 0, overlay, 0.0f, 1.0f,
+                         ImVec2(0.0f, 40.0f));
+    }
+
+    void UIManager::buildFlameGraph() {
+        bool enabled = Profiler::isEnabled();
+        if (ImGui::Checkbox("Record", &enabled)) Profiler::setEnabled(enabled);
+        ImGui::SameLine();
+        ImGui::Checkbox("Pause", &m_pauseFlameGraph);
+        ImGui::SameLine();
+        if (ImGui::Button("Write trace")) {
+            std::string path = context->config && !context->config->tracePath.empty()
+                                   ? context->config->tracePath
+                                   : "trace.json";
+            if (Profiler::writeChromeTrace(path)) {
+                Log::Info("[UIManager::buildFlameGraph] Wrote CPU trace to {}", path);
+            } else {
+                Log::Error("[UIManager::buildFlameGraph] Cannot write CPU trace to {}", path);
             }
-            // Add other scene controls here
         }
 
-        // TODO: Add controls for lights, materials, entity selection/properties etc.
+        if (!m_pauseFlameGraph) Profiler::getLastFrame(m_flameEvents, m_flameStart, m_flameEnd);
+        if (m_flameEnd <= m_flameStart) {
+            ImGui::TextDisabled("No frame recorded yet.");
+            return;
+        }
+        ImGui::Text("Main thread, previous frame: %.3f ms", Profiler::ticksToMilliseconds(m_flameEnd - m_flameStart));
 
-        ImGui::End(); // End the window
+        uint32_t maxDepth = 0;
+        for (const auto &event: m_flameEvents) maxDepth = std::max(maxDepth, event.depth);
+
+        const float rowHeight = ImGui::GetTextLineHeightWithSpacing();
+        const ImVec2 origin = ImGui::GetCursorScreenPos();
+        const float width = std::max(ImGui::GetContentRegionAvail().x, 1.0f);
+        ImGui::InvisibleButton("##flameGraph", ImVec2(width, rowHeight * static_cast<float>(maxDepth + 1)));
+        const bool hovered = ImGui::IsItemHovered();
+        const ImVec2 mouse = ImGui::GetIO().MousePos;
+
+        ImDrawList *drawList = ImGui::GetWindowDrawList();
+        const double scale = width / static_cast<double>(m_flameEnd - m_flameStart);
+        for (const auto &event: m_flameEvents) {
+            uint64_t end = std::min(event.end, m_flameEnd);
+            ImVec2 min(origin.x + static_cast<float>(static_cast<double>(event.start - m_flameStart) * scale),
+                       origin.y + rowHeight * static_cast<float>(event.depth));
+            ImVec2 max(std::max(origin.x + static_cast<float>(static_cast<double>(end - m_flameStart) * scale),
+                                min.x + 1.0f), min.y + rowHeight - 1.0f);
+
+            // Stable color per scope name
+            size_t hash = std::hash<std::string_view>()(event.name ? event.name : "");
+            float hue = static_cast<float>(hash % 360) / 360.0f;
+            drawList->AddRectFilled(min, max, ImColor::HSV(hue, 0.45f, 0.75f));
+            if (event.name && max.x - min.x > 8.0f) {
+                drawList->PushClipRect(min, max, true);
+                drawList->AddText(ImVec2(min.x + 2.0f, min.y), IM_COL32(0, 0, 0, 255), event.name);
+                drawList->PopClipRect();
+            }
+            if (hovered && mouse.x >= min.x && mouse.x < max.x && mouse.y >= min.y && mouse.y < max.y) {
+                ImGui::SetTooltip("%s: %.3f ms", event.name ? event.name : "?",
+                                  Profiler::ticksToMilliseconds(event.end - event.start));
+            }
+        }
     }
 }
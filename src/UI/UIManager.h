@@ -6,8 +6,13 @@
 #define UIMANAGER_H
 
 #include "Manager.h"
+#include "EntityInspector.h"
+#include "Profiler.h"
+#include <chrono>
 #include <vulkan/vulkan_core.h>
 
+struct ImDrawData;
+
 namespace Bcg {
     class Application;
     class UIManager : public Manager {
@@ -22,13 +27,57 @@ namespace Bcg {
 
         void initGLFWBackend();
 
+        // Rasterizes the fonts on the CPU, may run on a worker thread while nothing else uses ImGui
+        void buildFontAtlas();
+
         void beginFrame();
 
         void endFrame();
 
-        void recordDrawCommands(VkCommandBuffer commandBuffer);
+        // drawData is ImGui::GetDrawData() or a copy captured by the simulation thread
+        void recordDrawCommands(VkCommandBuffer commandBuffer, ImDrawData *drawData);
 
         void buildUI();
+
+        // Builds the UI (beginFrame, buildUI, endFrame) unless it is static: no window event since the last build
+        // or the frames after it, config.uiRefreshMilliseconds not elapsed and no invalidate(). Otherwise ImGui's
+        // draw data of the last build stays current. False if the UI was not built.
+        bool update();
+
+        // Rebuild in the next update(), for changes not caused by window events
+        void invalidate() { m_invalid = true; }
+
+        // Of ImGui's current draw data, counts the builds from 1
+        uint64_t getVersion() const { return m_version; }
+
+    private:
+        // Percentiles of the CPU frame time and the frame's waits, hitch counts
+        void buildFrameStats();
+
+        // Scopes of the last main loop iteration as nested bars, hover for durations
+        void buildFlameGraph();
+
+        // History of every work counter and the culling efficiency derived from them
+        void buildPerfCounters();
+
+        std::vector<ProfileEvent> m_flameEvents;
+        uint64_t m_flameStart = 0;
+        uint64_t m_flameEnd = 0;
+        bool m_pauseFlameGraph = false;
+        bool m_showDemoWindow = false;
+
+        // Static UI detection and the CPU time of update() when it built the UI and when it reused it
+        uint64_t m_version = 0;
+        uint64_t m_lastEventCount = 0;
+        uint32_t m_settleFrames = 0;
+        bool m_invalid = false;
+        std::chrono::steady_clock::time_point m_lastBuild;
+        uint64_t m_builtFrames = 0;
+        uint64_t m_reusedFrames = 0;
+        double m_builtMilliseconds = 0.0;
+        double m_reusedMilliseconds = 0.0;
+
+        EntityInspector m_entityInspector;
     };
 }
 
@@ -0,0 +1,38 @@
+//
+// Created by alex on 5/5/25.
+//
+
+#include "UiDrawData.h"
+
+namespace Bcg {
+    UiDrawData::~UiDrawData() {
+        for (auto *list: m_lists) IM_DELETE(list);
+    }
+
+    void UiDrawData::capture(uint64_t version) {
+        if (version != 0 && version == m_version) return;
+        m_version = version;
+        ImDrawData *source = ImGui::GetDrawData();
+        m_valid = source != nullptr && source->Valid;
+        if (!m_valid) return;
+
+        // Everything but the lists: display rectangle, scale, counts
+        m_data = *source;
+        const auto count = static_cast<size_t>(source->CmdListsCount);
+        while (m_lists.size() < count) m_lists.push_back(IM_NEW(ImDrawList)(ImGui::GetDrawListSharedData()));
+        for (size_t i = 0; i < count; ++i) {
+            const ImDrawList *list = source->CmdLists[static_cast<int>(i)];
+            // Only what the renderer backends read
+            m_lists[i]->CmdBuffer = list->CmdBuffer;
+            m_lists[i]->IdxBuffer = list->IdxBuffer;
+            m_lists[i]->VtxBuffer = list->VtxBuffer;
+            m_lists[i]->Flags = list->Flags;
+        }
+#if IMGUI_VERSION_NUM >= 18980
+        m_data.CmdLists.resize(0);
+        for (size_t i = 0; i < count; ++i) m_data.CmdLists.push_back(m_lists[i]);
+#else
+        m_data.CmdLists = m_lists.data();
+#endif
+    }
+}
@@ -0,0 +1,41 @@
+//
+// Created by alex on 5/5/25.
+//
+
+#ifndef UIDRAWDATA_H
+#define UIDRAWDATA_H
+
+#include <cstdint>
+#include <vector>
+
+#include <imgui.h>
+
+namespace Bcg {
+    // Copy of ImGui's draw data after ImGui::Render(), so that the render thread can record it while the next UI
+    // frame is built. The draw lists are kept and only their buffers are copied, which reuses their allocations.
+    class UiDrawData {
+    public:
+        UiDrawData() = default;
+
+        ~UiDrawData();
+
+        UiDrawData(const UiDrawData &) = delete;
+
+        UiDrawData &operator=(const UiDrawData &) = delete;
+
+        // Copies ImGui::GetDrawData() unless this copy already is of the version (UIManager::getVersion()), call on
+        // the thread that owns the ImGui context
+        void capture(uint64_t version);
+
+        // nullptr before the first capture or if ImGui rendered nothing
+        ImDrawData *get() { return m_valid ? &m_data : nullptr; }
+
+    private:
+        ImDrawData m_data;
+        std::vector<ImDrawList *> m_lists;
+        bool m_valid = false;
+        uint64_t m_version = 0;
+    };
+}
+
+#endif //UIDRAWDATA_H
@@ -1,8 +1,21 @@
 #include <iostream>
 #include "Application.h"
+#include "ApplicationConfig.h"
 
-int main() {
-    Bcg::Application app;
+int main(int argc, char **argv) {
+    Bcg::ApplicationConfig config;
+    try {
+        config = Bcg::ApplicationConfig::fromCommandLine(argc, argv);
+    } catch (const std::invalid_argument &e) {
+        std::cerr << e.what() << "\n\n" << Bcg::ApplicationConfig::usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (config.showHelp) {
+        std::cout << Bcg::ApplicationConfig::usage(argv[0]);
+        return EXIT_SUCCESS;
+    }
+
+    Bcg::Application app(config);
 
     try {
         app.run();
@@ -16,4 +29,4 @@ int main() {
 
 
     return EXIT_SUCCESS;
-}
\ No newline at end of file
+}